@@ -0,0 +1,172 @@
+/**
+ * @brief Host check of the picow_timer ADC filter
+ *
+ * Feeds synthetic sample blocks through picow_timer/src/adc_filter.c
+ * and checks decimation, the median, spike rejection, hysteresis on a
+ * noisy resting knob and the knob-to-publish latency in blocks (1 ms
+ * each on the target).
+ *
+ * Usage:
+ *
+ *   adc_filter_check [-v]
+ *
+ * Exits with 1 if any check fails.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "adc_filter.h"
+
+// same as picow_timer/src/main.c
+#define ADC_THRESHOLD 128
+
+static bool verbose = false;
+static unsigned int checks = 0;
+static unsigned int failures = 0;
+
+static void check(bool ok, const char *name, long got, long expected) {
+    checks++;
+    if (!ok) {
+        printf("FAIL %s: got %ld, expected %ld\n", name, got, expected);
+        failures++;
+    } else if (verbose) {
+        printf("ok   %s: %ld\n", name, got);
+    }
+}
+
+// small LCG, the same noise on every run
+static uint32_t noise_state = 1;
+static int noise(int amplitude) {
+    noise_state = noise_state * 1664525u + 1013904223u;
+    return (int) ((noise_state >> 16) % (2 * amplitude + 1)) - amplitude;
+}
+
+/**
+ * Fill a block around a 12-bit level with +-amplitude noise
+ *
+ * @return void
+ */
+static void fill(uint16_t *block, int level, int amplitude) {
+    for (unsigned int i = 0; i < ADC_FILTER_OVERSAMPLE; i++) {
+        int v = level + (amplitude ? noise(amplitude) : 0);
+        block[i] = v < 0 ? 0 : v > 4095 ? 4095 : v;
+    }
+}
+
+static void check_decimate(void) {
+    uint16_t block[ADC_FILTER_OVERSAMPLE];
+
+    fill(block, 0, 0);
+    check(adc_filter_decimate(block) == 0, "decimate zero", adc_filter_decimate(block), 0);
+    fill(block, 4095, 0);
+    check(adc_filter_decimate(block) == 65520, "decimate full scale", adc_filter_decimate(block), 65520);
+    fill(block, 2048, 0);
+    check(adc_filter_decimate(block) == 32768, "decimate mid scale", adc_filter_decimate(block), 32768);
+
+    // alternating 2048/2049 averages to half an LSB, kept by the extra bits
+    for (unsigned int i = 0; i < ADC_FILTER_OVERSAMPLE; i++) block[i] = 2048 + (i & 1);
+    check(adc_filter_decimate(block) == 32776, "decimate sub-LSB", adc_filter_decimate(block), 32776);
+
+    // the error flag bit must not leak into the sum
+    fill(block, 100, 0);
+    block[0] |= 0x8000;
+    check(adc_filter_decimate(block) == 1600, "decimate error bit", adc_filter_decimate(block), 1600);
+}
+
+static void check_median(void) {
+    static const uint16_t cases[][ADC_FILTER_MEDIAN + 1] = {
+        {1, 2, 3, 4, 5, 3},
+        {5, 4, 3, 2, 1, 3},
+        {9, 1, 9, 1, 5, 5},
+        {7, 7, 7, 7, 7, 7},
+        {0, 65535, 100, 200, 300, 200},
+        {65535, 65535, 0, 0, 1, 1},
+    };
+
+    for (unsigned int i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        uint16_t median = adc_filter_median(cases[i]);
+        check(median == cases[i][ADC_FILTER_MEDIAN], "median", median, cases[i][ADC_FILTER_MEDIAN]);
+    }
+}
+
+static void check_update(void) {
+    uint16_t block[ADC_FILTER_OVERSAMPLE];
+    adc_filter_t filter;
+    uint16_t value = 0;
+    unsigned int published = 0;
+
+    // nothing until the median window is full
+    adc_filter_init(&filter, ADC_THRESHOLD);
+    fill(block, 1000, 0);
+    for (unsigned int i = 0; i < ADC_FILTER_MEDIAN - 1; i++) {
+        published += adc_filter_update(&filter, block, &value);
+    }
+    check(published == 0, "quiet while filling", published, 0);
+    published = adc_filter_update(&filter, block, &value);
+    check(published && value == 16000, "first value", value, 16000);
+
+    // a single spike block is voted out by the median
+    fill(block, 4095, 0);
+    published = adc_filter_update(&filter, block, &value);
+    fill(block, 1000, 0);
+    for (unsigned int i = 0; i < ADC_FILTER_MEDIAN; i++) {
+        published += adc_filter_update(&filter, block, &value);
+    }
+    check(published == 0, "spike rejected", published, 0);
+
+    // a resting knob with +-16 LSB of noise never publishes
+    published = 0;
+    for (unsigned int i = 0; i < 10000; i++) {
+        fill(block, 1000, 16);
+        published += adc_filter_update(&filter, block, &value);
+    }
+    check(published == 0, "noisy resting knob", published, 0);
+
+    // a real move is published within half the median window
+    fill(block, 3000, 16);
+    unsigned int latency = 0;
+    while (!adc_filter_update(&filter, block, &value) && latency < 100) {
+        latency++;
+        fill(block, 3000, 16);
+    }
+    latency++;
+    check(latency <= ADC_FILTER_MEDIAN / 2 + 1, "step latency (blocks)", latency, ADC_FILTER_MEDIAN / 2 + 1);
+    check(value > 48000 - ADC_THRESHOLD && value < 48000 + ADC_THRESHOLD, "step value", value, 48000);
+
+    // a slow sweep publishes in threshold sized steps, never more often
+    published = 0;
+    uint16_t last = value;
+    bool steps_ok = true;
+    for (int level = 3000; level >= 1000; level--) {
+        fill(block, level, 0);
+        if (adc_filter_update(&filter, block, &value)) {
+            uint16_t delta = last > value ? last - value : value - last;
+            steps_ok &= delta > ADC_THRESHOLD;
+            last = value;
+            published++;
+        }
+    }
+    check(steps_ok, "sweep steps above threshold", published, published);
+    check(published > 0 && published <= 32000 / ADC_THRESHOLD, "sweep publishes", published, 32000 / ADC_THRESHOLD);
+}
+
+int main(int argc, char **argv) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "v")) != -1) {
+        switch (opt) {
+            case 'v': verbose = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    check_decimate();
+    check_median();
+    check_update();
+
+    printf("adc_filter_check: %u checks, %u failures\n", checks, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,321 @@
+/**
+ * @brief Host runner for the picow_test benchmarks
+ *
+ * Asks the board for a run, collects the lib/bench result lines and
+ * prints cycles per operation. Given a baseline it compares the
+ * medians and fails on a regression.
+ *
+ * Usage:
+ *
+ *   bench_runner [-b baseline] [-s save] [-t percent] [device|file]
+ *   bench_runner selftest
+ *
+ * - device: sends 'r' and reads until "bench-end" (stdin if none given)
+ * - -b: results of an earlier run, saved with -s
+ * - -t: allowed median increase before it counts as a regression, default 10
+ *
+ * Exits with 1 if a case regressed or went missing.
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include "bench.h"
+
+#define MAX_RESULTS 64
+// give up on a board that stops talking
+#define READ_TIMEOUT_MS 30000
+
+typedef struct {
+    bench_result_t results[MAX_RESULTS];
+    size_t count;
+    unsigned long clk;
+    bool complete;
+} run_t;
+
+/**
+ * Take one line of board output
+ *
+ * @param run
+ * @param line
+ *
+ * @return void
+ */
+static void run_add_line(run_t *run, const char *line) {
+    unsigned long clk;
+
+    if (sscanf(line, "bench-begin clk=%lu", &clk) == 1) {
+        // only keep the latest run
+        run->count = 0;
+        run->clk = clk;
+        run->complete = false;
+    } else if (!strncmp(line, "bench-end", 9)) {
+        run->complete = true;
+    } else if (run->count < MAX_RESULTS && bench_parse(line, &run->results[run->count])) {
+        run->count++;
+    }
+}
+
+/**
+ * Read a run from a device (after asking for one) or a file
+ *
+ * @param path - NULL for stdin
+ * @param run
+ *
+ * @return bool - false if it couldn't be opened or no run arrived
+ */
+static bool run_read(const char *path, run_t *run) {
+    int fd = path ? open(path, O_RDWR | O_NOCTTY) : STDIN_FILENO;
+    if (fd < 0 && path) fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+
+    struct termios tio;
+    if (isatty(fd) && tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+        tcflush(fd, TCIFLUSH);
+        // start a run now instead of waiting for the next interval
+        if (write(fd, "r", 1) != 1) perror("write");
+    }
+
+    memset(run, 0, sizeof(*run));
+
+    char line[256];
+    size_t len = 0;
+    struct pollfd pfd = {fd, POLLIN, 0};
+
+    while (!run->complete && poll(&pfd, 1, READ_TIMEOUT_MS) > 0) {
+        char c;
+        if (read(fd, &c, 1) != 1) break;
+
+        if (c == '\n') {
+            line[len] = 0;
+            if (len && line[len - 1] == '\r') line[len - 1] = 0;
+            run_add_line(run, line);
+            len = 0;
+        } else if (len < sizeof(line) - 1) {
+            line[len++] = c;
+        }
+    }
+
+    if (path) close(fd);
+    return run->count > 0;
+}
+
+/**
+ * Save a run in the format the board prints, usable as a baseline
+ *
+ * @param path
+ * @param run
+ *
+ * @return bool
+ */
+static bool run_save(const char *path, const run_t *run) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+
+    char line[BENCH_LINE_MAX];
+    fprintf(file, "bench-begin clk=%lu\n", run->clk);
+    for (size_t i = 0; i < run->count; i++) {
+        bench_format(line, sizeof(line), &run->results[i]);
+        fprintf(file, "%s\n", line);
+    }
+    fprintf(file, "bench-end\n");
+
+    fclose(file);
+    return true;
+}
+
+static const bench_result_t *run_find(const run_t *run, const char *name) {
+    for (size_t i = 0; i < run->count; i++) {
+        if (!strcmp(run->results[i].name, name)) return &run->results[i];
+    }
+    return NULL;
+}
+
+/**
+ * Print a run, compared against a baseline if there is one
+ *
+ * @param run
+ * @param baseline - NULL for none
+ * @param threshold - allowed median increase in percent
+ *
+ * @return int - number of regressed or missing cases
+ */
+static int run_report(const run_t *run, const run_t *baseline, double threshold) {
+    int regressions = 0;
+
+    printf("%-24s %5s %10s %10s %10s %9s", "case", "ops", "min/op", "median/op", "p99/op", "ns/op");
+    if (baseline) printf(" %10s %8s", "baseline", "change");
+    printf("\n");
+
+    for (size_t i = 0; i < run->count; i++) {
+        const bench_result_t *result = &run->results[i];
+        double ops = result->ops;
+        double median = result->median / ops;
+
+        printf("%-24s %5lu %10.2f %10.2f %10.2f %9.1f", result->name, (unsigned long) result->ops,
+               result->min / ops, median, result->p99 / ops, run->clk ? median * 1e9 / run->clk : 0);
+
+        const bench_result_t *base = baseline ? run_find(baseline, result->name) : NULL;
+        if (base) {
+            double base_median = base->median / (double) base->ops;
+            double change = base_median ? (median - base_median) * 100 / base_median : 0;
+            bool regressed = change > threshold;
+
+            printf(" %10.2f %+7.1f%%%s", base_median, change, regressed ? "  REGRESSED" : "");
+            if (regressed) regressions++;
+        } else if (baseline) {
+            printf(" %10s", "new");
+        }
+        printf("\n");
+    }
+
+    if (baseline) {
+        for (size_t i = 0; i < baseline->count; i++) {
+            if (!run_find(run, baseline->results[i].name)) {
+                printf("%-24s missing from this run\n", baseline->results[i].name);
+                regressions++;
+            }
+        }
+    }
+
+    return regressions;
+}
+
+//
+// selftest: the harness on the host, through format, parse and compare
+//
+
+static volatile uint32_t sink;
+
+static uint32_t sum_run(void) {
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < 1000; i++) total += i * sink;
+    sink = total;
+    return 0;
+}
+
+static uint32_t fixed_run(void) {
+    return 1234;
+}
+
+static int selftest(void) {
+    const bench_case_t cases[] = {
+        {"sum_1000", NULL, sum_run, NULL, 1000, 0},
+        {"self_timed", NULL, fixed_run, NULL, 1, BENCH_SELF_TIMED},
+    };
+    int failures = 0;
+    bench_t bench;
+    run_t run = {0};
+    char line[BENCH_LINE_MAX];
+
+    bench_init(&bench, 4, 101);
+    bench_calibrate(&bench);
+    run_add_line(&run, "noise before the run");
+    run_add_line(&run, "bench-begin clk=1000000000");
+
+    for (size_t i = 0; i < 2; i++) {
+        bench_result_t result;
+        bench_run(&bench, &cases[i], &result);
+        bench_format(line, sizeof(line), &result);
+        run_add_line(&run, line);
+    }
+    run_add_line(&run, "bench-end");
+
+    if (!run.complete || run.count != 2) {
+        printf("FAIL: run not parsed back (%zu results)\n", run.count);
+        failures++;
+    }
+
+    const bench_result_t *fixed = run_find(&run, "self_timed");
+    if (!fixed || fixed->min != 1234 || fixed->median != 1234 || fixed->p99 != 1234 || fixed->reps != 101) {
+        printf("FAIL: self-timed case statistics\n");
+        failures++;
+    }
+
+    const bench_result_t *sum = run_find(&run, "sum_1000");
+    if (!sum || sum->min > sum->median || sum->median > sum->p99) {
+        printf("FAIL: min <= median <= p99\n");
+        failures++;
+    }
+
+    // the same run against itself passes, a slower copy regresses
+    run_t slower = run;
+    slower.results[0].median *= 2;
+    slower.results[0].median += 100;
+
+    if (run_report(&run, &run, 10) != 0) {
+        printf("FAIL: run regressed against itself\n");
+        failures++;
+    }
+    if (run_report(&slower, &run, 10) != 1) {
+        printf("FAIL: slower median not flagged\n");
+        failures++;
+    }
+
+    slower.count = 1;
+    if (run_report(&slower, &run, 1000) != 1) {
+        printf("FAIL: missing case not flagged\n");
+        failures++;
+    }
+
+    printf("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    const char *baseline_path = NULL;
+    const char *save_path = NULL;
+    double threshold = 10;
+    int opt;
+
+    if (argc > 1 && !strcmp(argv[1], "selftest")) {
+        return selftest();
+    }
+
+    while ((opt = getopt(argc, argv, "b:s:t:")) != -1) {
+        switch (opt) {
+            case 'b': baseline_path = optarg; break;
+            case 's': save_path = optarg; break;
+            case 't': threshold = atof(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-b baseline] [-s save] [-t percent] [device|file] | selftest\n", argv[0]);
+                return 1;
+        }
+    }
+
+    static run_t run, baseline;
+
+    if (baseline_path && !run_read(baseline_path, &baseline)) {
+        fprintf(stderr, "no results in %s\n", baseline_path);
+        return 1;
+    }
+
+    if (!run_read(optind < argc ? argv[optind] : NULL, &run)) {
+        fprintf(stderr, "no results\n");
+        return 1;
+    }
+
+    if (save_path && !run_save(save_path, &run)) {
+        return 1;
+    }
+
+    int regressions = run_report(&run, baseline_path ? &baseline : NULL, threshold);
+    if (regressions) {
+        printf("%d regressions over %.1f%%\n", regressions, threshold);
+    }
+
+    return regressions ? 1 : 0;
+}
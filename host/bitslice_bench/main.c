@@ -0,0 +1,186 @@
+/**
+ * @brief Host check and benchmark of lib/bitslice
+ *
+ * - exact: every pin count from 1 to 32 and the unrolled 8 and 32 pin
+ *   versions must match a one bit at a time reference, on random
+ *   words with the channels spread out by a stride
+ * - speed: Mbit/s through each transpose and through the reference
+ *
+ * Usage:
+ *
+ *   bitslice_bench [-n words]     channel words per speed run, default 1M
+ *
+ * Exits with 1 if a transpose is wrong.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "bitslice.h"
+
+#define EXACT_ROUNDS 2000
+
+static int failures = 0;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// small LCG, same sequence on every run
+static uint32_t next_random(uint32_t *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state ^ (*state >> 15);
+}
+
+/**
+ * One bit at a time, the definition the fast ones have to match
+ *
+ * @param channels
+ * @param stride
+ * @param out
+ * @param pins
+ *
+ * @return void
+ */
+static void reference_transpose(const uint32_t *channels, uint32_t stride, uint32_t *out, uint32_t pins) {
+    for (uint32_t w = 0; w < pins; w++) {
+        out[w] = 0;
+    }
+
+    for (uint32_t p = 0; p < pins; p++) {
+        for (uint32_t step = 0; step < 32; step++) {
+            uint32_t bit = (channels[p * stride] >> step) & 1;
+            out[step * pins / 32] |= bit << ((step * pins) % 32 + p);
+        }
+    }
+}
+
+static void transpose8(const uint32_t *channels, uint32_t stride, uint32_t *out, uint32_t pins) {
+    bitslice_transpose8(channels, stride, out);
+}
+
+static void transpose32(const uint32_t *channels, uint32_t stride, uint32_t *out, uint32_t pins) {
+    bitslice_transpose32(channels, stride, out);
+}
+
+typedef void (*transpose_fn)(const uint32_t *channels, uint32_t stride, uint32_t *out, uint32_t pins);
+
+/**
+ * Compare a transpose with the reference on random channels
+ *
+ * @param transpose
+ * @param pins
+ * @param name
+ *
+ * @return void
+ */
+static void check_exact(transpose_fn transpose, uint32_t pins, const char *name) {
+    uint32_t channels[32 * 3];
+    uint32_t fast[32];
+    uint32_t slow[32];
+    uint32_t seed = pins;
+
+    for (int round = 0; round < EXACT_ROUNDS; round++) {
+        uint32_t stride = 1 + round % 3;
+
+        for (uint32_t i = 0; i < 32 * 3; i++) {
+            channels[i] = next_random(&seed);
+        }
+        // all zeros and all ones as well
+        if (round == 0 || round == 1) {
+            for (uint32_t i = 0; i < 32 * 3; i++) {
+                channels[i] = round ? ~0u : 0;
+            }
+        }
+
+        transpose(channels, stride, fast, pins);
+        reference_transpose(channels, stride, slow, pins);
+
+        for (uint32_t w = 0; w < pins; w++) {
+            if (fast[w] != slow[w]) {
+                printf("FAIL %s: %u pins, stride %u, word %u is %08x, reference %08x\n", name, pins, stride, w,
+                       fast[w], slow[w]);
+                failures++;
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * Mbit/s through a transpose
+ *
+ * @param transpose
+ * @param pins
+ * @param channels - count random words
+ * @param count
+ *
+ * @return double
+ */
+static double speed(transpose_fn transpose, uint32_t pins, const uint32_t *channels, uint32_t count) {
+    uint32_t *out = malloc(count * sizeof(uint32_t));
+    volatile uint32_t sink = 0;
+    double best = 0;
+
+    // best of a few runs, the first one pages the buffers in
+    for (int run = 0; run < 5; run++) {
+        double start = now();
+        for (uint32_t i = 0; i + pins <= count; i += pins) {
+            transpose(channels + i, 1, out + i, pins);
+        }
+        double rate = count * 32.0 / (now() - start) / 1e6;
+        sink += out[count - 1];
+        if (rate > best) best = rate;
+    }
+
+    free(out);
+    return best;
+}
+
+int main(int argc, char **argv) {
+    uint32_t count = 1u << 20;
+    uint32_t seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+            case 'n':
+                count = strtoul(optarg, NULL, 0);
+                if (count < 32) count = 32;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n words]\n", argv[0]);
+                return 1;
+        }
+    }
+    count &= ~31u;
+
+    for (uint32_t pins = 1; pins <= 32; pins <<= 1) {
+        check_exact(bitslice_transpose, pins, "bitslice_transpose");
+    }
+    check_exact(transpose8, 8, "bitslice_transpose8");
+    check_exact(transpose32, 32, "bitslice_transpose32");
+
+    uint32_t *channels = malloc(count * sizeof(uint32_t));
+    for (uint32_t i = 0; i < count; i++) {
+        channels[i] = next_random(&seed);
+    }
+
+    printf("bitslice:     %u channel words per run\n", count);
+    printf("pins   transpose Mbit/s   reference Mbit/s\n");
+    for (uint32_t pins = 1; pins <= 32; pins <<= 1) {
+        printf("%4u   %16.1f   %16.1f\n", pins, speed(bitslice_transpose, pins, channels, count),
+               speed(reference_transpose, pins, channels, count));
+    }
+    printf("unrolled 8 pins %.1f Mbit/s, 32 pins %.1f Mbit/s\n", speed(transpose8, 8, channels, count),
+           speed(transpose32, 32, channels, count));
+
+    free(channels);
+
+    printf("bitslice_bench: %d failures\n", failures);
+    return failures ? 1 : 0;
+}
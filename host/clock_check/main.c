@@ -0,0 +1,525 @@
+/**
+ * @brief Host check of the lib/clock_gen clock generator
+ *
+ * Runs clock_solve() from lib/clock_gen/clock_solver.c over a sweep
+ * of frequencies and duty cycles, loads the chosen divider and loop
+ * counts into the clock_gen program (picow_timer's clock output and
+ * picow_pio's LED) on the PIO simulator and checks that the pin does
+ * exactly what the solver promised:
+ *
+ * - high and low times are exactly the counts given to
+ *   clock_gen_word(), from the shortest (CLOCK_MIN_HIGH/LOW) to the
+ *   longest the 16-bit fields allow, at divider 1 and above
+ * - every period and high time matches clkdiv * (high + low) and
+ *   clkdiv * high system cycles to the cycle
+ * - the measured frequency is within the reported error of the target
+ * - retuning on the fly (same or different divider) never produces a
+ *   runt pulse, a setting written halfway into a high or a low phase
+ *   starts with the next rising edge and one replaced before the
+ *   program pulled it never shows up
+ * - the monostable program fires exactly one pulse of the high time,
+ *   raises its IRQ flag when it ends and a pulse after a divider
+ *   change has the new high time
+ *
+ * Usage:
+ *
+ *   clock_check [-s sys_clk] [-v]
+ *
+ * Exits with 1 if any case fails.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pio_sim.h"
+#include "clock_gen.pio.h"
+#include "clock_solver.h"
+
+// same pin as picow_timer and picow_pio
+#define CLOCK_PIN 16
+#define MAX_EDGES 64
+
+typedef struct {
+    uint64_t rises[MAX_EDGES];
+    uint64_t falls[MAX_EDGES];
+    uint rise_count;
+    uint fall_count;
+} edges_t;
+
+static edges_t edges;
+static bool verbose = false;
+static uint failures = 0;
+static uint cases = 0;
+
+static void on_pin_change(pio_sim_t *pio, uint64_t cycle, uint32_t pins, uint32_t changed, void *user) {
+    if (!(changed & (1u << CLOCK_PIN))) return;
+
+    if (pins & (1u << CLOCK_PIN)) {
+        if (edges.rise_count < MAX_EDGES) edges.rises[edges.rise_count++] = cycle;
+    } else {
+        if (edges.fall_count < MAX_EDGES) edges.falls[edges.fall_count++] = cycle;
+    }
+}
+
+/**
+ * Load a program and configure the state machine like clock_sm_start()
+ *
+ * @param pio - simulated PIO block
+ * @param program - clock_gen_program or clock_pulse_program
+ * @param timing - setting to start with
+ *
+ * @return void
+ */
+static void setup(pio_sim_t *pio, const struct pio_program *program, const clock_timing_t *timing) {
+    pio_sim_init(pio);
+    pio_sim_set_pin_callback(pio, on_pin_change, NULL);
+    memset(&edges, 0, sizeof(edges));
+
+    int offset = pio_sim_add_program(pio, program);
+    pio_sm_config config = program == &clock_gen_program
+        ? clock_gen_program_get_default_config(offset)
+        : clock_pulse_program_get_default_config(offset);
+
+    sm_config_set_sideset_pins(&config, CLOCK_PIN);
+    sm_config_set_out_shift(&config, true, false, 32);
+    sm_config_set_clkdiv_int_frac(&config, timing->clkdiv, 0);
+    pio->pindirs |= 1u << CLOCK_PIN;
+    pio_sim_sm_init(pio, 0, offset, &config);
+}
+
+static void fail(const char *name, const char *fmt, unsigned long long a, unsigned long long b) {
+    printf("FAIL %s: ", name);
+    printf(fmt, a, b);
+    printf("\n");
+    failures++;
+}
+
+/**
+ * Check every complete period after the first rising edge
+ *
+ * @param name - case name
+ * @param timing - expected setting
+ *
+ * @return void
+ */
+static void check_periods(const char *name, const clock_timing_t *timing) {
+    uint64_t period = (uint64_t) timing->clkdiv * (timing->high + timing->low);
+    uint64_t high = (uint64_t) timing->clkdiv * timing->high;
+
+    if (edges.rise_count < 3) {
+        fail(name, "only %llu rising edges (need %llu)", edges.rise_count, 3);
+        return;
+    }
+
+    for (uint i = 1; i < edges.rise_count; i++) {
+        uint64_t measured = edges.rises[i] - edges.rises[i - 1];
+        if (measured != period) {
+            fail(name, "period %llu sys cycles, expected %llu", measured, period);
+            return;
+        }
+    }
+    // the first falling edge belongs to the first rise, the pin starts low
+    for (uint i = 0; i < edges.fall_count && i < edges.rise_count; i++) {
+        uint64_t measured = edges.falls[i] - edges.rises[i];
+        if (measured != high) {
+            fail(name, "high time %llu sys cycles, expected %llu", measured, high);
+            return;
+        }
+    }
+}
+
+/**
+ * Check the high and low time of complete periods from one rising edge on
+ *
+ * @param name - case name
+ * @param first - index of the first rising edge to check
+ * @param count - periods to check
+ * @param high - expected sys cycles high
+ * @param low - expected sys cycles low
+ *
+ * @return bool - false if a period is off
+ */
+static bool check_phases(const char *name, uint first, uint count, uint64_t high, uint64_t low) {
+    if (edges.rise_count < first + count + 1 || edges.fall_count < first + count) {
+        fail(name, "only %llu rising edges (need %llu)", edges.rise_count, first + count + 1);
+        return false;
+    }
+
+    for (uint i = first; i < first + count; i++) {
+        uint64_t measured_high = edges.falls[i] - edges.rises[i];
+        uint64_t measured_low = edges.rises[i + 1] - edges.falls[i];
+        if (measured_high != high) {
+            fail(name, "high time %llu sys cycles, expected %llu", measured_high, high);
+            return false;
+        }
+        if (measured_low != low) {
+            fail(name, "low time %llu sys cycles, expected %llu", measured_low, low);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Raw counts, each period must be exactly clkdiv * (high + low)
+ *
+ * @return void
+ */
+static void check_cycles(uint16_t clkdiv, uint32_t high, uint32_t low) {
+    static pio_sim_t pio;
+    clock_timing_t timing = {.clkdiv = clkdiv, .high = high, .low = low};
+    char name[64];
+
+    snprintf(name, sizeof(name), "cycles %lu/%lu div %u", (unsigned long) high, (unsigned long) low, clkdiv);
+    cases++;
+
+    setup(&pio, &clock_gen_program, &timing);
+    pio_sim_sm_put(&pio, 0, clock_gen_word(&timing));
+    pio_sim_sm_set_enabled(&pio, 0, true);
+
+    pio_sim_run(&pio, 5 * (uint64_t) clkdiv * (high + low) + 8 * clkdiv);
+    check_phases(name, 0, 4, (uint64_t) clkdiv * high, (uint64_t) clkdiv * low);
+}
+
+/**
+ * Astable output at one frequency and duty cycle
+ *
+ * @return void
+ */
+static void check_astable(uint32_t sys_clk, uint32_t frequency, uint duty_cycle) {
+    static pio_sim_t pio;
+    clock_timing_t timing;
+    char name[64];
+
+    snprintf(name, sizeof(name), "astable %lu Hz %u%%", (unsigned long) frequency, duty_cycle);
+    cases++;
+
+    if (!clock_solve(sys_clk, frequency, duty_cycle, &timing)) {
+        fail(name, "no setting found (%llu Hz, sys_clk %llu)", frequency, sys_clk);
+        return;
+    }
+
+    setup(&pio, &clock_gen_program, &timing);
+    pio_sim_sm_put(&pio, 0, clock_gen_word(&timing));
+    pio_sim_sm_set_enabled(&pio, 0, true);
+
+    uint64_t period = (uint64_t) timing.clkdiv * (timing.high + timing.low);
+    pio_sim_run(&pio, 5 * period + 8 * timing.clkdiv);
+    check_periods(name, &timing);
+
+    // the measured frequency must be the achieved one, within the reported error of the target
+    uint64_t measured_mhz = (uint64_t) sys_clk * 1000 / (edges.rises[2] - edges.rises[1]);
+    if (measured_mhz != timing.frequency_mhz) {
+        fail(name, "measured %llu mHz, solver reported %llu mHz", measured_mhz, timing.frequency_mhz);
+    }
+    // exact error from the measured period in sys cycles, the mHz value is rounded down
+    int64_t measured = (int64_t) (edges.rises[2] - edges.rises[1]) * frequency;
+    int64_t error_ppm = ((int64_t) sys_clk - measured) * 1000000 / measured;
+    int64_t allowed = llabs((long long) timing.error_ppm) + 1;
+    if (llabs((long long) error_ppm) > allowed) {
+        fail(name, "error %llu ppm above the reported %llu ppm", llabs((long long) error_ppm), allowed);
+    }
+
+    if (verbose) {
+        printf("%-28s div %5u high %6lu low %6lu -> %llu mHz (%ld ppm)\n", name, timing.clkdiv,
+               (unsigned long) timing.high, (unsigned long) timing.low,
+               (unsigned long long) timing.frequency_mhz, (long) timing.error_ppm);
+    }
+}
+
+/**
+ * Retune from one frequency to another while running, the way
+ * clock_gen_set() does, and look for runt pulses
+ *
+ * @return void
+ */
+static void check_retune(uint32_t sys_clk, uint32_t from, uint32_t to) {
+    static pio_sim_t pio;
+    clock_timing_t a, b;
+    char name[64];
+
+    snprintf(name, sizeof(name), "retune %lu -> %lu Hz", (unsigned long) from, (unsigned long) to);
+    cases++;
+
+    if (!clock_solve(sys_clk, from, 50, &a) || !clock_solve(sys_clk, to, 50, &b)) {
+        fail(name, "no setting found for %llu or %llu Hz", from, to);
+        return;
+    }
+
+    setup(&pio, &clock_gen_program, &a);
+    pio_sim_sm_put(&pio, 0, clock_gen_word(&a));
+    pio_sim_sm_set_enabled(&pio, 0, true);
+
+    uint64_t period_a = (uint64_t) a.clkdiv * (a.high + a.low);
+    uint64_t period_b = (uint64_t) b.clkdiv * (b.high + b.low);
+    pio_sim_run(&pio, 2 * period_a + period_a / 3);
+
+    // new setting like clock_gen_set(), a FIFO full of it if the divider
+    // changes, switched once the program pulled the first copy
+    pio_sim_sm_clear_fifos(&pio, 0);
+    pio_sim_sm_put(&pio, 0, clock_gen_word(&b));
+    if (a.clkdiv != b.clkdiv) {
+        while (pio_sim_sm_put(&pio, 0, clock_gen_word(&b))) {
+        }
+        while (pio_sim_sm_tx_full(&pio, 0)) {
+            pio_sim_run_until(&pio, pio_sim_next_tick(&pio));
+        }
+        pio_sim_sm_set_clkdiv_int_frac(&pio, 0, b.clkdiv, 0);
+    }
+    pio_sim_run(&pio, 3 * period_b);
+
+    // no phase may be shorter than the shorter of the two settings,
+    // less the couple of cycles that still run at the old divider
+    uint64_t min_high = (uint64_t) (a.high < b.high ? a.high : b.high) * (a.clkdiv < b.clkdiv ? a.clkdiv : b.clkdiv);
+    uint64_t min_low = (uint64_t) (a.low < b.low ? a.low : b.low) * (a.clkdiv < b.clkdiv ? a.clkdiv : b.clkdiv);
+    uint64_t slack = 4 * (uint64_t) (a.clkdiv > b.clkdiv ? a.clkdiv : b.clkdiv);
+
+    for (uint i = 0; i < edges.fall_count && i < edges.rise_count; i++) {
+        uint64_t high = edges.falls[i] - edges.rises[i];
+        if (high + slack < min_high) {
+            fail(name, "runt high pulse of %llu sys cycles, shortest setting %llu", high, min_high);
+            return;
+        }
+        if (i + 1 < edges.rise_count) {
+            uint64_t low = edges.rises[i + 1] - edges.falls[i];
+            if (low + slack < min_low) {
+                fail(name, "runt low phase of %llu sys cycles, shortest setting %llu", low, min_low);
+                return;
+            }
+        }
+    }
+
+    // and the last full period is the new setting
+    if (edges.rise_count < 2 || edges.rises[edges.rise_count - 1] - edges.rises[edges.rise_count - 2] != period_b) {
+        fail(name, "did not settle on the new period of %llu sys cycles (%llu edges)", period_b, edges.rise_count);
+    }
+}
+
+/**
+ * Change the setting halfway into a high and into a low phase, the
+ * way clock_gen_set() does on the same divider
+ *
+ * @return void
+ */
+static void check_update(uint16_t clkdiv) {
+    static pio_sim_t pio;
+    clock_timing_t timing = {.clkdiv = clkdiv, .high = 100, .low = 100};
+    char name[64];
+
+    snprintf(name, sizeof(name), "update div %u", clkdiv);
+    cases++;
+
+    // 100/100, a new setting in the middle of the second high phase
+    setup(&pio, &clock_gen_program, &timing);
+    pio_sim_sm_put(&pio, 0, clock_gen_word(&timing));
+    pio_sim_sm_set_enabled(&pio, 0, true);
+    pio_sim_run(&pio, 4 * clkdiv);
+    uint64_t start = edges.rises[0];
+    pio_sim_run_until(&pio, start + (200 + 50) * (uint64_t) clkdiv);
+    timing.high = 40;
+    timing.low = 60;
+    pio_sim_sm_clear_fifos(&pio, 0);
+    pio_sim_sm_put(&pio, 0, clock_gen_word(&timing));
+    // and again in the middle of the 40/60 low phase
+    pio_sim_run_until(&pio, start + (400 + 40 + 30) * (uint64_t) clkdiv);
+    timing.high = CLOCK_MIN_HIGH;
+    timing.low = CLOCK_MIN_LOW;
+    pio_sim_sm_clear_fifos(&pio, 0);
+    pio_sim_sm_put(&pio, 0, clock_gen_word(&timing));
+    pio_sim_run_until(&pio, start + (500 + 4 * 6) * (uint64_t) clkdiv);
+
+    // the period in progress finishes first, the new one starts with the next rising edge
+    if (!check_phases(name, 0, 2, 100 * clkdiv, 100 * clkdiv)) return;
+    if (!check_phases(name, 2, 1, 40 * clkdiv, 60 * clkdiv)) return;
+    check_phases(name, 3, 3, CLOCK_MIN_HIGH * clkdiv, CLOCK_MIN_LOW * clkdiv);
+}
+
+/**
+ * Replace a setting before the program pulls it, the way a second
+ * clock_gen_set() within one period does
+ *
+ * @return void
+ */
+static void check_replace(uint32_t sys_clk, uint32_t from, uint32_t dropped, uint32_t to) {
+    static pio_sim_t pio;
+    clock_timing_t a, b, c;
+    char name[64];
+
+    snprintf(name, sizeof(name), "replace %lu -> %lu Hz", (unsigned long) dropped, (unsigned long) to);
+    cases++;
+
+    if (!clock_solve(sys_clk, from, 50, &a) || !clock_solve(sys_clk, dropped, 50, &b)
+        || !clock_solve(sys_clk, to, 50, &c) || a.clkdiv != b.clkdiv || a.clkdiv != c.clkdiv) {
+        fail(name, "no settings on one divider for %llu and %llu Hz", dropped, to);
+        return;
+    }
+
+    setup(&pio, &clock_gen_program, &a);
+    pio_sim_sm_put(&pio, 0, clock_gen_word(&a));
+    pio_sim_sm_set_enabled(&pio, 0, true);
+
+    uint64_t period_a = (uint64_t) a.clkdiv * (a.high + a.low);
+    uint64_t period_c = (uint64_t) c.clkdiv * (c.high + c.low);
+    pio_sim_run(&pio, 2 * period_a + period_a / 3);
+
+    // the first setting is still waiting when the second one comes
+    pio_sim_sm_clear_fifos(&pio, 0);
+    pio_sim_sm_put(&pio, 0, clock_gen_word(&b));
+    pio_sim_run(&pio, period_a / 3);
+    pio_sim_sm_clear_fifos(&pio, 0);
+    pio_sim_sm_put(&pio, 0, clock_gen_word(&c));
+    pio_sim_run(&pio, 3 * period_c);
+
+    // a periods, then c periods, nothing in between
+    for (uint i = 1; i < edges.rise_count; i++) {
+        uint64_t period = edges.rises[i] - edges.rises[i - 1];
+        if (period != period_a && period != period_c) {
+            fail(name, "period of %llu sys cycles, expected %llu or the new setting", period, period_a);
+            return;
+        }
+    }
+    if (edges.rise_count < 2 || edges.rises[edges.rise_count - 1] - edges.rises[edges.rise_count - 2] != period_c) {
+        fail(name, "did not settle on the new period of %llu sys cycles (%llu edges)", period_c, edges.rise_count);
+    }
+}
+
+/**
+ * One monostable pulse, the way clock_gen_pulse() fires it
+ *
+ * @return void
+ */
+static void check_pulse(uint32_t sys_clk, uint32_t frequency) {
+    static pio_sim_t pio;
+    clock_timing_t timing;
+    char name[64];
+
+    snprintf(name, sizeof(name), "pulse at %lu Hz", (unsigned long) frequency);
+    cases++;
+
+    clock_solve(sys_clk, frequency, 50, &timing);
+    setup(&pio, &clock_pulse_program, &timing);
+    pio_sim_sm_set_enabled(&pio, 0, true);
+
+    uint64_t high = (uint64_t) timing.clkdiv * timing.high;
+    pio_sim_run(&pio, 10 * timing.clkdiv);
+    pio_sim_sm_put(&pio, 0, clock_pulse_word(&timing));
+    pio_sim_run(&pio, 3 * high);
+
+    if (edges.rise_count != 1 || edges.fall_count != 1) {
+        fail(name, "%llu rising and %llu falling edges, expected 1 each", edges.rise_count, edges.fall_count);
+        return;
+    }
+    if (edges.falls[0] - edges.rises[0] != high) {
+        fail(name, "pulse of %llu sys cycles, expected %llu", edges.falls[0] - edges.rises[0], high);
+        return;
+    }
+    if (!(pio.irq & 1)) {
+        fail(name, "IRQ flag %llu after the pulse, expected %llu", pio.irq & 1, 1);
+    }
+}
+
+/**
+ * A pulse at a new divider, the way clock_gen_pulse() waits for the
+ * running pulse to raise its IRQ flag before switching
+ *
+ * @return void
+ */
+static void check_pulse_retune(uint32_t sys_clk, uint32_t from, uint32_t to) {
+    static pio_sim_t pio;
+    clock_timing_t a, b;
+    char name[64];
+
+    snprintf(name, sizeof(name), "pulse %lu -> %lu Hz", (unsigned long) from, (unsigned long) to);
+    cases++;
+
+    clock_solve(sys_clk, from, 50, &a);
+    clock_solve(sys_clk, to, 50, &b);
+    setup(&pio, &clock_pulse_program, &a);
+    pio_sim_sm_set_enabled(&pio, 0, true);
+
+    pio_sim_run(&pio, 10 * a.clkdiv);
+    pio_sim_sm_put(&pio, 0, clock_pulse_word(&a));
+    while (!(pio.irq & 1)) {
+        pio_sim_run_until(&pio, pio_sim_next_tick(&pio));
+    }
+    pio.irq &= ~1u;
+    pio_sim_sm_set_clkdiv_int_frac(&pio, 0, b.clkdiv, 0);
+    pio_sim_sm_put(&pio, 0, clock_pulse_word(&b));
+    pio_sim_run(&pio, 10 * b.clkdiv + 2 * (uint64_t) b.clkdiv * b.high);
+
+    uint64_t high_a = (uint64_t) a.clkdiv * a.high;
+    uint64_t high_b = (uint64_t) b.clkdiv * b.high;
+    if (edges.rise_count != 2 || edges.fall_count != 2) {
+        fail(name, "%llu rising and %llu falling edges, expected 2 each", edges.rise_count, edges.fall_count);
+        return;
+    }
+    if (edges.falls[0] - edges.rises[0] != high_a) {
+        fail(name, "first pulse of %llu sys cycles, expected %llu", edges.falls[0] - edges.rises[0], high_a);
+    }
+    if (edges.falls[1] - edges.rises[1] != high_b) {
+        fail(name, "second pulse of %llu sys cycles, expected %llu", edges.falls[1] - edges.rises[1], high_b);
+    }
+}
+
+int main(int argc, char **argv) {
+    static const uint32_t frequencies[] = {
+        1, 2, 7, 50, 333, 1000, 12345, 100000, 1000000, 1234567, 5000000, 10000000,
+    };
+    static const uint duty_cycles[] = {50, 10, 90};
+    uint32_t sys_clk = 125000000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:v")) != -1) {
+        switch (opt) {
+            case 's': sys_clk = strtoul(optarg, NULL, 0); break;
+            case 'v': verbose = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-s sys_clk] [-v]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    // the program's limits, and a few in between
+    check_cycles(1, CLOCK_MIN_HIGH, CLOCK_MIN_LOW);
+    check_cycles(1, CLOCK_MIN_HIGH + 1, CLOCK_MIN_LOW + 1);
+    check_cycles(1, CLOCK_MAX_HIGH, CLOCK_MAX_LOW);
+    check_cycles(1, CLOCK_MIN_HIGH, CLOCK_MAX_LOW);
+    check_cycles(1, CLOCK_MAX_HIGH, CLOCK_MIN_LOW);
+    check_cycles(1, 12345, 54321);
+    check_cycles(3, 1000, CLOCK_MIN_LOW);
+    check_cycles(62500, 1024, 1028);
+
+    for (size_t i = 0; i < sizeof(frequencies) / sizeof(frequencies[0]); i++) {
+        for (size_t j = 0; j < sizeof(duty_cycles) / sizeof(duty_cycles[0]); j++) {
+            check_astable(sys_clk, frequencies[i], duty_cycles[j]);
+        }
+    }
+    // the fastest the program can go, 2 cycles high and 4 low
+    check_astable(sys_clk, sys_clk / 6, 33);
+
+    // same divider, then across divider bands both ways
+    check_retune(sys_clk, 1000, 1500);
+    check_retune(sys_clk, 1000, 10);
+    check_retune(sys_clk, 7, 100000);
+    check_replace(sys_clk, 1000, 1200, 1500);
+    check_update(1);
+    check_update(10);
+
+    check_pulse(sys_clk, 1);
+    check_pulse(sys_clk, 1000);
+    check_pulse(sys_clk, 1000000);
+    check_pulse_retune(sys_clk, 1000, 10);
+    check_pulse_retune(sys_clk, 10, 100000);
+
+    // out of range must be refused, not silently clamped
+    clock_timing_t timing;
+    cases++;
+    if (clock_solve(sys_clk, sys_clk / 6 + 1, 50, &timing)) {
+        fail("out of range", "accepted %llu Hz at sys_clk %llu", sys_clk / 6 + 1, sys_clk);
+    }
+
+    printf("clock_check: %u cases, %u failures\n", cases, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,426 @@
+/**
+ * @brief Host check of the picow_timer button debouncer
+ *
+ * Samples synthetic bounce traces through picow_timer/src/debounce.c
+ * once per DEBOUNCE_PERIOD_US, the way the hardware alarm does, and
+ * checks that every real press and release comes out once and in
+ * order, stamped at the start of its bounce, that two buttons don't
+ * mask each other, that glitches are filtered and that a full queue
+ * counts drops. Then prints the cost of a sample.
+ *
+ * A trace is a list of presses, each edge bounces for a while (the
+ * contact reads random levels, starting at the new one) and then
+ * holds.
+ *
+ * Usage:
+ *
+ *   debounce_check [-v]
+ *
+ * Exits with 1 if any check fails.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "debounce.h"
+
+// same as picow_timer/src/main.c
+#define MODE_PIN 14
+#define STEP_PIN 15
+#define PINS ((1u << MODE_PIN) | (1u << STEP_PIN))
+
+#define PERIOD DEBOUNCE_PERIOD_US
+#define MAX_PRESSES 20000
+#define MAX_EVENTS (2 * MAX_PRESSES + 2)
+#define MAX_SAMPLES (1u << 21)
+
+static bool verbose = false;
+static unsigned int checks = 0;
+static unsigned int failures = 0;
+
+static void check(bool ok, const char *name, long got, long expected) {
+    checks++;
+    if (!ok) {
+        printf("FAIL %s: got %ld, expected %ld\n", name, got, expected);
+        failures++;
+    } else if (verbose) {
+        printf("ok   %s: %ld\n", name, got);
+    }
+}
+
+// small LCG, the same traces on every run
+static uint32_t noise_state = 1;
+static uint32_t noise(uint32_t range) {
+    noise_state = noise_state * 1664525u + 1013904223u;
+    return (noise_state >> 8) % range;
+}
+
+typedef struct {
+    uint8_t pin;
+    uint32_t press_us;
+    uint32_t release_us;
+    // how long each edge bounces
+    uint32_t bounce_us;
+} press_t;
+
+typedef struct {
+    press_t presses[MAX_PRESSES];
+    unsigned int count;
+    // random level of each pin and sample while bouncing
+    uint32_t seed;
+    // pins held down from before the start, released at held_until_us
+    uint32_t held;
+    uint32_t held_until_us;
+} trace_t;
+
+typedef struct {
+    debounce_event_t event;
+    // sample that pushed it
+    uint32_t seen_us;
+} seen_t;
+
+static trace_t trace;
+// pressed pins at every sample, rendered from the trace
+static uint32_t trace_down[MAX_SAMPLES];
+static seen_t seen[MAX_EVENTS];
+static unsigned int seen_count;
+
+static void trace_reset(uint32_t seed) {
+    memset(&trace, 0, sizeof(trace));
+    trace.seed = seed;
+}
+
+static void trace_press(uint8_t pin, uint32_t press_us, uint32_t release_us, uint32_t bounce_us) {
+    trace.presses[trace.count++] = (press_t) {pin, press_us, release_us, bounce_us};
+}
+
+// a coin flip per pin and sample, so a level can be looked up again
+static bool bounce_level(uint8_t pin, uint32_t t) {
+    uint32_t h = (t / PERIOD) * 2654435761u ^ pin * 40503u ^ trace.seed;
+    h ^= h >> 15;
+    h *= 2246822519u;
+    h ^= h >> 13;
+    return h & 1;
+}
+
+/**
+ * Work out which pins are down at every sample up to end_us
+ *
+ * @return void
+ */
+static void trace_render(uint32_t end_us) {
+    memset(trace_down, 0, (end_us / PERIOD + 1) * sizeof(uint32_t));
+
+    for (uint32_t t = 0; t < trace.held_until_us && t <= end_us; t += PERIOD) {
+        trace_down[t / PERIOD] |= trace.held;
+    }
+
+    for (unsigned int i = 0; i < trace.count; i++) {
+        const press_t *p = &trace.presses[i];
+
+        for (uint32_t t = p->press_us; t < p->release_us + p->bounce_us && t <= end_us; t += PERIOD) {
+            bool pressed = t < p->release_us;
+
+            // the first contact reads the new level, then it chatters
+            if (t > p->press_us && t < p->press_us + p->bounce_us && t < p->release_us) {
+                pressed = bounce_level(p->pin, t);
+            } else if (t > p->release_us) {
+                pressed = !bounce_level(p->pin, t);
+            }
+            if (pressed) trace_down[t / PERIOD] |= 1u << p->pin;
+        }
+    }
+}
+
+/**
+ * Level of the pins at a sample, pulled up, 0 pressed
+ *
+ * @return uint32_t - gpio_get_all() as the board would see it
+ */
+static uint32_t trace_levels(uint32_t t) {
+    // all the other pins float high too
+    return ~trace_down[t / PERIOD];
+}
+
+/**
+ * Sample the trace once per period up to end_us, collecting events
+ *
+ * @param ring - debounce's ring, drained after every sample unless drain is false
+ *
+ * @return void
+ */
+static void trace_run(debounce_t *debounce, spsc_t *ring, uint32_t end_us, bool drain) {
+    debounce_event_t event;
+
+    seen_count = 0;
+    for (uint32_t t = PERIOD; t <= end_us; t += PERIOD) {
+        debounce_sample(debounce, t, trace_levels(t));
+        while (drain && seen_count < MAX_EVENTS && spsc_pop(ring, &event)) {
+            seen[seen_count++] = (seen_t) {event, t};
+        }
+    }
+}
+
+/**
+ * Expected events of one pin are its presses and releases in order,
+ * stamped within [edge, edge + bounce + period], seen no later than
+ * the end of the bounce plus DEBOUNCE_SAMPLES periods
+ *
+ * @return bool - every event of the pin matched
+ */
+static bool trace_matches(uint8_t pin, uint32_t *worst_latency_us, unsigned int *matched) {
+    unsigned int e = 0;
+
+    for (unsigned int i = 0; i < trace.count; i++) {
+        const press_t *p = &trace.presses[i];
+        if (p->pin != pin) continue;
+
+        for (int edge = 0; edge < 2; edge++) {
+            uint32_t at = edge ? p->release_us : p->press_us;
+
+            while (e < seen_count && seen[e].event.pin != pin) e++;
+            if (e == seen_count) return false;
+
+            const seen_t *s = &seen[e++];
+            if (s->event.pressed != !edge) return false;
+            if (s->event.time_us < at || s->event.time_us > at + p->bounce_us + PERIOD) return false;
+            if (s->seen_us > at + p->bounce_us + DEBOUNCE_SAMPLES * PERIOD) return false;
+
+            uint32_t latency = s->seen_us - at;
+            if (latency > *worst_latency_us) *worst_latency_us = latency;
+            (*matched)++;
+        }
+    }
+
+    // nothing extra either
+    while (e < seen_count && seen[e].event.pin != pin) e++;
+    return e == seen_count;
+}
+
+static spsc_t ring;
+static debounce_event_t ring_buffer[1 << 16];
+
+static void setup(debounce_t *debounce, uint32_t capacity, uint32_t end_us) {
+    trace_render(end_us);
+    spsc_init(&ring, ring_buffer, capacity, sizeof(debounce_event_t));
+    debounce_init(debounce, PINS, PINS, DEBOUNCE_SAMPLES, &ring, trace_levels(0));
+}
+
+static void check_clean(void) {
+    debounce_t debounce;
+    uint32_t latency = 0;
+    unsigned int matched = 0;
+
+    // no bounce at all, stamped exactly at the edges
+    trace_reset(1);
+    trace_press(MODE_PIN, 10000, 60000, 0);
+    setup(&debounce, 16, 100000);
+    trace_run(&debounce, &ring, 100000, true);
+
+    check(seen_count == 2, "clean events", seen_count, 2);
+    bool ok = trace_matches(MODE_PIN, &latency, &matched);
+    check(ok, "clean in order", matched, 2);
+    check(seen[0].event.time_us == 10000, "clean press stamp", seen[0].event.time_us, 10000);
+    check(seen[1].event.time_us == 60000, "clean release stamp", seen[1].event.time_us, 60000);
+    check(latency == (DEBOUNCE_SAMPLES - 1) * PERIOD, "clean latency (us)", latency, (DEBOUNCE_SAMPLES - 1) * PERIOD);
+}
+
+static void check_bounce(void) {
+    bool ok = true;
+    uint32_t latency = 0;
+    unsigned int matched = 0;
+
+    // the same press bouncing 3 ms on both edges, a different chatter every time
+    for (uint32_t seed = 1; seed <= 1000; seed++) {
+        debounce_t debounce;
+
+        trace_reset(seed);
+        trace_press(STEP_PIN, 10000, 80000, 3000);
+        setup(&debounce, 16, 120000);
+        trace_run(&debounce, &ring, 120000, true);
+        ok &= seen_count == 2 && trace_matches(STEP_PIN, &latency, &matched);
+    }
+    check(ok, "bouncing press, once each", matched, 2000);
+    check(latency <= 3000 + DEBOUNCE_SAMPLES * PERIOD, "bouncing worst latency (us)", latency,
+          3000 + DEBOUNCE_SAMPLES * PERIOD);
+}
+
+static void check_independent(void) {
+    debounce_t debounce;
+    uint32_t latency = 0;
+    unsigned int matched = 0;
+
+    // STEP pressed 1 ms after MODE, then two STEP presses 50 ms apart,
+    // all inside the 200 ms the single shared timestamp used to swallow
+    trace_reset(7);
+    trace_press(MODE_PIN, 10000, 40000, 2000);
+    trace_press(STEP_PIN, 11000, 30000, 2000);
+    trace_press(STEP_PIN, 80000, 110000, 2000);
+    trace_press(STEP_PIN, 130000, 160000, 2000);
+    setup(&debounce, 16, 200000);
+    trace_run(&debounce, &ring, 200000, true);
+
+    check(seen_count == 8, "overlapping events", seen_count, 8);
+    bool ok = trace_matches(MODE_PIN, &latency, &matched);
+    check(ok, "MODE in order", matched, 2);
+    ok = trace_matches(STEP_PIN, &latency, &matched);
+    check(ok, "STEP in order", matched, 8);
+}
+
+static void check_glitch(void) {
+    debounce_t debounce;
+
+    // a low shorter than DEBOUNCE_SAMPLES periods is bounce, not a press
+    trace_reset(3);
+    for (uint32_t i = 0; i < 50; i++) {
+        uint32_t at = 10000 + i * 20000;
+        trace_press(i & 1 ? MODE_PIN : STEP_PIN, at, at + (1 + i % (DEBOUNCE_SAMPLES - 1)) * PERIOD, 0);
+    }
+    setup(&debounce, 16, 1100000);
+    trace_run(&debounce, &ring, 1100000, true);
+    check(seen_count == 0, "glitches filtered", seen_count, 0);
+    check(debounce.moving == 0, "glitches died out", debounce.moving, 0);
+
+    // one period longer is a press
+    trace_reset(3);
+    trace_press(MODE_PIN, 10000, 10000 + DEBOUNCE_SAMPLES * PERIOD, 0);
+    setup(&debounce, 16, 50000);
+    trace_run(&debounce, &ring, 50000, true);
+    check(seen_count == 2, "shortest press", seen_count, 2);
+}
+
+static void check_held(void) {
+    debounce_t debounce;
+
+    // held since boot: no press, only its release
+    trace_reset(5);
+    trace.held = 1u << MODE_PIN;
+    trace.held_until_us = 30000;
+    setup(&debounce, 16, 60000);
+    check(debounce.state == 1u << MODE_PIN, "held at init", debounce.state, 1u << MODE_PIN);
+    trace_run(&debounce, &ring, 60000, true);
+    check(seen_count == 1 && !seen[0].event.pressed, "held, release only", seen_count, 1);
+    check(seen_count == 1 && seen[0].event.time_us == 30000, "held release stamp", seen[0].event.time_us, 30000);
+
+    // other pins changing don't matter
+    trace_reset(5);
+    setup(&debounce, 16, 0);
+    check(debounce_sample(&debounce, PERIOD, PINS) == 0 && debounce.moving == 0, "other pins ignored",
+          debounce.moving, 0);
+    debounce_sample(&debounce, 2 * PERIOD, 0);
+    check(debounce.moving == PINS, "only our pins", debounce.moving, PINS);
+}
+
+static void check_full(void) {
+    debounce_t debounce;
+    unsigned int events = 12;
+
+    // nobody draining a 4 slot ring, the rest is counted, not lost silently
+    trace_reset(9);
+    for (uint32_t i = 0; i < events / 2; i++) trace_press(STEP_PIN, 10000 + i * 40000, 30000 + i * 40000, 2000);
+    setup(&debounce, 4, 300000);
+    trace_run(&debounce, &ring, 300000, false);
+
+    check(spsc_available(&ring) == 4, "full ring", spsc_available(&ring), 4);
+    check(debounce.dropped == events - 4, "dropped", debounce.dropped, events - 4);
+
+    // the oldest ones are kept
+    debounce_event_t event;
+    spsc_pop(&ring, &event);
+    check(event.pressed && event.time_us >= 10000 && event.time_us <= 12000 + PERIOD, "kept oldest", event.time_us,
+          10000);
+}
+
+static void check_random(void) {
+    debounce_t debounce;
+    uint32_t latency = 0;
+    unsigned int matched = 0;
+    uint32_t next[2] = {10000, 10000};
+    uint32_t end = 0;
+
+    // both buttons mashed at random, every edge bouncing up to 4 ms, each
+    // level then held at least DEBOUNCE_SAMPLES periods
+    trace_reset(11);
+    noise_state = 11;
+    while (trace.count < MAX_PRESSES) {
+        int b = noise(2);
+        uint32_t bounce = noise(5) * PERIOD;
+        uint32_t press = next[b];
+        uint32_t release = press + bounce + (DEBOUNCE_SAMPLES + noise(40)) * PERIOD;
+
+        trace_press(b ? STEP_PIN : MODE_PIN, press, release, bounce);
+        next[b] = release + bounce + (DEBOUNCE_SAMPLES + noise(40)) * PERIOD;
+        if (next[b] > end) end = next[b];
+    }
+    setup(&debounce, 16, end + 10 * PERIOD);
+    trace_run(&debounce, &ring, end + 10 * PERIOD, true);
+
+    check(seen_count == 2 * MAX_PRESSES, "random events", seen_count, 2 * MAX_PRESSES);
+    bool ok = trace_matches(MODE_PIN, &latency, &matched);
+    ok &= trace_matches(STEP_PIN, &latency, &matched);
+    check(ok, "random, no edge lost", matched, 2 * MAX_PRESSES);
+    check(latency <= 4000 + DEBOUNCE_SAMPLES * PERIOD, "random worst latency (us)", latency,
+          4000 + DEBOUNCE_SAMPLES * PERIOD);
+    check(debounce.dropped == 0, "random dropped", debounce.dropped, 0);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/**
+ * What the alarm interrupt costs, settled and with a button moving
+ *
+ * @return void
+ */
+static void bench(void) {
+    debounce_t debounce;
+    debounce_event_t event;
+    const uint32_t n = 10000000;
+    volatile uint32_t levels = ~0u;
+    uint32_t pushed = 0;
+
+    trace_reset(1);
+    setup(&debounce, 16, 0);
+    uint64_t start = now_ns();
+    for (uint32_t t = 0; t < n; t++) pushed += debounce_sample(&debounce, t, levels);
+    double idle = (double) (now_ns() - start) / n;
+
+    // a square wave slower than the integrator, it always has a pin moving
+    start = now_ns();
+    for (uint32_t t = 0; t < n; t++) {
+        pushed += debounce_sample(&debounce, t, (t / 8) & 1 ? levels : levels & ~PINS);
+        spsc_pop(&ring, &event);
+    }
+    double moving = (double) (now_ns() - start) / n;
+
+    printf("sample: %.2f ns settled, %.2f ns moving (%lu events)\n", idle, moving, (unsigned long) pushed);
+}
+
+int main(int argc, char **argv) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "v")) != -1) {
+        switch (opt) {
+            case 'v': verbose = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    check_clean();
+    check_bounce();
+    check_independent();
+    check_glitch();
+    check_held();
+    check_full();
+    check_random();
+    bench();
+
+    printf("debounce_check: %u checks, %u failures\n", checks, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,356 @@
+/**
+ * @brief Host check of chained DMA designs on the hal_sim DMA model
+ *
+ * Builds against host/hal_sim like the sim_* examples, so the code
+ * below configures the DMA with the same SDK calls as the firmware,
+ * then compares the model's counters and the registers it wrote
+ * with what the design is supposed to do:
+ *
+ * - pwm_dma: lib/pwm_dma as picow_dma_pwm uses it, every PWM wrap
+ *   must move exactly one frame word to the right slice's CC, both
+ *   rings must wrap back to the start of their tables, and nothing
+ *   may move after pwm_dma_stop()
+ * - sequencer: the data/control/reload chain of picow_dma_pio feeding
+ *   a PIO state machine, the control ring must wrap every 32 blocks
+ *   and the FIFO must never run dry
+ * - ring: the same ring on an aligned and on a misaligned table, the
+ *   misaligned one must be reported as bad wraps
+ * - irq: chained memcpy channels with INTR, IRQ_QUIET and a handler
+ *   acknowledging through ints0
+ *
+ * Usage:
+ *
+ *   dma_check [-q]      -q no pin/DMA summary from the simulator
+ *
+ * Exits with 1 if any check fails.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "hardware/pwm.h"
+#include "hal_sim.h"
+#include "pwm_dma.h"
+#include "dma_pio.pio.h"
+
+// pwm_dma: 8 slices, 64 steps, a wrap every 1000 cycles
+#define ENGINE_SLICES 8
+#define ENGINE_STEPS 64
+#define ENGINE_WRAP 999
+
+// sequencer: picow_dma_pio with short blocks so the ring wraps often
+#define SEQ_LEVELS 32
+#define SEQ_BLOCK 100
+#define SEQ_CLK_DIV 10
+#define SEQ_RING_BITS 8
+
+static int failures = 0;
+static int checks = 0;
+
+static void check(bool ok, const char *name, const char *what, unsigned long long got, unsigned long long expected) {
+    checks++;
+    if (!ok) {
+        printf("FAIL %s: %s, got %llu, expected %llu\n", name, what, got, expected);
+        failures++;
+    }
+}
+
+PWM_DMA_FRAMES(frames, ENGINE_SLICES, ENGINE_STEPS);
+static pwm_dma_t engine;
+static uint16_t ramp[ENGINE_STEPS];
+
+/**
+ * lib/pwm_dma: one CC word per wrap, in frame order, rings intact
+ *
+ * @return void
+ */
+static void check_pwm_dma(void) {
+    hal_sim_dma_stats_t data;
+    hal_sim_dma_stats_t control;
+    pwm_config config = pwm_get_default_config();
+
+    pwm_config_set_wrap(&config, ENGINE_WRAP);
+    for (uint slice = 0; slice < ENGINE_SLICES; slice++) {
+        pwm_init(slice, &config, false);
+    }
+    for (uint step = 0; step < ENGINE_STEPS; step++) {
+        ramp[step] = step * 15 + 1;
+    }
+
+    pwm_dma_init(&engine, ENGINE_SLICES, ENGINE_STEPS, frames);
+    for (uint slice = 0; slice < ENGINE_SLICES; slice++) {
+        pwm_dma_set_wave(&engine, slice, PWM_CHAN_A, ramp, ENGINE_STEPS, slice * 2);
+        pwm_dma_set_wave(&engine, slice, PWM_CHAN_B, ramp, ENGINE_STEPS, slice * 2 + 1);
+    }
+
+    uint64_t start = hal_sim_cycle;
+    pwm_set_mask_enabled((1u << ENGINE_SLICES) - 1);
+    pwm_dma_start(&engine, 0);
+
+    // a bit over 2 passes through the frame table
+    sleep_us(2 * ENGINE_SLICES * ENGINE_STEPS * (ENGINE_WRAP + 1) / HAL_SIM_CYCLES_PER_US + 333);
+
+    uint64_t wraps = (hal_sim_cycle - start) / (ENGINE_WRAP + 1);
+    hal_sim_dma_get_stats(engine.data_channel, &data);
+    hal_sim_dma_get_stats(engine.control_channel, &control);
+
+    check(data.transfers == wraps, "pwm_dma", "one data transfer per wrap", data.transfers, wraps);
+    check(data.missed_dreqs == 0, "pwm_dma", "missed wrap DREQs", data.missed_dreqs, 0);
+    check(control.chained == data.completions, "pwm_dma", "control chained after every data transfer",
+          control.chained, data.completions);
+    check(data.ring_wraps == wraps / (ENGINE_SLICES * ENGINE_STEPS), "pwm_dma", "frame ring wraps", data.ring_wraps,
+          wraps / (ENGINE_SLICES * ENGINE_STEPS));
+    check(control.ring_wraps == (control.transfers) / ENGINE_SLICES, "pwm_dma", "CC address ring wraps",
+          control.ring_wraps, control.transfers / ENGINE_SLICES);
+    check(data.bad_wraps + control.bad_wraps == 0, "pwm_dma", "bad ring wraps", data.bad_wraps + control.bad_wraps, 0);
+
+    // transfer n wrote frame n % table size to slice n % slices
+    for (uint slice = 0; slice < ENGINE_SLICES; slice++) {
+        uint64_t last = wraps - 1 - ((wraps - 1 - slice) % ENGINE_SLICES);
+        uint32_t expected = frames[last % (ENGINE_SLICES * ENGINE_STEPS)];
+        check(pwm_hw->slice[slice].cc == expected, "pwm_dma", "CC register holds the last frame word",
+              pwm_hw->slice[slice].cc, expected);
+    }
+
+    pwm_dma_stop(&engine);
+    hal_sim_dma_get_stats(engine.data_channel, &data);
+    uint64_t stopped = data.transfers;
+    sleep_ms(5);
+    hal_sim_dma_get_stats(engine.data_channel, &data);
+    check(data.transfers == stopped, "pwm_dma", "transfers after pwm_dma_stop()", data.transfers - stopped, 0);
+
+    pwm_set_mask_enabled(0);
+}
+
+static const uint32_t levels[SEQ_LEVELS] = {
+    0x00000000, 0x00000001, 0x00000003, 0x00000007, 0x0000000f, 0x0000001f, 0x0000003f, 0x0000007f,
+    0x000000ff, 0x000001ff, 0x000003ff, 0x000007ff, 0x00000fff, 0x00001fff, 0x00003fff, 0x00007fff,
+    0x0000ffff, 0x0001ffff, 0x0003ffff, 0x0007ffff, 0x000fffff, 0x001fffff, 0x003fffff, 0x007fffff,
+    0x00ffffff, 0x01ffffff, 0x03ffffff, 0x07ffffff, 0x0fffffff, 0x1fffffff, 0x3fffffff, 0x7fffffff,
+};
+
+typedef struct {
+    uint32_t transfer_count;
+    uint32_t read_addr;
+} control_block_t;
+
+static control_block_t blocks[SEQ_LEVELS] __attribute__((aligned(1u << SEQ_RING_BITS)));
+static uint32_t control_write_addr;
+
+/**
+ * picow_dma_pio's sequencer: data -> reload -> control -> data, paced by PIO TX
+ *
+ * @return void
+ */
+static void check_sequencer(void) {
+    hal_sim_dma_stats_t data;
+    hal_sim_dma_stats_t control;
+    hal_sim_dma_stats_t reload;
+
+    uint offset = pio_add_program(pio0, &dma_pio_program);
+    pio_sm_config c = dma_pio_program_get_default_config(offset);
+    sm_config_set_out_pins(&c, 16, 1);
+    sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+    sm_config_set_clkdiv_int_frac(&c, SEQ_CLK_DIV, 0);
+    sm_config_set_out_shift(&c, true, true, 32);
+    pio_gpio_init(pio0, 16);
+    pio_sm_set_consecutive_pindirs(pio0, 0, 16, 1, true);
+    pio_sm_init(pio0, 0, offset, &c);
+
+    int data_channel = dma_claim_unused_channel(true);
+    int control_channel = dma_claim_unused_channel(true);
+    int reload_channel = dma_claim_unused_channel(true);
+
+    for (int i = 0; i < SEQ_LEVELS; i++) {
+        blocks[i].transfer_count = SEQ_BLOCK;
+        blocks[i].read_addr = (uint32_t) (uintptr_t) &levels[i];
+    }
+    control_write_addr = (uint32_t) (uintptr_t) &dma_hw->ch[data_channel].al3_transfer_count;
+
+    dma_channel_config dc = dma_channel_get_default_config(data_channel);
+    channel_config_set_read_increment(&dc, false);
+    channel_config_set_dreq(&dc, DREQ_PIO0_TX0);
+    channel_config_set_chain_to(&dc, reload_channel);
+    dma_channel_configure(data_channel, &dc, &pio0_hw->txf[0], NULL, SEQ_BLOCK, false);
+
+    dma_channel_config cc = dma_channel_get_default_config(control_channel);
+    channel_config_set_write_increment(&cc, true);
+    channel_config_set_ring(&cc, false, SEQ_RING_BITS);
+    dma_channel_configure(control_channel, &cc, &dma_hw->ch[data_channel].al3_transfer_count, blocks, 2, false);
+
+    dma_channel_config rc = dma_channel_get_default_config(reload_channel);
+    channel_config_set_read_increment(&rc, false);
+    dma_channel_configure(reload_channel, &rc, &dma_hw->ch[control_channel].al2_write_addr_trig,
+                          &control_write_addr, 1, false);
+
+    uint64_t start = hal_sim_cycle;
+    pio_sm_set_enabled(pio0, 0, true);
+    dma_channel_start(control_channel);
+
+    sleep_ms(20);
+
+    hal_sim_dma_get_stats(data_channel, &data);
+    hal_sim_dma_get_stats(control_channel, &control);
+    hal_sim_dma_get_stats(reload_channel, &reload);
+
+    // every 32 clocks the state machine pulls a word, the FIFO holds 8 more
+    uint64_t pulls = (hal_sim_cycle - start) / SEQ_CLK_DIV / 32;
+    check(data.transfers >= pulls && data.transfers <= pulls + 9, "sequencer", "data words vs PIO pulls",
+          data.transfers, pulls);
+    check(hal_sim_pio_stall_cycles(0, 0) == 0, "sequencer", "PIO stall cycles (FIFO ran dry)",
+          hal_sim_pio_stall_cycles(0, 0), 0);
+    check(data.completions == data.transfers / SEQ_BLOCK, "sequencer", "data blocks", data.completions,
+          data.transfers / SEQ_BLOCK);
+    check(reload.chained == data.completions, "sequencer", "reload chained after every block", reload.chained,
+          data.completions);
+    check(control.triggers == reload.completions + 1, "sequencer", "control triggered by the reload channel",
+          control.triggers, reload.completions + 1);
+    check(control.ring_wraps == control.transfers / (2 * SEQ_LEVELS), "sequencer", "control block ring wraps",
+          control.ring_wraps, control.transfers / (2 * SEQ_LEVELS));
+    check(control.bad_wraps == 0, "sequencer", "bad ring wraps", control.bad_wraps, 0);
+
+    // the level the data channel streams now is the block before the control channel's next one
+    uint next = (dma_hw->ch[control_channel].read_addr - (uint32_t) (uintptr_t) blocks) / sizeof(control_block_t);
+    uint level = (next + SEQ_LEVELS - 1) % SEQ_LEVELS;
+    check(dma_hw->ch[data_channel].read_addr == (uint32_t) (uintptr_t) &levels[level], "sequencer",
+          "data channel reads the current level", level, data.completions % SEQ_LEVELS);
+
+    pio_sm_set_enabled(pio0, 0, false);
+    dma_channel_abort(data_channel);
+    dma_channel_abort(control_channel);
+    dma_channel_abort(reload_channel);
+}
+
+static uint32_t table[16] __attribute__((aligned(64)));
+static uint32_t padded[32] __attribute__((aligned(64)));
+static uint32_t sink[64];
+
+/**
+ * Run 64 words through a 64-byte read ring starting at from
+ *
+ * @param from - first word, the ring wraps to the 64-byte boundary below it
+ * @param wraps - receives the ring wraps of this run
+ * @param bad_wraps - receives the wraps that missed from
+ *
+ * @return void
+ */
+static void ring_copy(const uint32_t *from, uint64_t *wraps, uint64_t *bad_wraps) {
+    hal_sim_dma_stats_t before;
+    hal_sim_dma_stats_t after;
+    int channel = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(channel);
+
+    // the counters add up over the channel's life
+    hal_sim_dma_get_stats(channel, &before);
+
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, false, 6);
+    dma_channel_configure(channel, &c, sink, from, 64, true);
+
+    hal_sim_dma_get_stats(channel, &after);
+    *wraps = after.ring_wraps - before.ring_wraps;
+    *bad_wraps = after.bad_wraps - before.bad_wraps;
+
+    dma_channel_acknowledge_irq0(channel);
+    dma_channel_unclaim(channel);
+}
+
+/**
+ * A ring only wraps back to the start of a naturally aligned table
+ *
+ * @return void
+ */
+static void check_ring(void) {
+    uint64_t wraps;
+    uint64_t bad_wraps;
+
+    for (uint32_t i = 0; i < 16; i++) {
+        table[i] = i;
+        padded[i] = 100;
+        padded[i + 16] = i;
+    }
+
+    // 64 words through 16, the last one wraps too
+    ring_copy(table, &wraps, &bad_wraps);
+    check(wraps == 4, "ring", "aligned table wraps", wraps, 4);
+    check(bad_wraps == 0, "ring", "aligned table bad wraps", bad_wraps, 0);
+    check(sink[16] == 0 && sink[63] == 15, "ring", "aligned table repeats", sink[16], 0);
+
+    // a 16-word table placed 4 words into a 64-byte block
+    ring_copy(&padded[4], &wraps, &bad_wraps);
+    check(bad_wraps == wraps && wraps > 0, "ring", "misaligned table reported", bad_wraps, wraps);
+    check(sink[12] == padded[0], "ring", "misaligned table wraps below its start", sink[12], padded[0]);
+}
+
+static uint32_t memcpy_src[16];
+static uint32_t memcpy_dst[2][16];
+static volatile uint32_t handled;
+static int irq_channels[2];
+
+static void dma_irq_handler(void) {
+    for (int i = 0; i < 2; i++) {
+        if (dma_hw->ints0 & (1u << irq_channels[i])) {
+            handled |= 1u << i;
+            dma_hw->ints0 = 1u << irq_channels[i];
+        }
+    }
+}
+
+/**
+ * Chained memcpy channels, INTR/ints0 flags and IRQ_QUIET
+ *
+ * @return void
+ */
+static void check_irq(void) {
+    hal_sim_dma_stats_t first;
+    hal_sim_dma_stats_t second;
+
+    for (uint32_t i = 0; i < 16; i++) {
+        memcpy_src[i] = 0x1000 + i;
+    }
+
+    irq_channels[0] = dma_claim_unused_channel(true);
+    irq_channels[1] = dma_claim_unused_channel(true);
+
+    dma_channel_config a = dma_channel_get_default_config(irq_channels[0]);
+    channel_config_set_write_increment(&a, true);
+    channel_config_set_chain_to(&a, irq_channels[1]);
+    dma_channel_configure(irq_channels[0], &a, memcpy_dst[0], memcpy_src, 16, false);
+
+    dma_channel_config b = dma_channel_get_default_config(irq_channels[1]);
+    channel_config_set_write_increment(&b, true);
+    channel_config_set_irq_quiet(&b, true);
+    dma_channel_configure(irq_channels[1], &b, memcpy_dst[1], memcpy_src, 16, false);
+
+    dma_channel_set_irq0_enabled(irq_channels[0], true);
+    dma_channel_set_irq0_enabled(irq_channels[1], true);
+    irq_set_exclusive_handler(DMA_IRQ_0, dma_irq_handler);
+    irq_set_enabled(DMA_IRQ_0, true);
+
+    dma_channel_start(irq_channels[0]);
+    dma_channel_wait_for_finish_blocking(irq_channels[1]);
+
+    hal_sim_dma_get_stats(irq_channels[0], &first);
+    hal_sim_dma_get_stats(irq_channels[1], &second);
+
+    check(memcmp(memcpy_dst[0], memcpy_src, sizeof(memcpy_src)) == 0 &&
+          memcmp(memcpy_dst[1], memcpy_src, sizeof(memcpy_src)) == 0, "irq", "both copies done", 0, 1);
+    check(second.chained == 1, "irq", "second channel chained", second.chained, 1);
+    check(handled == 1, "irq", "handled channels (the second is IRQ_QUIET)", handled, 1);
+    check(dma_hw->ints0 == 0, "irq", "ints0 after acknowledging", dma_hw->ints0, 0);
+
+    irq_set_enabled(DMA_IRQ_0, false);
+}
+
+int main() {
+    check_pwm_dma();
+    check_sequencer();
+    check_ring();
+    check_irq();
+
+    printf("dma_check: %d checks, %d failures\n", checks, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,591 @@
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hal_sim.h"
+
+/**
+ * DMA model
+ *
+ * The channel registers live in dma_hw like on the chip, the model
+ * keeps all four aliases of a channel in sync after every change, so
+ * code that reads e.g. dma_hw->ch[n].read_addr sees the live address.
+ *
+ * Writes have side effects (triggers, write-to-clear), plain memory
+ * can't see them, so:
+ *
+ * - CPU writes go through the dma_* functions below, except writing
+ *   intr/ints0/ints1 from a handler to acknowledge: while a handler
+ *   runs they read with IRQ_MARK set, whatever else the handler
+ *   leaves there is acknowledged when it returns. Writing back the
+ *   value read (`ints0 = ints0`) can't be told from no write at all,
+ *   write the channel bits
+ * - DMA writes (control blocks into another channel's aliases, words
+ *   into a PIO TX FIFO) go through write_word() and are decoded
+ *
+ * Addresses are 32-bit like on the chip, the simulator is linked
+ * without PIE so static buffers and the register blocks fit.
+ *
+ * Paced by DREQ: PWM wraps are counted per channel (the hardware's
+ * 6-bit credit counter), PIO TX is up while the FIFO has room, FORCE
+ * is always up. Channels take turns one transfer at a time, and a
+ * transfer takes no time.
+ *
+ * Every channel keeps counters (hal_sim_dma_stats_t), the summary at
+ * the end of a run shows them: chaining shows up as chained triggers,
+ * a ring over a misaligned buffer as bad wraps, DREQs that came while
+ * nothing was waiting for them as missed.
+ */
+
+#define CTRL_SIZE(ctrl) (1u << (((ctrl) & DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS) >> DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB))
+#define CTRL_RING(ctrl) (((ctrl) & DMA_CH0_CTRL_TRIG_RING_SIZE_BITS) >> DMA_CH0_CTRL_TRIG_RING_SIZE_LSB)
+#define CTRL_CHAIN(ctrl) (((ctrl) & DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS) >> DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB)
+#define CTRL_TREQ(ctrl) (((ctrl) & DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS) >> DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB)
+
+// most DREQs a channel can have banked
+#define CREDIT_MAX 63
+// set in the status registers while a handler runs, no channel uses it
+#define IRQ_MARK (1u << 31)
+
+// register of each alias slot: which field and whether it triggers
+enum { REG_READ, REG_WRITE, REG_COUNT, REG_CTRL };
+
+static const struct {
+    uint8_t reg;
+    bool trigger;
+} aliases[16] = {
+    {REG_READ, false}, {REG_WRITE, false}, {REG_COUNT, false}, {REG_CTRL, true},
+    {REG_CTRL, false}, {REG_READ, false}, {REG_WRITE, false}, {REG_COUNT, true},
+    {REG_CTRL, false}, {REG_COUNT, false}, {REG_READ, false}, {REG_WRITE, true},
+    {REG_CTRL, false}, {REG_WRITE, false}, {REG_COUNT, false}, {REG_READ, true},
+};
+
+dma_hw_t hal_sim_dma_hw;
+
+static uint32_t claimed;
+static uint32_t busy;
+static uint32_t reload[NUM_DMA_CHANNELS];
+static uint32_t credits[NUM_DMA_CHANNELS];
+static uint32_t intr;
+static hal_sim_dma_stats_t stats[NUM_DMA_CHANNELS];
+// an address register was written since the last trigger
+static uint32_t read_written;
+static uint32_t write_written;
+static uint32_t next_channel;
+static bool servicing;
+static bool in_irq;
+// status registers as a handler found them
+static uint32_t irq_seen[3];
+
+/**
+ * Mirror a channel's state into all of its alias registers
+ *
+ * @param ch - channel
+ * @param read_addr
+ * @param write_addr
+ * @param count - transfers left
+ * @param ctrl - without the busy bit
+ *
+ * @return void
+ */
+static void store(unsigned int ch, uint32_t read_addr, uint32_t write_addr, uint32_t count, uint32_t ctrl) {
+    dma_channel_hw_t *hw = &dma_hw->ch[ch];
+
+    ctrl &= ~DMA_CH0_CTRL_TRIG_BUSY_BITS;
+    if (busy & (1u << ch)) ctrl |= DMA_CH0_CTRL_TRIG_BUSY_BITS;
+
+    hw->read_addr = hw->al1_read_addr = hw->al2_read_addr = hw->al3_read_addr_trig = read_addr;
+    hw->write_addr = hw->al1_write_addr = hw->al2_write_addr_trig = hw->al3_write_addr = write_addr;
+    hw->transfer_count = hw->al1_transfer_count_trig = hw->al2_transfer_count = hw->al3_transfer_count = count;
+    hw->ctrl_trig = hw->al1_ctrl = hw->al2_ctrl = hw->al3_ctrl = ctrl;
+}
+
+/**
+ * Update the interrupt lines and the visible status registers
+ *
+ * Inside a handler they're left alone, see hal_sim_dma_irq_end().
+ *
+ * @return void
+ */
+static void update_irqs(void) {
+    uint32_t ints0 = (intr & dma_hw->inte0) | dma_hw->intf0;
+    uint32_t ints1 = (intr & dma_hw->inte1) | dma_hw->intf1;
+
+    if (!in_irq) {
+        dma_hw->intr = intr;
+        dma_hw->ints0 = ints0;
+        dma_hw->ints1 = ints1;
+    }
+
+    hal_sim_irq_set_pending(DMA_IRQ_0, ints0 != 0);
+    hal_sim_irq_set_pending(DMA_IRQ_1, ints1 != 0);
+}
+
+static void trigger(unsigned int ch);
+
+/**
+ * A channel ran out of transfers: raise its interrupt and chain
+ *
+ * @param ch - channel
+ *
+ * @return void
+ */
+static void complete(unsigned int ch) {
+    dma_channel_hw_t *hw = &dma_hw->ch[ch];
+    uint32_t ctrl = hw->al1_ctrl;
+
+    busy &= ~(1u << ch);
+    store(ch, hw->read_addr, hw->write_addr, 0, ctrl);
+
+    stats[ch].completions++;
+
+    if (!(ctrl & DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS)) {
+        stats[ch].irqs++;
+        intr |= 1u << ch;
+        update_irqs();
+    }
+
+    // chaining to itself disables chaining
+    if (CTRL_CHAIN(ctrl) != ch) {
+        stats[CTRL_CHAIN(ctrl)].chained++;
+        trigger(CTRL_CHAIN(ctrl));
+    }
+}
+
+/**
+ * Start a channel with its reload count
+ *
+ * @param ch - channel
+ *
+ * @return void
+ */
+static void trigger(unsigned int ch) {
+    dma_channel_hw_t *hw = &dma_hw->ch[ch];
+
+    // a disabled channel doesn't start, the same as a paused one
+    if (!(hw->al1_ctrl & DMA_CH0_CTRL_TRIG_EN_BITS)) return;
+
+    busy |= 1u << ch;
+    store(ch, hw->read_addr, hw->write_addr, reload[ch], hw->al1_ctrl);
+    stats[ch].triggers++;
+
+    // a new buffer for the ring side, its wraps should come back here
+    bool ring_write = hw->al1_ctrl & DMA_CH0_CTRL_TRIG_RING_SEL_BITS;
+    if ((ring_write ? write_written : read_written) & (1u << ch)) {
+        stats[ch].ring_start = ring_write ? hw->write_addr : hw->read_addr;
+    }
+    read_written &= ~(1u << ch);
+    write_written &= ~(1u << ch);
+
+    if (reload[ch]) {
+        hal_sim_dma_service();
+    } else {
+        complete(ch);
+    }
+
+    // started by the CPU, a completion interrupt is taken before it goes on
+    if (!servicing) hal_sim_irq_dispatch();
+}
+
+/**
+ * Write one channel register through one of its aliases
+ *
+ * @param ch - channel
+ * @param slot - alias slot 0-15, the register's word offset in the channel
+ * @param value
+ *
+ * @return void
+ */
+static void channel_write(unsigned int ch, unsigned int slot, uint32_t value) {
+    dma_channel_hw_t *hw = &dma_hw->ch[ch];
+    uint32_t read_addr = hw->read_addr;
+    uint32_t write_addr = hw->write_addr;
+    uint32_t count = hw->transfer_count;
+    uint32_t ctrl = hw->al1_ctrl;
+
+    switch (aliases[slot].reg) {
+        case REG_READ:
+            read_addr = value;
+            read_written |= 1u << ch;
+            break;
+        case REG_WRITE:
+            write_addr = value;
+            write_written |= 1u << ch;
+            break;
+        case REG_COUNT:
+            // written to the reload value, the live count loads on a trigger
+            reload[ch] = value;
+            break;
+        case REG_CTRL:
+            ctrl = value;
+            break;
+    }
+
+    store(ch, read_addr, write_addr, count, ctrl);
+
+    // writing 0 to a trigger register is a null trigger
+    if (aliases[slot].trigger && value) trigger(ch);
+}
+
+/**
+ * Convert a host pointer to a bus address
+ *
+ * @param addr
+ *
+ * @return uint32_t
+ */
+static uint32_t bus_addr(const volatile void *addr) {
+    if ((uintptr_t) addr > UINT32_MAX) {
+        hal_sim_fail("DMA address %p doesn't fit 32 bits, use a static buffer", (const void *) addr);
+    }
+    return (uint32_t) (uintptr_t) addr;
+}
+
+/**
+ * Write a word to the DMA registers, from the DMA itself
+ *
+ * @param addr - bus address inside dma_hw
+ * @param value
+ *
+ * @return void
+ */
+static void register_write(uint32_t addr, uint32_t value) {
+    uint32_t offset = addr - bus_addr(dma_hw);
+
+    if (offset < sizeof(dma_hw->ch)) {
+        channel_write(offset / sizeof(dma_channel_hw_t), (offset % sizeof(dma_channel_hw_t)) / 4, value);
+        return;
+    }
+
+    volatile uint32_t *reg = (volatile uint32_t *) (uintptr_t) addr;
+
+    if (reg == &dma_hw->intr || reg == &dma_hw->ints0 || reg == &dma_hw->ints1) {
+        intr &= ~value;
+    } else if (reg == &dma_hw->multi_channel_trigger) {
+        dma_start_channel_mask(value);
+        return;
+    } else if (reg == &dma_hw->abort) {
+        for (unsigned int ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+            if (value & (1u << ch)) dma_channel_abort(ch);
+        }
+        return;
+    } else {
+        *reg = value;
+    }
+
+    update_irqs();
+}
+
+/**
+ * Write one transfer to its destination, decoding register writes
+ *
+ * @param addr - bus address
+ * @param size - 1, 2 or 4 bytes
+ * @param value
+ *
+ * @return void
+ */
+static void write_word(uint32_t addr, uint32_t size, uint32_t value) {
+    uint32_t base = bus_addr(dma_hw);
+
+    if (addr >= base && addr < base + sizeof(dma_hw_t)) {
+        register_write(addr, value);
+    } else if (!hal_sim_pio_write_hook(addr, value)) {
+        memcpy((void *) (uintptr_t) addr, &value, size);
+    }
+}
+
+/**
+ * Check if a channel's DREQ is up
+ *
+ * @param ch - channel
+ * @param treq - its TREQ_SEL
+ *
+ * @return bool
+ */
+static bool dreq_ready(unsigned int ch, uint32_t treq) {
+    if (treq == DREQ_FORCE) return true;
+    if (treq <= DREQ_PIO1_TX3 && (treq & 4) == 0) return hal_sim_pio_tx_ready(treq);
+    if (treq >= DREQ_PWM_WRAP0 && treq <= DREQ_PWM_WRAP7) return credits[ch] > 0;
+
+    hal_sim_fail("DMA channel %u is paced by DREQ %u, which isn't simulated", ch, treq);
+}
+
+/**
+ * Do one transfer on a busy channel
+ *
+ * @param ch - channel
+ *
+ * @return void
+ */
+static void transfer(unsigned int ch) {
+    dma_channel_hw_t *hw = &dma_hw->ch[ch];
+    uint32_t ctrl = hw->al1_ctrl;
+    uint32_t size = CTRL_SIZE(ctrl);
+    uint32_t read_addr = hw->read_addr;
+    uint32_t write_addr = hw->write_addr;
+    uint32_t value = 0;
+
+    if (!read_addr || !write_addr) {
+        hal_sim_fail("DMA channel %u started with a NULL %s address", ch, read_addr ? "write" : "read");
+    }
+
+    memcpy(&value, (const void *) (uintptr_t) read_addr, size);
+    if (ctrl & DMA_CH0_CTRL_TRIG_BSWAP_BITS) {
+        value = size == 4 ? __builtin_bswap32(value) : size == 2 ? __builtin_bswap16(value) : value;
+    }
+
+    if (credits[ch]) credits[ch]--;
+    stats[ch].transfers++;
+    stats[ch].bytes += size;
+
+    // the address update happens before the write, which may retrigger this channel
+    uint32_t ring = CTRL_RING(ctrl) ? (1u << CTRL_RING(ctrl)) - 1 : 0;
+    bool ring_write = ctrl & DMA_CH0_CTRL_TRIG_RING_SEL_BITS;
+    uint32_t next_read = read_addr;
+    uint32_t next_write = write_addr;
+
+    if (ctrl & DMA_CH0_CTRL_TRIG_INCR_READ_BITS) {
+        next_read = read_addr + size;
+        if (ring && !ring_write) next_read = (read_addr & ~ring) | (next_read & ring);
+    }
+    if (ctrl & DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS) {
+        next_write = write_addr + size;
+        if (ring && ring_write) next_write = (write_addr & ~ring) | (next_write & ring);
+    }
+
+    uint32_t ring_addr = ring_write ? write_addr : read_addr;
+    uint32_t ring_next = ring_write ? next_write : next_read;
+    if (ring && (ring_addr & ring) + size > ring && ring_next != ring_addr) {
+        stats[ch].ring_wraps++;
+        if (ring_next != stats[ch].ring_start) stats[ch].bad_wraps++;
+    }
+
+    uint32_t count = hw->transfer_count - 1;
+    store(ch, next_read, next_write, count, ctrl);
+
+    write_word(write_addr, size, value);
+
+    // the write didn't restart us, so we're done
+    if (!count && hw->transfer_count == 0) complete(ch);
+}
+
+/**
+ * Run transfers while any busy channel has its DREQ up
+ *
+ * @return void
+ */
+void hal_sim_dma_service(void) {
+    bool progress = true;
+
+    // transfers trigger other channels, the outer call picks them up
+    if (servicing) return;
+    servicing = true;
+
+    while (progress) {
+        progress = false;
+
+        for (unsigned int i = 0; i < NUM_DMA_CHANNELS && busy; i++) {
+            unsigned int ch = (next_channel + i) % NUM_DMA_CHANNELS;
+            if (!(busy & (1u << ch))) continue;
+            if (!dreq_ready(ch, CTRL_TREQ(dma_hw->ch[ch].al1_ctrl))) continue;
+
+            transfer(ch);
+            progress = true;
+        }
+        next_channel = (next_channel + 1) % NUM_DMA_CHANNELS;
+    }
+
+    servicing = false;
+}
+
+/**
+ * A peripheral raised a DREQ, bank it on the channels it paces
+ *
+ * @param dreq - DREQ number
+ *
+ * @return void
+ */
+void hal_sim_dma_dreq(unsigned int dreq) {
+    for (unsigned int ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        uint32_t ctrl = dma_hw->ch[ch].al1_ctrl;
+
+        if (CTRL_TREQ(ctrl) != dreq || !(ctrl & DMA_CH0_CTRL_TRIG_EN_BITS)) continue;
+
+        if (!(busy & (1u << ch)) || credits[ch] >= CREDIT_MAX) {
+            stats[ch].missed_dreqs++;
+            continue;
+        }
+
+        credits[ch]++;
+        if (credits[ch] > stats[ch].max_credits) stats[ch].max_credits = credits[ch];
+    }
+
+    hal_sim_dma_service();
+}
+
+void hal_sim_dma_irq_begin(void) {
+    in_irq = true;
+    irq_seen[0] = dma_hw->intr |= IRQ_MARK;
+    irq_seen[1] = dma_hw->ints0 |= IRQ_MARK;
+    irq_seen[2] = dma_hw->ints1 |= IRQ_MARK;
+}
+
+void hal_sim_dma_irq_end(void) {
+    volatile uint32_t *regs[3] = {&dma_hw->intr, &dma_hw->ints0, &dma_hw->ints1};
+
+    // a register that doesn't read back as the handler found it was written
+    for (unsigned int i = 0; i < 3; i++) {
+        if (*regs[i] != irq_seen[i]) intr &= ~(*regs[i] & ~IRQ_MARK);
+    }
+
+    in_irq = false;
+    update_irqs();
+}
+
+void dma_channel_claim(unsigned int channel) {
+    if (claimed & (1u << channel)) hal_sim_fail("DMA channel %u is already claimed", channel);
+    claimed |= 1u << channel;
+}
+
+void dma_channel_unclaim(unsigned int channel) {
+    claimed &= ~(1u << channel);
+}
+
+int dma_claim_unused_channel(bool required) {
+    for (unsigned int ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        if (!(claimed & (1u << ch))) {
+            claimed |= 1u << ch;
+            return ch;
+        }
+    }
+
+    if (required) hal_sim_fail("no free DMA channel");
+    return -1;
+}
+
+bool dma_channel_is_claimed(unsigned int channel) {
+    return claimed & (1u << channel);
+}
+
+void dma_channel_set_config(unsigned int channel, const dma_channel_config *config, bool trigger) {
+    channel_write(channel, trigger ? 3 : 4, config->ctrl);
+}
+
+void dma_channel_set_read_addr(unsigned int channel, const volatile void *read_addr, bool trigger) {
+    channel_write(channel, trigger ? 15 : 0, bus_addr(read_addr));
+}
+
+void dma_channel_set_write_addr(unsigned int channel, volatile void *write_addr, bool trigger) {
+    channel_write(channel, trigger ? 11 : 1, bus_addr(write_addr));
+}
+
+void dma_channel_set_trans_count(unsigned int channel, uint32_t trans_count, bool trigger) {
+    channel_write(channel, trigger ? 7 : 2, trans_count);
+}
+
+void dma_channel_configure(unsigned int channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, unsigned int transfer_count, bool trigger) {
+    dma_channel_set_read_addr(channel, read_addr, false);
+    dma_channel_set_write_addr(channel, write_addr, false);
+    dma_channel_set_trans_count(channel, transfer_count, false);
+    dma_channel_set_config(channel, config, trigger);
+}
+
+void dma_start_channel_mask(uint32_t chan_mask) {
+    for (unsigned int ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        if (chan_mask & (1u << ch)) trigger(ch);
+    }
+}
+
+void dma_channel_abort(unsigned int channel) {
+    dma_channel_hw_t *hw = &dma_hw->ch[channel];
+
+    busy &= ~(1u << channel);
+    credits[channel] = 0;
+    store(channel, hw->read_addr, hw->write_addr, hw->transfer_count, hw->al1_ctrl);
+}
+
+bool dma_channel_is_busy(unsigned int channel) {
+    return busy & (1u << channel);
+}
+
+void dma_channel_wait_for_finish_blocking(unsigned int channel) {
+    while (dma_channel_is_busy(channel)) {
+        tight_loop_contents();
+    }
+}
+
+void dma_channel_set_irq0_enabled(unsigned int channel, bool enabled) {
+    dma_hw->inte0 = enabled ? dma_hw->inte0 | (1u << channel) : dma_hw->inte0 & ~(1u << channel);
+    update_irqs();
+}
+
+void dma_channel_set_irq1_enabled(unsigned int channel, bool enabled) {
+    dma_hw->inte1 = enabled ? dma_hw->inte1 | (1u << channel) : dma_hw->inte1 & ~(1u << channel);
+    update_irqs();
+}
+
+bool dma_channel_get_irq0_status(unsigned int channel) {
+    return (intr & dma_hw->inte0) & (1u << channel);
+}
+
+bool dma_channel_get_irq1_status(unsigned int channel) {
+    return (intr & dma_hw->inte1) & (1u << channel);
+}
+
+void dma_channel_acknowledge_irq0(unsigned int channel) {
+    intr &= ~(1u << channel);
+    update_irqs();
+}
+
+void dma_channel_acknowledge_irq1(unsigned int channel) {
+    intr &= ~(1u << channel);
+    update_irqs();
+}
+
+/**
+ * Get a channel's counters
+ *
+ * @param channel
+ * @param out - receives the counters
+ *
+ * @return void
+ */
+void hal_sim_dma_get_stats(unsigned int channel, hal_sim_dma_stats_t *out) {
+    *out = stats[channel];
+}
+
+/**
+ * Print the counters of every channel that ran, and how much of the
+ * DMA's bandwidth (one transfer per system cycle) was used
+ *
+ * @return void
+ */
+void hal_sim_dma_report(void) {
+    uint64_t transfers = 0;
+
+    for (unsigned int ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        transfers += stats[ch].transfers;
+    }
+    if (!transfers) return;
+
+    fprintf(stderr, "%-5s %10s %10s %12s %10s %8s %8s %8s %10s %7s\n", "dma", "triggers", "chained", "transfers",
+            "intr", "wraps", "bad", "missed", "per s", "banked");
+
+    for (unsigned int ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        hal_sim_dma_stats_t *s = &stats[ch];
+        if (!s->triggers) continue;
+
+        fprintf(stderr, "ch%-3u %10llu %10llu %12llu %10llu %8llu %8llu %8llu %10.1f %7u\n", ch,
+                (unsigned long long) s->triggers, (unsigned long long) s->chained,
+                (unsigned long long) s->transfers, (unsigned long long) s->irqs,
+                (unsigned long long) s->ring_wraps, (unsigned long long) s->bad_wraps,
+                (unsigned long long) s->missed_dreqs,
+                hal_sim_cycle ? (double) s->transfers * HAL_SIM_SYS_CLK / hal_sim_cycle : 0, s->max_credits);
+    }
+
+    fprintf(stderr, "dma bus: %llu transfers, %.4f%% of one transfer per cycle\n", (unsigned long long) transfers,
+            hal_sim_cycle ? 100.0 * transfers / hal_sim_cycle : 0);
+}
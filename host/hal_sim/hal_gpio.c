@@ -0,0 +1,367 @@
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hal_sim.h"
+
+// what each pin did, for the summary
+typedef struct {
+    uint64_t edges;
+    uint64_t rises;
+    uint64_t first_rise;
+    uint64_t last_rise;
+    // cycles spent high, up to the last rising edge
+    uint64_t high_cycles;
+    uint64_t high_at_first_rise;
+    uint64_t high_at_last_rise;
+    uint64_t last_change;
+    bool used;
+} pin_stats_t;
+
+static uint8_t functions[NUM_BANK0_GPIOS];
+static uint32_t sio_out;
+static uint32_t sio_oe;
+static uint32_t pull_up;
+static uint32_t pull_down;
+// pins held by hal_sim_gpio_set_input(), win over the pulls
+static uint32_t external_mask;
+static uint32_t external_levels;
+
+// what each peripheral drives, levels and output enables
+static uint32_t source_levels[HAL_SIM_SOURCES];
+static uint32_t source_oe[HAL_SIM_SOURCES];
+
+// current level of every traced pin, bit HAL_SIM_PIN_LED is the cyw43 LED
+static uint32_t levels;
+static pin_stats_t stats[HAL_SIM_PINS];
+
+static FILE *vcd;
+static uint64_t vcd_time = UINT64_MAX;
+
+static void __attribute__((constructor)) gpio_reset(void) {
+    memset(functions, GPIO_FUNC_NULL, sizeof(functions));
+}
+
+/**
+ * Get the VCD identifier of a pin, one printable character
+ *
+ * @param pin
+ *
+ * @return char
+ */
+static char vcd_id(unsigned int pin) {
+    return '!' + pin;
+}
+
+/**
+ * Record a pin change in the statistics and the VCD file
+ *
+ * @param pin
+ * @param level - new level
+ *
+ * @return void
+ */
+static void trace_pin(unsigned int pin, bool level) {
+    pin_stats_t *s = &stats[pin];
+    uint64_t now = hal_sim_cycle;
+
+    if (!level) {
+        s->high_cycles += now - s->last_change;
+    }
+    s->last_change = now;
+    s->edges++;
+
+    if (level) {
+        if (!s->rises++) {
+            s->first_rise = now;
+            s->high_at_first_rise = s->high_cycles;
+        }
+        s->last_rise = now;
+        s->high_at_last_rise = s->high_cycles;
+    }
+
+    if (vcd) {
+        if (now != vcd_time) {
+            fprintf(vcd, "#%llu\n", (unsigned long long) (now * 1000 / HAL_SIM_CYCLES_PER_US));
+            vcd_time = now;
+        }
+        fprintf(vcd, "%d%c\n", level, vcd_id(pin));
+    }
+}
+
+/**
+ * Get the level of a GPIO from whatever its function selects
+ *
+ * @param gpio
+ *
+ * @return bool
+ */
+static bool pin_level(unsigned int gpio) {
+    uint32_t bit = 1u << gpio;
+    int source = -1;
+
+    switch (functions[gpio]) {
+        case GPIO_FUNC_SIO:
+            source = HAL_SIM_SOURCE_SIO;
+            break;
+        case GPIO_FUNC_PWM:
+            source = HAL_SIM_SOURCE_PWM;
+            break;
+        case GPIO_FUNC_PIO0:
+            source = HAL_SIM_SOURCE_PIO0;
+            break;
+        case GPIO_FUNC_PIO1:
+            source = HAL_SIM_SOURCE_PIO1;
+            break;
+        default:
+            break;
+    }
+
+    if (source >= 0 && (source_oe[source] & bit)) {
+        return source_levels[source] & bit;
+    }
+    // an input, whatever is outside or the pulls
+    if (external_mask & bit) return external_levels & bit;
+    return pull_up & bit;
+}
+
+/**
+ * Re-evaluate some pins and trace the ones that changed
+ *
+ * @param mask - pins to look at
+ *
+ * @return void
+ */
+static void update_pins(uint32_t mask) {
+    uint32_t old = levels;
+
+    mask &= (1u << NUM_BANK0_GPIOS) - 1;
+    while (mask) {
+        unsigned int gpio = __builtin_ctz(mask);
+        mask &= mask - 1;
+
+        if (pin_level(gpio) != ((levels >> gpio) & 1)) {
+            levels ^= 1u << gpio;
+            trace_pin(gpio, (levels >> gpio) & 1);
+        }
+    }
+
+    // the PIO blocks read the pads back
+    if (levels != old) hal_sim_pio_set_inputs(levels);
+}
+
+/**
+ * Set what a peripheral drives, pins it doesn't own are ignored
+ *
+ * @param source - HAL_SIM_SOURCE_*
+ * @param new_levels - output levels, one bit per GPIO
+ * @param oe - output enables, one bit per GPIO
+ *
+ * @return void
+ */
+void hal_sim_gpio_drive(unsigned int source, uint32_t new_levels, uint32_t oe) {
+    uint32_t changed = (source_levels[source] ^ new_levels) | (source_oe[source] ^ oe);
+
+    source_levels[source] = new_levels;
+    source_oe[source] = oe;
+    if (changed) update_pins(changed);
+}
+
+/**
+ * Drive an input from outside, e.g. a button
+ *
+ * @param gpio
+ * @param level
+ *
+ * @return void
+ */
+void hal_sim_gpio_set_input(unsigned int gpio, bool level) {
+    external_mask |= 1u << gpio;
+    external_levels = level ? external_levels | (1u << gpio) : external_levels & ~(1u << gpio);
+    update_pins(1u << gpio);
+}
+
+void hal_sim_led_put(bool level) {
+    stats[HAL_SIM_PIN_LED].used = true;
+    if (level == ((levels >> HAL_SIM_PIN_LED) & 1)) return;
+
+    levels ^= 1u << HAL_SIM_PIN_LED;
+    trace_pin(HAL_SIM_PIN_LED, level);
+}
+
+bool hal_sim_led_get(void) {
+    return (levels >> HAL_SIM_PIN_LED) & 1;
+}
+
+void gpio_set_function(unsigned int gpio, enum gpio_function fn) {
+    functions[gpio] = fn;
+    stats[gpio].used = fn != GPIO_FUNC_NULL;
+    update_pins(1u << gpio);
+}
+
+enum gpio_function gpio_get_function(unsigned int gpio) {
+    return functions[gpio];
+}
+
+void gpio_init(unsigned int gpio) {
+    sio_oe &= ~(1u << gpio);
+    sio_out &= ~(1u << gpio);
+    gpio_set_function(gpio, GPIO_FUNC_SIO);
+}
+
+void gpio_init_mask(uint32_t mask) {
+    for (unsigned int gpio = 0; gpio < NUM_BANK0_GPIOS; gpio++) {
+        if (mask & (1u << gpio)) gpio_init(gpio);
+    }
+}
+
+static void sio_update(void) {
+    hal_sim_gpio_drive(HAL_SIM_SOURCE_SIO, sio_out, sio_oe);
+}
+
+void gpio_set_dir(unsigned int gpio, bool out) {
+    sio_oe = out ? sio_oe | (1u << gpio) : sio_oe & ~(1u << gpio);
+    sio_update();
+}
+
+void gpio_set_dir_out_masked(uint32_t mask) {
+    sio_oe |= mask;
+    sio_update();
+}
+
+void gpio_set_dir_in_masked(uint32_t mask) {
+    sio_oe &= ~mask;
+    sio_update();
+}
+
+void gpio_put(unsigned int gpio, bool value) {
+    sio_out = value ? sio_out | (1u << gpio) : sio_out & ~(1u << gpio);
+    sio_update();
+}
+
+void gpio_put_masked(uint32_t mask, uint32_t value) {
+    sio_out = (sio_out & ~mask) | (value & mask);
+    sio_update();
+}
+
+void gpio_put_all(uint32_t value) {
+    sio_out = value;
+    sio_update();
+}
+
+void gpio_set_mask(uint32_t mask) {
+    sio_out |= mask;
+    sio_update();
+}
+
+void gpio_clr_mask(uint32_t mask) {
+    sio_out &= ~mask;
+    sio_update();
+}
+
+void gpio_xor_mask(uint32_t mask) {
+    sio_out ^= mask;
+    sio_update();
+}
+
+bool gpio_get(unsigned int gpio) {
+    return (levels >> gpio) & 1;
+}
+
+uint32_t gpio_get_all(void) {
+    return levels & ((1u << NUM_BANK0_GPIOS) - 1);
+}
+
+void gpio_set_pulls(unsigned int gpio, bool up, bool down) {
+    pull_up = up ? pull_up | (1u << gpio) : pull_up & ~(1u << gpio);
+    pull_down = down ? pull_down | (1u << gpio) : pull_down & ~(1u << gpio);
+    update_pins(1u << gpio);
+}
+
+/**
+ * Start writing pin changes to a VCD file
+ *
+ * @param path
+ *
+ * @return bool - false if it can't be created
+ */
+bool hal_sim_trace_open(const char *path) {
+    vcd = fopen(path, "w");
+    if (!vcd) return false;
+
+    fprintf(vcd, "$timescale 1 ns $end\n$scope module rp2040 $end\n");
+    for (unsigned int pin = 0; pin < NUM_BANK0_GPIOS; pin++) {
+        fprintf(vcd, "$var wire 1 %c gpio%u $end\n", vcd_id(pin), pin);
+    }
+    fprintf(vcd, "$var wire 1 %c wl_led $end\n", vcd_id(HAL_SIM_PIN_LED));
+    fprintf(vcd, "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n");
+    for (unsigned int pin = 0; pin < HAL_SIM_PINS; pin++) {
+        fprintf(vcd, "%d%c\n", (levels >> pin) & 1, vcd_id(pin));
+    }
+    fprintf(vcd, "$end\n");
+    vcd_time = 0;
+    return true;
+}
+
+void hal_sim_trace_close(void) {
+    if (!vcd) return;
+
+    // the end time, so viewers show the last state for as long as it lasted
+    fprintf(vcd, "#%llu\n", (unsigned long long) (hal_sim_cycle * 1000 / HAL_SIM_CYCLES_PER_US));
+    fclose(vcd);
+    vcd = NULL;
+}
+
+static const char *pin_source(unsigned int pin) {
+    if (pin == HAL_SIM_PIN_LED) return "cyw43";
+
+    switch (functions[pin]) {
+        case GPIO_FUNC_SIO:
+            return "sio";
+        case GPIO_FUNC_PWM:
+            return "pwm";
+        case GPIO_FUNC_PIO0:
+            return "pio0";
+        case GPIO_FUNC_PIO1:
+            return "pio1";
+        default:
+            return "-";
+    }
+}
+
+/**
+ * Print what every used pin did, frequency and duty over whole periods
+ *
+ * @return void
+ */
+void hal_sim_trace_report(void) {
+    fprintf(stderr, "%-8s %-6s %10s %16s %8s %6s\n", "pin", "source", "edges", "frequency", "duty", "level");
+
+    for (unsigned int pin = 0; pin < HAL_SIM_PINS; pin++) {
+        pin_stats_t *s = &stats[pin];
+        char name[8];
+
+        if (!s->used && !s->edges) continue;
+
+        if (pin == HAL_SIM_PIN_LED) {
+            snprintf(name, sizeof(name), "wl_led");
+        } else {
+            snprintf(name, sizeof(name), "gpio%u", pin);
+        }
+
+        fprintf(stderr, "%-8s %-6s %10llu ", name, pin_source(pin), (unsigned long long) s->edges);
+
+        if (s->rises >= 2) {
+            // rising edge to rising edge, so a partial period doesn't skew it
+            uint64_t span = s->last_rise - s->first_rise;
+            double periods = s->rises - 1;
+            double hz = periods * HAL_SIM_SYS_CLK / span;
+            double duty = 100.0 * (s->high_at_last_rise - s->high_at_first_rise) / span;
+
+            fprintf(stderr, "%13.4f Hz %7.2f%% ", hz, duty);
+        } else {
+            fprintf(stderr, "%16s %8s ", "-", "-");
+        }
+
+        fprintf(stderr, "%6d\n", (levels >> pin) & 1);
+    }
+}
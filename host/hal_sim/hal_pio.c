@@ -0,0 +1,333 @@
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "pio_sim.h"
+#include "hal_sim.h"
+
+/**
+ * PIO model, the two blocks are pio_sim.c instances
+ *
+ * They run in lockstep with the rest of the simulator: before time
+ * moves to a cycle, every state machine clock up to it is stepped,
+ * oldest first across both blocks. Pin changes go to the GPIO model,
+ * a state machine about to run with room in its TX FIFO lets the DMA
+ * top it up first, at that cycle. A block with interrupt sources
+ * enabled is stepped one clock at a time so PIOx_IRQ_0 is raised at
+ * the cycle its FIFO or IRQ flag changes.
+ *
+ * pio0_hw/pio1_hw only exist for their addresses: the DMA writes to
+ * txf[] are routed here, the CPU uses the pio_* functions.
+ */
+
+pio_hw_t hal_sim_pio_hw[NUM_PIOS];
+
+static pio_sim_t sims[NUM_PIOS];
+static uint32_t claimed[NUM_PIOS];
+// INTE of PIOx_IRQ_0
+static uint32_t inte0[NUM_PIOS];
+
+static pio_sim_t *sim_of(PIO pio) {
+    return &sims[pio_get_index(pio)];
+}
+
+static unsigned int source_of(pio_sim_t *sim) {
+    return sim == &sims[1] ? HAL_SIM_SOURCE_PIO1 : HAL_SIM_SOURCE_PIO0;
+}
+
+static void pin_changed(pio_sim_t *sim, uint64_t cycle, uint32_t pins, uint32_t changed, void *user) {
+    hal_sim_cycle = cycle;
+    hal_sim_gpio_drive(source_of(sim), pins, sim->pindirs);
+}
+
+static void dreq(pio_sim_t *sim, uint sm, void *user) {
+    hal_sim_cycle = sim->cycle;
+    hal_sim_dma_service();
+    // a DMA completion is handled before the FIFO runs dry, like on the board
+    hal_sim_irq_dispatch();
+}
+
+/**
+ * Set the PIOx_IRQ_0 line from the raw interrupt status and INTE
+ *
+ * @param i - block
+ *
+ * @return void
+ */
+static void update_irq(unsigned int i) {
+    pio_sim_t *sim = &sims[i];
+    uint32_t intr = (sim->irq & 0xfu) << 8;
+
+    for (unsigned int sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+        if (pio_sim_sm_rx_level(sim, sm)) intr |= 1u << sm;
+        if (!pio_sim_sm_tx_full(sim, sm)) intr |= 1u << (4 + sm);
+    }
+
+    hal_sim_irq_set_pending(i ? PIO1_IRQ_0 : PIO0_IRQ_0, (intr & inte0[i]) != 0);
+}
+
+void hal_sim_pio_init(void) {
+    for (unsigned int i = 0; i < NUM_PIOS; i++) {
+        pio_sim_init(&sims[i]);
+        pio_sim_set_pin_callback(&sims[i], pin_changed, NULL);
+        pio_sim_set_dreq_callback(&sims[i], dreq, NULL);
+    }
+}
+
+/**
+ * Bring a block's clock up to now before touching its state machines
+ *
+ * @param sim
+ *
+ * @return pio_sim_t *
+ */
+static pio_sim_t *sync(pio_sim_t *sim) {
+    sim->cycle = hal_sim_cycle;
+    return sim;
+}
+
+/**
+ * Step every state machine clock up to a cycle, oldest first across both blocks
+ *
+ * @param cycle - system cycle
+ *
+ * @return void
+ */
+void hal_sim_pio_run_until(uint64_t cycle) {
+    while (true) {
+        uint64_t next0 = pio_sim_next_tick(&sims[0]);
+        uint64_t next1 = pio_sim_next_tick(&sims[1]);
+        uint64_t next = next0 < next1 ? next0 : next1;
+
+        if (next > cycle) break;
+
+        // run one block until the other one's next clock, or a
+        // single clock while it can interrupt
+        unsigned int i = next0 <= next1 ? 0 : 1;
+        uint64_t until = i ? next0 : next1;
+
+        if (inte0[i]) until = next;
+        pio_sim_run_until(&sims[i], until < cycle ? until : cycle);
+
+        if (inte0[i]) {
+            update_irq(i);
+            hal_sim_cycle = next;
+            hal_sim_irq_dispatch();
+        }
+    }
+
+    sims[0].cycle = cycle;
+    sims[1].cycle = cycle;
+}
+
+void hal_sim_pio_set_inputs(uint32_t levels) {
+    sims[0].gpio_in = levels;
+    sims[1].gpio_in = levels;
+}
+
+/**
+ * Check a TX DREQ, up while the FIFO has room
+ *
+ * @param dreq - DREQ_PIO0_TX0 .. DREQ_PIO1_TX3
+ *
+ * @return bool
+ */
+bool hal_sim_pio_tx_ready(unsigned int dreq) {
+    return !pio_sim_sm_tx_full(&sims[dreq >> 3], dreq & 3);
+}
+
+/**
+ * Route a DMA write to a TX FIFO register
+ *
+ * @param addr - bus address
+ * @param value
+ *
+ * @return bool - false if addr isn't a TX FIFO
+ */
+bool hal_sim_pio_write_hook(uint32_t addr, uint32_t value) {
+    for (unsigned int i = 0; i < NUM_PIOS; i++) {
+        uint32_t txf = (uint32_t) (uintptr_t) hal_sim_pio_hw[i].txf;
+
+        if (addr >= txf && addr < txf + sizeof(hal_sim_pio_hw[i].txf)) {
+            // a full FIFO drops the word, the hardware sets FDEBUG.TXOVER
+            if (!pio_sim_sm_put(&sims[i], (addr - txf) / 4, value)) {
+                hal_sim_pio_hw[i].fdebug |= 1u << (16 + (addr - txf) / 4);
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool pio_can_add_program(PIO pio, const struct pio_program *program) {
+    // try it on a copy
+    pio_sim_t copy = *sim_of(pio);
+    return pio_sim_add_program(&copy, program) >= 0;
+}
+
+unsigned int pio_add_program(PIO pio, const struct pio_program *program) {
+    int offset = pio_sim_add_program(sim_of(pio), program);
+    if (offset < 0) hal_sim_fail("no program space left in PIO%u", pio_get_index(pio));
+    return offset;
+}
+
+void pio_sm_claim(PIO pio, unsigned int sm) {
+    uint32_t *mask = &claimed[pio_get_index(pio)];
+
+    if (*mask & (1u << sm)) hal_sim_fail("PIO%u SM%u is already claimed", pio_get_index(pio), sm);
+    *mask |= 1u << sm;
+}
+
+void pio_sm_unclaim(PIO pio, unsigned int sm) {
+    claimed[pio_get_index(pio)] &= ~(1u << sm);
+}
+
+int pio_claim_unused_sm(PIO pio, bool required) {
+    for (unsigned int sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+        if (!(claimed[pio_get_index(pio)] & (1u << sm))) {
+            pio_sm_claim(pio, sm);
+            return sm;
+        }
+    }
+
+    if (required) hal_sim_fail("no free state machine in PIO%u", pio_get_index(pio));
+    return -1;
+}
+
+void pio_gpio_init(PIO pio, unsigned int pin) {
+    gpio_set_function(pin, pio_get_index(pio) ? GPIO_FUNC_PIO1 : GPIO_FUNC_PIO0);
+}
+
+void pio_sm_init(PIO pio, unsigned int sm, unsigned int initial_pc, const pio_sm_config *config) {
+    pio_sim_sm_init(sync(sim_of(pio)), sm, initial_pc, config);
+}
+
+void pio_sm_set_enabled(PIO pio, unsigned int sm, bool enabled) {
+    pio_sim_sm_set_enabled(sync(sim_of(pio)), sm, enabled);
+}
+
+void pio_sm_set_clkdiv_int_frac(PIO pio, unsigned int sm, uint16_t div_int, uint8_t div_frac) {
+    pio_sim_sm_set_clkdiv_int_frac(sync(sim_of(pio)), sm, div_int, div_frac);
+}
+
+void pio_sm_set_clkdiv(PIO pio, unsigned int sm, float div) {
+    uint16_t div_int = (uint16_t) div;
+    uint8_t div_frac = div_int ? (uint8_t) ((div - div_int) * 256) : 0;
+    pio_sm_set_clkdiv_int_frac(pio, sm, div_int, div_frac);
+}
+
+void pio_sm_set_consecutive_pindirs(PIO pio, unsigned int sm, unsigned int pin_base, unsigned int pin_count, bool is_out) {
+    pio_sim_t *sim = sim_of(pio);
+    uint32_t mask = ((1u << pin_count) - 1) << pin_base;
+
+    sim->pindirs = is_out ? sim->pindirs | mask : sim->pindirs & ~mask;
+    hal_sim_gpio_drive(source_of(sim), sim->pins, sim->pindirs);
+}
+
+void pio_sm_set_pins_with_mask(PIO pio, unsigned int sm, uint32_t pin_values, uint32_t pin_mask) {
+    pio_sim_t *sim = sim_of(pio);
+
+    sim->pins = (sim->pins & ~pin_mask) | (pin_values & pin_mask);
+    hal_sim_gpio_drive(source_of(sim), sim->pins, sim->pindirs);
+}
+
+void pio_sm_exec(PIO pio, unsigned int sm, unsigned int instr) {
+    pio_sim_sm_exec(sim_of(pio), sm, instr);
+}
+
+void pio_sm_clear_fifos(PIO pio, unsigned int sm) {
+    pio_sim_sm_clear_fifos(sim_of(pio), sm);
+    update_irq(pio_get_index(pio));
+}
+
+uint8_t pio_sm_get_pc(PIO pio, unsigned int sm) {
+    return sim_of(pio)->sm[sm].pc;
+}
+
+void pio_sm_put(PIO pio, unsigned int sm, uint32_t data) {
+    pio_sim_sm_put(sim_of(pio), sm, data);
+    update_irq(pio_get_index(pio));
+}
+
+void pio_set_irq0_source_enabled(PIO pio, enum pio_interrupt_source source, bool enabled) {
+    unsigned int i = pio_get_index(pio);
+
+    inte0[i] = enabled ? inte0[i] | (1u << source) : inte0[i] & ~(1u << source);
+    update_irq(i);
+}
+
+void pio_interrupt_clear(PIO pio, unsigned int pio_interrupt_num) {
+    sim_of(pio)->irq &= ~(1u << pio_interrupt_num);
+    update_irq(pio_get_index(pio));
+}
+
+/**
+ * Wait for the state machine's next clock, that's when FIFOs change
+ *
+ * @param sim
+ * @param sm
+ *
+ * @return void
+ */
+static void wait_for_clock(pio_sim_t *sim, unsigned int sm) {
+    if (!sim->sm[sm].enabled) hal_sim_fail("waiting on a FIFO of a disabled state machine");
+    hal_sim_wait_until(sim->sm[sm].next_tick >> 8);
+}
+
+void pio_sm_put_blocking(PIO pio, unsigned int sm, uint32_t data) {
+    pio_sim_t *sim = sim_of(pio);
+
+    while (pio_sim_sm_tx_full(sim, sm)) {
+        wait_for_clock(sim, sm);
+    }
+    pio_sim_sm_put(sim, sm, data);
+}
+
+uint32_t pio_sm_get(PIO pio, unsigned int sm) {
+    uint32_t data = 0;
+    pio_sim_sm_get(sim_of(pio), sm, &data);
+    update_irq(pio_get_index(pio));
+    return data;
+}
+
+uint32_t pio_sm_get_blocking(PIO pio, unsigned int sm) {
+    pio_sim_t *sim = sim_of(pio);
+    uint32_t data;
+
+    while (!pio_sim_sm_get(sim, sm, &data)) {
+        wait_for_clock(sim, sm);
+    }
+    return data;
+}
+
+bool pio_sm_is_tx_fifo_full(PIO pio, unsigned int sm) {
+    return pio_sim_sm_tx_full(sim_of(pio), sm);
+}
+
+bool pio_sm_is_tx_fifo_empty(PIO pio, unsigned int sm) {
+    return pio_sim_sm_tx_level(sim_of(pio), sm) == 0;
+}
+
+bool pio_sm_is_rx_fifo_empty(PIO pio, unsigned int sm) {
+    return pio_sim_sm_rx_level(sim_of(pio), sm) == 0;
+}
+
+unsigned int pio_sm_get_tx_fifo_level(PIO pio, unsigned int sm) {
+    return pio_sim_sm_tx_level(sim_of(pio), sm);
+}
+
+unsigned int pio_sm_get_rx_fifo_level(PIO pio, unsigned int sm) {
+    return pio_sim_sm_rx_level(sim_of(pio), sm);
+}
+
+/**
+ * Get the cycles a state machine spent stalled, e.g. on an empty TX FIFO
+ *
+ * @param pio - 0 or 1
+ * @param sm
+ *
+ * @return uint64_t
+ */
+uint64_t hal_sim_pio_stall_cycles(unsigned int pio, unsigned int sm) {
+    return sims[pio].sm[sm].stall_cycles;
+}
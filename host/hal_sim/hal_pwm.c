@@ -0,0 +1,189 @@
+#include "pico/stdlib.h"
+#include "hardware/pwm.h"
+#include "hal_sim.h"
+
+/**
+ * PWM model
+ *
+ * Nothing is counted, each running slice knows when its next wrap and
+ * compare edges are, in 1/16 system cycles so fractional dividers
+ * come out exact. TOP, CC and DIV are latched at every wrap like the
+ * hardware's double buffering, so a DMA write to CC on the wrap DREQ
+ * shows up one period later, same as on the board.
+ *
+ * Phase-correct mode isn't modelled.
+ */
+
+#define NEVER UINT64_MAX
+
+typedef struct {
+    bool running;
+    uint64_t period_start;
+    uint64_t next_wrap;
+    uint64_t fall[2];
+    uint32_t div16;
+    uint32_t top;
+} slice_state_t;
+
+pwm_hw_t hal_sim_pwm_hw;
+
+static slice_state_t slices[NUM_PWM_SLICES];
+// raw compare outputs, bit slice * 2 + channel
+static uint32_t outputs;
+
+/**
+ * Put the compare outputs on every GPIO that has a PWM function
+ *
+ * Slice n drives GPIO 2n, 2n + 1 and again 2n + 16, 2n + 17.
+ *
+ * @return void
+ */
+static void drive(void) {
+    uint32_t pins = 0;
+
+    for (unsigned int out = 0; out < NUM_PWM_SLICES * 2; out++) {
+        unsigned int slice = out >> 1;
+        uint32_t inv = pwm_hw->slice[slice].csr & (out & 1 ? PWM_CH0_CSR_B_INV_BITS : PWM_CH0_CSR_A_INV_BITS);
+        bool level = ((outputs >> out) & 1) ^ (inv != 0);
+
+        if (level) pins |= (1u << out) | (1u << (out + 16));
+    }
+
+    pins &= (1u << NUM_BANK0_GPIOS) - 1;
+    hal_sim_gpio_drive(HAL_SIM_SOURCE_PWM, pins, (1u << NUM_BANK0_GPIOS) - 1);
+}
+
+/**
+ * Latch the registers and start a counter period
+ *
+ * @param slice_num
+ * @param start - period start in 1/16 cycles
+ *
+ * @return void
+ */
+static void start_period(unsigned int slice_num, uint64_t start) {
+    slice_state_t *s = &slices[slice_num];
+    pwm_slice_hw_t *hw = &pwm_hw->slice[slice_num];
+    uint32_t div_int = (hw->div >> PWM_CH0_DIV_INT_LSB) & 0xff;
+    uint32_t cc = hw->cc;
+
+    // an integer part of 0 divides by 256
+    s->div16 = (div_int ? div_int : 256) * 16 + (hw->div & 0xf);
+    s->top = hw->top & 0xffff;
+    s->period_start = start;
+    s->next_wrap = start + (uint64_t) (s->top + 1) * s->div16;
+
+    for (unsigned int chan = 0; chan < 2; chan++) {
+        uint32_t level = chan ? cc >> PWM_CH0_CC_B_LSB : cc & 0xffff;
+        unsigned int out = slice_num * 2 + chan;
+
+        outputs = level ? outputs | (1u << out) : outputs & ~(1u << out);
+        // a level above TOP stays high the whole period
+        s->fall[chan] = level && level <= s->top ? start + (uint64_t) level * s->div16 : NEVER;
+    }
+}
+
+static uint64_t slice_next_event(const slice_state_t *s) {
+    if (!s->running) return NEVER;
+
+    uint64_t next = s->next_wrap;
+    if (s->fall[0] < next) next = s->fall[0];
+    if (s->fall[1] < next) next = s->fall[1];
+    return next;
+}
+
+/**
+ * Get the system cycle of the next wrap or edge of any slice
+ *
+ * @return uint64_t - UINT64_MAX if no slice runs
+ */
+uint64_t hal_sim_pwm_next_event(void) {
+    uint64_t next = NEVER;
+
+    for (unsigned int slice_num = 0; slice_num < NUM_PWM_SLICES; slice_num++) {
+        uint64_t event = slice_next_event(&slices[slice_num]);
+        if (event < next) next = event;
+    }
+
+    return next == NEVER ? NEVER : next >> 4;
+}
+
+/**
+ * Process every wrap and edge up to and including a cycle, in time order
+ *
+ * @param cycle - system cycle
+ *
+ * @return void
+ */
+void hal_sim_pwm_run_until(uint64_t cycle) {
+    uint64_t limit = (cycle << 4) | 15;
+
+    while (true) {
+        unsigned int slice_num = 0;
+        uint64_t event = NEVER;
+
+        for (unsigned int i = 0; i < NUM_PWM_SLICES; i++) {
+            uint64_t next = slice_next_event(&slices[i]);
+            if (next < event) {
+                event = next;
+                slice_num = i;
+            }
+        }
+        if (event > limit) break;
+
+        slice_state_t *s = &slices[slice_num];
+
+        if (event == s->next_wrap) {
+            start_period(slice_num, event);
+            drive();
+            // the wrap DREQ, the DMA writes the CC for the period after this one
+            hal_sim_dma_dreq(pwm_get_dreq(slice_num));
+            continue;
+        }
+
+        for (unsigned int chan = 0; chan < 2; chan++) {
+            if (s->fall[chan] == event) {
+                outputs &= ~(1u << (slice_num * 2 + chan));
+                s->fall[chan] = NEVER;
+            }
+        }
+        drive();
+    }
+}
+
+/**
+ * Pick up enables and disables, called by the pwm_* setters
+ *
+ * @param slice_num - slice, NUM_PWM_SLICES for all of them at once
+ *
+ * @return void
+ */
+void hal_sim_pwm_changed(unsigned int slice_num) {
+    unsigned int first = slice_num == NUM_PWM_SLICES ? 0 : slice_num;
+    unsigned int last = slice_num == NUM_PWM_SLICES ? NUM_PWM_SLICES - 1 : slice_num;
+
+    for (unsigned int i = first; i <= last; i++) {
+        slice_state_t *s = &slices[i];
+        bool enabled = pwm_hw->slice[i].csr & PWM_CH0_CSR_EN_BITS;
+
+        if (enabled && !s->running) {
+            s->running = true;
+            start_period(i, hal_sim_cycle << 4);
+        } else if (!enabled && s->running) {
+            // the counter stops, the outputs hold their level
+            pwm_hw->slice[i].ctr = pwm_get_counter(i);
+            s->running = false;
+        }
+    }
+
+    drive();
+}
+
+uint16_t pwm_get_counter(unsigned int slice_num) {
+    slice_state_t *s = &slices[slice_num];
+
+    if (!s->running) return pwm_hw->slice[slice_num].ctr;
+
+    uint64_t count = ((hal_sim_cycle << 4) - s->period_start) / s->div16;
+    return count > s->top ? s->top : count;
+}
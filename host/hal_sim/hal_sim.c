@@ -0,0 +1,437 @@
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "pico/multicore.h"
+#include "hardware/clocks.h"
+#include "hardware/irq.h"
+#include "hal_sim.h"
+
+// the example's main(), renamed at compile time
+int picow_main(void);
+
+// a handler that runs this often without time passing never acknowledges
+#define IRQ_STORM_LIMIT 100000
+
+uint64_t hal_sim_cycle;
+static uint64_t limit_cycle = 5ull * HAL_SIM_SYS_CLK;
+static bool quiet;
+static struct timespec wall_start;
+
+// only one core runs at a time, the other waits on its condition
+static pthread_mutex_t core_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t core_turn[2] = {PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER};
+static unsigned int running_core;
+static uint64_t core_wake[2];
+static bool core1_alive;
+static void (*core1_entry)(void);
+
+// core get_core_num() reports, the interrupted core's inside a handler
+static unsigned int current_core;
+
+// NVIC, one handler per interrupt, taken by core 0 or whoever enabled it
+static irq_handler_t handlers[NUM_IRQS];
+static unsigned int irq_core[NUM_IRQS];
+static uint32_t irq_enabled;
+static uint32_t irq_pending;
+static bool irqs_masked[2];
+static bool in_handler;
+static uint64_t irq_count;
+
+static bool cyw43_ready;
+
+/**
+ * Print the summary and leave, the device never returns from main()
+ *
+ * @param code - exit status
+ *
+ * @return void
+ */
+static void finish(int code) {
+    struct timespec now;
+
+    fflush(stdout);
+    hal_sim_trace_close();
+
+    if (!quiet) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double wall = (now.tv_sec - wall_start.tv_sec) + (now.tv_nsec - wall_start.tv_nsec) / 1e9;
+        double device = (double) hal_sim_cycle / HAL_SIM_SYS_CLK;
+
+        fprintf(stderr, "sim: %.3f s of device time in %.3f s (%.1fx), %llu interrupts\n", device, wall,
+                wall > 0 ? device / wall : 0, (unsigned long long) irq_count);
+        hal_sim_trace_report();
+        hal_sim_dma_report();
+    }
+
+    exit(code);
+}
+
+/**
+ * Stop the simulation with an error, for things the board would hang or fault on
+ *
+ * @param format - printf format
+ *
+ * @return void
+ */
+void hal_sim_fail(const char *format, ...) {
+    va_list args;
+
+    fflush(stdout);
+    fprintf(stderr, "sim: error at %.6f s: ", (double) hal_sim_cycle / HAL_SIM_SYS_CLK);
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+
+    hal_sim_trace_close();
+    exit(2);
+}
+
+/**
+ * Run every peripheral up to a cycle, taking interrupts on the way
+ *
+ * @param target - system cycle
+ *
+ * @return void
+ */
+static void advance_to(uint64_t target) {
+    while (hal_sim_cycle < target) {
+        uint64_t stop = target < limit_cycle ? target : limit_cycle;
+        uint64_t next = hal_sim_pwm_next_event();
+        if (next < stop) stop = next;
+        if (stop < hal_sim_cycle) stop = hal_sim_cycle;
+
+        hal_sim_pio_run_until(stop);
+        hal_sim_cycle = stop;
+        hal_sim_pwm_run_until(stop);
+        hal_sim_dma_service();
+        hal_sim_irq_dispatch();
+
+        if (hal_sim_cycle >= limit_cycle) finish(0);
+    }
+}
+
+/**
+ * Hand the CPU to the other core and wait until it's ours again
+ *
+ * @param to - core to run
+ *
+ * @return void
+ */
+static void switch_core(unsigned int to) {
+    unsigned int me = running_core;
+
+    pthread_mutex_lock(&core_lock);
+    running_core = to;
+    current_core = to;
+    pthread_cond_signal(&core_turn[to]);
+    while (running_core != me) {
+        pthread_cond_wait(&core_turn[me], &core_lock);
+    }
+    current_core = me;
+    pthread_mutex_unlock(&core_lock);
+}
+
+/**
+ * Let the calling core sleep until a cycle
+ *
+ * If the other core wakes up first, it runs until it waits too. Inside
+ * an interrupt handler time passes, but the core can't be switched.
+ *
+ * @param cycle - system cycle to wake up at
+ *
+ * @return void
+ */
+void hal_sim_wait_until(uint64_t cycle) {
+    if (in_handler) {
+        advance_to(cycle);
+        return;
+    }
+
+    unsigned int me = running_core;
+    unsigned int other = me ^ 1;
+    core_wake[me] = cycle;
+
+    while (core1_alive && core_wake[other] < core_wake[me]) {
+        advance_to(core_wake[other]);
+        switch_core(other);
+    }
+
+    advance_to(cycle);
+}
+
+static void *core1_thread(void *arg) {
+    pthread_mutex_lock(&core_lock);
+    while (running_core != 1) {
+        pthread_cond_wait(&core_turn[1], &core_lock);
+    }
+    pthread_mutex_unlock(&core_lock);
+
+    current_core = 1;
+    core1_entry();
+
+    // core 1 returned, it sleeps for good and core 0 carries on
+    pthread_mutex_lock(&core_lock);
+    core1_alive = false;
+    running_core = 0;
+    current_core = 0;
+    pthread_cond_signal(&core_turn[0]);
+    pthread_mutex_unlock(&core_lock);
+    return NULL;
+}
+
+void multicore_launch_core1(void (*entry)(void)) {
+    pthread_t thread;
+
+    if (core1_alive) hal_sim_fail("multicore_launch_core1() while core 1 is running");
+
+    core1_entry = entry;
+    core1_alive = true;
+    // core 1 starts right away, it runs as soon as core 0 waits
+    core_wake[1] = hal_sim_cycle;
+
+    if (pthread_create(&thread, NULL, core1_thread, NULL) != 0) {
+        hal_sim_fail("can't start the core 1 thread");
+    }
+    pthread_detach(thread);
+}
+
+unsigned int get_core_num(void) {
+    return current_core;
+}
+
+//
+// interrupts
+//
+
+void irq_set_exclusive_handler(unsigned int num, irq_handler_t handler) {
+    if (handlers[num] && handlers[num] != handler) {
+        hal_sim_fail("IRQ %u already has a handler", num);
+    }
+    handlers[num] = handler;
+}
+
+void irq_set_enabled(unsigned int num, bool enabled) {
+    if (enabled) {
+        irq_enabled |= 1u << num;
+        // each core has its own NVIC, the one enabling it takes the interrupt
+        irq_core[num] = current_core;
+        hal_sim_irq_dispatch();
+    } else {
+        irq_enabled &= ~(1u << num);
+    }
+}
+
+bool irq_is_enabled(unsigned int num) {
+    return irq_enabled & (1u << num);
+}
+
+/**
+ * Set the level of a peripheral's interrupt line
+ *
+ * @param num - IRQ number
+ * @param pending - line level
+ *
+ * @return void
+ */
+void hal_sim_irq_set_pending(unsigned int num, bool pending) {
+    irq_pending = pending ? irq_pending | (1u << num) : irq_pending & ~(1u << num);
+}
+
+/**
+ * Run the handlers of every pending, enabled and unmasked interrupt
+ *
+ * Lowest number first, like equal NVIC priorities. The lines are
+ * levels, a handler that doesn't clear its cause runs again.
+ *
+ * @return void
+ */
+void hal_sim_irq_dispatch(void) {
+    uint32_t storm = 0;
+
+    if (in_handler) return;
+
+    while (true) {
+        uint32_t ready = irq_pending & irq_enabled;
+        uint32_t num = 0;
+
+        while (ready && irqs_masked[irq_core[num = __builtin_ctz(ready)]]) {
+            ready &= ~(1u << num);
+        }
+        if (!ready) return;
+
+        if (!handlers[num]) hal_sim_fail("IRQ %u is enabled but has no handler", num);
+        if (++storm > IRQ_STORM_LIMIT) hal_sim_fail("IRQ %u keeps firing, is its handler acknowledging it?", num);
+
+        unsigned int saved_core = current_core;
+        in_handler = true;
+        current_core = irq_core[num];
+        irq_count++;
+
+        hal_sim_dma_irq_begin();
+        handlers[num]();
+        hal_sim_dma_irq_end();
+
+        current_core = saved_core;
+        in_handler = false;
+    }
+}
+
+uint32_t save_and_disable_interrupts(void) {
+    uint32_t status = irqs_masked[current_core];
+    irqs_masked[current_core] = true;
+    return status;
+}
+
+void restore_interrupts(uint32_t status) {
+    irqs_masked[current_core] = status;
+    if (!status) hal_sim_irq_dispatch();
+}
+
+void __wfi(void) {
+    // nothing wakes a core 1 that has nothing to do, core 0 polls on
+    hal_sim_wait_until(current_core == 1 && !in_handler ? UINT64_MAX : hal_sim_cycle + HAL_SIM_SPIN_US * HAL_SIM_CYCLES_PER_US);
+}
+
+void __wfe(void) {
+    __wfi();
+}
+
+//
+// time
+//
+
+uint64_t time_us_64(void) {
+    return hal_sim_cycle / HAL_SIM_CYCLES_PER_US;
+}
+
+uint32_t time_us_32(void) {
+    return (uint32_t) time_us_64();
+}
+
+void busy_wait_us(uint64_t us) {
+    hal_sim_wait_until(hal_sim_cycle + us * HAL_SIM_CYCLES_PER_US);
+}
+
+void busy_wait_us_32(uint32_t us) {
+    busy_wait_us(us);
+}
+
+void busy_wait_ms(uint32_t ms) {
+    busy_wait_us(ms * 1000ull);
+}
+
+void sleep_us(uint64_t us) {
+    busy_wait_us(us);
+}
+
+void sleep_ms(uint32_t ms) {
+    busy_wait_us(ms * 1000ull);
+}
+
+void tight_loop_contents(void) {
+    busy_wait_us(HAL_SIM_SPIN_US);
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index) {
+    switch (clk_index) {
+        case clk_ref:
+            return 12000000;
+        case clk_usb:
+        case clk_adc:
+            return 48000000;
+        case clk_rtc:
+            return 46875;
+        default:
+            return HAL_SIM_SYS_CLK;
+    }
+}
+
+//
+// stdio, the host's stdout, there's no input
+//
+
+bool stdio_init_all(void) {
+    // line buffered, so output and pin traces interleave sensibly
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    return true;
+}
+
+int getchar_timeout_us(uint32_t timeout_us) {
+    busy_wait_us(timeout_us);
+    return PICO_ERROR_TIMEOUT;
+}
+
+int putchar_raw(int c) {
+    return putchar(c);
+}
+
+//
+// cyw43, only the LED
+//
+
+int cyw43_arch_init(void) {
+    if (!cyw43_ready) {
+        // the firmware upload keeps the calling core busy
+        busy_wait_us(HAL_SIM_CYW43_INIT_US);
+        cyw43_ready = true;
+    }
+    return 0;
+}
+
+void cyw43_arch_deinit(void) {
+    cyw43_ready = false;
+}
+
+void cyw43_arch_gpio_put(unsigned int wl_gpio, bool value) {
+    if (!cyw43_ready) hal_sim_fail("cyw43_arch_gpio_put() before cyw43_arch_init()");
+    if (wl_gpio == CYW43_WL_GPIO_LED_PIN) hal_sim_led_put(value);
+}
+
+bool cyw43_arch_gpio_get(unsigned int wl_gpio) {
+    if (!cyw43_ready) hal_sim_fail("cyw43_arch_gpio_get() before cyw43_arch_init()");
+    return wl_gpio == CYW43_WL_GPIO_LED_PIN && hal_sim_led_get();
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-t seconds] [-v trace.vcd] [-q]\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:v:q")) != -1) {
+        switch (opt) {
+            case 't': {
+                double seconds = atof(optarg);
+                if (seconds <= 0) usage(argv[0]);
+                limit_cycle = (uint64_t) (seconds * HAL_SIM_SYS_CLK);
+                break;
+            }
+            case 'v':
+                if (!hal_sim_trace_open(optarg)) {
+                    fprintf(stderr, "can't write %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'q':
+                quiet = true;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+    hal_sim_pio_init();
+
+    int code = picow_main();
+    finish(code);
+}
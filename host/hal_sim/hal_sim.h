@@ -0,0 +1,120 @@
+/**
+ * @brief Simulated RP2040 backend, runs the examples as Linux programs
+ *
+ * The stand-in SDK headers in include/ declare the subset of
+ * hardware/gpio, pwm, dma, pio, irq, clocks, pico/multicore and
+ * pico/cyw43_arch the examples use. This backend implements them on
+ * top of a register file (pwm_hw, dma_hw, pio0_hw look like the real
+ * ones) and a virtual clock counting system cycles.
+ *
+ * How time works:
+ *
+ * - nothing takes time except what would wait on the board: sleeps,
+ *   busy waits, tight_loop_contents() (HAL_SIM_SPIN_US per call),
+ *   __wfi() and blocking FIFO/DMA waits
+ * - the clock then jumps from event to event: PWM wraps and compare
+ *   edges are computed, not counted, PIO state machines run on the
+ *   cycle-accurate pio_sim.c, DMA transfers happen when their DREQ is
+ *   up, interrupt handlers run in between
+ * - so a PWM example runs seconds of device time in milliseconds, a
+ *   PIO program costs one step per state machine clock
+ *
+ * Core 1 is a thread, but only one core runs at a time: whichever
+ * wakes first in virtual time, so runs are deterministic.
+ *
+ * Every example's main() is renamed to picow_main() at compile time,
+ * the backend's main() parses the options, runs it until the time
+ * limit and prints what every pin did (frequency, duty, edges).
+ *
+ * Usage:
+ *
+ *   sim_<example> [-t seconds] [-v trace.vcd] [-q]
+ *
+ *   -t  device time to simulate (default: 5)
+ *   -v  write every pin change to a VCD file (gtkwave, PulseView)
+ *   -q  no pin summary
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+
+#define HAL_SIM_SYS_CLK (SYS_CLK_KHZ * 1000u)
+#define HAL_SIM_CYCLES_PER_US (SYS_CLK_KHZ / 1000u)
+// virtual time one tight_loop_contents() or __wfi() call lets pass
+#define HAL_SIM_SPIN_US 1
+// virtual time cyw43_arch_init() takes, a stand-in for the firmware upload
+#define HAL_SIM_CYW43_INIT_US 250000
+
+// traced pins: GPIO 0-29 and the cyw43 LED
+#define HAL_SIM_PIN_LED 30
+#define HAL_SIM_PINS 31
+
+// who drives a pin, the GPIO function selects one of them
+enum {
+    HAL_SIM_SOURCE_SIO,
+    HAL_SIM_SOURCE_PWM,
+    HAL_SIM_SOURCE_PIO0,
+    HAL_SIM_SOURCE_PIO1,
+    HAL_SIM_SOURCES,
+};
+
+// current system cycle, only moves inside hal_sim_wait_until()
+extern uint64_t hal_sim_cycle;
+
+void hal_sim_wait_until(uint64_t cycle);
+void hal_sim_fail(const char *format, ...) __attribute__((format(printf, 1, 2), noreturn));
+
+// interrupts, see hal_sim.c
+void hal_sim_irq_set_pending(unsigned int num, bool pending);
+void hal_sim_irq_dispatch(void);
+
+// pins, see hal_gpio.c
+void hal_sim_gpio_drive(unsigned int source, uint32_t levels, uint32_t oe);
+void hal_sim_gpio_set_input(unsigned int gpio, bool level);
+void hal_sim_led_put(bool level);
+bool hal_sim_led_get(void);
+bool hal_sim_trace_open(const char *path);
+void hal_sim_trace_close(void);
+void hal_sim_trace_report(void);
+
+// PWM, see hal_pwm.c
+uint64_t hal_sim_pwm_next_event(void);
+void hal_sim_pwm_run_until(uint64_t cycle);
+
+// DMA, see hal_dma.c
+typedef struct {
+    uint64_t triggers;
+    // triggers that came from another channel's CHAIN_TO
+    uint64_t chained;
+    uint64_t transfers;
+    uint64_t bytes;
+    uint64_t completions;
+    // completions that set the channel's INTR bit
+    uint64_t irqs;
+    uint64_t ring_wraps;
+    // wraps that didn't land where the ring started, a misaligned buffer
+    uint64_t bad_wraps;
+    // DREQs lost because the channel was idle or had 63 banked
+    uint64_t missed_dreqs;
+    uint32_t max_credits;
+    // ring side address at the last trigger after it was written
+    uint32_t ring_start;
+} hal_sim_dma_stats_t;
+
+void hal_sim_dma_get_stats(unsigned int channel, hal_sim_dma_stats_t *stats);
+void hal_sim_dma_report(void);
+void hal_sim_dma_dreq(unsigned int dreq);
+void hal_sim_dma_service(void);
+void hal_sim_dma_irq_begin(void);
+void hal_sim_dma_irq_end(void);
+
+// PIO, see hal_pio.c
+void hal_sim_pio_init(void);
+void hal_sim_pio_run_until(uint64_t cycle);
+void hal_sim_pio_set_inputs(uint32_t levels);
+bool hal_sim_pio_tx_ready(unsigned int dreq);
+bool hal_sim_pio_write_hook(uint32_t addr, uint32_t value);
+uint64_t hal_sim_pio_stall_cycles(unsigned int pio, unsigned int sm);
@@ -0,0 +1,25 @@
+/**
+ * @brief Host stand-in for "hardware/clocks.h", see host/hal_sim
+ *
+ * The simulated system clock is fixed at SYS_CLK_KHZ.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+enum clock_index {
+    clk_gpout0 = 0,
+    clk_gpout1,
+    clk_gpout2,
+    clk_gpout3,
+    clk_ref,
+    clk_sys,
+    clk_peri,
+    clk_usb,
+    clk_adc,
+    clk_rtc,
+    CLK_COUNT,
+};
+
+uint32_t clock_get_hz(enum clock_index clk_index);
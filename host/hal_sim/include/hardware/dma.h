@@ -0,0 +1,240 @@
+/**
+ * @brief Host stand-in for "hardware/dma.h", see host/hal_sim
+ *
+ * Same register layout as the RP2040, including the four alias views
+ * of each channel, so code can point one channel at another's
+ * al2_write_addr_trig or al3_transfer_count like on the board.
+ *
+ * The simulated DMA moves real host memory. Addresses are 32 bits like
+ * on the RP2040, the simulator is linked without PIE so static data
+ * and the register blocks sit below 4 GB. DMA buffers have to be
+ * static (or heap), a stack address is caught when it's configured.
+ *
+ * Writes the DMA itself makes to its own registers, the PIO TX FIFOs
+ * and the PWM CC registers have their side effects (triggers, FIFO
+ * pushes). CPU writes have to go through the functions below, a plain
+ * store to a trigger alias only changes memory. The one exception is
+ * acknowledging an interrupt with `dma_hw->ints0 = 1u << channel`
+ * from the handler, which works as on the hardware (see hal_dma.c).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define NUM_DMA_CHANNELS 12
+
+// CTRL register fields (RP2040 datasheet, 2.5.7 List of Registers)
+#define DMA_CH0_CTRL_TRIG_EN_BITS 0x00000001u
+#define DMA_CH0_CTRL_TRIG_HIGH_PRIORITY_BITS 0x00000002u
+#define DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB 2
+#define DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS 0x0000000cu
+#define DMA_CH0_CTRL_TRIG_INCR_READ_BITS 0x00000010u
+#define DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS 0x00000020u
+#define DMA_CH0_CTRL_TRIG_RING_SIZE_LSB 6
+#define DMA_CH0_CTRL_TRIG_RING_SIZE_BITS 0x000003c0u
+#define DMA_CH0_CTRL_TRIG_RING_SEL_BITS 0x00000400u
+#define DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB 11
+#define DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS 0x00007800u
+#define DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB 15
+#define DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS 0x001f8000u
+#define DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS 0x00200000u
+#define DMA_CH0_CTRL_TRIG_BSWAP_BITS 0x00400000u
+#define DMA_CH0_CTRL_TRIG_BUSY_BITS 0x01000000u
+
+enum dma_channel_transfer_size {
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2,
+};
+
+enum dreq_num {
+    DREQ_PIO0_TX0 = 0,
+    DREQ_PIO0_TX1 = 1,
+    DREQ_PIO0_TX2 = 2,
+    DREQ_PIO0_TX3 = 3,
+    DREQ_PIO0_RX0 = 4,
+    DREQ_PIO0_RX1 = 5,
+    DREQ_PIO0_RX2 = 6,
+    DREQ_PIO0_RX3 = 7,
+    DREQ_PIO1_TX0 = 8,
+    DREQ_PIO1_TX1 = 9,
+    DREQ_PIO1_TX2 = 10,
+    DREQ_PIO1_TX3 = 11,
+    DREQ_PIO1_RX0 = 12,
+    DREQ_PIO1_RX1 = 13,
+    DREQ_PIO1_RX2 = 14,
+    DREQ_PIO1_RX3 = 15,
+    DREQ_SPI0_TX = 16,
+    DREQ_SPI0_RX = 17,
+    DREQ_SPI1_TX = 18,
+    DREQ_SPI1_RX = 19,
+    DREQ_UART0_TX = 20,
+    DREQ_UART0_RX = 21,
+    DREQ_UART1_TX = 22,
+    DREQ_UART1_RX = 23,
+    DREQ_PWM_WRAP0 = 24,
+    DREQ_PWM_WRAP1 = 25,
+    DREQ_PWM_WRAP2 = 26,
+    DREQ_PWM_WRAP3 = 27,
+    DREQ_PWM_WRAP4 = 28,
+    DREQ_PWM_WRAP5 = 29,
+    DREQ_PWM_WRAP6 = 30,
+    DREQ_PWM_WRAP7 = 31,
+    DREQ_I2C0_TX = 32,
+    DREQ_I2C0_RX = 33,
+    DREQ_I2C1_TX = 34,
+    DREQ_I2C1_RX = 35,
+    DREQ_ADC = 36,
+    DREQ_DMA_TIMER0 = 0x3b,
+    DREQ_DMA_TIMER1 = 0x3c,
+    DREQ_DMA_TIMER2 = 0x3d,
+    DREQ_DMA_TIMER3 = 0x3e,
+    DREQ_FORCE = 0x3f,
+};
+
+typedef struct {
+    volatile uint32_t read_addr;
+    volatile uint32_t write_addr;
+    volatile uint32_t transfer_count;
+    volatile uint32_t ctrl_trig;
+    volatile uint32_t al1_ctrl;
+    volatile uint32_t al1_read_addr;
+    volatile uint32_t al1_write_addr;
+    volatile uint32_t al1_transfer_count_trig;
+    volatile uint32_t al2_ctrl;
+    volatile uint32_t al2_transfer_count;
+    volatile uint32_t al2_read_addr;
+    volatile uint32_t al2_write_addr_trig;
+    volatile uint32_t al3_ctrl;
+    volatile uint32_t al3_write_addr;
+    volatile uint32_t al3_transfer_count;
+    volatile uint32_t al3_read_addr_trig;
+} dma_channel_hw_t;
+
+typedef struct {
+    dma_channel_hw_t ch[NUM_DMA_CHANNELS];
+    uint32_t _pad0[64];
+    volatile uint32_t intr;
+    volatile uint32_t inte0;
+    volatile uint32_t intf0;
+    volatile uint32_t ints0;
+    uint32_t _pad1;
+    volatile uint32_t inte1;
+    volatile uint32_t intf1;
+    volatile uint32_t ints1;
+    volatile uint32_t timer[4];
+    volatile uint32_t multi_channel_trigger;
+    volatile uint32_t sniff_ctrl;
+    volatile uint32_t sniff_data;
+    uint32_t _pad2;
+    volatile uint32_t fifo_levels;
+    volatile uint32_t abort;
+} dma_hw_t;
+
+_Static_assert(__builtin_offsetof(dma_hw_t, intr) == 0x400, "dma_hw_t layout");
+_Static_assert(__builtin_offsetof(dma_hw_t, abort) == 0x444, "dma_hw_t layout");
+
+extern dma_hw_t hal_sim_dma_hw;
+#define dma_hw (&hal_sim_dma_hw)
+
+typedef struct {
+    uint32_t ctrl;
+} dma_channel_config;
+
+static inline void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+    c->ctrl = incr ? c->ctrl | DMA_CH0_CTRL_TRIG_INCR_READ_BITS : c->ctrl & ~DMA_CH0_CTRL_TRIG_INCR_READ_BITS;
+}
+
+static inline void channel_config_set_write_increment(dma_channel_config *c, bool incr) {
+    c->ctrl = incr ? c->ctrl | DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS : c->ctrl & ~DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS;
+}
+
+static inline void channel_config_set_dreq(dma_channel_config *c, unsigned int dreq) {
+    c->ctrl = (c->ctrl & ~DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS) | (dreq << DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB);
+}
+
+static inline void channel_config_set_chain_to(dma_channel_config *c, unsigned int chain_to) {
+    c->ctrl = (c->ctrl & ~DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS) | (chain_to << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB);
+}
+
+static inline void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {
+    c->ctrl = (c->ctrl & ~DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS) | ((uint32_t) size << DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB);
+}
+
+static inline void channel_config_set_ring(dma_channel_config *c, bool write, unsigned int size_bits) {
+    c->ctrl = (c->ctrl & ~(DMA_CH0_CTRL_TRIG_RING_SIZE_BITS | DMA_CH0_CTRL_TRIG_RING_SEL_BITS)) |
+              (size_bits << DMA_CH0_CTRL_TRIG_RING_SIZE_LSB) | (write ? DMA_CH0_CTRL_TRIG_RING_SEL_BITS : 0);
+}
+
+static inline void channel_config_set_bswap(dma_channel_config *c, bool bswap) {
+    c->ctrl = bswap ? c->ctrl | DMA_CH0_CTRL_TRIG_BSWAP_BITS : c->ctrl & ~DMA_CH0_CTRL_TRIG_BSWAP_BITS;
+}
+
+static inline void channel_config_set_irq_quiet(dma_channel_config *c, bool irq_quiet) {
+    c->ctrl = irq_quiet ? c->ctrl | DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS : c->ctrl & ~DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS;
+}
+
+static inline void channel_config_set_high_priority(dma_channel_config *c, bool high_priority) {
+    c->ctrl = high_priority ? c->ctrl | DMA_CH0_CTRL_TRIG_HIGH_PRIORITY_BITS : c->ctrl & ~DMA_CH0_CTRL_TRIG_HIGH_PRIORITY_BITS;
+}
+
+static inline void channel_config_set_enable(dma_channel_config *c, bool enable) {
+    c->ctrl = enable ? c->ctrl | DMA_CH0_CTRL_TRIG_EN_BITS : c->ctrl & ~DMA_CH0_CTRL_TRIG_EN_BITS;
+}
+
+static inline uint32_t channel_config_get_ctrl_value(const dma_channel_config *c) {
+    return c->ctrl;
+}
+
+/**
+ * Same defaults as the SDK: read increment, 32-bit, unpaced, chained to itself
+ *
+ * @param channel
+ *
+ * @return dma_channel_config
+ */
+static inline dma_channel_config dma_channel_get_default_config(unsigned int channel) {
+    dma_channel_config c = {0};
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, DREQ_FORCE);
+    channel_config_set_chain_to(&c, channel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_ring(&c, false, 0);
+    channel_config_set_enable(&c, true);
+    return c;
+}
+
+static inline dma_channel_config dma_get_channel_config(unsigned int channel) {
+    dma_channel_config c = {dma_hw->ch[channel].al1_ctrl};
+    return c;
+}
+
+void dma_channel_claim(unsigned int channel);
+void dma_channel_unclaim(unsigned int channel);
+int dma_claim_unused_channel(bool required);
+bool dma_channel_is_claimed(unsigned int channel);
+
+void dma_channel_set_config(unsigned int channel, const dma_channel_config *config, bool trigger);
+void dma_channel_set_read_addr(unsigned int channel, const volatile void *read_addr, bool trigger);
+void dma_channel_set_write_addr(unsigned int channel, volatile void *write_addr, bool trigger);
+void dma_channel_set_trans_count(unsigned int channel, uint32_t trans_count, bool trigger);
+void dma_channel_configure(unsigned int channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, unsigned int transfer_count, bool trigger);
+void dma_start_channel_mask(uint32_t chan_mask);
+void dma_channel_abort(unsigned int channel);
+bool dma_channel_is_busy(unsigned int channel);
+void dma_channel_wait_for_finish_blocking(unsigned int channel);
+
+void dma_channel_set_irq0_enabled(unsigned int channel, bool enabled);
+void dma_channel_set_irq1_enabled(unsigned int channel, bool enabled);
+bool dma_channel_get_irq0_status(unsigned int channel);
+bool dma_channel_get_irq1_status(unsigned int channel);
+void dma_channel_acknowledge_irq0(unsigned int channel);
+void dma_channel_acknowledge_irq1(unsigned int channel);
+
+static inline void dma_channel_start(unsigned int channel) {
+    dma_start_channel_mask(1u << channel);
+}
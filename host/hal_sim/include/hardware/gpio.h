@@ -0,0 +1,59 @@
+/**
+ * @brief Host stand-in for "hardware/gpio.h", see host/hal_sim
+ *
+ * SIO outputs, pin functions and pulls. A pin shows the level of the
+ * peripheral its function selects, every change goes to the trace.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define NUM_BANK0_GPIOS 30
+
+#define GPIO_OUT 1
+#define GPIO_IN 0
+
+enum gpio_function {
+    GPIO_FUNC_XIP = 0,
+    GPIO_FUNC_SPI = 1,
+    GPIO_FUNC_UART = 2,
+    GPIO_FUNC_I2C = 3,
+    GPIO_FUNC_PWM = 4,
+    GPIO_FUNC_SIO = 5,
+    GPIO_FUNC_PIO0 = 6,
+    GPIO_FUNC_PIO1 = 7,
+    GPIO_FUNC_GPCK = 8,
+    GPIO_FUNC_USB = 9,
+    GPIO_FUNC_NULL = 0x1f,
+};
+
+void gpio_init(unsigned int gpio);
+void gpio_init_mask(uint32_t mask);
+void gpio_set_function(unsigned int gpio, enum gpio_function fn);
+enum gpio_function gpio_get_function(unsigned int gpio);
+void gpio_set_dir(unsigned int gpio, bool out);
+void gpio_set_dir_out_masked(uint32_t mask);
+void gpio_set_dir_in_masked(uint32_t mask);
+void gpio_put(unsigned int gpio, bool value);
+void gpio_put_masked(uint32_t mask, uint32_t value);
+void gpio_put_all(uint32_t value);
+void gpio_set_mask(uint32_t mask);
+void gpio_clr_mask(uint32_t mask);
+void gpio_xor_mask(uint32_t mask);
+bool gpio_get(unsigned int gpio);
+uint32_t gpio_get_all(void);
+void gpio_set_pulls(unsigned int gpio, bool up, bool down);
+
+static inline void gpio_pull_up(unsigned int gpio) {
+    gpio_set_pulls(gpio, true, false);
+}
+
+static inline void gpio_pull_down(unsigned int gpio) {
+    gpio_set_pulls(gpio, false, true);
+}
+
+static inline void gpio_disable_pulls(unsigned int gpio) {
+    gpio_set_pulls(gpio, false, false);
+}
@@ -0,0 +1,91 @@
+/**
+ * @brief Host stand-in for "hardware/pio.h", see host/hal_sim
+ *
+ * The pio_sm_config encoding and the sm_config_* setters come from
+ * host/pio_sim/include (the header the pioasm output already builds
+ * against on the host), this adds the PIO blocks and the pio_sm_*
+ * functions on top, backed by the cycle-accurate model in pio_sim.c.
+ */
+
+#pragma once
+
+#include_next <hardware/pio.h>
+#include "hardware/gpio.h"
+
+#define NUM_PIOS 2
+#define NUM_PIO_STATE_MACHINES 4
+
+typedef struct {
+    volatile uint32_t ctrl;
+    volatile uint32_t fstat;
+    volatile uint32_t fdebug;
+    volatile uint32_t flevel;
+    volatile uint32_t txf[NUM_PIO_STATE_MACHINES];
+    volatile uint32_t rxf[NUM_PIO_STATE_MACHINES];
+    volatile uint32_t irq;
+    volatile uint32_t irq_force;
+} pio_hw_t;
+
+typedef pio_hw_t *PIO;
+
+// INTR/INTE bits, the same numbers as the SDK
+enum pio_interrupt_source {
+    pis_sm0_rx_fifo_not_empty = 0,
+    pis_sm1_rx_fifo_not_empty = 1,
+    pis_sm2_rx_fifo_not_empty = 2,
+    pis_sm3_rx_fifo_not_empty = 3,
+    pis_sm0_tx_fifo_not_full = 4,
+    pis_sm1_tx_fifo_not_full = 5,
+    pis_sm2_tx_fifo_not_full = 6,
+    pis_sm3_tx_fifo_not_full = 7,
+    pis_interrupt0 = 8,
+    pis_interrupt1 = 9,
+    pis_interrupt2 = 10,
+    pis_interrupt3 = 11,
+};
+
+extern pio_hw_t hal_sim_pio_hw[NUM_PIOS];
+#define pio0_hw (&hal_sim_pio_hw[0])
+#define pio1_hw (&hal_sim_pio_hw[1])
+#define pio0 pio0_hw
+#define pio1 pio1_hw
+
+static inline unsigned int pio_get_index(PIO pio) {
+    return pio == pio1 ? 1 : 0;
+}
+
+static inline unsigned int pio_get_dreq(PIO pio, unsigned int sm, bool is_tx) {
+    // DREQ_PIO0_TX0 + sm, DREQ_PIO0_RX0 + sm, PIO1 8 further
+    return pio_get_index(pio) * 8 + (is_tx ? 0 : 4) + sm;
+}
+
+bool pio_can_add_program(PIO pio, const struct pio_program *program);
+unsigned int pio_add_program(PIO pio, const struct pio_program *program);
+void pio_sm_claim(PIO pio, unsigned int sm);
+void pio_sm_unclaim(PIO pio, unsigned int sm);
+int pio_claim_unused_sm(PIO pio, bool required);
+void pio_gpio_init(PIO pio, unsigned int pin);
+
+void pio_sm_init(PIO pio, unsigned int sm, unsigned int initial_pc, const pio_sm_config *config);
+void pio_sm_set_enabled(PIO pio, unsigned int sm, bool enabled);
+void pio_sm_set_clkdiv_int_frac(PIO pio, unsigned int sm, uint16_t div_int, uint8_t div_frac);
+void pio_sm_set_clkdiv(PIO pio, unsigned int sm, float div);
+void pio_sm_set_consecutive_pindirs(PIO pio, unsigned int sm, unsigned int pin_base, unsigned int pin_count, bool is_out);
+void pio_sm_set_pins_with_mask(PIO pio, unsigned int sm, uint32_t pin_values, uint32_t pin_mask);
+void pio_sm_exec(PIO pio, unsigned int sm, unsigned int instr);
+void pio_sm_clear_fifos(PIO pio, unsigned int sm);
+uint8_t pio_sm_get_pc(PIO pio, unsigned int sm);
+
+// PIOx_IRQ_0 only, nothing here uses IRQ 1
+void pio_set_irq0_source_enabled(PIO pio, enum pio_interrupt_source source, bool enabled);
+void pio_interrupt_clear(PIO pio, unsigned int pio_interrupt_num);
+
+void pio_sm_put(PIO pio, unsigned int sm, uint32_t data);
+void pio_sm_put_blocking(PIO pio, unsigned int sm, uint32_t data);
+uint32_t pio_sm_get(PIO pio, unsigned int sm);
+uint32_t pio_sm_get_blocking(PIO pio, unsigned int sm);
+bool pio_sm_is_tx_fifo_full(PIO pio, unsigned int sm);
+bool pio_sm_is_tx_fifo_empty(PIO pio, unsigned int sm);
+bool pio_sm_is_rx_fifo_empty(PIO pio, unsigned int sm);
+unsigned int pio_sm_get_tx_fifo_level(PIO pio, unsigned int sm);
+unsigned int pio_sm_get_rx_fifo_level(PIO pio, unsigned int sm);
@@ -0,0 +1,159 @@
+/**
+ * @brief Host stand-in for "hardware/pwm.h", see host/hal_sim
+ *
+ * Same register layout as the RP2040 (pwm_hw->slice[n].cc is a real
+ * DMA destination here too). The model reads CC, TOP and DIV at every
+ * wrap like the double-buffered hardware and raises the wrap DREQ.
+ * Free-running mode only, no phase-correct or gated counting.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hardware/gpio.h"
+
+#define NUM_PWM_SLICES 8
+
+// register fields (RP2040 datasheet, 4.5.3 List of Registers)
+#define PWM_CH0_CSR_EN_BITS 0x00000001u
+#define PWM_CH0_CSR_PH_CORRECT_BITS 0x00000002u
+#define PWM_CH0_CSR_A_INV_BITS 0x00000004u
+#define PWM_CH0_CSR_B_INV_BITS 0x00000008u
+#define PWM_CH0_DIV_INT_LSB 4
+#define PWM_CH0_DIV_FRAC_LSB 0
+#define PWM_CH0_CC_B_LSB 16
+
+enum pwm_chan {
+    PWM_CHAN_A = 0,
+    PWM_CHAN_B = 1,
+};
+
+typedef struct {
+    volatile uint32_t csr;
+    volatile uint32_t div;
+    volatile uint32_t ctr;
+    volatile uint32_t cc;
+    volatile uint32_t top;
+} pwm_slice_hw_t;
+
+typedef struct {
+    pwm_slice_hw_t slice[NUM_PWM_SLICES];
+    volatile uint32_t en;
+    volatile uint32_t intr;
+    volatile uint32_t inte;
+    volatile uint32_t intf;
+    volatile uint32_t ints;
+} pwm_hw_t;
+
+extern pwm_hw_t hal_sim_pwm_hw;
+#define pwm_hw (&hal_sim_pwm_hw)
+
+typedef struct {
+    uint32_t csr;
+    uint32_t div;
+    uint32_t top;
+} pwm_config;
+
+// the model only looks at the registers at a wrap, this catches enables
+void hal_sim_pwm_changed(unsigned int slice_num);
+// computed from the virtual clock, the CTR register isn't kept up to date
+uint16_t pwm_get_counter(unsigned int slice_num);
+
+static inline unsigned int pwm_gpio_to_slice_num(unsigned int gpio) {
+    return (gpio >> 1u) & 7u;
+}
+
+static inline unsigned int pwm_gpio_to_channel(unsigned int gpio) {
+    return gpio & 1u;
+}
+
+static inline void pwm_config_set_clkdiv_int_frac(pwm_config *c, uint8_t integer, uint8_t fract) {
+    c->div = ((uint32_t) integer << PWM_CH0_DIV_INT_LSB) | ((uint32_t) fract << PWM_CH0_DIV_FRAC_LSB);
+}
+
+static inline void pwm_config_set_clkdiv_int(pwm_config *c, unsigned int div) {
+    pwm_config_set_clkdiv_int_frac(c, (uint8_t) div, 0);
+}
+
+static inline void pwm_config_set_clkdiv(pwm_config *c, float div) {
+    c->div = (uint32_t) (div * (float) (1u << PWM_CH0_DIV_INT_LSB));
+}
+
+static inline void pwm_config_set_wrap(pwm_config *c, uint16_t wrap) {
+    c->top = wrap;
+}
+
+static inline void pwm_config_set_output_polarity(pwm_config *c, bool a, bool b) {
+    c->csr = (c->csr & ~(PWM_CH0_CSR_A_INV_BITS | PWM_CH0_CSR_B_INV_BITS)) |
+             (a ? PWM_CH0_CSR_A_INV_BITS : 0) | (b ? PWM_CH0_CSR_B_INV_BITS : 0);
+}
+
+/**
+ * Same defaults as the SDK: free-running, divider 1, wrap 0xffff
+ *
+ * @return pwm_config
+ */
+static inline pwm_config pwm_get_default_config(void) {
+    pwm_config c = {0, 0, 0};
+    pwm_config_set_clkdiv_int(&c, 1);
+    pwm_config_set_wrap(&c, 0xffff);
+    return c;
+}
+
+static inline void pwm_init(unsigned int slice_num, pwm_config *c, bool start) {
+    pwm_slice_hw_t *slice = &pwm_hw->slice[slice_num];
+    slice->csr = 0;
+    slice->ctr = 0;
+    slice->cc = 0;
+    slice->top = c->top;
+    slice->div = c->div;
+    slice->csr = c->csr | (start ? PWM_CH0_CSR_EN_BITS : 0);
+    hal_sim_pwm_changed(slice_num);
+}
+
+static inline void pwm_set_clkdiv_int_frac(unsigned int slice_num, uint8_t integer, uint8_t fract) {
+    pwm_hw->slice[slice_num].div = ((uint32_t) integer << PWM_CH0_DIV_INT_LSB) | ((uint32_t) fract << PWM_CH0_DIV_FRAC_LSB);
+}
+
+static inline void pwm_set_clkdiv(unsigned int slice_num, float div) {
+    pwm_hw->slice[slice_num].div = (uint32_t) (div * (float) (1u << PWM_CH0_DIV_INT_LSB));
+}
+
+static inline void pwm_set_wrap(unsigned int slice_num, uint16_t wrap) {
+    pwm_hw->slice[slice_num].top = wrap;
+}
+
+static inline void pwm_set_chan_level(unsigned int slice_num, unsigned int chan, uint16_t level) {
+    uint32_t shift = chan ? PWM_CH0_CC_B_LSB : 0;
+    uint32_t cc = pwm_hw->slice[slice_num].cc;
+    pwm_hw->slice[slice_num].cc = (cc & ~(0xffffu << shift)) | ((uint32_t) level << shift);
+}
+
+static inline void pwm_set_both_levels(unsigned int slice_num, uint16_t level_a, uint16_t level_b) {
+    pwm_hw->slice[slice_num].cc = ((uint32_t) level_b << PWM_CH0_CC_B_LSB) | level_a;
+}
+
+static inline void pwm_set_gpio_level(unsigned int gpio, uint16_t level) {
+    pwm_set_chan_level(pwm_gpio_to_slice_num(gpio), pwm_gpio_to_channel(gpio), level);
+}
+
+static inline void pwm_set_enabled(unsigned int slice_num, bool enabled) {
+    pwm_slice_hw_t *slice = &pwm_hw->slice[slice_num];
+    slice->csr = enabled ? slice->csr | PWM_CH0_CSR_EN_BITS : slice->csr & ~PWM_CH0_CSR_EN_BITS;
+    hal_sim_pwm_changed(slice_num);
+}
+
+static inline void pwm_set_mask_enabled(uint32_t mask) {
+    for (unsigned int slice_num = 0; slice_num < NUM_PWM_SLICES; slice_num++) {
+        pwm_slice_hw_t *slice = &pwm_hw->slice[slice_num];
+        slice->csr = (mask >> slice_num) & 1 ? slice->csr | PWM_CH0_CSR_EN_BITS : slice->csr & ~PWM_CH0_CSR_EN_BITS;
+    }
+    // all at once, so they wrap in lockstep
+    hal_sim_pwm_changed(NUM_PWM_SLICES);
+}
+
+static inline unsigned int pwm_get_dreq(unsigned int slice_num) {
+    // DREQ_PWM_WRAP0 + slice_num, see hardware/dma.h
+    return 24 + slice_num;
+}
@@ -0,0 +1,27 @@
+/**
+ * @brief Host stand-in for "hardware/sync.h", see host/hal_sim
+ *
+ * Only one simulated core runs at a time and interrupt handlers are
+ * called between simulated events, so the interrupt masking is a
+ * counter. __wfi()/__wfe() let the virtual clock run on.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+void __wfi(void);
+void __wfe(void);
+
+static inline void __sev(void) {
+}
+
+static inline void __dmb(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void __compiler_memory_barrier(void) {
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
@@ -0,0 +1,7 @@
+/**
+ * @brief Host stand-in for "hardware/timer.h", see host/hal_sim
+ */
+
+#pragma once
+
+#include "pico/stdlib.h"
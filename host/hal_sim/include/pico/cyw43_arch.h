@@ -0,0 +1,18 @@
+/**
+ * @brief Host stand-in for "pico/cyw43_arch.h", see host/hal_sim
+ *
+ * The onboard LED is traced like a pin ("wl_led"). cyw43_arch_init()
+ * costs HAL_SIM_CYW43_INIT_US of virtual time on the calling core,
+ * a stand-in for the firmware upload.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#define CYW43_WL_GPIO_LED_PIN 0
+
+int cyw43_arch_init(void);
+void cyw43_arch_deinit(void);
+void cyw43_arch_gpio_put(unsigned int wl_gpio, bool value);
+bool cyw43_arch_gpio_get(unsigned int wl_gpio);
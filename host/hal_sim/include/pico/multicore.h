@@ -0,0 +1,12 @@
+/**
+ * @brief Host stand-in for "pico/multicore.h", see host/hal_sim
+ *
+ * Core 1 is a thread, but the two cores take turns in virtual time:
+ * whichever is due first runs until it sleeps, spins or waits.
+ */
+
+#pragma once
+
+#include "pico/stdlib.h"
+
+void multicore_launch_core1(void (*entry)(void));
@@ -0,0 +1,377 @@
+/**
+ * @brief Host report of the picow_test interrupt latency cases
+ *
+ * Asks the board for a run, collects the lib/irq_latency result lines
+ * and prints entry latency and handler time per case, side by side
+ * for flash and RAM handlers, a cold XIP cache and a competing
+ * handler at the same or a lower priority. Given a baseline it
+ * compares the medians and fails on a regression.
+ *
+ * Usage:
+ *
+ *   irq_report [-H] [-b baseline] [-s save] [-t percent] [device|file]
+ *   irq_report selftest
+ *
+ * - device: sends 'r' and reads until "irq-end" (stdin if none given)
+ * - -H: the histogram of every result as well
+ * - -b: results of an earlier run, saved with -s
+ * - -t: allowed median increase before it counts as a regression, default 10
+ *
+ * Exits with 1 if a result regressed or went missing.
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include "irq_latency.h"
+
+// two per case
+#define MAX_RESULTS 128
+// the board runs lib/bench first, give it time
+#define READ_TIMEOUT_MS 30000
+// widest histogram bar
+#define BAR_WIDTH 50
+
+typedef struct {
+    irq_latency_result_t results[MAX_RESULTS];
+    size_t count;
+    unsigned long clk;
+    bool complete;
+} run_t;
+
+/**
+ * Take one line of board output
+ *
+ * @param run
+ * @param line
+ *
+ * @return void
+ */
+static void run_add_line(run_t *run, const char *line) {
+    unsigned long clk;
+
+    if (sscanf(line, "irq-begin clk=%lu", &clk) == 1) {
+        // only keep the latest run
+        run->count = 0;
+        run->clk = clk;
+        run->complete = false;
+    } else if (!strncmp(line, "irq-end", 7)) {
+        run->complete = true;
+    } else if (run->count < MAX_RESULTS && irq_latency_parse(line, &run->results[run->count])) {
+        run->count++;
+    }
+}
+
+/**
+ * Read a run from a device (after asking for one) or a file
+ *
+ * @param path - NULL for stdin
+ * @param run
+ *
+ * @return bool - false if it couldn't be opened or no run arrived
+ */
+static bool run_read(const char *path, run_t *run) {
+    int fd = path ? open(path, O_RDWR | O_NOCTTY) : STDIN_FILENO;
+    if (fd < 0 && path) fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+
+    struct termios tio;
+    if (isatty(fd) && tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+        tcflush(fd, TCIFLUSH);
+        // start a run now instead of waiting for the next interval
+        if (write(fd, "r", 1) != 1) perror("write");
+    }
+
+    memset(run, 0, sizeof(*run));
+
+    char line[IRQ_LATENCY_LINE_MAX + 16];
+    size_t len = 0;
+    struct pollfd pfd = {fd, POLLIN, 0};
+
+    while (!run->complete && poll(&pfd, 1, READ_TIMEOUT_MS) > 0) {
+        char c;
+        if (read(fd, &c, 1) != 1) break;
+
+        if (c == '\n') {
+            line[len] = 0;
+            if (len && line[len - 1] == '\r') line[len - 1] = 0;
+            run_add_line(run, line);
+            len = 0;
+        } else if (len < sizeof(line) - 1) {
+            line[len++] = c;
+        }
+    }
+
+    if (path) close(fd);
+    return run->count > 0;
+}
+
+/**
+ * Save a run in the format the board prints, usable as a baseline
+ *
+ * @param path
+ * @param run
+ *
+ * @return bool
+ */
+static bool run_save(const char *path, const run_t *run) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+
+    char line[IRQ_LATENCY_LINE_MAX];
+    fprintf(file, "irq-begin clk=%lu\n", run->clk);
+    for (size_t i = 0; i < run->count; i++) {
+        irq_latency_format(line, sizeof(line), &run->results[i]);
+        fprintf(file, "%s\n", line);
+    }
+    fprintf(file, "irq-end\n");
+
+    fclose(file);
+    return true;
+}
+
+static const irq_latency_result_t *run_find(const run_t *run, const char *name, const char *metric) {
+    for (size_t i = 0; i < run->count; i++) {
+        const irq_latency_result_t *result = &run->results[i];
+        if (!strcmp(result->name, name) && !strcmp(result->metric, metric)) return result;
+    }
+    return NULL;
+}
+
+/**
+ * Print the non-empty buckets of a result as bars
+ *
+ * @param result
+ * @param clk - CPU clock, 0 leaves out the ns
+ *
+ * @return void
+ */
+static void hist_print(const irq_latency_result_t *result, unsigned long clk) {
+    uint32_t most = 0;
+
+    for (uint32_t i = 0; i < HIST_BUCKETS; i++) {
+        if (result->hist.buckets[i] > most) most = result->hist.buckets[i];
+    }
+
+    for (uint32_t i = 0; i < HIST_BUCKETS; i++) {
+        uint32_t n = result->hist.buckets[i];
+        if (!n) continue;
+
+        int width = (int) (((uint64_t) n * BAR_WIDTH + most - 1) / most);
+        printf("    %8lu-%-8lu", (unsigned long) hist_bucket_low(i), (unsigned long) hist_bucket_high(i));
+        if (clk) printf(" %9.1f ns", hist_bucket_low(i) * 1e9 / clk);
+        printf(" %6lu %.*s\n", (unsigned long) n, width, "##################################################");
+    }
+}
+
+/**
+ * Print a run, compared against a baseline if there is one
+ *
+ * @param run
+ * @param baseline - NULL for none
+ * @param threshold - allowed median increase in percent
+ * @param histograms - print every histogram under its line
+ *
+ * @return int - number of regressed or missing results
+ */
+static int run_report(const run_t *run, const run_t *baseline, double threshold, bool histograms) {
+    int regressions = 0;
+
+    printf("%-20s %-7s %6s %8s %8s %8s %8s %10s", "case", "metric", "count", "min", "median", "p99", "max",
+           "median ns");
+    if (baseline) printf(" %8s %8s", "baseline", "change");
+    printf("\n");
+
+    for (size_t i = 0; i < run->count; i++) {
+        const irq_latency_result_t *result = &run->results[i];
+
+        printf("%-20s %-7s %6lu %8lu %8lu %8lu %8lu %10.1f", result->name, result->metric,
+               (unsigned long) result->count, (unsigned long) result->min, (unsigned long) result->median,
+               (unsigned long) result->p99, (unsigned long) result->max,
+               run->clk ? result->median * 1e9 / run->clk : 0);
+
+        const irq_latency_result_t *base = baseline ? run_find(baseline, result->name, result->metric) : NULL;
+        if (base) {
+            double change = base->median ? ((double) result->median - base->median) * 100 / base->median : 0;
+            bool regressed = change > threshold;
+
+            printf(" %8lu %+7.1f%%%s", (unsigned long) base->median, change, regressed ? "  REGRESSED" : "");
+            if (regressed) regressions++;
+        } else if (baseline) {
+            printf(" %8s", "new");
+        }
+        if (result->timeouts) printf("  %lu timeouts", (unsigned long) result->timeouts);
+        printf("\n");
+
+        if (histograms) hist_print(result, run->clk);
+    }
+
+    if (baseline) {
+        for (size_t i = 0; i < baseline->count; i++) {
+            const irq_latency_result_t *base = &baseline->results[i];
+            if (!run_find(run, base->name, base->metric)) {
+                printf("%-20s %-7s missing from this run\n", base->name, base->metric);
+                regressions++;
+            }
+        }
+    }
+
+    return regressions;
+}
+
+//
+// selftest: statistics, format, parse and compare on the host
+//
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static bool results_equal(const irq_latency_result_t *a, const irq_latency_result_t *b) {
+    return !strcmp(a->name, b->name) && !strcmp(a->metric, b->metric) && a->count == b->count &&
+           a->timeouts == b->timeouts && a->min == b->min && a->median == b->median && a->p99 == b->p99 &&
+           a->max == b->max && a->mean == b->mean && a->hist.count == b->hist.count &&
+           !memcmp(a->hist.buckets, b->hist.buckets, sizeof(a->hist.buckets));
+}
+
+static int selftest(void) {
+    static irq_latency_t latency;
+    static irq_latency_result_t entry, handler, parsed;
+    static run_t run, slower;
+    char line[IRQ_LATENCY_LINE_MAX];
+
+    // 1000 samples, entry shuffled 1..1000, handler constant
+    irq_latency_reset(&latency);
+    for (uint32_t i = 0; i < 1000; i++) {
+        irq_latency_add(&latency, (i * 617) % 1000 + 1, 40);
+    }
+    for (uint32_t i = 0; i < 100; i++) irq_latency_add(&latency, 1, 1);
+    latency.timeouts = 3;
+    expect(latency.count == IRQ_LATENCY_REPS_MAX, "samples past IRQ_LATENCY_REPS_MAX dropped");
+
+    latency.count = 1000;
+    irq_latency_results(&latency, "gpio/ram", &entry, &handler);
+    expect(entry.min == 1 && entry.median == 501 && entry.p99 == 991 && entry.max == 1000, "entry min/median/p99/max");
+    expect(entry.mean == 500 && entry.count == 1000 && entry.timeouts == 3, "entry mean, count, timeouts");
+    expect(entry.hist.count == 1000 && entry.hist.buckets[hist_bucket(1000)] > 0, "entry histogram");
+    expect(handler.min == 40 && handler.max == 40 && handler.hist.buckets[hist_bucket(40)] == 1000,
+           "constant handler time");
+    expect(!strcmp(entry.metric, IRQ_LATENCY_ENTRY) && !strcmp(handler.metric, IRQ_LATENCY_HANDLER),
+           "metric names");
+
+    // a result line round-trips, histogram included
+    size_t len = irq_latency_format(line, sizeof(line), &entry);
+    expect(len > 0 && len < sizeof(line), "format fits");
+    expect(irq_latency_parse(line, &parsed) && results_equal(&entry, &parsed), "format/parse round trip");
+
+    // empty case, no samples, all timeouts
+    irq_latency_t none = {.timeouts = 1000};
+    irq_latency_results(&none, "dma/flash", &entry, &handler);
+    irq_latency_format(line, sizeof(line), &entry);
+    expect(irq_latency_parse(line, &parsed) && parsed.count == 0 && parsed.timeouts == 1000, "empty case");
+
+    // a short buffer keeps the statistics and drops the histogram's tail
+    irq_latency_results(&latency, "alarm/flash-cold", &entry, &handler);
+    len = irq_latency_format(line, 140, &entry);
+    expect(len > 0 && len < 140 && irq_latency_parse(line, &parsed), "truncated line parses");
+    expect(parsed.median == entry.median && parsed.hist.count < entry.hist.count, "truncated histogram");
+
+    // other output is ignored, a new begin starts over
+    expect(!irq_latency_parse("bench gpio_put ops=64 reps=1000 min=1 median=2 p99=3 mean=2", &parsed),
+           "bench line ignored");
+    expect(!irq_latency_parse("irq gpio/ram entry count=1", &parsed), "partial line ignored");
+    expect(!irq_latency_parse("irq gpio/ram entry count=1 timeouts=0 min=1 median=1 p99=1 max=1 mean=1 hist=200:1",
+                              &parsed), "bad bucket rejected");
+
+    run_add_line(&run, "irq-begin clk=1");
+    run_add_line(&run, "irq x entry count=1 timeouts=0 min=1 median=1 p99=1 max=1 mean=1 hist=1:1");
+    run_add_line(&run, "irq-begin clk=125000000");
+    run_add_line(&run, "noise in between");
+    irq_latency_results(&latency, "gpio/ram", &entry, &handler);
+    irq_latency_format(line, sizeof(line), &entry);
+    run_add_line(&run, line);
+    irq_latency_format(line, sizeof(line), &handler);
+    strcat(line, "\r");
+    run_add_line(&run, line);
+    run_add_line(&run, "irq-end");
+    expect(run.complete && run.count == 2 && run.clk == 125000000, "run parsed back");
+    expect(run_find(&run, "gpio/ram", IRQ_LATENCY_HANDLER) != NULL, "result found by case and metric");
+
+    // the same run against itself passes, a slower copy regresses
+    slower = run;
+    slower.results[1].median = slower.results[1].median * 2 + 10;
+
+    expect(run_report(&run, &run, 10, true) == 0, "run against itself");
+    expect(run_report(&slower, &run, 10, false) == 1, "slower median flagged");
+    slower.count = 1;
+    expect(run_report(&slower, &run, 1000, false) == 1, "missing result flagged");
+
+    printf("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    const char *baseline_path = NULL;
+    const char *save_path = NULL;
+    double threshold = 10;
+    bool histograms = false;
+    int opt;
+
+    if (argc > 1 && !strcmp(argv[1], "selftest")) {
+        return selftest();
+    }
+
+    while ((opt = getopt(argc, argv, "Hb:s:t:")) != -1) {
+        switch (opt) {
+            case 'H': histograms = true; break;
+            case 'b': baseline_path = optarg; break;
+            case 's': save_path = optarg; break;
+            case 't': threshold = atof(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-H] [-b baseline] [-s save] [-t percent] [device|file] | selftest\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+
+    static run_t run, baseline;
+
+    if (baseline_path && !run_read(baseline_path, &baseline)) {
+        fprintf(stderr, "no results in %s\n", baseline_path);
+        return 1;
+    }
+
+    if (!run_read(optind < argc ? argv[optind] : NULL, &run)) {
+        fprintf(stderr, "no results\n");
+        return 1;
+    }
+
+    if (save_path && !run_save(save_path, &run)) {
+        return 1;
+    }
+
+    int regressions = run_report(&run, baseline_path ? &baseline : NULL, threshold, histograms);
+    if (regressions) {
+        printf("%d regressions over %.1f%%\n", regressions, threshold);
+    }
+
+    return regressions ? 1 : 0;
+}
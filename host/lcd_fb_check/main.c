@@ -0,0 +1,260 @@
+/**
+ * @brief Host check of the picow_lcd shadow framebuffer
+ *
+ * Links picow_lcd/src/lcd_fb.c against stand-ins for lcd_set_cursor()
+ * and lcd_write_char() that count the bus transactions and keep a
+ * model of the HD44780 display memory and address counter. Checks
+ * that a flush sends only what changed, never clears, never moves
+ * the cursor where auto-increment already put it and leaves the
+ * display showing the frame, on 16x2 and 20x4 layouts.
+ *
+ * Usage:
+ *
+ *   lcd_fb_check [-v]
+ *
+ * Exits with 1 if any check fails.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "lcd.h"
+#include "lcd_fb.h"
+
+// display memory, 0x00-0x27 and 0x40-0x67 in 2-line mode
+#define DDRAM_SIZE 0x80
+
+static bool verbose = false;
+static unsigned int checks = 0;
+static unsigned int failures = 0;
+
+static void check(bool ok, const char *name, long got, long expected) {
+    checks++;
+    if (!ok) {
+        printf("FAIL %s: got %ld, expected %ld\n", name, got, expected);
+        failures++;
+    } else if (verbose) {
+        printf("ok   %s: %ld\n", name, got);
+    }
+}
+
+// small LCG, the same frames on every run
+static uint32_t noise_state = 1;
+static uint32_t noise(uint32_t range) {
+    noise_state = noise_state * 1664525u + 1013904223u;
+    return (noise_state >> 8) % range;
+}
+
+//
+// HD44780 model behind the lcd.h calls lcd_fb.c makes
+//
+
+static const uint8_t row_address[4] = {0x00, 0x40, 0x14, 0x54};
+
+static char ddram[DDRAM_SIZE];
+static uint8_t address_counter;
+static unsigned int cursor_moves;
+static unsigned int data_writes;
+static unsigned int clears;
+// cursor moves to where the address counter already was
+static unsigned int redundant_moves;
+
+// right after lcd_init(): cleared, cursor home
+static void display_reset(void) {
+    memset(ddram, ' ', sizeof(ddram));
+    address_counter = 0;
+    cursor_moves = data_writes = clears = redundant_moves = 0;
+}
+
+static void display_count_reset(void) {
+    cursor_moves = data_writes = clears = redundant_moves = 0;
+}
+
+void lcd_set_cursor(uint8_t row, uint8_t col) {
+    uint8_t address = row_address[row] + col;
+
+    if (address == address_counter) redundant_moves++;
+    address_counter = address;
+    cursor_moves++;
+}
+
+void lcd_write_char(char c) {
+    ddram[address_counter] = c;
+    // 2-line mode wraps from the end of one line to the start of the other
+    address_counter = address_counter == 0x27 ? 0x40 : address_counter == 0x67 ? 0x00 : address_counter + 1;
+    data_writes++;
+}
+
+void lcd_clear() {
+    memset(ddram, ' ', sizeof(ddram));
+    address_counter = 0;
+    clears++;
+}
+
+void lcd_send_command(uint8_t command) {
+    if (command == 0x01) clears++;
+}
+
+/**
+ * Check the display shows every cell of the frame
+ *
+ * @return bool
+ */
+static bool display_matches(const lcd_fb_t *fb) {
+    for (uint8_t row = 0; row < fb->rows; row++) {
+        for (uint8_t col = 0; col < fb->cols; col++) {
+            if (ddram[row_address[row] + col] != fb->frame[row][col]) return false;
+        }
+    }
+    return true;
+}
+
+static void check_layout(uint8_t rows, uint8_t cols) {
+    lcd_fb_t fb;
+    char name[64];
+    char line[LCD_FB_MAX_COLS + 1];
+
+    display_reset();
+    lcd_fb_init(&fb, rows, cols);
+
+    // nothing changed, nothing sent
+    uint writes = lcd_fb_flush(&fb);
+    snprintf(name, sizeof(name), "%ux%u empty flush", cols, rows);
+    check(writes == 0 && data_writes == 0 && cursor_moves == 0, name, writes, 0);
+
+    // the whole screen from the cleared display: every row but the
+    // first needs a move, the first starts at home
+    for (uint8_t row = 0; row < rows; row++) {
+        for (uint8_t col = 0; col < cols; col++) line[col] = 'A' + (row * cols + col) % 26;
+        line[cols] = 0;
+        lcd_fb_print(&fb, row, 0, line);
+    }
+    display_count_reset();
+    writes = lcd_fb_flush(&fb);
+    snprintf(name, sizeof(name), "%ux%u full screen writes", cols, rows);
+    check(data_writes == (unsigned) rows * cols, name, data_writes, rows * cols);
+    snprintf(name, sizeof(name), "%ux%u full screen moves", cols, rows);
+    check(cursor_moves == rows - 1u, name, cursor_moves, rows - 1);
+    snprintf(name, sizeof(name), "%ux%u full screen returned", cols, rows);
+    check(writes == data_writes + cursor_moves, name, writes, data_writes + cursor_moves);
+    snprintf(name, sizeof(name), "%ux%u full screen shown", cols, rows);
+    check(display_matches(&fb), name, 0, 0);
+
+    // one changed digit: one move and one byte
+    lcd_fb_print(&fb, 1, 5, "7");
+    display_count_reset();
+    writes = lcd_fb_flush(&fb);
+    snprintf(name, sizeof(name), "%ux%u one digit", cols, rows);
+    check(cursor_moves == 1 && data_writes == 1 && writes == 2, name, writes, 2);
+
+    // the next digit over: auto-increment is already there
+    lcd_fb_print(&fb, 1, 6, "8");
+    display_count_reset();
+    lcd_fb_flush(&fb);
+    snprintf(name, sizeof(name), "%ux%u next digit", cols, rows);
+    check(cursor_moves == 0 && data_writes == 1, name, cursor_moves, 0);
+
+    // two digits apart: a move each, the unchanged cell in between isn't sent
+    lcd_fb_print(&fb, 0, 1, "12");
+    lcd_fb_print(&fb, 0, 4, "9");
+    display_count_reset();
+    lcd_fb_flush(&fb);
+    snprintf(name, sizeof(name), "%ux%u gap", cols, rows);
+    check(cursor_moves == 2 && data_writes == 3, name, cursor_moves * 100 + data_writes, 203);
+
+    // the same text again sends nothing
+    lcd_fb_print(&fb, 0, 1, "12");
+    display_count_reset();
+    writes = lcd_fb_flush(&fb);
+    snprintf(name, sizeof(name), "%ux%u unchanged", cols, rows);
+    check(writes == 0, name, writes, 0);
+
+    // lcd_fb_clear() only blanks the frame, the display gets spaces, not a clear
+    lcd_fb_clear(&fb);
+    display_count_reset();
+    lcd_fb_flush(&fb);
+    snprintf(name, sizeof(name), "%ux%u frame clear", cols, rows);
+    check(clears == 0 && data_writes == (unsigned) rows * cols && display_matches(&fb), name, data_writes,
+          rows * cols);
+
+    // random edits: the display always shows the frame, no move is wasted
+    bool shown = true;
+    unsigned int total_clears = 0;
+    unsigned int total_redundant = 0;
+    for (int i = 0; i < 10000; i++) {
+        for (uint32_t n = noise(6); n > 0; n--) {
+            char text[2] = {(char) ('0' + noise(10)), 0};
+            lcd_fb_print(&fb, noise(rows), noise(cols), text);
+        }
+        display_count_reset();
+        writes = lcd_fb_flush(&fb);
+        shown &= display_matches(&fb) && writes == data_writes + cursor_moves;
+        total_clears += clears;
+        total_redundant += redundant_moves;
+    }
+    snprintf(name, sizeof(name), "%ux%u random frames shown", cols, rows);
+    check(shown, name, 0, 0);
+    snprintf(name, sizeof(name), "%ux%u random redundant moves", cols, rows);
+    check(total_redundant == 0, name, total_redundant, 0);
+    snprintf(name, sizeof(name), "%ux%u random clears", cols, rows);
+    check(total_clears == 0, name, total_clears, 0);
+}
+
+static void check_rows_20x4(void) {
+    lcd_fb_t fb;
+
+    // row 2 continues row 0 in display memory, so no move between them
+    display_reset();
+    lcd_fb_init(&fb, 4, 20);
+    lcd_fb_print(&fb, 0, 0, "01234567890123456789");
+    lcd_fb_print(&fb, 2, 0, "abcdefghijabcdefghij");
+    lcd_fb_flush(&fb);
+    check(cursor_moves == 0 && data_writes == 40, "20x4 rows 0 and 2 in one run", cursor_moves, 0);
+
+    // and row 3 continues row 1, one move for the end of one and the start of the other
+    lcd_fb_print(&fb, 1, 19, "x");
+    lcd_fb_print(&fb, 3, 0, "y");
+    display_count_reset();
+    lcd_fb_flush(&fb);
+    check(cursor_moves == 1 && data_writes == 2 && display_matches(&fb), "20x4 rows 1 and 3 in one run",
+          cursor_moves, 1);
+
+    // the end of row 3 wraps to row 0 in display memory, not to row 1
+    lcd_fb_print(&fb, 3, 19, "z");
+    lcd_fb_print(&fb, 0, 0, "w");
+    display_count_reset();
+    lcd_fb_flush(&fb);
+    check(cursor_moves == 2 && data_writes == 2 && display_matches(&fb), "20x4 rows 3 and 0", cursor_moves, 2);
+
+    // clipped at the end of the row, nothing lands on the next one
+    lcd_fb_print(&fb, 0, 18, "XYZ");
+    display_count_reset();
+    lcd_fb_flush(&fb);
+    check(data_writes == 2 && fb.frame[2][0] == 'a', "20x4 print clipped", data_writes, 2);
+
+    // rows past the layout are ignored
+    lcd_fb_init(&fb, 2, 16);
+    display_reset();
+    lcd_fb_print(&fb, 2, 0, "nope");
+    check(lcd_fb_flush(&fb) == 0, "16x2 row 2 ignored", data_writes, 0);
+}
+
+int main(int argc, char **argv) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "v")) != -1) {
+        switch (opt) {
+            case 'v': verbose = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    check_layout(2, 16);
+    check_layout(4, 20);
+    check_rows_20x4();
+
+    printf("lcd_fb_check: %u checks, %u failures\n", checks, failures);
+    return failures ? 1 : 0;
+}
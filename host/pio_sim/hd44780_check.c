@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <string.h>
+#include "hd44780.h"
+#include "hd44780_check.h"
+
+/**
+ * Record one measurement of a timing parameter
+ *
+ * @param check - checker state
+ * @param param - HD44780_T_AS ... HD44780_EXEC_LONG
+ * @param cycles - measured time in system cycles
+ *
+ * @return void
+ */
+static void measure(hd44780_check_t *check, uint param, uint64_t cycles) {
+    hd44780_param_t *p = &check->params[param];
+    uint64_t ns = cycles * 1000000000ull / check->sys_clk;
+
+    if (!p->samples || ns < p->min_ns) p->min_ns = ns;
+    if (ns < p->limit_ns) p->violations++;
+    p->samples++;
+}
+
+/**
+ * Initialize the checker
+ *
+ * @param check - checker state
+ * @param rs_pin - GPIO of RS
+ * @param e_pin - GPIO of E
+ * @param d4_pin - GPIO of D4, D5-D7 follow it
+ * @param sys_clk - system clock in Hz, converts cycles to ns
+ *
+ * @return void
+ */
+void hd44780_check_init(hd44780_check_t *check, uint rs_pin, uint e_pin, uint d4_pin, uint32_t sys_clk) {
+    static const hd44780_param_t params[HD44780_PARAM_COUNT] = {
+        [HD44780_T_AS] = {"tAS  address set-up", HD44780_T_AS_NS, 0, 0, 0},
+        [HD44780_T_AH] = {"tAH  address hold", HD44780_T_AH_NS, 0, 0, 0},
+        [HD44780_PW_EH] = {"PWEH enable high", HD44780_PW_EH_NS, 0, 0, 0},
+        [HD44780_T_CYCE] = {"tcycE enable cycle", HD44780_T_CYCE_NS, 0, 0, 0},
+        [HD44780_T_DSW] = {"tDSW data set-up", HD44780_T_DSW_NS, 0, 0, 0},
+        [HD44780_T_H] = {"tH   data hold", HD44780_T_H_NS, 0, 0, 0},
+        // idle time past the typical execution time, a slow oscillator needs this much more
+        [HD44780_EXEC] = {"exec margin", (HD44780_EXEC_US - HD44780_EXEC_TYP_US) * 1000ull, 0, 0, 0},
+        [HD44780_EXEC_LONG] = {"exec margin clear", (HD44780_EXEC_LONG_US - HD44780_EXEC_LONG_TYP_US) * 1000ull, 0, 0, 0},
+    };
+
+    memset(check, 0, sizeof(*check));
+    check->rs_pin = rs_pin;
+    check->e_pin = e_pin;
+    check->d4_pin = d4_pin;
+    check->sys_clk = sys_clk;
+    memcpy(check->params, params, sizeof(params));
+}
+
+/**
+ * Feed one pin change, call from the simulator's pin callback
+ *
+ * E edges are handled before the RS and data changes of the same
+ * cycle, so a data change on the falling edge counts as zero hold.
+ *
+ * @param check - checker state
+ * @param cycle - system cycle of the change
+ * @param pins - new pin levels
+ * @param changed - mask of the pins that changed
+ *
+ * @return void
+ */
+void hd44780_check_pins(hd44780_check_t *check, uint64_t cycle, uint32_t pins, uint32_t changed) {
+    uint32_t rs_mask = 1u << check->rs_pin;
+    uint32_t data_mask = 0xfu << check->d4_pin;
+
+    if (changed & (1u << check->e_pin)) {
+        check->e = pins & (1u << check->e_pin);
+
+        if (check->e) {
+            measure(check, HD44780_T_AS, cycle - check->rs_change);
+            if (check->fell) {
+                measure(check, HD44780_T_CYCE, cycle - check->e_rise);
+            }
+            // the first nibble of a byte must wait for the previous byte to execute,
+            // the margin is how much longer than the typical time the bus stayed idle
+            if (check->nibbles == 0 && check->busy) {
+                uint param = check->exec_long ? HD44780_EXEC_LONG : HD44780_EXEC;
+                uint64_t required = (uint64_t) check->exec_us * check->sys_clk / 1000000;
+                uint64_t idle = cycle - check->byte_end;
+                if (idle < required) {
+                    check->params[param].violations++;
+                    check->params[param].samples++;
+                } else {
+                    measure(check, param, idle - required);
+                }
+            }
+            check->e_rise = cycle;
+        } else {
+            measure(check, HD44780_PW_EH, cycle - check->e_rise);
+            measure(check, HD44780_T_DSW, cycle - check->data_change);
+            check->e_fall = cycle;
+            check->fell = true;
+            check->hold_checked = false;
+            check->rs_hold_checked = false;
+
+            // the display latches the nibble on the falling edge
+            uint8_t nibble = (pins >> check->d4_pin) & 0xf;
+            if (check->nibbles++ == 0) {
+                check->high = nibble;
+            } else {
+                bool rs = pins & rs_mask;
+                uint8_t byte = (check->high << 4) | nibble;
+                if (check->count < HD44780_CHECK_MAX_BYTES) {
+                    check->bytes[check->count++] = (rs ? 0x100 : 0) | byte;
+                }
+                check->nibbles = 0;
+                check->busy = true;
+                check->byte_end = cycle;
+                check->exec_us = hd44780_exec_typ_us(rs, byte);
+                check->exec_long = check->exec_us != HD44780_EXEC_TYP_US;
+            }
+        }
+    }
+
+    if (changed & rs_mask) {
+        if (check->fell && !check->e && !check->rs_hold_checked) {
+            measure(check, HD44780_T_AH, cycle - check->e_fall);
+            check->rs_hold_checked = true;
+        }
+        check->rs_change = cycle;
+    }
+
+    if (changed & data_mask) {
+        if (check->fell && !check->e && !check->hold_checked) {
+            measure(check, HD44780_T_H, cycle - check->e_fall);
+            check->hold_checked = true;
+        }
+        check->data_change = cycle;
+    }
+}
+
+/**
+ * Print the decoded bytes and the timing table
+ *
+ * @param check - checker state
+ *
+ * @return bool - true if every write met the datasheet limits
+ */
+bool hd44780_check_report(const hd44780_check_t *check) {
+    uint64_t violations = 0;
+
+    printf("hd44780:      %u bytes decoded:", check->count);
+    for (uint i = 0; i < check->count; i++) {
+        uint16_t b = check->bytes[i];
+        if ((b & 0x100) && (b & 0xff) >= 0x20 && (b & 0xff) < 0x7f) {
+            printf(" '%c'", b & 0xff);
+        } else {
+            printf(" %s%02x", b & 0x100 ? "d:" : "c:", b & 0xff);
+        }
+    }
+    printf("\n");
+
+    for (uint i = 0; i < HD44780_PARAM_COUNT; i++) {
+        const hd44780_param_t *p = &check->params[i];
+        printf("  %-20s min %8llu ns, limit %5llu ns, %llu samples, %llu violations\n", p->name,
+               (unsigned long long) p->min_ns, (unsigned long long) p->limit_ns,
+               (unsigned long long) p->samples, (unsigned long long) p->violations);
+        violations += p->violations;
+    }
+
+    printf("hd44780:      %s\n", violations ? "FAIL" : "PASS");
+    return !violations;
+}
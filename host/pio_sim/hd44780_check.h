@@ -0,0 +1,76 @@
+/**
+ * @brief HD44780 bus timing checker for simulated pin traces
+ *
+ * Fed with the pin changes of a simulated state machine, decodes the
+ * 4-bit bus back into bytes and measures every write cycle against
+ * the datasheet limits in picow_lcd/src/hd44780.h: address set-up and
+ * hold, enable pulse width and cycle time, data set-up and hold, and
+ * the execution time the display needs after each byte. The idle
+ * time after a byte is measured against its typical execution time
+ * (fosc 270 kHz), the margin on top of it must cover the slowest
+ * oscillator (190 kHz) or the write counts as a violation.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hardware/pio.h"
+
+#define HD44780_CHECK_MAX_BYTES 256
+
+// one measured parameter, smallest value seen against its limit
+typedef struct {
+    const char *name;
+    uint64_t limit_ns;
+    uint64_t min_ns;
+    uint64_t samples;
+    uint64_t violations;
+} hd44780_param_t;
+
+enum {
+    HD44780_T_AS,
+    HD44780_T_AH,
+    HD44780_PW_EH,
+    HD44780_T_CYCE,
+    HD44780_T_DSW,
+    HD44780_T_H,
+    HD44780_EXEC,
+    HD44780_EXEC_LONG,
+    HD44780_PARAM_COUNT,
+};
+
+typedef struct {
+    uint rs_pin;
+    uint e_pin;
+    uint d4_pin;
+    uint32_t sys_clk;
+
+    // bus state, all times in system cycles
+    bool e;
+    bool fell;
+    uint64_t e_rise;
+    uint64_t e_fall;
+    uint64_t rs_change;
+    uint64_t data_change;
+    bool hold_checked;
+    bool rs_hold_checked;
+
+    // nibble assembly and execution time of the previous byte
+    uint nibbles;
+    uint8_t high;
+    bool busy;
+    uint64_t byte_end;
+    uint32_t exec_us;
+    bool exec_long;
+
+    hd44780_param_t params[HD44780_PARAM_COUNT];
+
+    // decoded bytes, bit 8 set for data (RS high)
+    uint16_t bytes[HD44780_CHECK_MAX_BYTES];
+    uint count;
+} hd44780_check_t;
+
+void hd44780_check_init(hd44780_check_t *check, uint rs_pin, uint e_pin, uint d4_pin, uint32_t sys_clk);
+void hd44780_check_pins(hd44780_check_t *check, uint64_t cycle, uint32_t pins, uint32_t changed);
+bool hd44780_check_report(const hd44780_check_t *check);
@@ -0,0 +1,161 @@
+/**
+ * @brief Host stand-in for the subset of "hardware/pio.h" used by
+ * the pioasm generated headers (program.pio.h, dma_pio.pio.h, ...)
+ *
+ * The generated headers only need `struct pio_program`, the
+ * `pio_sm_config` type and a couple of sm_config_* setters. The
+ * setters below encode the exact same register bit fields as the
+ * SDK does, so the simulator can decode them like the hardware.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+// PIO register bit fields (see RP2040 datasheet, 3.7 List of Registers)
+#define PIO_SM0_CLKDIV_INT_LSB 16
+#define PIO_SM0_CLKDIV_FRAC_LSB 8
+#define PIO_SM0_EXECCTRL_SIDE_EN_LSB 30
+#define PIO_SM0_EXECCTRL_SIDE_PINDIR_LSB 29
+#define PIO_SM0_EXECCTRL_JMP_PIN_LSB 24
+#define PIO_SM0_EXECCTRL_WRAP_TOP_LSB 12
+#define PIO_SM0_EXECCTRL_WRAP_BOTTOM_LSB 7
+#define PIO_SM0_EXECCTRL_STATUS_SEL_LSB 4
+#define PIO_SM0_EXECCTRL_STATUS_N_LSB 0
+#define PIO_SM0_SHIFTCTRL_FJOIN_RX_LSB 31
+#define PIO_SM0_SHIFTCTRL_FJOIN_TX_LSB 30
+#define PIO_SM0_SHIFTCTRL_PULL_THRESH_LSB 25
+#define PIO_SM0_SHIFTCTRL_PUSH_THRESH_LSB 20
+#define PIO_SM0_SHIFTCTRL_OUT_SHIFTDIR_LSB 19
+#define PIO_SM0_SHIFTCTRL_IN_SHIFTDIR_LSB 18
+#define PIO_SM0_SHIFTCTRL_AUTOPULL_LSB 17
+#define PIO_SM0_SHIFTCTRL_AUTOPUSH_LSB 16
+#define PIO_SM0_PINCTRL_SIDESET_COUNT_LSB 29
+#define PIO_SM0_PINCTRL_SET_COUNT_LSB 26
+#define PIO_SM0_PINCTRL_OUT_COUNT_LSB 20
+#define PIO_SM0_PINCTRL_IN_BASE_LSB 15
+#define PIO_SM0_PINCTRL_SIDESET_BASE_LSB 10
+#define PIO_SM0_PINCTRL_SET_BASE_LSB 5
+#define PIO_SM0_PINCTRL_OUT_BASE_LSB 0
+
+struct pio_program {
+    const uint16_t *instructions;
+    uint8_t length;
+    int8_t origin;
+    uint8_t pio_version;
+};
+
+typedef struct {
+    uint32_t clkdiv;
+    uint32_t execctrl;
+    uint32_t shiftctrl;
+    uint32_t pinctrl;
+} pio_sm_config;
+
+enum pio_fifo_join {
+    PIO_FIFO_JOIN_NONE = 0,
+    PIO_FIFO_JOIN_TX = 1,
+    PIO_FIFO_JOIN_RX = 2,
+};
+
+enum pio_mov_status_type {
+    STATUS_TX_LESSTHAN = 0,
+    STATUS_RX_LESSTHAN = 1,
+};
+
+/**
+ * Replace a bit field in a register value
+ *
+ * @param reg - register value
+ * @param lsb - least significant bit of the field
+ * @param bits - width of the field
+ * @param value - new field value
+ *
+ * @return uint32_t
+ */
+static inline uint32_t _pio_field(uint32_t reg, uint lsb, uint bits, uint32_t value) {
+    uint32_t mask = (bits >= 32 ? ~0u : ((1u << bits) - 1)) << lsb;
+    return (reg & ~mask) | ((value << lsb) & mask);
+}
+
+static inline void sm_config_set_out_pins(pio_sm_config *c, uint out_base, uint out_count) {
+    c->pinctrl = _pio_field(c->pinctrl, PIO_SM0_PINCTRL_OUT_BASE_LSB, 5, out_base);
+    c->pinctrl = _pio_field(c->pinctrl, PIO_SM0_PINCTRL_OUT_COUNT_LSB, 6, out_count);
+}
+
+static inline void sm_config_set_set_pins(pio_sm_config *c, uint set_base, uint set_count) {
+    c->pinctrl = _pio_field(c->pinctrl, PIO_SM0_PINCTRL_SET_BASE_LSB, 5, set_base);
+    c->pinctrl = _pio_field(c->pinctrl, PIO_SM0_PINCTRL_SET_COUNT_LSB, 3, set_count);
+}
+
+static inline void sm_config_set_in_pins(pio_sm_config *c, uint in_base) {
+    c->pinctrl = _pio_field(c->pinctrl, PIO_SM0_PINCTRL_IN_BASE_LSB, 5, in_base);
+}
+
+static inline void sm_config_set_sideset_pins(pio_sm_config *c, uint sideset_base) {
+    c->pinctrl = _pio_field(c->pinctrl, PIO_SM0_PINCTRL_SIDESET_BASE_LSB, 5, sideset_base);
+}
+
+static inline void sm_config_set_sideset(pio_sm_config *c, uint bit_count, bool optional, bool pindirs) {
+    c->pinctrl = _pio_field(c->pinctrl, PIO_SM0_PINCTRL_SIDESET_COUNT_LSB, 3, bit_count);
+    c->execctrl = _pio_field(c->execctrl, PIO_SM0_EXECCTRL_SIDE_EN_LSB, 1, optional);
+    c->execctrl = _pio_field(c->execctrl, PIO_SM0_EXECCTRL_SIDE_PINDIR_LSB, 1, pindirs);
+}
+
+static inline void sm_config_set_clkdiv_int_frac(pio_sm_config *c, uint16_t div_int, uint8_t div_frac) {
+    c->clkdiv = ((uint32_t) div_int << PIO_SM0_CLKDIV_INT_LSB) | ((uint32_t) div_frac << PIO_SM0_CLKDIV_FRAC_LSB);
+}
+
+static inline void sm_config_set_clkdiv(pio_sm_config *c, float div) {
+    uint16_t div_int = (uint16_t) div;
+    uint8_t div_frac = div_int ? (uint8_t) ((div - (float) div_int) * (1u << 8u)) : 0;
+    sm_config_set_clkdiv_int_frac(c, div_int, div_frac);
+}
+
+static inline void sm_config_set_wrap(pio_sm_config *c, uint wrap_target, uint wrap) {
+    c->execctrl = _pio_field(c->execctrl, PIO_SM0_EXECCTRL_WRAP_BOTTOM_LSB, 5, wrap_target);
+    c->execctrl = _pio_field(c->execctrl, PIO_SM0_EXECCTRL_WRAP_TOP_LSB, 5, wrap);
+}
+
+static inline void sm_config_set_jmp_pin(pio_sm_config *c, uint pin) {
+    c->execctrl = _pio_field(c->execctrl, PIO_SM0_EXECCTRL_JMP_PIN_LSB, 5, pin);
+}
+
+static inline void sm_config_set_in_shift(pio_sm_config *c, bool shift_right, bool autopush, uint push_threshold) {
+    c->shiftctrl = _pio_field(c->shiftctrl, PIO_SM0_SHIFTCTRL_IN_SHIFTDIR_LSB, 1, shift_right);
+    c->shiftctrl = _pio_field(c->shiftctrl, PIO_SM0_SHIFTCTRL_AUTOPUSH_LSB, 1, autopush);
+    c->shiftctrl = _pio_field(c->shiftctrl, PIO_SM0_SHIFTCTRL_PUSH_THRESH_LSB, 5, push_threshold & 0x1fu);
+}
+
+static inline void sm_config_set_out_shift(pio_sm_config *c, bool shift_right, bool autopull, uint pull_threshold) {
+    c->shiftctrl = _pio_field(c->shiftctrl, PIO_SM0_SHIFTCTRL_OUT_SHIFTDIR_LSB, 1, shift_right);
+    c->shiftctrl = _pio_field(c->shiftctrl, PIO_SM0_SHIFTCTRL_AUTOPULL_LSB, 1, autopull);
+    c->shiftctrl = _pio_field(c->shiftctrl, PIO_SM0_SHIFTCTRL_PULL_THRESH_LSB, 5, pull_threshold & 0x1fu);
+}
+
+static inline void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join) {
+    c->shiftctrl = _pio_field(c->shiftctrl, PIO_SM0_SHIFTCTRL_FJOIN_TX_LSB, 1, join == PIO_FIFO_JOIN_TX);
+    c->shiftctrl = _pio_field(c->shiftctrl, PIO_SM0_SHIFTCTRL_FJOIN_RX_LSB, 1, join == PIO_FIFO_JOIN_RX);
+}
+
+static inline void sm_config_set_mov_status(pio_sm_config *c, enum pio_mov_status_type status_sel, uint status_n) {
+    c->execctrl = _pio_field(c->execctrl, PIO_SM0_EXECCTRL_STATUS_SEL_LSB, 1, status_sel);
+    c->execctrl = _pio_field(c->execctrl, PIO_SM0_EXECCTRL_STATUS_N_LSB, 4, status_n);
+}
+
+/**
+ * Same defaults as the SDK: clkdiv 1, wrap 0..31, shift right, no autopull/push
+ *
+ * @return pio_sm_config
+ */
+static inline pio_sm_config pio_get_default_sm_config(void) {
+    pio_sm_config c = {0, 0, 0, 0};
+    sm_config_set_clkdiv_int_frac(&c, 1, 0);
+    sm_config_set_wrap(&c, 0, 31);
+    sm_config_set_in_shift(&c, true, false, 32);
+    sm_config_set_out_shift(&c, true, false, 32);
+    return c;
+}
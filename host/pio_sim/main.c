@@ -0,0 +1,364 @@
+/**
+ * @brief Host-side runner for the PIO programs in this repository
+ *
+ * Loads the pioasm output of an example (clock_gen_program from
+ * lib/clock_gen as picow_pio runs it, dma_pio_program from
+ * picow_dma_pio, lcd_pio_program from picow_lcd), configures the state machine exactly like the
+ * firmware does and runs it on the cycle-accurate model in pio_sim.c.
+ *
+ * The lcd target also feeds the bytes of a picow_lcd screen update
+ * and checks the bus against the HD44780 timing (hd44780_check.c),
+ * exiting with 1 if any write violates it. Try -d 20 to see it fail.
+ *
+ * Usage:
+ *
+ *   pio_sim [options] <clock_gen|dma_pio|lcd>
+ *
+ *   -d, --clkdiv <div>     state machine clock divider (default: same as the firmware)
+ *   -s, --sys-clk <hz>     system clock (default: 125000000)
+ *   -t, --time <seconds>   simulated time (default: 4)
+ *   -l, --level <0-31>     dma_pio only, wavetable level kept in the TX FIFO (default: 16)
+ *   -b, --bench            report how many state machine cycles per second the simulator runs
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pio_sim.h"
+#include "clock_gen.pio.h"
+#include "clock_solver.h"
+#include "dma_pio.pio.h"
+#include "lcd_pio.pio.h"
+#include "hd44780.h"
+#include "hd44780_check.h"
+
+// same pins and dividers as the firmware
+#define LED_PIN 16
+#define CLOCK_GEN_CLK_DIV 1.f
+#define CLOCK_GEN_FREQUENCY 2000
+#define DMA_PIO_CLK_DIV 10.f
+// picow_lcd: RS, E, D4-D7 on GPIO 10-15, 1 MHz state machine clock
+#define LCD_RS_PIN 10
+#define LCD_E_PIN 11
+#define LCD_D4_PIN 12
+#define LCD_PIO_CLK_DIV 125.f
+#define LCD_PIO_FREQ 1000000
+
+typedef struct {
+    uint64_t rises;
+    uint64_t falls;
+    uint64_t last_rise;
+    uint64_t last_fall;
+    uint64_t period_min;
+    uint64_t period_max;
+    uint64_t period_sum;
+    uint64_t high_sum;
+    uint64_t last_high;
+} pin_stats_t;
+
+typedef struct {
+    const char *name;
+    const struct pio_program *program;
+    float clk_div;
+    void (*setup)(pio_sim_t *pio, uint sm, uint offset, float clk_div, uint32_t sys_clk);
+    // optional extra checks after the run, false fails the run
+    bool (*finish)(void);
+} target_t;
+
+static pin_stats_t pin_stats[32];
+static uint32_t feed_word;
+
+// bytes picow_lcd sends after lcd_init() for its first frame, bit 8 set for data
+static const uint16_t lcd_script[] = {
+    0x001, // clear
+    0x148, 0x165, 0x16c, 0x16c, 0x16f, 0x12c, 0x120, 0x157, 0x16f, 0x172, 0x16c, 0x164, 0x121, // "Hello, World!"
+    0x0c0, // cursor to row 1
+    0x130, // "0"
+};
+static uint lcd_script_pos;
+static hd44780_check_t lcd_check;
+static bool lcd_checking;
+
+/**
+ * Collect edge statistics for every pin the state machines drive
+ *
+ * @return void
+ */
+static void on_pin_change(pio_sim_t *pio, uint64_t cycle, uint32_t pins, uint32_t changed, void *user) {
+    for (uint pin = 0; pin < 32; pin++) {
+        if (!(changed & (1u << pin))) continue;
+
+        pin_stats_t *p = &pin_stats[pin];
+        if (pins & (1u << pin)) {
+            // full periods are measured rising edge to rising edge
+            if (p->rises) {
+                uint64_t period = cycle - p->last_rise;
+                p->period_min = p->rises == 1 || period < p->period_min ? period : p->period_min;
+                p->period_max = period > p->period_max ? period : p->period_max;
+                p->period_sum += period;
+                p->high_sum += p->last_high;
+            }
+            p->rises++;
+            p->last_rise = cycle;
+        } else {
+            if (p->rises) p->last_high = cycle - p->last_rise;
+            p->falls++;
+            p->last_fall = cycle;
+        }
+    }
+
+    if (lcd_checking) {
+        hd44780_check_pins(&lcd_check, cycle, pins, changed);
+    }
+}
+
+/**
+ * Emulates the DMA channel of picow_dma_pio: keeps the TX FIFO full
+ *
+ * @return void
+ */
+static void on_dreq(pio_sim_t *pio, uint sm, void *user) {
+    while (!pio_sim_sm_tx_full(pio, sm)) {
+        pio_sim_sm_put(pio, sm, feed_word);
+    }
+}
+
+/**
+ * Same configuration as clock_gen_init() in lib/clock_gen/clock_gen.c,
+ * 2 kHz 50% like picow_pio starts with
+ *
+ * @return void
+ */
+static void setup_clock_gen(pio_sim_t *pio, uint sm, uint offset, float clk_div, uint32_t sys_clk) {
+    clock_timing_t timing = {.clkdiv = 1, .high = CLOCK_MAX_HIGH, .low = CLOCK_MAX_LOW};
+
+    // solved at the state machine clock the divider leaves, the solver may divide further
+    if (!clock_solve((uint32_t) (sys_clk / clk_div), CLOCK_GEN_FREQUENCY, 50, &timing)) {
+        printf("clock_gen:    %u Hz out of range at clkdiv %.4f, using the longest period\n", CLOCK_GEN_FREQUENCY,
+               clk_div);
+    }
+
+    pio_sm_config config = clock_gen_program_get_default_config(offset);
+    sm_config_set_sideset_pins(&config, LED_PIN);
+    sm_config_set_out_shift(&config, true, false, 32);
+    sm_config_set_clkdiv(&config, clk_div * timing.clkdiv);
+    pio->pindirs |= 1u << LED_PIN;
+    pio_sim_sm_init(pio, sm, offset, &config);
+    pio_sim_sm_put(pio, sm, clock_gen_word(&timing));
+}
+
+/**
+ * Same configuration as dma_pio_program_init() in picow_dma_pio/src/main.c
+ *
+ * @return void
+ */
+static void setup_dma_pio(pio_sim_t *pio, uint sm, uint offset, float clk_div, uint32_t sys_clk) {
+    pio_sm_config c = dma_pio_program_get_default_config(offset);
+    sm_config_set_out_pins(&c, LED_PIN, 1);
+    sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+    sm_config_set_clkdiv(&c, clk_div);
+    sm_config_set_out_shift(&c, true, true, 32);
+    pio->pindirs |= 1u << LED_PIN;
+    pio_sim_sm_init(pio, sm, offset, &c);
+    pio_sim_set_dreq_callback(pio, on_dreq, NULL);
+}
+
+/**
+ * Emulates the queue DMA of picow_lcd: feeds the script, encoded
+ * like lcd_pio_write() does, as long as there's room in the FIFO
+ *
+ * @return void
+ */
+static void on_lcd_dreq(pio_sim_t *pio, uint sm, void *user) {
+    uint count = sizeof(lcd_script) / sizeof(lcd_script[0]);
+
+    while (lcd_script_pos < count && !pio_sim_sm_tx_full(pio, sm)) {
+        bool rs = lcd_script[lcd_script_pos] & 0x100;
+        uint8_t byte = lcd_script[lcd_script_pos] & 0xff;
+        uint32_t cycles = hd44780_exec_us(rs, byte) * (LCD_PIO_FREQ / 1000000);
+        uint32_t delay = cycles > lcd_pio_delay_overhead ? cycles - lcd_pio_delay_overhead : 0;
+
+        pio_sim_sm_put(pio, sm, hd44780_pio_word(rs, byte, delay));
+        lcd_script_pos++;
+    }
+}
+
+/**
+ * Same configuration as lcd_pio_init() in picow_lcd/src/lcd_pio.c
+ *
+ * @return void
+ */
+static void setup_lcd(pio_sim_t *pio, uint sm, uint offset, float clk_div, uint32_t sys_clk) {
+    pio_sm_config config = lcd_pio_program_get_default_config(offset);
+    sm_config_set_out_pins(&config, LCD_RS_PIN, 6);
+    sm_config_set_sideset_pins(&config, LCD_E_PIN);
+    sm_config_set_out_shift(&config, true, false, 32);
+    sm_config_set_fifo_join(&config, PIO_FIFO_JOIN_TX);
+    sm_config_set_clkdiv(&config, clk_div);
+    pio->pindirs |= 0x3fu << LCD_RS_PIN;
+    pio_sim_sm_init(pio, sm, offset, &config);
+    pio_sim_set_dreq_callback(pio, on_lcd_dreq, NULL);
+
+    hd44780_check_init(&lcd_check, LCD_RS_PIN, LCD_E_PIN, LCD_D4_PIN, sys_clk);
+    lcd_checking = true;
+}
+
+/**
+ * Check the timing and that the display received the script
+ *
+ * @return bool
+ */
+static bool finish_lcd(void) {
+    uint count = sizeof(lcd_script) / sizeof(lcd_script[0]);
+    bool ok = hd44780_check_report(&lcd_check);
+
+    if (lcd_check.count != count || memcmp(lcd_check.bytes, lcd_script, sizeof(lcd_script))) {
+        printf("hd44780:      decoded bytes don't match the %u sent\n", count);
+        ok = false;
+    }
+
+    return ok;
+}
+
+static const target_t targets[] = {
+    {"clock_gen", &clock_gen_program, CLOCK_GEN_CLK_DIV, setup_clock_gen, NULL},
+    {"dma_pio", &dma_pio_program, DMA_PIO_CLK_DIV, setup_dma_pio, NULL},
+    {"lcd", &lcd_pio_program, LCD_PIO_CLK_DIV, setup_lcd, finish_lcd},
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [-d clkdiv] [-s sys_clk] [-t seconds] [-l level] [-b] <clock_gen|dma_pio|lcd>\n", argv0);
+}
+
+/**
+ * Print cycle counts and pin toggle rates
+ *
+ * @param pio - simulated PIO block after the run
+ * @param sm - state machine that ran the program
+ * @param sys_clk - system clock in Hz
+ *
+ * @return void
+ */
+static void report(const pio_sim_t *pio, uint sm, uint32_t sys_clk) {
+    const pio_sim_sm_t *s = &pio->sm[sm];
+    double div = (double) (s->clkdiv >> PIO_SM0_CLKDIV_INT_LSB) + ((s->clkdiv >> PIO_SM0_CLKDIV_FRAC_LSB) & 0xff) / 256.0;
+
+    printf("sys clock:    %u Hz, clkdiv %.4f (SM clock %.3f Hz)\n", sys_clk, div, sys_clk / div);
+    printf("simulated:    %llu sys cycles (%.6f s)\n", (unsigned long long) pio->cycle, (double) pio->cycle / sys_clk);
+    printf("state machine: %llu cycles, %llu instructions, %llu stalled, %llu wraps\n",
+           (unsigned long long) s->cycles, (unsigned long long) s->instructions,
+           (unsigned long long) s->stall_cycles, (unsigned long long) s->wraps);
+
+    if (s->wraps > 1) {
+        double per_wrap = (double) (s->last_wrap_cycle - s->first_wrap_cycle) / (double) (s->wraps - 1);
+        printf("per wrap:     %.3f SM cycles (%.3f sys cycles, %.3f Hz)\n", per_wrap, per_wrap * div, sys_clk / (per_wrap * div));
+    }
+
+    for (uint pin = 0; pin < 32; pin++) {
+        const pin_stats_t *p = &pin_stats[pin];
+        if (!p->rises && !p->falls) continue;
+
+        printf("pin %2u:       %llu rising, %llu falling edges", pin, (unsigned long long) p->rises, (unsigned long long) p->falls);
+        if (p->rises > 1) {
+            uint64_t periods = p->rises - 1;
+            double period = (double) p->period_sum / periods;
+            printf(", period %.3f sys cycles (min %llu, max %llu), %.3f SM cycles\n", period,
+                   (unsigned long long) p->period_min, (unsigned long long) p->period_max, period / div);
+            printf("              %.6f Hz, duty %.3f%%, %.3f toggles/s\n", sys_clk / period,
+                   100.0 * p->high_sum / p->period_sum, 2.0 * sys_clk / period);
+        } else {
+            printf(", not enough edges for a period\n");
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    static const struct option options[] = {
+        {"clkdiv", required_argument, NULL, 'd'},
+        {"sys-clk", required_argument, NULL, 's'},
+        {"time", required_argument, NULL, 't'},
+        {"level", required_argument, NULL, 'l'},
+        {"bench", no_argument, NULL, 'b'},
+        {NULL, 0, NULL, 0},
+    };
+
+    float clk_div = 0;
+    uint32_t sys_clk = 125000000;
+    double seconds = 4;
+    uint level = 16;
+    bool bench = false;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "d:s:t:l:b", options, NULL)) != -1) {
+        switch (opt) {
+            case 'd': clk_div = strtof(optarg, NULL); break;
+            case 's': sys_clk = strtoul(optarg, NULL, 0); break;
+            case 't': seconds = strtod(optarg, NULL); break;
+            case 'l': level = strtoul(optarg, NULL, 0) & 31; break;
+            case 'b': bench = true; break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const target_t *target = NULL;
+    for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+        if (strcmp(argv[optind], targets[i].name) == 0) target = &targets[i];
+    }
+    if (!target) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // same bit pattern picow_dma_pio puts in its wavetable
+    feed_word = ~(~0u << level);
+
+    static pio_sim_t pio;
+    pio_sim_init(&pio);
+    pio_sim_set_pin_callback(&pio, on_pin_change, NULL);
+
+    int offset = pio_sim_add_program(&pio, target->program);
+    target->setup(&pio, 0, offset, clk_div > 0 ? clk_div : target->clk_div, sys_clk);
+    pio_sim_sm_set_enabled(&pio, 0, true);
+
+    printf("program:      %s, %u instructions at offset %d\n", target->name, target->program->length, offset);
+
+    if (bench) {
+        // run in slices of 2^20 SM cycles until a second of wall time has passed
+        uint64_t div_256 = ((pio.sm[0].clkdiv >> 8) ? (pio.sm[0].clkdiv >> 8) : 1);
+        uint64_t slice = (div_256 << 20) >> 8;
+        double start = now_seconds();
+        double elapsed;
+
+        do {
+            pio_sim_run(&pio, slice ? slice : 1);
+            elapsed = now_seconds() - start;
+        } while (elapsed < 1.0);
+
+        report(&pio, 0, sys_clk);
+        printf("benchmark:    %.0f SM cycles/s, %.3f simulated s per wall s\n",
+               pio.sm[0].cycles / elapsed, (double) pio.cycle / sys_clk / elapsed);
+        return 0;
+    }
+
+    pio_sim_run(&pio, (uint64_t) (seconds * sys_clk));
+    report(&pio, 0, sys_clk);
+
+    if (target->finish && !target->finish()) {
+        return 1;
+    }
+
+    return 0;
+}
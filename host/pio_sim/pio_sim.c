@@ -0,0 +1,741 @@
+#include <string.h>
+#include "pio_sim.h"
+
+// instruction encoding (see RP2040 datasheet, 3.4 Instruction Set)
+#define INSTR_JMP 0
+#define INSTR_WAIT 1
+#define INSTR_IN 2
+#define INSTR_OUT 3
+#define INSTR_PUSH_PULL 4
+#define INSTR_MOV 5
+#define INSTR_IRQ 6
+#define INSTR_SET 7
+
+/**
+ * Extract a bit field from a register value
+ *
+ * @param reg - register value
+ * @param lsb - least significant bit of the field
+ * @param bits - width of the field
+ *
+ * @return uint32_t
+ */
+static inline uint32_t field(uint32_t reg, uint lsb, uint bits) {
+    return (reg >> lsb) & ((1u << bits) - 1);
+}
+
+// a threshold of 0 means 32 bits
+static inline uint pull_threshold(const pio_sim_sm_t *s) {
+    uint t = field(s->shiftctrl, PIO_SM0_SHIFTCTRL_PULL_THRESH_LSB, 5);
+    return t ? t : 32;
+}
+
+static inline uint push_threshold(const pio_sim_sm_t *s) {
+    uint t = field(s->shiftctrl, PIO_SM0_SHIFTCTRL_PUSH_THRESH_LSB, 5);
+    return t ? t : 32;
+}
+
+static inline uint tx_depth(const pio_sim_sm_t *s) {
+    if (field(s->shiftctrl, PIO_SM0_SHIFTCTRL_FJOIN_TX_LSB, 1)) return 2 * PIO_SIM_FIFO_DEPTH;
+    if (field(s->shiftctrl, PIO_SM0_SHIFTCTRL_FJOIN_RX_LSB, 1)) return 0;
+    return PIO_SIM_FIFO_DEPTH;
+}
+
+static inline uint rx_depth(const pio_sim_sm_t *s) {
+    if (field(s->shiftctrl, PIO_SM0_SHIFTCTRL_FJOIN_RX_LSB, 1)) return 2 * PIO_SIM_FIFO_DEPTH;
+    if (field(s->shiftctrl, PIO_SM0_SHIFTCTRL_FJOIN_TX_LSB, 1)) return 0;
+    return PIO_SIM_FIFO_DEPTH;
+}
+
+// clock divider in 1/256 system cycles, an integer part of 0 means 65536
+static inline uint64_t clkdiv_256(const pio_sim_sm_t *s) {
+    uint64_t div_int = field(s->clkdiv, PIO_SM0_CLKDIV_INT_LSB, 16);
+    uint64_t div_frac = field(s->clkdiv, PIO_SM0_CLKDIV_FRAC_LSB, 8);
+    if (div_int == 0) div_int = 65536;
+    return (div_int << 8) | div_frac;
+}
+
+static inline uint32_t rotr(uint32_t value, uint n) {
+    n &= 31;
+    return n ? (value >> n) | (value << (32 - n)) : value;
+}
+
+static inline uint32_t bitrev(uint32_t value) {
+    uint32_t out = 0;
+    for (int i = 0; i < 32; i++) {
+        out = (out << 1) | (value & 1);
+        value >>= 1;
+    }
+    return out;
+}
+
+/**
+ * Drive a group of pins (or pin directions) from the low bits of value
+ *
+ * @param pio - the simulated PIO block
+ * @param dirs - true to write pin directions instead of levels
+ * @param base - first pin of the group
+ * @param count - number of pins, wrapping around at 32
+ * @param value - new levels, LSB goes to base
+ *
+ * @return void
+ */
+static void write_pins(pio_sim_t *pio, bool dirs, uint base, uint count, uint32_t value) {
+    uint32_t *reg = dirs ? &pio->pindirs : &pio->pins;
+    uint32_t old = pio->pins;
+
+    for (uint i = 0; i < count; i++) {
+        uint32_t bit = 1u << ((base + i) & 31);
+        *reg = (value >> i) & 1 ? *reg | bit : *reg & ~bit;
+    }
+
+    if (!dirs && old != pio->pins && pio->pin_callback) {
+        pio->pin_callback(pio, pio->cycle, pio->pins, old ^ pio->pins, pio->pin_user);
+    }
+}
+
+// pins as seen by IN/WAIT/JMP PIN: outputs read back, inputs from outside
+static inline uint32_t read_gpios(const pio_sim_t *pio) {
+    return (pio->pins & pio->pindirs) | (pio->gpio_in & ~pio->pindirs);
+}
+
+static uint irq_index(uint sm, uint index) {
+    // REL: the low 2 bits are added to the state machine number
+    if (index & 0x10) {
+        return (index & 0x4) | ((index + sm) & 0x3);
+    }
+    return index & 0x7;
+}
+
+static void tx_pop(pio_sim_sm_t *s, uint32_t *data) {
+    *data = s->tx_fifo[s->tx_head];
+    s->tx_head = (s->tx_head + 1) % (2 * PIO_SIM_FIFO_DEPTH);
+    s->tx_level--;
+}
+
+static bool rx_push(pio_sim_sm_t *s, uint32_t data) {
+    if (s->rx_level >= rx_depth(s)) return false;
+    s->rx_fifo[(s->rx_head + s->rx_level) % (2 * PIO_SIM_FIFO_DEPTH)] = data;
+    s->rx_level++;
+    return true;
+}
+
+/**
+ * Shift bits out of the OSR
+ *
+ * @param s - state machine
+ * @param count - number of bits, 1 to 32
+ *
+ * @return uint32_t
+ */
+static uint32_t osr_shift(pio_sim_sm_t *s, uint count) {
+    uint32_t data;
+    bool right = field(s->shiftctrl, PIO_SM0_SHIFTCTRL_OUT_SHIFTDIR_LSB, 1);
+
+    if (count == 32) {
+        data = s->osr;
+        s->osr = 0;
+    } else if (right) {
+        data = s->osr & ((1u << count) - 1);
+        s->osr >>= count;
+    } else {
+        data = s->osr >> (32 - count);
+        s->osr <<= count;
+    }
+
+    s->osr_count = s->osr_count + count > 32 ? 32 : s->osr_count + count;
+    return data;
+}
+
+/**
+ * Shift bits into the ISR
+ *
+ * @param s - state machine
+ * @param count - number of bits, 1 to 32
+ * @param data - source value, only the low `count` bits are used
+ *
+ * @return void
+ */
+static void isr_shift(pio_sim_sm_t *s, uint count, uint32_t data) {
+    bool right = field(s->shiftctrl, PIO_SM0_SHIFTCTRL_IN_SHIFTDIR_LSB, 1);
+
+    if (count == 32) {
+        s->isr = data;
+    } else {
+        data &= (1u << count) - 1;
+        s->isr = right ? (s->isr >> count) | (data << (32 - count)) : (s->isr << count) | data;
+    }
+
+    s->isr_count = s->isr_count + count > 32 ? 32 : s->isr_count + count;
+}
+
+/**
+ * Execute one instruction
+ *
+ * @param pio - the simulated PIO block
+ * @param sm - state machine number
+ * @param instr - encoded instruction
+ * @param jumped - set to true when the instruction wrote the PC
+ *
+ * @return bool - false if the instruction stalled
+ */
+static bool execute(pio_sim_t *pio, uint sm, uint16_t instr, bool *jumped) {
+    pio_sim_sm_t *s = &pio->sm[sm];
+    uint op = instr >> 13;
+    uint arg1 = (instr >> 5) & 0x7;
+    uint arg2 = instr & 0x1f;
+    uint32_t pinctrl = s->pinctrl;
+
+    switch (op) {
+        case INSTR_JMP: {
+            bool cond;
+            switch (arg1) {
+                case 0: cond = true; break;
+                case 1: cond = s->x == 0; break;
+                case 2: cond = s->x != 0; s->x--; break;
+                case 3: cond = s->y == 0; break;
+                case 4: cond = s->y != 0; s->y--; break;
+                case 5: cond = s->x != s->y; break;
+                case 6: cond = (read_gpios(pio) >> field(s->execctrl, PIO_SM0_EXECCTRL_JMP_PIN_LSB, 5)) & 1; break;
+                default: cond = s->osr_count < pull_threshold(s); break;
+            }
+            if (cond) {
+                s->pc = arg2;
+                *jumped = true;
+            }
+            return true;
+        }
+
+        case INSTR_WAIT: {
+            bool polarity = (instr >> 7) & 1;
+            uint source = (instr >> 5) & 0x3;
+            bool level;
+
+            if (source == 0) {
+                level = (read_gpios(pio) >> arg2) & 1;
+            } else if (source == 1) {
+                uint in_base = field(pinctrl, PIO_SM0_PINCTRL_IN_BASE_LSB, 5);
+                level = (read_gpios(pio) >> ((in_base + arg2) & 31)) & 1;
+            } else {
+                uint index = irq_index(sm, arg2);
+                level = (pio->irq >> index) & 1;
+                // waiting for an IRQ flag to be set also clears it
+                if (level && polarity) pio->irq &= ~(1u << index);
+            }
+            return level == polarity;
+        }
+
+        case INSTR_IN: {
+            uint count = arg2 ? arg2 : 32;
+            bool autopush = field(s->shiftctrl, PIO_SM0_SHIFTCTRL_AUTOPUSH_LSB, 1);
+            uint32_t data;
+
+            // an IN that would autopush into a full RX FIFO stalls
+            if (autopush && s->isr_count >= push_threshold(s) && s->rx_level >= rx_depth(s)) {
+                return false;
+            }
+            if (autopush && s->isr_count >= push_threshold(s)) {
+                rx_push(s, s->isr);
+                s->isr = 0;
+                s->isr_count = 0;
+            }
+
+            switch (arg1) {
+                case 0: data = rotr(read_gpios(pio), field(pinctrl, PIO_SM0_PINCTRL_IN_BASE_LSB, 5)); break;
+                case 1: data = s->x; break;
+                case 2: data = s->y; break;
+                case 6: data = s->isr; break;
+                case 7: data = s->osr; break;
+                default: data = 0; break;
+            }
+            isr_shift(s, count, data);
+
+            // push straight away if the FIFO has room, otherwise on the next IN
+            if (autopush && s->isr_count >= push_threshold(s) && rx_push(s, s->isr)) {
+                s->isr = 0;
+                s->isr_count = 0;
+            }
+            return true;
+        }
+
+        case INSTR_OUT: {
+            uint count = arg2 ? arg2 : 32;
+            uint32_t data;
+
+            // autopull: refill an empty OSR first, stall if there is nothing to refill with
+            if (field(s->shiftctrl, PIO_SM0_SHIFTCTRL_AUTOPULL_LSB, 1) && s->osr_count >= pull_threshold(s)) {
+                if (s->tx_level == 0) return false;
+                tx_pop(s, &s->osr);
+                s->osr_count = 0;
+            }
+
+            data = osr_shift(s, count);
+            switch (arg1) {
+                case 0:
+                    write_pins(pio, false, field(pinctrl, PIO_SM0_PINCTRL_OUT_BASE_LSB, 5),
+                               field(pinctrl, PIO_SM0_PINCTRL_OUT_COUNT_LSB, 6), data);
+                    break;
+                case 1: s->x = data; break;
+                case 2: s->y = data; break;
+                case 4:
+                    write_pins(pio, true, field(pinctrl, PIO_SM0_PINCTRL_OUT_BASE_LSB, 5),
+                               field(pinctrl, PIO_SM0_PINCTRL_OUT_COUNT_LSB, 6), data);
+                    break;
+                case 5: s->pc = data & 31; *jumped = true; break;
+                case 6: s->isr = data; s->isr_count = count; break;
+                case 7: s->exec_instr = data; s->exec_pending = true; break;
+                default: break;
+            }
+            return true;
+        }
+
+        case INSTR_PUSH_PULL: {
+            bool pull = (instr >> 7) & 1;
+            bool if_flag = (instr >> 6) & 1;
+            bool block = (instr >> 5) & 1;
+
+            if (pull) {
+                bool autopull = field(s->shiftctrl, PIO_SM0_SHIFTCTRL_AUTOPULL_LSB, 1);
+                bool empty = s->osr_count >= pull_threshold(s);
+
+                // PULL IFEMPTY, or any PULL with autopull on, leaves a non-empty OSR alone
+                if ((if_flag || autopull) && !empty) return true;
+
+                if (s->tx_level == 0) {
+                    if (block) return false;
+                    // non-blocking PULL on an empty FIFO is MOV OSR, X
+                    s->osr = s->x;
+                } else {
+                    tx_pop(s, &s->osr);
+                }
+                s->osr_count = 0;
+            } else {
+                if (if_flag && s->isr_count < push_threshold(s)) return true;
+                if (s->rx_level >= rx_depth(s) && block) return false;
+                // non-blocking PUSH on a full FIFO drops the data
+                rx_push(s, s->isr);
+                s->isr = 0;
+                s->isr_count = 0;
+            }
+            return true;
+        }
+
+        case INSTR_MOV: {
+            uint op2 = (instr >> 3) & 0x3;
+            uint32_t data;
+
+            switch (instr & 0x7) {
+                case 0: data = rotr(read_gpios(pio), field(pinctrl, PIO_SM0_PINCTRL_IN_BASE_LSB, 5)); break;
+                case 1: data = s->x; break;
+                case 2: data = s->y; break;
+                case 5: {
+                    uint n = field(s->execctrl, PIO_SM0_EXECCTRL_STATUS_N_LSB, 4);
+                    bool rx = field(s->execctrl, PIO_SM0_EXECCTRL_STATUS_SEL_LSB, 1);
+                    data = (rx ? s->rx_level : s->tx_level) < n ? ~0u : 0;
+                    break;
+                }
+                case 6: data = s->isr; break;
+                case 7: data = s->osr; break;
+                default: data = 0; break;
+            }
+
+            if (op2 == 1) data = ~data;
+            else if (op2 == 2) data = bitrev(data);
+
+            switch (arg1) {
+                case 0:
+                    write_pins(pio, false, field(pinctrl, PIO_SM0_PINCTRL_OUT_BASE_LSB, 5),
+                               field(pinctrl, PIO_SM0_PINCTRL_OUT_COUNT_LSB, 6), data);
+                    break;
+                case 1: s->x = data; break;
+                case 2: s->y = data; break;
+                case 4: s->exec_instr = data; s->exec_pending = true; break;
+                case 5: s->pc = data & 31; *jumped = true; break;
+                case 6: s->isr = data; s->isr_count = 0; break;
+                case 7: s->osr = data; s->osr_count = 0; break;
+                default: break;
+            }
+            return true;
+        }
+
+        case INSTR_IRQ: {
+            bool clear = (instr >> 6) & 1;
+            bool wait = (instr >> 5) & 1;
+            uint32_t bit = 1u << irq_index(sm, arg2);
+
+            if (clear) {
+                pio->irq &= ~bit;
+                return true;
+            }
+            if (!s->irq_waiting) {
+                pio->irq |= bit;
+                if (!wait) return true;
+                s->irq_waiting = true;
+            }
+            // IRQ WAIT holds until someone clears the flag again
+            if (pio->irq & bit) return false;
+            s->irq_waiting = false;
+            return true;
+        }
+
+        default: {
+            switch (arg1) {
+                case 0:
+                    write_pins(pio, false, field(pinctrl, PIO_SM0_PINCTRL_SET_BASE_LSB, 5),
+                               field(pinctrl, PIO_SM0_PINCTRL_SET_COUNT_LSB, 3), arg2);
+                    break;
+                case 1: s->x = arg2; break;
+                case 2: s->y = arg2; break;
+                case 4:
+                    write_pins(pio, true, field(pinctrl, PIO_SM0_PINCTRL_SET_BASE_LSB, 5),
+                               field(pinctrl, PIO_SM0_PINCTRL_SET_COUNT_LSB, 3), arg2);
+                    break;
+                default: break;
+            }
+            return true;
+        }
+    }
+}
+
+/**
+ * Clock one state machine by one of its own cycles
+ *
+ * @param pio - the simulated PIO block
+ * @param sm - state machine number
+ *
+ * @return void
+ */
+static void sm_step(pio_sim_t *pio, uint sm) {
+    pio_sim_sm_t *s = &pio->sm[sm];
+    s->cycles++;
+
+    // delay cycles run after the instruction has completed
+    if (s->delay) {
+        s->delay--;
+        return;
+    }
+
+    bool from_exec = s->exec_pending;
+    uint16_t instr = from_exec ? s->exec_instr : pio->instr_mem[s->pc];
+    s->exec_pending = false;
+
+    // split the delay/side-set field
+    uint sideset_count = field(s->pinctrl, PIO_SM0_PINCTRL_SIDESET_COUNT_LSB, 3);
+    bool sideset_opt = field(s->execctrl, PIO_SM0_EXECCTRL_SIDE_EN_LSB, 1);
+    uint ds = (instr >> 8) & 0x1f;
+    uint delay = ds & ((1u << (5 - sideset_count)) - 1);
+    uint sideset_bits = sideset_count - (sideset_opt ? 1 : 0);
+    uint32_t sideset = ds >> (5 - sideset_count);
+    bool sideset_en = sideset_count > 0 && (!sideset_opt || (sideset >> sideset_bits) & 1);
+
+    bool first_issue = !s->stalled;
+    bool jumped = false;
+    bool done = execute(pio, sm, instr, &jumped);
+
+    // side-set is asserted once, on the first cycle of the instruction,
+    // and wins over an OUT/SET/MOV to the same pins
+    if (sideset_en && first_issue) {
+        write_pins(pio, field(s->execctrl, PIO_SM0_EXECCTRL_SIDE_PINDIR_LSB, 1),
+                   field(s->pinctrl, PIO_SM0_PINCTRL_SIDESET_BASE_LSB, 5), sideset_bits, sideset);
+    }
+
+    if (!done) {
+        s->stalled = true;
+        s->stall_cycles++;
+        // keep re-executing the same instruction until it completes
+        if (from_exec) {
+            s->exec_pending = true;
+            s->exec_instr = instr;
+        }
+        return;
+    }
+
+    s->stalled = false;
+    s->instructions++;
+
+    // instructions run through OUT/MOV EXEC don't advance the PC
+    if (!jumped && !from_exec) {
+        if (s->pc == field(s->execctrl, PIO_SM0_EXECCTRL_WRAP_TOP_LSB, 5)) {
+            s->pc = field(s->execctrl, PIO_SM0_EXECCTRL_WRAP_BOTTOM_LSB, 5);
+            if (s->wraps == 0) s->first_wrap_cycle = s->cycles;
+            s->last_wrap_cycle = s->cycles;
+            s->wraps++;
+        } else {
+            s->pc = (s->pc + 1) & 31;
+        }
+    }
+
+    // delay is ignored for instructions that were stalled by EXEC
+    if (!s->exec_pending) {
+        s->delay = delay;
+    }
+}
+
+/**
+ * Reset the PIO block: empty instruction memory, all state machines stopped
+ *
+ * @param pio - the simulated PIO block
+ *
+ * @return void
+ */
+void pio_sim_init(pio_sim_t *pio) {
+    memset(pio, 0, sizeof(*pio));
+
+    pio_sm_config c = pio_get_default_sm_config();
+    for (uint sm = 0; sm < PIO_SIM_SM_COUNT; sm++) {
+        pio_sim_sm_init(pio, sm, 0, &c);
+    }
+}
+
+/**
+ * Load a program into the first free space of the instruction memory
+ *
+ * Like pio_add_program(), JMP targets are relocated by the load offset.
+ *
+ * @param pio - the simulated PIO block
+ * @param program - program generated by pioasm
+ *
+ * @return int - offset of the program or -1 if there is no space
+ */
+int pio_sim_add_program(pio_sim_t *pio, const struct pio_program *program) {
+    uint32_t mask = (1u << program->length) - 1;
+    if (program->length >= 32) mask = ~0u;
+
+    for (int offset = 32 - program->length; offset >= 0; offset--) {
+        if (program->origin >= 0 && offset != program->origin) continue;
+        if (pio->used_instr & (mask << offset)) continue;
+
+        for (uint i = 0; i < program->length; i++) {
+            uint16_t instr = program->instructions[i];
+            pio->instr_mem[offset + i] = (instr >> 13) == INSTR_JMP ? instr + offset : instr;
+        }
+        pio->used_instr |= mask << offset;
+        return offset;
+    }
+
+    return -1;
+}
+
+/**
+ * Apply a config and reset a state machine, like pio_sm_init()
+ *
+ * @param pio - the simulated PIO block
+ * @param sm - state machine number
+ * @param initial_pc - address to start at
+ * @param config - state machine config
+ *
+ * @return void
+ */
+void pio_sim_sm_init(pio_sim_t *pio, uint sm, uint initial_pc, const pio_sm_config *config) {
+    pio_sim_sm_t *s = &pio->sm[sm];
+
+    memset(s, 0, sizeof(*s));
+    s->clkdiv = config->clkdiv;
+    s->execctrl = config->execctrl;
+    s->shiftctrl = config->shiftctrl;
+    s->pinctrl = config->pinctrl;
+    s->pc = initial_pc & 31;
+    // the OSR starts empty so the first OUT autopulls
+    s->osr_count = 32;
+    s->next_tick = (pio->cycle << 8) + clkdiv_256(s);
+}
+
+void pio_sim_sm_set_enabled(pio_sim_t *pio, uint sm, bool enabled) {
+    pio_sim_sm_t *s = &pio->sm[sm];
+    if (enabled && !s->enabled) {
+        s->next_tick = (pio->cycle << 8) + clkdiv_256(s);
+    }
+    s->enabled = enabled;
+}
+
+void pio_sim_sm_set_clkdiv_int_frac(pio_sim_t *pio, uint sm, uint16_t div_int, uint8_t div_frac) {
+    pio_sim_sm_t *s = &pio->sm[sm];
+    s->clkdiv = ((uint32_t) div_int << PIO_SM0_CLKDIV_INT_LSB) | ((uint32_t) div_frac << PIO_SM0_CLKDIV_FRAC_LSB);
+    s->next_tick = (pio->cycle << 8) + clkdiv_256(s);
+}
+
+void pio_sim_set_pin_callback(pio_sim_t *pio, pio_sim_pin_callback_t callback, void *user) {
+    pio->pin_callback = callback;
+    pio->pin_user = user;
+}
+
+void pio_sim_set_dreq_callback(pio_sim_t *pio, pio_sim_dreq_callback_t callback, void *user) {
+    pio->dreq_callback = callback;
+    pio->dreq_user = user;
+}
+
+/**
+ * Write a word to the TX FIFO, like pio_sm_put()
+ *
+ * @param pio - the simulated PIO block
+ * @param sm - state machine number
+ * @param data - data word
+ *
+ * @return bool - false if the FIFO was full and the word was dropped
+ */
+bool pio_sim_sm_put(pio_sim_t *pio, uint sm, uint32_t data) {
+    pio_sim_sm_t *s = &pio->sm[sm];
+    if (s->tx_level >= tx_depth(s)) return false;
+    s->tx_fifo[(s->tx_head + s->tx_level) % (2 * PIO_SIM_FIFO_DEPTH)] = data;
+    s->tx_level++;
+    return true;
+}
+
+/**
+ * Drop everything in both FIFOs, like pio_sm_clear_fifos()
+ *
+ * @param pio - the simulated PIO block
+ * @param sm - state machine number
+ *
+ * @return void
+ */
+void pio_sim_sm_clear_fifos(pio_sim_t *pio, uint sm) {
+    pio->sm[sm].tx_level = 0;
+    pio->sm[sm].rx_level = 0;
+}
+
+/**
+ * Read a word from the RX FIFO, like pio_sm_get()
+ *
+ * @param pio - the simulated PIO block
+ * @param sm - state machine number
+ * @param data - receives the data word
+ *
+ * @return bool - false if the FIFO was empty
+ */
+bool pio_sim_sm_get(pio_sim_t *pio, uint sm, uint32_t *data) {
+    pio_sim_sm_t *s = &pio->sm[sm];
+    if (s->rx_level == 0) return false;
+    *data = s->rx_fifo[s->rx_head];
+    s->rx_head = (s->rx_head + 1) % (2 * PIO_SIM_FIFO_DEPTH);
+    s->rx_level--;
+    return true;
+}
+
+uint pio_sim_sm_tx_level(const pio_sim_t *pio, uint sm) {
+    return pio->sm[sm].tx_level;
+}
+
+uint pio_sim_sm_rx_level(const pio_sim_t *pio, uint sm) {
+    return pio->sm[sm].rx_level;
+}
+
+bool pio_sim_sm_tx_full(const pio_sim_t *pio, uint sm) {
+    return pio->sm[sm].tx_level >= tx_depth(&pio->sm[sm]);
+}
+
+/**
+ * Force an instruction into a state machine, like pio_sm_exec()
+ *
+ * @param pio - the simulated PIO block
+ * @param sm - state machine number
+ * @param instr - encoded instruction
+ *
+ * @return void
+ */
+void pio_sim_sm_exec(pio_sim_t *pio, uint sm, uint16_t instr) {
+    pio->sm[sm].exec_instr = instr;
+    pio->sm[sm].exec_pending = true;
+}
+
+/**
+ * Get the next system cycle any enabled state machine is clocked
+ *
+ * @param pio - the simulated PIO block
+ *
+ * @return uint64_t - UINT64_MAX if no state machine is enabled
+ */
+uint64_t pio_sim_next_tick(const pio_sim_t *pio) {
+    uint64_t next = UINT64_MAX;
+    for (uint sm = 0; sm < PIO_SIM_SM_COUNT; sm++) {
+        if (pio->sm[sm].enabled && (pio->sm[sm].next_tick >> 8) < next) {
+            next = pio->sm[sm].next_tick >> 8;
+        }
+    }
+    return next;
+}
+
+/**
+ * Iterations of a counted loop that can be skipped in one go
+ *
+ * A state machine on "jmp x--, self" or "jmp y--, self" without
+ * delay or side-set does nothing but count its register down, so
+ * all passes that jump back again only cost time. The pass that
+ * falls through still runs normally.
+ *
+ * @param pio - the simulated PIO block
+ * @param s - state machine, about to execute its next instruction
+ *
+ * @return uint32_t - passes that jump back, 0 if it isn't such a loop
+ */
+static uint32_t loop_passes(const pio_sim_t *pio, const pio_sim_sm_t *s) {
+    if (s->delay || s->stalled || s->exec_pending) return 0;
+
+    uint16_t instr = pio->instr_mem[s->pc];
+    uint cond = (instr >> 5) & 0x7;
+    if ((instr >> 13) != INSTR_JMP || (instr & 0x1f) != s->pc || (cond != 2 && cond != 4)) return 0;
+    // delay and side-set share the field, a loop with either isn't plain counting
+    if ((instr >> 8) & 0x1f) return 0;
+
+    return cond == 2 ? s->x : s->y;
+}
+
+/**
+ * Run the PIO block up to (and including) the given system cycle
+ *
+ * Rather than stepping every system cycle, jump straight to the
+ * next cycle a state machine is clocked on. State machines that
+ * tick on the same cycle run in order, so SM3 wins pin conflicts
+ * like on the hardware. A state machine counting down in a loop
+ * on one jmp skips all of its passes up to the given cycle at once,
+ * nothing outside the state machine can tell the difference.
+ *
+ * @param pio - the simulated PIO block
+ * @param cycle - system cycle to run to
+ *
+ * @return void
+ */
+void pio_sim_run_until(pio_sim_t *pio, uint64_t cycle) {
+    while (true) {
+        uint64_t next = pio_sim_next_tick(pio);
+        if (next > cycle) break;
+
+        pio->cycle = next;
+        for (uint sm = 0; sm < PIO_SIM_SM_COUNT; sm++) {
+            pio_sim_sm_t *s = &pio->sm[sm];
+            if (!s->enabled || (s->next_tick >> 8) != next) continue;
+
+            // give the DMA (or whoever feeds us) a chance to top up the FIFO
+            uint tx_level = s->tx_level;
+            if (pio->dreq_callback && s->tx_level < tx_depth(s)) {
+                pio->dreq_callback(pio, sm, pio->dreq_user);
+            }
+
+            sm_step(pio, sm);
+            s->next_tick += clkdiv_256(s);
+
+            // fast-forward a counted loop, unless the FIFO is still being fed
+            uint32_t passes = s->tx_level == tx_level ? loop_passes(pio, s) : 0;
+            uint64_t limit = cycle < (UINT64_MAX >> 9) ? (cycle + 1) << 8 : UINT64_MAX;
+            if (passes && s->next_tick < limit) {
+                uint64_t fit = (limit - s->next_tick + clkdiv_256(s) - 1) / clkdiv_256(s);
+                if (passes > fit) passes = fit;
+
+                if ((pio->instr_mem[s->pc] >> 5 & 0x7) == 2) {
+                    s->x -= passes;
+                } else {
+                    s->y -= passes;
+                }
+                s->next_tick += passes * clkdiv_256(s);
+                s->cycles += passes;
+                s->instructions += passes;
+            }
+        }
+    }
+
+    pio->cycle = cycle;
+}
+
+void pio_sim_run(pio_sim_t *pio, uint64_t cycles) {
+    pio_sim_run_until(pio, pio->cycle + cycles);
+}
@@ -0,0 +1,126 @@
+/**
+ * @brief Cycle-accurate model of one RP2040 PIO block
+ *
+ * Models the 32 word instruction memory, the 4 state machines with
+ * their clock dividers, TX/RX FIFOs (including joins), autopull and
+ * autopush, side-set, wrap, IRQ flags and the 32 GPIO outputs.
+ *
+ * Time is counted in system clock cycles. Each state machine only
+ * executes on the system cycles its clock divider lets through, so
+ * a divider of 62500 costs the simulator 1 step per 62500 cycles.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hardware/pio.h"
+
+#define PIO_SIM_SM_COUNT 4
+#define PIO_SIM_INSTR_COUNT 32
+#define PIO_SIM_FIFO_DEPTH 4
+
+typedef struct pio_sim pio_sim_t;
+
+/**
+ * Called whenever a state machine changes the level of a pin
+ *
+ * @param pio - the simulated PIO block
+ * @param cycle - system cycle of the change
+ * @param pins - new pin levels (1 bit per GPIO)
+ * @param changed - mask of the pins that changed
+ * @param user - user pointer given to pio_sim_set_pin_callback()
+ */
+typedef void (*pio_sim_pin_callback_t)(pio_sim_t *pio, uint64_t cycle, uint32_t pins, uint32_t changed, void *user);
+
+/**
+ * Called when a state machine wants data in its TX FIFO (DREQ)
+ *
+ * @param pio - the simulated PIO block
+ * @param sm - state machine number
+ * @param user - user pointer given to pio_sim_set_dreq_callback()
+ */
+typedef void (*pio_sim_dreq_callback_t)(pio_sim_t *pio, uint sm, void *user);
+
+typedef struct {
+    bool enabled;
+
+    // configuration registers, same encoding as SMx_CLKDIV etc.
+    uint32_t clkdiv;
+    uint32_t execctrl;
+    uint32_t shiftctrl;
+    uint32_t pinctrl;
+
+    // execution state
+    uint8_t pc;
+    uint32_t x;
+    uint32_t y;
+    uint32_t isr;
+    uint32_t osr;
+    uint8_t isr_count;
+    uint8_t osr_count;
+    uint32_t delay;
+    bool stalled;
+    bool irq_waiting;
+    bool exec_pending;
+    uint16_t exec_instr;
+
+    // FIFOs (8 entries deep when joined)
+    uint32_t tx_fifo[2 * PIO_SIM_FIFO_DEPTH];
+    uint8_t tx_head;
+    uint8_t tx_level;
+    uint32_t rx_fifo[2 * PIO_SIM_FIFO_DEPTH];
+    uint8_t rx_head;
+    uint8_t rx_level;
+
+    // next system cycle this state machine is clocked, in 1/256 cycles
+    uint64_t next_tick;
+
+    // statistics
+    uint64_t cycles;
+    uint64_t stall_cycles;
+    uint64_t instructions;
+    uint64_t wraps;
+    uint64_t first_wrap_cycle;
+    uint64_t last_wrap_cycle;
+} pio_sim_sm_t;
+
+struct pio_sim {
+    uint16_t instr_mem[PIO_SIM_INSTR_COUNT];
+    uint32_t used_instr;
+    pio_sim_sm_t sm[PIO_SIM_SM_COUNT];
+
+    // pin levels driven by the state machines and their directions
+    uint32_t pins;
+    uint32_t pindirs;
+    // levels of pins driven from outside (inputs)
+    uint32_t gpio_in;
+    uint8_t irq;
+
+    uint64_t cycle;
+
+    pio_sim_pin_callback_t pin_callback;
+    void *pin_user;
+    pio_sim_dreq_callback_t dreq_callback;
+    void *dreq_user;
+};
+
+void pio_sim_init(pio_sim_t *pio);
+int pio_sim_add_program(pio_sim_t *pio, const struct pio_program *program);
+void pio_sim_sm_init(pio_sim_t *pio, uint sm, uint initial_pc, const pio_sm_config *config);
+void pio_sim_sm_set_enabled(pio_sim_t *pio, uint sm, bool enabled);
+void pio_sim_sm_set_clkdiv_int_frac(pio_sim_t *pio, uint sm, uint16_t div_int, uint8_t div_frac);
+void pio_sim_set_pin_callback(pio_sim_t *pio, pio_sim_pin_callback_t callback, void *user);
+void pio_sim_set_dreq_callback(pio_sim_t *pio, pio_sim_dreq_callback_t callback, void *user);
+
+bool pio_sim_sm_put(pio_sim_t *pio, uint sm, uint32_t data);
+bool pio_sim_sm_get(pio_sim_t *pio, uint sm, uint32_t *data);
+uint pio_sim_sm_tx_level(const pio_sim_t *pio, uint sm);
+uint pio_sim_sm_rx_level(const pio_sim_t *pio, uint sm);
+bool pio_sim_sm_tx_full(const pio_sim_t *pio, uint sm);
+void pio_sim_sm_clear_fifos(pio_sim_t *pio, uint sm);
+void pio_sim_sm_exec(pio_sim_t *pio, uint sm, uint16_t instr);
+
+uint64_t pio_sim_next_tick(const pio_sim_t *pio);
+void pio_sim_run(pio_sim_t *pio, uint64_t cycles);
+void pio_sim_run_until(pio_sim_t *pio, uint64_t cycle);
@@ -0,0 +1,863 @@
+/**
+ * @brief Command line client for picow_proto and picow_udp
+ *
+ * Usage:
+ *
+ *   proto_cli [-d device | -l | -u host[:port] | -U] <command>
+ *
+ *   -d, --device <path>       serial port of the board (default: /dev/ttyACM0)
+ *   -l, --loopback            run a simulated board on a pty instead, same
+ *                             lib/proto code, no hardware needed
+ *   -u, --udp <host[:port]>   board on Wi-Fi (picow_udp), port 5006 by default
+ *   -U, --udp-loopback        run a simulated board behind a UDP socket on
+ *                             127.0.0.1, the same lib/proto server as picow_udp
+ *   -t, --timeout <ms>        response timeout (default: 1000)
+ *
+ * Commands:
+ *
+ *   ping [text]
+ *   led <on|off>
+ *   gpio put <pin> <0|1>
+ *   gpio get <pin>
+ *   pwm <pin> <level 0-65535>
+ *   timer <hz, 0 stops>
+ *   hist [op] [reset]
+ *   uptime
+ *   bootsel
+ *   bench [-n frames] [-c commands per frame] [-m]
+ *   selftest
+ *
+ * bench is the load generator: frames of LED commands (-m mixes in PWM
+ * and ping) back to back, it reports the command rate and the frame
+ * round-trip time (min, p50, p99, p99.9, max). Over UDP it also splits
+ * off the time on the board from the ack timestamps and prints the
+ * board's service time histogram of each command it sent.
+ * hist prints those histograms (every op with samples if none is
+ * given), reset empties them after reading. selftest checks COBS, the
+ * CRC, corrupt frame rejection, lib/hist and the datagram server
+ * without opening a device.
+ */
+
+// posix_openpt() and friends
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "hist.h"
+#include "proto.h"
+#include "proto_client.h"
+#include "proto_server.h"
+
+// bench -m sets a PWM level on this pin
+#define BENCH_PWM_PIN 16
+
+static int timeout_ms = 1000;
+
+static const char *op_names[PROTO_OP_COUNT] = {
+    [PROTO_OP_PING] = "ping",
+    [PROTO_OP_LED] = "led",
+    [PROTO_OP_GPIO_PUT] = "gpio_put",
+    [PROTO_OP_GPIO_GET] = "gpio_get",
+    [PROTO_OP_UPTIME] = "uptime",
+    [PROTO_OP_BOOTSEL] = "bootsel",
+    [PROTO_OP_PWM] = "pwm",
+    [PROTO_OP_TIMER] = "timer",
+    [PROTO_OP_HIST] = "hist",
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Simulated board for --loopback: same handler shape as picow_proto
+ */
+static uint8_t sim_gpio[32];
+static uint16_t sim_pwm[32];
+static uint32_t sim_timer_hz;
+static uint8_t sim_led;
+
+static uint8_t sim_ping(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    if (len > *reply_len) return PROTO_STATUS_NO_SPACE;
+    memcpy(reply, data, len);
+    *reply_len = len;
+    return PROTO_STATUS_OK;
+}
+
+static uint8_t sim_led_op(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    *reply_len = 0;
+    if (len != 1) return PROTO_STATUS_BAD_LENGTH;
+    sim_led = data[0] ? 1 : 0;
+    return PROTO_STATUS_OK;
+}
+
+static uint8_t sim_gpio_put(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    *reply_len = 0;
+    if (len != 2) return PROTO_STATUS_BAD_LENGTH;
+    if (data[0] > 22) return PROTO_STATUS_BAD_ARGUMENT;
+    sim_gpio[data[0]] = data[1] ? 1 : 0;
+    return PROTO_STATUS_OK;
+}
+
+static uint8_t sim_gpio_get(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    if (len != 1) return PROTO_STATUS_BAD_LENGTH;
+    if (data[0] > 22) return PROTO_STATUS_BAD_ARGUMENT;
+    reply[0] = sim_gpio[data[0]];
+    *reply_len = 1;
+    return PROTO_STATUS_OK;
+}
+
+static uint8_t sim_uptime(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t now = (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+    for (int i = 0; i < 8; i++) reply[i] = now >> (8 * i);
+    *reply_len = 8;
+    return PROTO_STATUS_OK;
+}
+
+static uint8_t sim_bootsel(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    *reply_len = 0;
+    return PROTO_STATUS_OK;
+}
+
+static uint8_t sim_pwm_op(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    *reply_len = 0;
+    if (len != 3) return PROTO_STATUS_BAD_LENGTH;
+    if (data[0] > 22) return PROTO_STATUS_BAD_ARGUMENT;
+    sim_pwm[data[0]] = data[1] | (data[2] << 8);
+    return PROTO_STATUS_OK;
+}
+
+static uint8_t sim_timer(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    *reply_len = 0;
+    if (len != 4) return PROTO_STATUS_BAD_LENGTH;
+    uint32_t hz = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t) data[3] << 24);
+    if (hz > 10000) return PROTO_STATUS_BAD_ARGUMENT;
+    sim_timer_hz = hz;
+    return PROTO_STATUS_OK;
+}
+
+static const proto_handler_t sim_handlers[PROTO_OP_COUNT] = {
+    [PROTO_OP_PING] = sim_ping,
+    [PROTO_OP_LED] = sim_led_op,
+    [PROTO_OP_GPIO_PUT] = sim_gpio_put,
+    [PROTO_OP_GPIO_GET] = sim_gpio_get,
+    [PROTO_OP_UPTIME] = sim_uptime,
+    [PROTO_OP_BOOTSEL] = sim_bootsel,
+    [PROTO_OP_PWM] = sim_pwm_op,
+    [PROTO_OP_TIMER] = sim_timer,
+    // only answers behind proto_server, i.e. -U
+    [PROTO_OP_HIST] = proto_server_hist_op,
+};
+
+/**
+ * The board's main loop from picow_proto, on the pty slave
+ *
+ * @return void *
+ */
+static void *sim_board(void *arg) {
+    int fd = *(int *) arg;
+    static proto_rx_t rx;
+    static uint8_t frame[PROTO_ENCODED_MAX];
+    static uint8_t response[PROTO_ENCODED_MAX];
+    uint8_t buf[512];
+
+    proto_rx_init(&rx);
+
+    while (true) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+
+        for (ssize_t i = 0; i < n; i++) {
+            size_t len = proto_rx_feed(&rx, buf[i], frame);
+            if (!len) continue;
+
+            size_t out = proto_handle(sim_handlers, PROTO_OP_COUNT, frame, len, response, NULL);
+            if (out && write(fd, response, out) != (ssize_t) out) return NULL;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Open a pty pair and run the simulated board on the slave side
+ *
+ * @return int - master fd, -1 on error
+ */
+static int open_loopback(void) {
+    static int slave;
+    static pthread_t thread;
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) return -1;
+
+    slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    if (slave < 0) return -1;
+
+    // both ends raw, the pty must not touch the binary frames
+    proto_serial_raw(master);
+    proto_serial_raw(slave);
+
+    // blocking reads on the board side
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    tio.c_cc[VMIN] = 1;
+    tcsetattr(slave, TCSANOW, &tio);
+
+    if (pthread_create(&thread, NULL, sim_board, &slave)) return -1;
+    pthread_detach(thread);
+
+    return master;
+}
+
+/**
+ * Simulated board for --udp-loopback: the lib/proto server of
+ * picow_udp on a Linux socket, ticks are nanoseconds
+ */
+static proto_server_t sim_server;
+
+static uint32_t sim_ticks(void) {
+    return now_ns();
+}
+
+static uint32_t sim_now_us(void) {
+    return now_ns() / 1000;
+}
+
+/**
+ * The receive callback of proto_udp.c, on a UDP socket
+ *
+ * @return void *
+ */
+static void *sim_udp_board(void *arg) {
+    int fd = *(int *) arg;
+    static uint8_t request[PROTO_SERVER_DATAGRAM_MAX];
+    static uint8_t response[PROTO_SERVER_DATAGRAM_MAX];
+
+    while (true) {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        ssize_t n = recvfrom(fd, request, sizeof(request), 0, (struct sockaddr *) &from, &from_len);
+        if (n < 0) break;
+
+        uint32_t rx_us = sim_now_us();
+        size_t out = proto_server_handle(&sim_server, request, n, rx_us, response);
+        if (out) sendto(fd, response, out, 0, (struct sockaddr *) &from, from_len);
+    }
+
+    return NULL;
+}
+
+/**
+ * Bind a UDP socket on 127.0.0.1 and run the simulated board on it
+ *
+ * @return int - the port, -1 on error
+ */
+static int open_udp_loopback(void) {
+    static int fd;
+    static pthread_t thread;
+    struct sockaddr_in addr = {0};
+    socklen_t addr_len = sizeof(addr);
+
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) return -1;
+    if (getsockname(fd, (struct sockaddr *) &addr, &addr_len) < 0) return -1;
+
+    proto_clock_t clock = {
+        .ticks = sim_ticks,
+        .tick_mask = 0xffffffff,
+        .tick_hz = 1000000000,
+        .now_us = sim_now_us,
+    };
+    proto_server_init(&sim_server, sim_handlers, PROTO_OP_COUNT, &clock);
+
+    if (pthread_create(&thread, NULL, sim_udp_board, &fd)) return -1;
+    pthread_detach(thread);
+
+    return ntohs(addr.sin_port);
+}
+
+static const char *status_name(uint8_t status) {
+    switch (status) {
+        case PROTO_STATUS_OK: return "ok";
+        case PROTO_STATUS_UNKNOWN_OP: return "unknown op";
+        case PROTO_STATUS_BAD_LENGTH: return "bad length";
+        case PROTO_STATUS_BAD_ARGUMENT: return "bad argument";
+        case PROTO_STATUS_NO_SPACE: return "no space";
+        default: return "?";
+    }
+}
+
+/**
+ * Send one command and print its status
+ *
+ * @param client
+ * @param op - PROTO_OP_*
+ * @param data - command data
+ * @param len - data length
+ * @param item - receives the response item
+ *
+ * @return bool - true if the board answered with PROTO_STATUS_OK
+ */
+static bool command(proto_client_t *client, uint8_t op, const void *data, uint8_t len, proto_item_t *item) {
+    proto_frame_t request;
+    proto_reader_t response;
+
+    proto_client_begin(client, &request);
+    proto_frame_add(&request, op, data, len);
+
+    if (!proto_client_transact(client, &request, &response, timeout_ms)) {
+        fprintf(stderr, "no response\n");
+        return false;
+    }
+    if (!proto_reader_next(&response, item) || item->len < 1) {
+        fprintf(stderr, "empty response\n");
+        return false;
+    }
+    if (item->data[0] != PROTO_STATUS_OK) {
+        fprintf(stderr, "error: %s\n", status_name(item->data[0]));
+        return false;
+    }
+
+    return true;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Get a service time histogram from the board
+ *
+ * @param client
+ * @param op - PROTO_OP_*
+ * @param reset - empty it after reading
+ * @param hist - receives the histogram
+ * @param tick_hz - receives the tick rate of its values
+ *
+ * @return bool - false if the board didn't answer or has none
+ */
+static bool get_hist(proto_client_t *client, uint8_t op, bool reset, hist_t *hist, uint32_t *tick_hz) {
+    proto_item_t item;
+    uint8_t data[2] = {op, reset};
+
+    if (!command(client, PROTO_OP_HIST, data, 2, &item) || item.len < 1 + 4) return false;
+
+    const uint8_t *reply = item.data + 1;
+    *tick_hz = reply[0] | (reply[1] << 8) | (reply[2] << 16) | ((uint32_t) reply[3] << 24);
+    return *tick_hz && hist_decode(hist, reply + 4, item.len - 1 - 4);
+}
+
+/**
+ * One line per op: samples and percentiles in us
+ *
+ * @return void
+ */
+static void print_hist(uint8_t op, const hist_t *hist, uint32_t tick_hz) {
+    double us = 1e6 / tick_hz;
+    uint64_t bucketed = 0;
+
+    for (uint32_t i = 0; i < HIST_BUCKETS; i++) {
+        bucketed += hist->buckets[i];
+    }
+
+    printf("%-10s %8u  min %8.2f  p50 %8.2f  p99 %8.2f  p99.9 %8.2f  max %8.2f  mean %8.2f us%s\n",
+           op_names[op] ? op_names[op] : "?", hist->count, hist->min * us, hist_percentile(hist, 500) * us,
+           hist_percentile(hist, 990) * us, hist_percentile(hist, 999) * us, hist->max * us,
+           hist->count ? (double) hist->sum / hist->count * us : 0, bucketed < hist->count ? " (truncated)" : "");
+}
+
+/**
+ * The percentile of sorted samples
+ *
+ * @return uint64_t
+ */
+static uint64_t percentile(const uint64_t *sorted, long count, uint32_t permille) {
+    long rank = (count * permille + 999) / 1000;
+    return sorted[rank ? rank - 1 : 0];
+}
+
+/**
+ * Frames of LED toggles (and with -m PWM levels and pings) back to
+ * back, rate and round-trip time
+ *
+ * @return int - exit code
+ */
+static int bench(proto_client_t *client, int argc, char **argv) {
+    static const uint8_t mixed_ops[] = {PROTO_OP_LED, PROTO_OP_PWM, PROTO_OP_PING};
+    long frames = 1000;
+    int batch = 32;
+    bool mixed = false;
+    int opt;
+
+    optind = 1;
+    while ((opt = getopt(argc, argv, "n:c:m")) != -1) {
+        switch (opt) {
+            case 'n': frames = strtol(optarg, NULL, 0); break;
+            case 'c': batch = strtol(optarg, NULL, 0); break;
+            case 'm': mixed = true; break;
+            default: return 1;
+        }
+    }
+    // LED and PWM replies are 3 bytes, a ping of 4 bytes comes back as 7
+    int batch_max = (PROTO_FRAME_MAX - PROTO_HEADER_SIZE - PROTO_CRC_SIZE) / (mixed ? 7 : 3);
+    if (batch < 1 || batch > batch_max || frames < 1) {
+        fprintf(stderr, "bench: -c must be 1-%d, -n at least 1\n", batch_max);
+        return 1;
+    }
+
+    // service times of this run only
+    if (client->udp) {
+        hist_t hist;
+        uint32_t tick_hz;
+        for (uint32_t i = 0; i < (mixed ? sizeof(mixed_ops) : 1); i++) {
+            get_hist(client, mixed_ops[i], true, &hist, &tick_hz);
+        }
+    }
+
+    uint64_t *rtt = calloc(frames, sizeof(uint64_t));
+    uint64_t *board = calloc(frames, sizeof(uint64_t));
+    long failed = 0;
+    uint64_t start = now_ns();
+
+    for (long i = 0; i < frames; i++) {
+        proto_frame_t request;
+        proto_reader_t response;
+        proto_item_t item;
+
+        proto_client_begin(client, &request);
+        for (int j = 0; j < batch; j++) {
+            uint8_t op = mixed ? mixed_ops[j % sizeof(mixed_ops)] : PROTO_OP_LED;
+            uint8_t on = (i + j) & 1;
+            uint8_t pwm[3] = {BENCH_PWM_PIN, i, j};
+
+            if (op == PROTO_OP_LED) {
+                proto_frame_add(&request, op, &on, 1);
+            } else if (op == PROTO_OP_PWM) {
+                proto_frame_add(&request, op, pwm, 3);
+            } else {
+                proto_frame_add(&request, op, "ping", 4);
+            }
+        }
+
+        uint64_t sent = now_ns();
+        bool ok = proto_client_transact(client, &request, &response, timeout_ms);
+        rtt[i] = now_ns() - sent;
+        board[i] = ok && client->udp ? (uint64_t) (client->tx_us - client->rx_us) * 1000 : 0;
+
+        // every command must come back ok
+        int count = 0;
+        while (ok && proto_reader_next(&response, &item)) {
+            uint8_t op = mixed ? mixed_ops[count % sizeof(mixed_ops)] : PROTO_OP_LED;
+            ok = item.op == op && item.len >= 1 && item.data[0] == PROTO_STATUS_OK;
+            count++;
+        }
+        if (!ok || count != batch) failed++;
+    }
+
+    double elapsed = (now_ns() - start) / 1e9;
+    qsort(rtt, frames, sizeof(uint64_t), compare_u64);
+    qsort(board, frames, sizeof(uint64_t), compare_u64);
+
+    printf("frames:       %ld x %d commands%s, %ld failed, %u timeouts\n", frames, batch, mixed ? " (mixed)" : "",
+           failed, client->timeouts);
+    printf("throughput:   %.0f commands/s, %.0f frames/s\n", frames * batch / elapsed, frames / elapsed);
+    printf("round trip:   min %.1f us, p50 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us\n", rtt[0] / 1e3,
+           percentile(rtt, frames, 500) / 1e3, percentile(rtt, frames, 990) / 1e3, percentile(rtt, frames, 999) / 1e3,
+           rtt[frames - 1] / 1e3);
+
+    if (client->udp) {
+        // the board's clock is in us, so is this
+        printf("on the board: p50 %.0f us, p99 %.0f us (request in to response out)\n",
+               percentile(board, frames, 500) / 1e3, percentile(board, frames, 990) / 1e3);
+        printf("service time per command on the board:\n");
+
+        for (uint32_t i = 0; i < (mixed ? sizeof(mixed_ops) : 1); i++) {
+            hist_t hist;
+            uint32_t tick_hz;
+            if (get_hist(client, mixed_ops[i], false, &hist, &tick_hz)) print_hist(mixed_ops[i], &hist, tick_hz);
+        }
+    }
+
+    free(rtt);
+    free(board);
+    return failed ? 1 : 0;
+}
+
+/**
+ * lib/hist: bucket edges, percentiles against exact ones, the wire format
+ *
+ * @return int - failures
+ */
+static int selftest_hist(void) {
+    int failures = 0;
+
+    // buckets tile uint32_t without gaps, none wider than a quarter of its values
+    for (uint32_t b = 0; b < HIST_BUCKETS; b++) {
+        uint32_t low = hist_bucket_low(b), high = hist_bucket_high(b);
+        bool next = b == HIST_BUCKETS - 1 ? high == UINT32_MAX : high + 1 == hist_bucket_low(b + 1);
+
+        if (hist_bucket(low) != b || hist_bucket(high) != b || !next || (b >= 4 && high - low >= low / 4)) {
+            printf("FAIL hist bucket %u: %u-%u\n", b, low, high);
+            failures++;
+        }
+    }
+
+    // 1..10000: exact percentiles are known, the histogram may only be up to 25% above
+    hist_t hist, decoded;
+    hist_reset(&hist);
+    for (uint32_t v = 10000; v >= 1; v--) hist_add(&hist, v);
+
+    static const uint32_t permilles[] = {1, 500, 900, 990, 999, 1000};
+    for (uint32_t i = 0; i < sizeof(permilles) / sizeof(permilles[0]); i++) {
+        uint32_t exact = permilles[i] * 10;
+        uint32_t got = hist_percentile(&hist, permilles[i]);
+        if (got < exact || got > exact + exact / 4) {
+            printf("FAIL hist p%u: %u, exact %u\n", permilles[i], got, exact);
+            failures++;
+        }
+    }
+    if (hist.min != 1 || hist.max != 10000 || hist.sum != 50005000ull) {
+        printf("FAIL hist min/max/sum\n");
+        failures++;
+    }
+
+    // round trip, then a short buffer keeps only the lowest buckets
+    uint8_t wire[HIST_HEADER_SIZE + HIST_BUCKETS * HIST_PAIR_SIZE];
+    size_t len = hist_encode(&hist, wire, sizeof(wire));
+    if (!hist_decode(&decoded, wire, len) || decoded.count != hist.count || decoded.min != hist.min ||
+        decoded.max != hist.max || decoded.sum != hist.sum || memcmp(decoded.buckets, hist.buckets, sizeof(hist.buckets))) {
+        printf("FAIL hist encode/decode\n");
+        failures++;
+    }
+    len = hist_encode(&hist, wire, HIST_HEADER_SIZE + 3 * HIST_PAIR_SIZE + 2);
+    if (len != HIST_HEADER_SIZE + 3 * HIST_PAIR_SIZE || !hist_decode(&decoded, wire, len) ||
+        decoded.buckets[0] || decoded.buckets[1] != 1 || decoded.buckets[3] != 1 || decoded.buckets[4]) {
+        printf("FAIL hist truncated encode\n");
+        failures++;
+    }
+    if (hist_decode(&decoded, wire, len - 1)) {
+        printf("FAIL hist decode of a cut pair\n");
+        failures++;
+    }
+
+    return failures;
+}
+
+// a clock for the server selftest, every read is 7 ticks on
+static uint32_t fake_tick;
+
+static uint32_t fake_ticks(void) {
+    return fake_tick += 7;
+}
+
+static uint32_t fake_now_us(void) {
+    return 1234;
+}
+
+/**
+ * proto_server: ack timestamps, the response frame, service times,
+ * PROTO_OP_HIST and corrupt requests
+ *
+ * @return int - failures
+ */
+static int selftest_server(void) {
+    static proto_server_t server;
+    static uint8_t out[PROTO_SERVER_DATAGRAM_MAX];
+    proto_clock_t clock = {fake_ticks, 0xffffff, 1000000, fake_now_us};
+    proto_frame_t request;
+    proto_reader_t reader;
+    proto_item_t item;
+    int failures = 0;
+
+    proto_server_init(&server, sim_handlers, PROTO_OP_COUNT, &clock);
+
+    uint8_t on = 1;
+    uint8_t pwm[3] = {BENCH_PWM_PIN, 0x34, 0x12};
+    proto_frame_begin(&request, 9);
+    proto_frame_add(&request, PROTO_OP_LED, &on, 1);
+    proto_frame_add(&request, PROTO_OP_PWM, pwm, 3);
+    proto_frame_add(&request, 0x7f, NULL, 0);
+    size_t len = proto_frame_finish(&request);
+
+    size_t n = proto_server_handle(&server, request.buf, len, 1000, out);
+    bool ok = n > PROTO_SERVER_ACK_SIZE && out[0] == 0xe8 && out[1] == 0x03 && out[4] == 0xd2 && out[5] == 0x04 &&
+              proto_reader_init(&reader, out + PROTO_SERVER_ACK_SIZE, n - PROTO_SERVER_ACK_SIZE) && reader.seq == 9 &&
+              reader.count == 3;
+    ok = ok && proto_reader_next(&reader, &item) && item.op == PROTO_OP_LED && item.data[0] == PROTO_STATUS_OK;
+    ok = ok && proto_reader_next(&reader, &item) && item.op == PROTO_OP_PWM && item.data[0] == PROTO_STATUS_OK;
+    ok = ok && proto_reader_next(&reader, &item) && item.op == 0x7f && item.data[0] == PROTO_STATUS_UNKNOWN_OP;
+    if (!ok || sim_led != 1 || sim_pwm[BENCH_PWM_PIN] != 0x1234) {
+        printf("FAIL server response\n");
+        failures++;
+    }
+
+    // one sample per handler call, 7 ticks each, unknown ops aren't timed
+    if (server.hists[PROTO_OP_LED].count != 1 || server.hists[PROTO_OP_LED].max != 7 ||
+        server.hists[PROTO_OP_PWM].count != 1 || server.requests != 1) {
+        printf("FAIL server service times\n");
+        failures++;
+    }
+
+    // the LED histogram read back and reset
+    uint8_t query[2] = {PROTO_OP_LED, 1};
+    proto_frame_begin(&request, 10);
+    proto_frame_add(&request, PROTO_OP_HIST, query, 2);
+    len = proto_frame_finish(&request);
+    n = proto_server_handle(&server, request.buf, len, 0, out);
+
+    hist_t hist;
+    ok = n && proto_reader_init(&reader, out + PROTO_SERVER_ACK_SIZE, n - PROTO_SERVER_ACK_SIZE) &&
+         proto_reader_next(&reader, &item) && item.data[0] == PROTO_STATUS_OK && item.len > 5 &&
+         item.data[1] == 0x40 && item.data[2] == 0x42 && item.data[3] == 0x0f &&
+         hist_decode(&hist, item.data + 5, item.len - 5) && hist.count == 1 && hist.buckets[hist_bucket(7)] == 1;
+    if (!ok || server.hists[PROTO_OP_LED].count != 0) {
+        printf("FAIL server PROTO_OP_HIST\n");
+        failures++;
+    }
+
+    // a flipped bit or a datagram too long gets no response
+    request.buf[2] ^= 1;
+    if (proto_server_handle(&server, request.buf, len, 0, out) ||
+        proto_server_handle(&server, out, PROTO_FRAME_MAX + 1, 0, out) || server.bad != 2) {
+        printf("FAIL server accepted a bad request\n");
+        failures++;
+    }
+
+    return failures;
+}
+
+/**
+ * COBS round trips around the 254 byte block size, the CRC check
+ * value and rejection of corrupted frames
+ *
+ * @return int - exit code
+ */
+static int selftest(void) {
+    uint8_t in[PROTO_FRAME_MAX], encoded[PROTO_ENCODED_MAX], decoded[PROTO_ENCODED_MAX];
+    int failures = 0;
+    uint32_t seed = 1;
+
+    for (size_t len = 1; len <= PROTO_FRAME_MAX; len++) {
+        for (int pattern = 0; pattern < 3; pattern++) {
+            for (size_t i = 0; i < len; i++) {
+                seed = seed * 1664525u + 1013904223u;
+                // all zeros, no zeros, random
+                in[i] = pattern == 0 ? 0 : pattern == 1 ? 1 + (seed >> 24) % 255 : seed >> 24;
+            }
+            size_t n = proto_cobs_encode(in, len, encoded);
+            bool zero_free = memchr(encoded, 0, n) == NULL;
+            size_t m = proto_cobs_decode(encoded, n, decoded);
+            if (!zero_free || m != len || memcmp(in, decoded, len) || n > PROTO_ENCODED_MAX - 1) {
+                printf("FAIL cobs: length %zu pattern %d\n", len, pattern);
+                failures++;
+            }
+        }
+    }
+
+    // CRC-16/CCITT-FALSE check value
+    if (proto_crc16((const uint8_t *) "123456789", 9) != 0x29b1) {
+        printf("FAIL crc16: 0x%04x, expected 0x29b1\n", proto_crc16((const uint8_t *) "123456789", 9));
+        failures++;
+    }
+
+    // every single bit flip of an encoded frame must be rejected
+    proto_frame_t frame;
+    uint8_t led = 1;
+    proto_frame_begin(&frame, 42);
+    proto_frame_add(&frame, PROTO_OP_LED, &led, 1);
+    proto_frame_add(&frame, PROTO_OP_PING, "abc", 3);
+    size_t n = proto_frame_encode(&frame, encoded);
+
+    for (size_t bit = 0; bit < (n - 1) * 8; bit++) {
+        proto_rx_t rx;
+        proto_reader_t reader;
+        size_t len = 0;
+
+        proto_rx_init(&rx);
+        encoded[bit / 8] ^= 1u << (bit % 8);
+        for (size_t i = 0; i < n; i++) {
+            size_t l = proto_rx_feed(&rx, encoded[i], decoded);
+            if (l) len = l;
+        }
+        if (len && proto_reader_init(&reader, decoded, len)) {
+            printf("FAIL corrupt frame accepted, bit %zu\n", bit);
+            failures++;
+        }
+        encoded[bit / 8] ^= 1u << (bit % 8);
+    }
+
+    failures += selftest_hist();
+    failures += selftest_server();
+
+    printf("selftest: %d failures\n", failures);
+    return failures ? 1 : 0;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [-d device | -l | -u host[:port] | -U] [-t timeout_ms] <ping [text] | led <on|off> |\n"
+                    "       gpio put <pin> <0|1> | gpio get <pin> | pwm <pin> <level> | timer <hz> | hist [op] [reset] |\n"
+                    "       uptime | bootsel | bench [-n frames] [-c commands] [-m] | selftest>\n", argv0);
+}
+
+/**
+ * Look up an op by name or number
+ *
+ * @return int - PROTO_OP_*, -1 if unknown
+ */
+static int op_lookup(const char *name) {
+    for (int op = 0; op < PROTO_OP_COUNT; op++) {
+        if (op_names[op] && strcmp(op_names[op], name) == 0) return op;
+    }
+
+    char *end;
+    long op = strtol(name, &end, 0);
+    return *end || op <= 0 || op >= PROTO_OP_COUNT ? -1 : op;
+}
+
+int main(int argc, char **argv) {
+    static const struct option options[] = {
+        {"device", required_argument, NULL, 'd'},
+        {"loopback", no_argument, NULL, 'l'},
+        {"timeout", required_argument, NULL, 't'},
+        {"udp", required_argument, NULL, 'u'},
+        {"udp-loopback", no_argument, NULL, 'U'},
+        {NULL, 0, NULL, 0},
+    };
+    const char *device = "/dev/ttyACM0";
+    char *udp_host = NULL;
+    bool loopback = false;
+    bool udp_loopback = false;
+    int opt;
+
+    // stop at the command, its options are its own
+    while ((opt = getopt_long(argc, argv, "+d:lt:u:U", options, NULL)) != -1) {
+        switch (opt) {
+            case 'd': device = optarg; break;
+            case 'l': loopback = true; break;
+            case 'u': udp_host = optarg; break;
+            case 'U': udp_loopback = true; break;
+            case 't': timeout_ms = strtol(optarg, NULL, 0); break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[optind], "selftest") == 0) {
+        return selftest();
+    }
+
+    proto_client_t client;
+    if (udp_loopback) {
+        int port = open_udp_loopback();
+        if (port < 0 || proto_client_open_udp(&client, "127.0.0.1", port) < 0) {
+            perror("udp loopback");
+            return 1;
+        }
+    } else if (udp_host) {
+        char *colon = strchr(udp_host, ':');
+        uint16_t port = PROTO_UDP_PORT;
+        if (colon) {
+            *colon = 0;
+            port = strtoul(colon + 1, NULL, 0);
+        }
+        if (proto_client_open_udp(&client, udp_host, port) < 0) {
+            perror(udp_host);
+            return 1;
+        }
+    } else if (loopback) {
+        int fd = open_loopback();
+        if (fd < 0) {
+            perror("loopback");
+            return 1;
+        }
+        proto_client_attach(&client, fd);
+    } else if (proto_client_open(&client, device) < 0) {
+        perror(device);
+        return 1;
+    }
+
+    char **args = argv + optind;
+    int nargs = argc - optind;
+    proto_item_t item;
+
+    if (strcmp(args[0], "ping") == 0) {
+        const char *text = nargs > 1 ? args[1] : "ping";
+        size_t len = strlen(text) > PROTO_DATA_MAX - 2 ? PROTO_DATA_MAX - 2 : strlen(text);
+        uint64_t start = now_ns();
+        if (!command(&client, PROTO_OP_PING, text, len, &item)) return 1;
+        printf("%.*s (%.1f us", item.len - 1, (const char *) item.data + 1, (now_ns() - start) / 1e3);
+        if (client.udp) printf(", %u us on the board", client.tx_us - client.rx_us);
+        printf(")\n");
+    } else if (strcmp(args[0], "led") == 0 && nargs == 2) {
+        uint8_t on = strcmp(args[1], "on") == 0;
+        if (!command(&client, PROTO_OP_LED, &on, 1, &item)) return 1;
+        printf("LED %s\n", on ? "ON" : "OFF");
+    } else if (strcmp(args[0], "gpio") == 0 && nargs == 4 && strcmp(args[1], "put") == 0) {
+        uint8_t data[2] = {strtoul(args[2], NULL, 0), strtoul(args[3], NULL, 0)};
+        if (!command(&client, PROTO_OP_GPIO_PUT, data, 2, &item)) return 1;
+    } else if (strcmp(args[0], "gpio") == 0 && nargs == 3 && strcmp(args[1], "get") == 0) {
+        uint8_t pin = strtoul(args[2], NULL, 0);
+        if (!command(&client, PROTO_OP_GPIO_GET, &pin, 1, &item)) return 1;
+        printf("%u\n", item.data[1]);
+    } else if (strcmp(args[0], "pwm") == 0 && nargs == 3) {
+        uint16_t level = strtoul(args[2], NULL, 0);
+        uint8_t data[3] = {strtoul(args[1], NULL, 0), level, level >> 8};
+        if (!command(&client, PROTO_OP_PWM, data, 3, &item)) return 1;
+    } else if (strcmp(args[0], "timer") == 0 && nargs == 2) {
+        uint32_t hz = strtoul(args[1], NULL, 0);
+        uint8_t data[4] = {hz, hz >> 8, hz >> 16, hz >> 24};
+        if (!command(&client, PROTO_OP_TIMER, data, 4, &item)) return 1;
+    } else if (strcmp(args[0], "hist") == 0 && nargs <= 3) {
+        bool reset = strcmp(args[nargs - 1], "reset") == 0;
+        bool all = nargs == 1 || (nargs == 2 && reset);
+        int only = all ? 0 : op_lookup(args[1]);
+        if (only < 0) {
+            fprintf(stderr, "unknown op %s\n", args[1]);
+            return 1;
+        }
+
+        for (int op = all ? 1 : only; op <= (all ? PROTO_OP_COUNT - 1 : only); op++) {
+            hist_t hist;
+            uint32_t tick_hz;
+            if (!get_hist(&client, op, reset, &hist, &tick_hz)) return 1;
+            if (hist.count || !all) print_hist(op, &hist, tick_hz);
+        }
+    } else if (strcmp(args[0], "uptime") == 0) {
+        uint64_t us = 0;
+        if (!command(&client, PROTO_OP_UPTIME, NULL, 0, &item) || item.len < 9) return 1;
+        for (int i = 0; i < 8; i++) us |= (uint64_t) item.data[1 + i] << (8 * i);
+        printf("%.6f s\n", us / 1e6);
+    } else if (strcmp(args[0], "bootsel") == 0) {
+        if (!command(&client, PROTO_OP_BOOTSEL, NULL, 0, &item)) return 1;
+        printf("BOOTSEL\n");
+    } else if (strcmp(args[0], "bench") == 0) {
+        return bench(&client, nargs, args);
+    } else {
+        usage(argv[0]);
+        return 1;
+    }
+
+    return 0;
+}
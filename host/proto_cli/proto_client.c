@@ -0,0 +1,259 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "proto_client.h"
+
+/**
+ * Put a tty in raw mode, no echo, no line discipline, no CRLF mapping
+ *
+ * @param fd - serial port or pty
+ *
+ * @return int - 0 on success, -1 with errno set
+ */
+int proto_serial_raw(int fd) {
+    struct termios tio;
+
+    if (tcgetattr(fd, &tio) < 0) return -1;
+    cfmakeraw(&tio);
+    // USB CDC ignores the baud rate, set one anyway for real UARTs
+    cfsetispeed(&tio, B115200);
+    cfsetospeed(&tio, B115200);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+
+    return tcsetattr(fd, TCSANOW, &tio);
+}
+
+/**
+ * Open a serial port (e.g. /dev/ttyACM0) in raw mode
+ *
+ * @param client
+ * @param path
+ *
+ * @return int - 0 on success, -1 with errno set
+ */
+int proto_client_open(proto_client_t *client, const char *path) {
+    int fd = open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+
+    if (fd < 0) return -1;
+    if (proto_serial_raw(fd) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    proto_client_attach(client, fd);
+    return 0;
+}
+
+/**
+ * Talk to a board over UDP, e.g. picow_udp
+ *
+ * @param client
+ * @param host - name or address
+ * @param port - e.g. PROTO_UDP_PORT
+ *
+ * @return int - 0 on success, -1 with errno set
+ */
+int proto_client_open_udp(proto_client_t *client, const char *host, uint16_t port) {
+    struct addrinfo hints = {0};
+    struct addrinfo *addr;
+    char service[8];
+
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    snprintf(service, sizeof(service), "%u", port);
+    if (getaddrinfo(host, service, &hints, &addr)) {
+        errno = EHOSTUNREACH;
+        return -1;
+    }
+
+    // connected, so only the board's datagrams come back
+    int fd = socket(addr->ai_family, addr->ai_socktype | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, addr->ai_addr, addr->ai_addrlen) < 0) {
+        if (fd >= 0) close(fd);
+        freeaddrinfo(addr);
+        return -1;
+    }
+    freeaddrinfo(addr);
+
+    proto_client_attach(client, fd);
+    client->udp = true;
+    return 0;
+}
+
+/**
+ * Use an already open descriptor, e.g. the master side of a pty
+ *
+ * @param client
+ * @param fd
+ *
+ * @return void
+ */
+void proto_client_attach(proto_client_t *client, int fd) {
+    memset(client, 0, sizeof(*client));
+    client->fd = fd;
+    proto_rx_init(&client->rx);
+}
+
+void proto_client_close(proto_client_t *client) {
+    close(client->fd);
+    client->fd = -1;
+}
+
+/**
+ * Start a request frame with the next sequence number
+ *
+ * @param client
+ * @param request
+ *
+ * @return void
+ */
+void proto_client_begin(proto_client_t *client, proto_frame_t *request) {
+    proto_frame_begin(request, ++client->seq);
+}
+
+/**
+ * Encode and write a request
+ *
+ * @param client
+ * @param request - from proto_client_begin()
+ *
+ * @return bool - false on a write error
+ */
+bool proto_client_send(proto_client_t *client, proto_frame_t *request) {
+    if (client->udp) {
+        size_t len = proto_frame_finish(request);
+        if (send(client->fd, request->buf, len, 0) != (ssize_t) len) return false;
+
+        client->sent++;
+        return true;
+    }
+
+    uint8_t out[PROTO_ENCODED_MAX];
+    size_t len = proto_frame_encode(request, out);
+    size_t done = 0;
+
+    while (done < len) {
+        ssize_t n = write(client->fd, out + done, len - done);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            return false;
+        }
+        done += n;
+    }
+
+    client->sent++;
+    return true;
+}
+
+static inline uint32_t get32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+/**
+ * Read one waiting datagram
+ *
+ * @param client
+ * @param response - reader over the response items
+ *
+ * @return bool - true if it's the response to the last request
+ */
+static bool receive_datagram(proto_client_t *client, proto_reader_t *response) {
+    ssize_t n = recv(client->fd, client->datagram, sizeof(client->datagram), 0);
+
+    if (n < PROTO_SERVER_ACK_SIZE ||
+        !proto_reader_init(response, client->datagram + PROTO_SERVER_ACK_SIZE, n - PROTO_SERVER_ACK_SIZE)) {
+        client->rx.errors++;
+        return false;
+    }
+    if (response->seq != client->seq) {
+        client->stale++;
+        return false;
+    }
+
+    client->rx_us = get32(client->datagram);
+    client->tx_us = get32(client->datagram + 4);
+    client->frame_len = n - PROTO_SERVER_ACK_SIZE;
+    client->received++;
+    return true;
+}
+
+static int64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Wait for the response to the last request
+ *
+ * Responses to older requests (after a timeout) are skipped.
+ *
+ * @param client
+ * @param response - reader over the response items
+ * @param timeout_ms
+ *
+ * @return bool - false on timeout
+ */
+bool proto_client_receive(proto_client_t *client, proto_reader_t *response, int timeout_ms) {
+    int64_t deadline = now_ms() + timeout_ms;
+
+    while (true) {
+        // feed what's buffered first, a read can hold the start of the next frame
+        while (client->in_pos < client->in_len) {
+            size_t len = proto_rx_feed(&client->rx, client->in[client->in_pos++], client->frame);
+            if (!len) continue;
+
+            if (!proto_reader_init(response, client->frame, len)) {
+                client->rx.errors++;
+                continue;
+            }
+            if (response->seq != client->seq) {
+                client->stale++;
+                continue;
+            }
+
+            client->frame_len = len;
+            client->received++;
+            return true;
+        }
+
+        int64_t left = deadline - now_ms();
+        struct pollfd pfd = {client->fd, POLLIN, 0};
+
+        if (left <= 0 || poll(&pfd, 1, (int) left) <= 0) {
+            client->timeouts++;
+            return false;
+        }
+
+        if (client->udp) {
+            if (receive_datagram(client, response)) return true;
+            continue;
+        }
+
+        ssize_t n = read(client->fd, client->in, sizeof(client->in));
+        client->in_pos = 0;
+        client->in_len = n > 0 ? n : 0;
+    }
+}
+
+/**
+ * Send a request and wait for its response
+ *
+ * @param client
+ * @param request - from proto_client_begin()
+ * @param response - reader over the response items
+ * @param timeout_ms
+ *
+ * @return bool - false on a write error or timeout
+ */
+bool proto_client_transact(proto_client_t *client, proto_frame_t *request, proto_reader_t *response, int timeout_ms) {
+    return proto_client_send(client, request) && proto_client_receive(client, response, timeout_ms);
+}
@@ -0,0 +1,50 @@
+/**
+ * @brief Host side of lib/proto over a serial port, pty or UDP
+ *
+ * Sends request frames, waits for the response with the matching
+ * sequence number and counts what went wrong on the way. Over UDP a
+ * frame is a datagram, see proto_server.h.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "proto.h"
+#include "proto_server.h"
+
+typedef struct {
+    int fd;
+    // datagrams instead of a COBS byte stream
+    bool udp;
+    uint8_t seq;
+    proto_rx_t rx;
+    // decoded response, items of the reader point in here
+    uint8_t frame[PROTO_ENCODED_MAX];
+    size_t frame_len;
+    // bytes read but not fed to rx yet
+    uint8_t in[PROTO_ENCODED_MAX];
+    size_t in_len;
+    size_t in_pos;
+    // UDP: the response datagram, the frame starts after the ack
+    uint8_t datagram[PROTO_SERVER_DATAGRAM_MAX];
+    // UDP: board timestamps of the last response, see proto_server.h
+    uint32_t rx_us;
+    uint32_t tx_us;
+
+    uint32_t sent;
+    uint32_t received;
+    uint32_t timeouts;
+    uint32_t stale;
+} proto_client_t;
+
+int proto_client_open(proto_client_t *client, const char *path);
+int proto_client_open_udp(proto_client_t *client, const char *host, uint16_t port);
+void proto_client_attach(proto_client_t *client, int fd);
+void proto_client_close(proto_client_t *client);
+int proto_serial_raw(int fd);
+
+void proto_client_begin(proto_client_t *client, proto_frame_t *request);
+bool proto_client_send(proto_client_t *client, proto_frame_t *request);
+bool proto_client_receive(proto_client_t *client, proto_reader_t *response, int timeout_ms);
+bool proto_client_transact(proto_client_t *client, proto_frame_t *request, proto_reader_t *response, int timeout_ms);
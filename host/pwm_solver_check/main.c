@@ -0,0 +1,226 @@
+/**
+ * @brief Host check of lib/pwm_solver
+ *
+ * - exhaustive: for a set of targets every one of the 4080 x 65536
+ *   divider/wrap settings is tried, pwm_solve() must find the same
+ *   smallest error (exact 128-bit arithmetic)
+ * - sweep: thousands of frequencies, system clocks and resolutions,
+ *   each result must be a valid setting, report its own frequency and
+ *   error correctly and beat an independent long double search
+ * - compile time: PWM_SOLVE_DIV16/WRAP must be constant expressions,
+ *   valid, and within half a count of the target
+ * - targets out of reach must be rejected
+ *
+ * Usage:
+ *
+ *   pwm_solver_check [-q]      -q skips the slow exhaustive part
+ *
+ * Exits with 1 if any check fails.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "pwm_solver.h"
+
+// picow_pwm's blink and picow_dma's fade, at the default 125 MHz
+_Static_assert(PWM_SOLVE_DIV16(125000000, PWM_HZ(8)) == 3815, "8 Hz divider");
+_Static_assert(PWM_SOLVE_WRAP(125000000, PWM_HZ(8)) == 65530, "8 Hz wrap");
+_Static_assert(PWM_SOLVE_DIV16(125000000, PWM_HZ(1000)) == 31, "1 kHz divider");
+_Static_assert(PWM_SOLVE_WRAP(125000000, PWM_HZ(1000)) == 64515, "1 kHz wrap");
+_Static_assert(PWM_SOLVE_DIV16(125000000, PWM_HZ(1)) == 0, "1 Hz is out of reach");
+
+static int failures = 0;
+static int checks = 0;
+
+static void check(bool ok, const char *what, uint32_t sys_clk, uint64_t freq_mhz, uint32_t levels) {
+    checks++;
+    if (!ok) {
+        printf("FAIL: %s (sys_clk %u, %llu mHz, %u levels)\n", what, sys_clk, (unsigned long long) freq_mhz, levels);
+        failures++;
+    }
+}
+
+/**
+ * Exact error of a setting as a fraction, |scale - freq * period| / period
+ *
+ * @param sys_clk - system clock in Hz
+ * @param freq_mhz - requested frequency in mHz
+ * @param div16 - divider * 16
+ * @param wrap
+ * @param num - receives the numerator
+ * @param den - receives the denominator
+ *
+ * @return void
+ */
+static void exact_error(uint32_t sys_clk, uint64_t freq_mhz, uint32_t div16, uint32_t wrap, unsigned __int128 *num, unsigned __int128 *den) {
+    unsigned __int128 scale = PWM_SOLVE_SCALE(sys_clk);
+    unsigned __int128 period = (unsigned __int128) div16 * (wrap + 1);
+    unsigned __int128 actual = freq_mhz * period;
+
+    *num = actual > scale ? actual - scale : scale - actual;
+    *den = period;
+}
+
+static int compare_errors(unsigned __int128 n1, unsigned __int128 d1, unsigned __int128 n2, unsigned __int128 d2) {
+    unsigned __int128 a = n1 * d2;
+    unsigned __int128 b = n2 * d1;
+    return a < b ? -1 : a > b;
+}
+
+/**
+ * Try every divider and wrap and compare with pwm_solve()
+ *
+ * @param sys_clk - system clock in Hz
+ * @param freq_mhz - requested frequency in mHz
+ * @param levels - min_levels for the solver
+ *
+ * @return void
+ */
+static void check_exhaustive(uint32_t sys_clk, uint64_t freq_mhz, uint32_t levels) {
+    unsigned __int128 best_num = 0, best_den = 0;
+    pwm_timing_t timing;
+
+    for (uint32_t div16 = PWM_DIV16_MIN; div16 <= PWM_DIV16_MAX; div16++) {
+        for (uint32_t wrap = levels - 1; wrap <= PWM_WRAP_MAX; wrap++) {
+            unsigned __int128 num, den;
+            exact_error(sys_clk, freq_mhz, div16, wrap, &num, &den);
+            if (!best_den || compare_errors(num, den, best_num, best_den) < 0) {
+                best_num = num;
+                best_den = den;
+            }
+        }
+    }
+
+    check(pwm_solve(sys_clk, freq_mhz, levels, &timing), "exhaustive: solved", sys_clk, freq_mhz, levels);
+
+    unsigned __int128 num, den;
+    exact_error(sys_clk, freq_mhz, timing.div16, timing.wrap, &num, &den);
+    check(compare_errors(num, den, best_num, best_den) == 0, "exhaustive: smallest error", sys_clk, freq_mhz, levels);
+}
+
+/**
+ * Check one solved target against its own report and a long double search
+ *
+ * @param sys_clk - system clock in Hz
+ * @param freq_mhz - requested frequency in mHz
+ * @param levels - min_levels for the solver
+ *
+ * @return void
+ */
+static void check_target(uint32_t sys_clk, uint64_t freq_mhz, uint32_t levels) {
+    pwm_timing_t timing;
+
+    // independent search in long double over the two wraps around the ideal one
+    long double best = INFINITY;
+    for (uint32_t div16 = PWM_DIV16_MIN; div16 <= PWM_DIV16_MAX; div16++) {
+        long double ideal = (long double) sys_clk * 16000 / ((long double) freq_mhz * div16);
+        for (long double around = floorl(ideal); around <= floorl(ideal) + 1; around++) {
+            long double counts = fminl(fmaxl(around, levels), PWM_WRAP_MAX + 1);
+            long double actual = (long double) sys_clk * 16000 / (div16 * counts);
+            long double error = fabsl(actual - freq_mhz) / freq_mhz;
+            if (error < best) best = error;
+        }
+    }
+
+    // reachable if it's within half a count of the longest and the shortest period
+    long double slowest = (long double) sys_clk * 16000 / ((long double) PWM_DIV16_MAX * (PWM_WRAP_MAX + 1.5L));
+    long double fastest = (long double) sys_clk * 16000 / ((long double) PWM_DIV16_MIN * (levels - 0.5L));
+    bool solved = pwm_solve(sys_clk, freq_mhz, levels, &timing);
+    check(solved == (freq_mhz >= slowest && freq_mhz <= fastest), "reachable iff in range", sys_clk, freq_mhz, levels);
+    if (!solved) return;
+
+    check(timing.div16 >= PWM_DIV16_MIN && timing.div16 <= PWM_DIV16_MAX, "divider in range", sys_clk, freq_mhz, levels);
+    check(timing.wrap + 1u >= levels, "enough duty steps", sys_clk, freq_mhz, levels);
+
+    long double actual = (long double) sys_clk * 16000 / ((long double) timing.div16 * (timing.wrap + 1));
+    long double error = (actual - freq_mhz) / freq_mhz;
+    check(llroundl(actual) == (long long) timing.frequency_mhz, "reported frequency", sys_clk, freq_mhz, levels);
+    check(fabsl(error * 1e6L - timing.error_ppm) < 1, "reported error", sys_clk, freq_mhz, levels);
+    check(fabsl(error) <= best * (1 + 1e-12L) + 1e-18L, "no better setting", sys_clk, freq_mhz, levels);
+}
+
+/**
+ * Check the compile-time macros with runtime values
+ *
+ * @param sys_clk - system clock in Hz
+ * @param freq_mhz - requested frequency in mHz
+ *
+ * @return void
+ */
+static void check_macros(uint32_t sys_clk, uint64_t freq_mhz) {
+    uint32_t div16 = PWM_SOLVE_DIV16(sys_clk, freq_mhz);
+    pwm_timing_t solved;
+    pwm_timing_t timing;
+
+    bool reachable = pwm_solve(sys_clk, freq_mhz, 1, &solved);
+    if (!div16) {
+        // out of reach for the macros means the divider would have to exceed 255.9375
+        check(!reachable || (long double) sys_clk * 16000 / ((long double) freq_mhz * PWM_DIV16_MAX) > PWM_WRAP_MAX + 1.5L,
+              "macro only gives up when out of reach", sys_clk, freq_mhz, 0);
+        return;
+    }
+
+    uint32_t wrap = PWM_SOLVE_WRAP(sys_clk, freq_mhz);
+    if (wrap > PWM_WRAP_MAX || wrap < 1) {
+        // the smallest divider is already too fast for any useful wrap
+        check(freq_mhz * PWM_DIV16_MIN * 2 > PWM_SOLVE_SCALE(sys_clk), "macro wrap in range", sys_clk, freq_mhz, 0);
+        return;
+    }
+
+    pwm_timing_from(sys_clk, freq_mhz, div16, wrap, &timing);
+    // nearest wrap: within half a count, relative to the period
+    check(fabs((double) timing.error_ppm) <= 1e6 / (2.0 * (wrap + 1)) + 1, "macro within half a count", sys_clk, freq_mhz, wrap + 1);
+
+    // and the solver at the same resolution is never worse
+    check(pwm_solve(sys_clk, freq_mhz, wrap + 1, &solved) && abs(solved.error_ppm) <= abs(timing.error_ppm),
+          "solver at least as good as the macro", sys_clk, freq_mhz, wrap + 1);
+}
+
+int main(int argc, char **argv) {
+    static const uint32_t clocks[] = {125000000, 133000000, 48000000, 200000000, 250000000};
+    static const uint32_t levels[] = {1, 100, 256, 1024, 65536};
+    bool quick = argc > 1 && !strcmp(argv[1], "-q");
+
+    if (!quick) {
+        // small and large periods, integer and fractional best dividers
+        check_exhaustive(125000000, PWM_HZ(8), 1);
+        check_exhaustive(125000000, PWM_HZ(1000), 1024);
+        check_exhaustive(125000000, 7629, 65536);
+        check_exhaustive(133000000, PWM_HZ(50), 256);
+        check_exhaustive(48000000, 440123, 1);
+        check_exhaustive(125000000, PWM_HZ(25000), 100);
+        printf("exhaustive: %d checks\n", checks);
+    }
+
+    for (size_t c = 0; c < sizeof(clocks) / sizeof(clocks[0]); c++) {
+        for (int step = 0; step <= 300; step++) {
+            // 1 Hz .. 10 MHz, log spaced, odd mHz values in between
+            uint64_t freq_mhz = (uint64_t) (1000.0 * pow(10.0, step * 7.0 / 300.0)) + step % 7;
+
+            for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+                check_target(clocks[c], freq_mhz, levels[l]);
+            }
+            check_macros(clocks[c], freq_mhz);
+        }
+    }
+
+    // out of reach
+    pwm_timing_t timing;
+    check(!pwm_solve(125000000, PWM_HZ(1), 1, &timing), "1 Hz needs a divider over 256", 125000000, PWM_HZ(1), 1);
+    check(!pwm_solve(125000000, PWM_HZ(10000), 65537, &timing), "more than 65536 levels", 125000000, PWM_HZ(10000), 65537);
+    check(!pwm_solve(125000000, PWM_HZ(1000000), 256, &timing), "1 MHz with 256 levels", 125000000, PWM_HZ(1000000), 256);
+    check(!pwm_solve(125000000, 0, 1, &timing), "0 Hz", 125000000, 0, 1);
+
+    // what it costs at runtime, e.g. after a clk_sys change
+    clock_t start = clock();
+    for (int i = 0; i < 1000; i++) {
+        pwm_solve(125000000 + i, PWM_HZ(1000), 256, &timing);
+    }
+    printf("pwm_solve(): %.1f us per call on the host\n", (double) (clock() - start) / CLOCKS_PER_SEC * 1000);
+
+    printf("%d checks, %d failures\n", checks, failures);
+    return failures ? 1 : 0;
+}
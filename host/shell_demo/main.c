@@ -0,0 +1,161 @@
+/**
+ * @brief lib/shell on the host, against stdin/stdout
+ *
+ * Same loop shape as the firmware: shell_poll() between other work,
+ * here a tick counter that keeps going while no input arrives. Pipe
+ * commands in to script it, the demo exits on end of input:
+ *
+ *   printf 'help\nled on\nadd 2 3\n' | shell_demo
+ *
+ * Usage:
+ *
+ *   shell_demo [-b]
+ *
+ *   -b, --bench    time shell_execute() dispatch instead of reading stdin
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "shell.h"
+
+static shell_t shell;
+static bool led = false;
+static bool done = false;
+static unsigned long ticks = 0;
+
+static void cmd_help(int argc, char **argv) {
+    shell_print_help(&shell);
+}
+
+static void cmd_led(int argc, char **argv) {
+    if (argc == 2 && strcmp(argv[1], "on") == 0) {
+        led = true;
+    } else if (argc == 2 && strcmp(argv[1], "off") == 0) {
+        led = false;
+    } else {
+        printf("usage: led <on|off>\n");
+        return;
+    }
+    printf("LED %s\n", led ? "ON" : "OFF");
+}
+
+static void cmd_add(int argc, char **argv) {
+    long sum = 0;
+    for (int i = 1; i < argc; i++) sum += strtol(argv[i], NULL, 0);
+    printf("%ld\n", sum);
+}
+
+static void cmd_echo(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) printf("%s%s", argv[i], i + 1 < argc ? " " : "\n");
+}
+
+static void cmd_ticks(int argc, char **argv) {
+    printf("%lu ticks\n", ticks);
+}
+
+static const shell_command_t commands[] = {
+    {"help", "Show this help", cmd_help},
+    {"led", "led <on|off>, switch the simulated LED", cmd_led},
+    {"add", "add <a> <b> ..., print the sum", cmd_add},
+    {"echo", "echo <args>, print the arguments", cmd_echo},
+    {"ticks", "Show how often the application loop ran", cmd_ticks},
+};
+
+/**
+ * shell_stdio_getc() with end of input detection
+ *
+ * @return int
+ */
+static int stdin_getc(void) {
+    unsigned char c;
+    static bool nonblocking = false;
+
+    if (!nonblocking) {
+        // the first shell_stdio_getc() call switches stdin to non-blocking
+        shell_stdio_getc();
+        nonblocking = true;
+    }
+
+    ssize_t n = read(STDIN_FILENO, &c, 1);
+    if (n == 0) done = true;
+    return n == 1 ? c : -1;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void noop(int argc, char **argv) {
+}
+
+/**
+ * Dispatch time with a small and a full command table
+ *
+ * @return void
+ */
+static void bench(void) {
+    static shell_command_t table[SHELL_COMMANDS_MAX];
+    static char names[SHELL_COMMANDS_MAX][16];
+    uint8_t sizes[] = {2, SHELL_COMMANDS_MAX};
+
+    for (uint8_t i = 0; i < SHELL_COMMANDS_MAX; i++) {
+        snprintf(names[i], sizeof(names[i]), "command%u", i);
+        table[i] = (shell_command_t) {names[i], "", noop};
+    }
+
+    for (size_t s = 0; s < sizeof(sizes); s++) {
+        shell_t bench_shell;
+        char line[32];
+        const long iterations = 2000000;
+
+        shell_init(&bench_shell, table, sizes[s], NULL);
+
+        double start = now_seconds();
+        for (long i = 0; i < iterations; i++) {
+            snprintf(line, sizeof(line), "command%u arg", (unsigned) (i % sizes[s]));
+            shell_execute(&bench_shell, line);
+        }
+        double elapsed = now_seconds() - start;
+
+        printf("%2u commands: %.1f ns per line (format + split + dispatch)\n", sizes[s], elapsed / iterations * 1e9);
+    }
+}
+
+int main(int argc, char **argv) {
+    static const struct option options[] = {
+        {"bench", no_argument, NULL, 'b'},
+        {NULL, 0, NULL, 0},
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "b", options, NULL)) != -1) {
+        switch (opt) {
+            case 'b': bench(); return 0;
+            default:
+                fprintf(stderr, "usage: %s [-b]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (!shell_init(&shell, commands, sizeof(commands) / sizeof(commands[0]), stdin_getc)) {
+        fprintf(stderr, "bad command table\n");
+        return 1;
+    }
+    shell.prompt = isatty(STDIN_FILENO) ? "> " : NULL;
+    shell.echo = false;
+
+    while (!done) {
+        shell_poll(&shell);
+        // the rest of the application, runs whether or not there was input
+        ticks++;
+        usleep(1000);
+    }
+
+    return 0;
+}
@@ -0,0 +1,342 @@
+/**
+ * @brief Host check and benchmark of lib/sigma_delta
+ *
+ * - exact: sigma_delta_encode() must give the same bits as a plain
+ *   one bit at a time reference, for random and full scale samples
+ *   encoded in random block sizes
+ * - dc: the density of ones over 4096 words must match the 16-bit
+ *   level to within a bit
+ * - resolution: a slow sine through each encoder, averaged back by a
+ *   3-stage moving average like an LED or RC filter would, the SNR
+ *   against the same filter on the input gives effective bits. The
+ *   32-level thermometer code picow_dma_pio used is the baseline
+ * - speed: encoded Mbit/s of each encoder
+ *
+ * Usage:
+ *
+ *   sigma_delta_bench [-n words]     words per speed run, default 1M
+ *
+ * Exits with 1 if a check fails.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sigma_delta.h"
+
+// picow_dma_pio: 125 MHz / 10 PIO clock, one word per 32 clocks
+#define WORD_RATE (125e6 / 10 / 32)
+// resolution test: sine frequency and reconstruction filter length in words
+#define SINE_HZ 100.0
+#define FILTER_WORDS 32
+#define FILTER_STAGES 3
+#define SINE_WORDS (1u << 18)
+
+static int failures = 0;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// small LCG, same sequence on every run
+static uint32_t next_random(uint32_t *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+/**
+ * One bit at a time, with branches, the definition the fast one has to match
+ *
+ * @param sd
+ * @param samples
+ * @param words
+ * @param count
+ *
+ * @return void
+ */
+static void reference_encode(sigma_delta_t *sd, const uint16_t *samples, uint32_t *words, uint32_t count) {
+    for (uint32_t n = 0; n < count; n++) {
+        words[n] = 0;
+
+        for (uint32_t k = 0; k < SIGMA_DELTA_BITS_PER_WORD; k++) {
+            bool bit;
+
+            if (sd->order == 1) {
+                sd->i1 += samples[n];
+                bit = sd->i1 >= 65536;
+                if (bit) sd->i1 -= 65536;
+            } else {
+                bit = sd->i2 > 0;
+                int32_t feedback = bit ? 65536 : 0;
+                sd->i1 += samples[n] - feedback;
+                sd->i2 += sd->i1 - feedback;
+            }
+
+            if (bit) words[n] |= 1u << k;
+        }
+
+        if (sd->order == 2) {
+            if (sd->i1 > SIGMA_DELTA_I1_LIMIT) sd->i1 = SIGMA_DELTA_I1_LIMIT;
+            if (sd->i1 < -SIGMA_DELTA_I1_LIMIT) sd->i1 = -SIGMA_DELTA_I1_LIMIT;
+            if (sd->i2 > SIGMA_DELTA_I2_LIMIT) sd->i2 = SIGMA_DELTA_I2_LIMIT;
+            if (sd->i2 < -SIGMA_DELTA_I2_LIMIT) sd->i2 = -SIGMA_DELTA_I2_LIMIT;
+        }
+    }
+}
+
+/**
+ * picow_dma_pio's 32-level thermometer code, the top 5 bits of the sample
+ *
+ * @param sd - unused, same signature as the others
+ * @param samples
+ * @param words
+ * @param count
+ *
+ * @return void
+ */
+static void thermometer_encode(sigma_delta_t *sd, const uint16_t *samples, uint32_t *words, uint32_t count) {
+    for (uint32_t n = 0; n < count; n++) {
+        words[n] = ~(~0u << (samples[n] >> 11));
+    }
+}
+
+typedef void (*encode_fn)(sigma_delta_t *sd, const uint16_t *samples, uint32_t *words, uint32_t count);
+
+/**
+ * Fast and reference encoders on the same stream, in random block sizes
+ *
+ * @param order
+ * @param samples
+ * @param count
+ *
+ * @return void
+ */
+static void check_exact(uint32_t order, const uint16_t *samples, uint32_t count, const char *name) {
+    uint32_t *fast = malloc(count * sizeof(uint32_t));
+    uint32_t *slow = malloc(count * sizeof(uint32_t));
+    sigma_delta_t a;
+    sigma_delta_t b;
+    uint32_t seed = 7;
+
+    sigma_delta_init(&a, order);
+    sigma_delta_init(&b, order);
+    reference_encode(&b, samples, slow, count);
+
+    for (uint32_t done = 0; done < count;) {
+        uint32_t block = 1 + next_random(&seed) % 300;
+        if (block > count - done) block = count - done;
+        sigma_delta_encode(&a, samples + done, fast + done, block);
+        done += block;
+    }
+
+    for (uint32_t n = 0; n < count; n++) {
+        if (fast[n] != slow[n]) {
+            printf("FAIL exact: order %u %s, word %u is %08x, reference %08x\n", order, name, n, fast[n], slow[n]);
+            failures++;
+            break;
+        }
+    }
+    if (a.i1 != b.i1 || a.i2 != b.i2) {
+        printf("FAIL exact: order %u %s, state differs after the stream\n", order, name);
+        failures++;
+    }
+
+    free(fast);
+    free(slow);
+}
+
+/**
+ * Worst density error over the 16-bit levels
+ *
+ * Every level near 0 and full scale, where the second order loop
+ * overloads, every 61st in between.
+ *
+ * @param order
+ *
+ * @return double - in 16-bit LSBs
+ */
+static double dc_error(uint32_t order) {
+    static uint16_t samples[4096];
+    static uint32_t words[4096];
+    double worst = 0;
+
+    for (uint32_t level = 0; level < 65536; level += level < 1024 || level >= 64512 ? 1 : 61) {
+        sigma_delta_t sd;
+        uint64_t ones = 0;
+
+        sigma_delta_init(&sd, order);
+        for (uint32_t n = 0; n < 4096; n++) {
+            samples[n] = level;
+        }
+        sigma_delta_encode(&sd, samples, words, 4096);
+        for (uint32_t n = 0; n < 4096; n++) {
+            ones += __builtin_popcount(words[n]);
+        }
+
+        double error = fabs((double) ones * 65536 / (4096.0 * 32) - level);
+        if (error > worst) worst = error;
+    }
+
+    return worst;
+}
+
+/**
+ * FILTER_STAGES moving averages of FILTER_WORDS, in place
+ *
+ * @param values
+ * @param count
+ *
+ * @return void
+ */
+static void smooth(double *values, uint32_t count) {
+    for (uint32_t stage = 0; stage < FILTER_STAGES; stage++) {
+        double sum = 0;
+        for (uint32_t n = 0; n < count; n++) {
+            sum += values[n];
+            if (n >= FILTER_WORDS) sum -= values[n - FILTER_WORDS];
+            values[n] = sum / FILTER_WORDS;
+        }
+    }
+}
+
+/**
+ * Effective bits of an encoder on a slow sine
+ *
+ * @param encode
+ * @param order
+ * @param samples - the sine, SINE_WORDS
+ *
+ * @return double
+ */
+static double effective_bits(encode_fn encode, uint32_t order, const uint16_t *samples) {
+    uint32_t *words = malloc(SINE_WORDS * sizeof(uint32_t));
+    double *out = malloc(SINE_WORDS * sizeof(double));
+    double *in = malloc(SINE_WORDS * sizeof(double));
+    sigma_delta_t sd;
+    double signal = 0;
+    double noise = 0;
+    double mean = 0;
+
+    sigma_delta_init(&sd, order);
+    encode(&sd, samples, words, SINE_WORDS);
+
+    for (uint32_t n = 0; n < SINE_WORDS; n++) {
+        out[n] = __builtin_popcount(words[n]) / 32.0;
+        in[n] = samples[n] / 65536.0;
+    }
+    smooth(out, SINE_WORDS);
+    smooth(in, SINE_WORDS);
+
+    // skip the encoder and filter start up
+    uint32_t start = SINE_WORDS / 16;
+    for (uint32_t n = start; n < SINE_WORDS; n++) {
+        mean += in[n];
+    }
+    mean /= SINE_WORDS - start;
+    for (uint32_t n = start; n < SINE_WORDS; n++) {
+        signal += (in[n] - mean) * (in[n] - mean);
+        noise += (out[n] - in[n]) * (out[n] - in[n]);
+    }
+
+    free(words);
+    free(out);
+    free(in);
+
+    double snr = 10 * log10(signal / noise);
+    return (snr - 1.76) / 6.02;
+}
+
+/**
+ * Encoded Mbit/s
+ *
+ * @param encode
+ * @param order
+ * @param samples
+ * @param count
+ *
+ * @return double
+ */
+static double speed(encode_fn encode, uint32_t order, const uint16_t *samples, uint32_t count) {
+    uint32_t *words = malloc(count * sizeof(uint32_t));
+    volatile uint32_t sink = 0;
+    sigma_delta_t sd;
+    double best = 0;
+
+    sigma_delta_init(&sd, order);
+    // best of a few runs, the first one pages the buffers in
+    for (int run = 0; run < 5; run++) {
+        double start = now();
+        encode(&sd, samples, words, count);
+        double rate = count * 32.0 / (now() - start) / 1e6;
+        sink += words[count - 1];
+        if (rate > best) best = rate;
+    }
+
+    free(words);
+    return best;
+}
+
+int main(int argc, char **argv) {
+    uint32_t count = 1u << 20;
+    uint32_t seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+            case 'n':
+                count = strtoul(optarg, NULL, 0);
+                if (count < SINE_WORDS) count = SINE_WORDS;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n words]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    uint16_t *noise = malloc(count * sizeof(uint16_t));
+    uint16_t *rails = malloc(count * sizeof(uint16_t));
+    uint16_t *sine = malloc(count * sizeof(uint16_t));
+
+    for (uint32_t n = 0; n < count; n++) {
+        noise[n] = next_random(&seed);
+        // runs at 0 and 65535, the second order loop overloads and has to recover
+        rails[n] = (n >> 10) & 1 ? 65535 : (n >> 11) & 1 ? 0 : next_random(&seed);
+        // a 0 .. 65535 fade, like the LED
+        sine[n] = 32767.5 + 32767.5 * sin(2 * M_PI * SINE_HZ * n / WORD_RATE);
+    }
+
+    for (uint32_t order = 1; order <= 2; order++) {
+        check_exact(order, noise, count, "random");
+        check_exact(order, rails, count, "full scale");
+    }
+
+    printf("sigma_delta:  %.1f kHz sample rate at %.1f Mbit/s, %u-word x%u filter\n", WORD_RATE / 1e3,
+           WORD_RATE * 32 / 1e6, FILTER_WORDS, FILTER_STAGES);
+
+    for (uint32_t order = 1; order <= 2; order++) {
+        double dc = dc_error(order);
+        if (dc > 1) {
+            printf("FAIL dc: order %u is off by %.2f LSB\n", order, dc);
+            failures++;
+        }
+        printf("order %u       dc error %.2f LSB, %.1f effective bits, %.1f Mbit/s (reference %.1f Mbit/s)\n",
+               order, dc, effective_bits(sigma_delta_encode, order, sine), speed(sigma_delta_encode, order, noise, count),
+               speed(reference_encode, order, noise, count));
+    }
+
+    printf("thermometer   %.1f effective bits, %.1f Mbit/s\n", effective_bits(thermometer_encode, 0, sine),
+           speed(thermometer_encode, 0, noise, count));
+
+    free(noise);
+    free(rails);
+    free(sine);
+
+    printf("sigma_delta_bench: %d failures\n", failures);
+    return failures ? 1 : 0;
+}
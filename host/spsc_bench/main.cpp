@@ -0,0 +1,181 @@
+/**
+ * @brief Host test and benchmark of lib/spsc with std::thread
+ *
+ * The producer and consumer run on two threads like core 0 and
+ * core 1 on the board:
+ *
+ * - order: a counting sequence must arrive complete and in order,
+ *   with single, fixed batch and random batch push/pop
+ * - throughput: messages/second for single and batched operations
+ * - latency: ping-pong over two rings, round trip min/median/p99
+ *
+ * Usage:
+ *
+ *   spsc_bench [-n messages]
+ *
+ * Exits with 1 if a sequence arrives broken.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "spsc.h"
+
+#define CAPACITY 1024
+
+using clock_type = std::chrono::steady_clock;
+
+static uint32_t buffer_a[CAPACITY];
+static uint32_t buffer_b[CAPACITY];
+
+static double seconds_since(clock_type::time_point start) {
+    return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+// give the other thread the CPU when there are fewer cores than threads
+static void backoff(void) {
+    std::this_thread::yield();
+}
+
+// small LCG for the random batch sizes, one per thread
+static uint32_t next_random(uint32_t *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 16;
+}
+
+/**
+ * Send 0 .. n-1 through a ring and check it arrives in order
+ *
+ * @param n - number of messages
+ * @param push_batch - elements per push, 0 for random 1-64
+ * @param pop_batch - elements per pop, 0 for random 1-64
+ * @param rate - receives messages/second
+ *
+ * @return bool - true if the sequence arrived intact
+ */
+static bool run_sequence(uint32_t n, uint32_t push_batch, uint32_t pop_batch, double *rate) {
+    spsc_t ring;
+    spsc_init(&ring, buffer_a, CAPACITY, sizeof(uint32_t));
+    bool ok = true;
+
+    auto start = clock_type::now();
+
+    std::thread producer([&] {
+        uint32_t batch[64];
+        uint32_t state = 1;
+        uint32_t next = 0;
+
+        while (next < n) {
+            uint32_t count = push_batch ? push_batch : 1 + next_random(&state) % 64;
+            if (count > n - next) count = n - next;
+            for (uint32_t i = 0; i < count; i++) batch[i] = next + i;
+
+            uint32_t done = 0;
+            while (done < count) {
+                uint32_t pushed = spsc_push_batch(&ring, batch + done, count - done);
+                if (!pushed) backoff();
+                done += pushed;
+            }
+            next += count;
+        }
+    });
+
+    std::thread consumer([&] {
+        uint32_t batch[64];
+        uint32_t state = 2;
+        uint32_t expected = 0;
+
+        while (expected < n) {
+            uint32_t count = pop_batch ? pop_batch : 1 + next_random(&state) % 64;
+            uint32_t got = spsc_pop_batch(&ring, batch, count);
+            if (!got) backoff();
+            for (uint32_t i = 0; i < got; i++) {
+                if (batch[i] != expected++) ok = false;
+            }
+        }
+    });
+
+    producer.join();
+    consumer.join();
+    *rate = n / seconds_since(start);
+
+    return ok;
+}
+
+/**
+ * Ping-pong one message between two threads over two rings
+ *
+ * @param rounds - number of round trips
+ *
+ * @return void
+ */
+static void run_latency(uint32_t rounds) {
+    spsc_t ping, pong;
+    spsc_init(&ping, buffer_a, CAPACITY, sizeof(uint32_t));
+    spsc_init(&pong, buffer_b, CAPACITY, sizeof(uint32_t));
+    std::vector<double> rtt(rounds);
+
+    std::thread echo([&] {
+        uint32_t value;
+        for (uint32_t i = 0; i < rounds; i++) {
+            while (!spsc_pop(&ping, &value)) backoff();
+            while (!spsc_push(&pong, &value)) backoff();
+        }
+    });
+
+    for (uint32_t i = 0; i < rounds; i++) {
+        uint32_t value = i;
+        auto start = clock_type::now();
+        while (!spsc_push(&ping, &value)) backoff();
+        while (!spsc_pop(&pong, &value)) backoff();
+        rtt[i] = seconds_since(start) * 1e9;
+    }
+    echo.join();
+
+    std::sort(rtt.begin(), rtt.end());
+    printf("latency:      round trip min %.0f ns, median %.0f ns, p99 %.0f ns (%u rounds)\n",
+           rtt[0], rtt[rounds / 2], rtt[(rounds * 99) / 100], rounds);
+}
+
+int main(int argc, char **argv) {
+    uint32_t n = 4000000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+            case 'n': n = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n messages]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    static const struct {
+        const char *name;
+        uint32_t push_batch;
+        uint32_t pop_batch;
+    } cases[] = {
+        {"single", 1, 1},
+        {"batch 16", 16, 16},
+        {"batch 64/7", 64, 7},
+        {"random batches", 0, 0},
+    };
+    int failures = 0;
+
+    printf("spsc:         capacity %u, %u messages, %u hardware threads\n", CAPACITY, n, std::thread::hardware_concurrency());
+
+    for (const auto &c : cases) {
+        double rate;
+        bool ok = run_sequence(n, c.push_batch, c.pop_batch, &rate);
+        printf("%-14s %s, %.1f M messages/s\n", c.name, ok ? "in order" : "BROKEN", rate / 1e6);
+        if (!ok) failures++;
+    }
+
+    run_latency(20000);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,43 @@
+/**
+ * @brief lwIP options for telemetry_bench
+ *
+ * lwIP's unix port with NO_SYS, the raw API from one thread like
+ * pico_cyw43_arch_lwip_poll. The heap and the pools sit on malloc
+ * and every call goes through the bench's counters, so a pbuf_alloc()
+ * or memp_malloc() per datagram shows up.
+ */
+
+#pragma once
+
+#define NO_SYS 1
+#define LWIP_SOCKET 0
+#define LWIP_NETCONN 0
+#define SYS_LIGHTWEIGHT_PROT 0
+
+#define LWIP_IPV4 1
+#define LWIP_IPV6 0
+#define LWIP_UDP 1
+#define LWIP_TCP 0
+#define LWIP_ARP 0
+#define LWIP_ETHERNET 0
+#define LWIP_DHCP 0
+#define LWIP_ICMP 1
+#define LWIP_RAW 0
+
+#define MEM_LIBC_MALLOC 1
+#define MEMP_MEM_MALLOC 1
+#define MEM_ALIGNMENT 4
+#define mem_clib_malloc bench_malloc
+#define mem_clib_calloc bench_calloc
+#define mem_clib_free bench_free
+
+#define LWIP_SUPPORT_CUSTOM_PBUF 1
+#define LWIP_NETIF_TX_SINGLE_PBUF 1
+#define LWIP_STATS 0
+
+#ifndef __ASSEMBLER__
+#include <stddef.h>
+void *bench_malloc(size_t size);
+void *bench_calloc(size_t count, size_t size);
+void bench_free(void *ptr);
+#endif
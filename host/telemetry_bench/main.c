@@ -0,0 +1,274 @@
+/**
+ * @brief lib/telemetry on lwIP's unix port, over Linux loopback
+ *
+ * The same telemetry.c and telemetry_udp.c as picow_udp, with a netif
+ * standing in for the cyw43 driver: its output function takes the IP
+ * packet lwIP built, strips the IP and UDP headers and sends the
+ * payload on a real UDP socket to 127.0.0.1, where the bench receives
+ * and decodes it again.
+ *
+ * Records are ADC blocks of 100 samples and a pulse count, the same
+ * mix as picow_udp, produced as fast as the stack takes them. Reported:
+ *
+ * - datagrams/s and payload MB/s through lwIP and loopback
+ * - heap allocations per datagram (lwIP's heap and pools sit on a
+ *   counting malloc, see lwipopts.h), 0 for the custom pbufs
+ * - chained packets, 0 when lwIP prepends its headers in place
+ * - records received and sequence gaps on the receiving side
+ *
+ * With -c each datagram is copied into a pbuf_alloc() pbuf instead,
+ * the usual way to send with lwIP, for comparison.
+ *
+ * Usage:
+ *
+ *   telemetry_bench [-c] [-n datagrams]    default 100000
+ *
+ * Exits with 1 if anything was lost or zero-copy allocated.
+ */
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "lwip/init.h"
+#include "lwip/ip_addr.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include "telemetry.h"
+
+#define ADC_BLOCK 100
+#define COUNT_EVERY 10
+// the bench's netif is 10.0.0.1/24, datagrams go to .2
+#define BENCH_HOST "10.0.0.2"
+#define BENCH_PORT 5005
+
+static uint64_t allocs = 0;
+static uint64_t alloc_bytes = 0;
+
+static struct netif bench_netif;
+static int tx_fd = -1;
+static int rx_fd = -1;
+static uint64_t chained = 0;
+static uint64_t wire_bytes = 0;
+
+// receiving side
+static uint64_t received = 0;
+static uint64_t received_records = 0;
+static uint64_t lost = 0;
+static uint64_t bad = 0;
+static uint32_t expected_seq = 0;
+
+// copy mode
+static struct udp_pcb *copy_pcb;
+static ip_addr_t copy_addr;
+
+void *bench_malloc(size_t size) {
+    allocs++;
+    alloc_bytes += size;
+    return malloc(size);
+}
+
+void *bench_calloc(size_t count, size_t size) {
+    allocs++;
+    alloc_bytes += count * size;
+    return calloc(count, size);
+}
+
+void bench_free(void *ptr) {
+    free(ptr);
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void count_record(uint8_t type, const uint8_t *data, uint8_t len, void *user) {
+    received_records++;
+}
+
+/**
+ * Decode whatever arrived on the loopback socket
+ *
+ * @return void
+ */
+static void receive(void) {
+    uint8_t buffer[2048];
+    ssize_t len;
+
+    while ((len = recv(rx_fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+        telemetry_header_t header;
+
+        if (!telemetry_decode(buffer, len, &header, count_record, NULL)) {
+            bad++;
+            continue;
+        }
+        lost += header.seq - expected_seq;
+        expected_seq = header.seq + 1;
+        received++;
+    }
+}
+
+/**
+ * netif output: the "driver", sends the UDP payload over loopback
+ *
+ * @param netif
+ * @param p - IP packet, headers in front
+ * @param ipaddr
+ *
+ * @return err_t
+ */
+static err_t bench_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr) {
+    uint8_t packet[1600];
+
+    if (p->next) chained++;
+
+    // the copy a driver's DMA would do
+    uint16_t len = pbuf_copy_partial(p, packet, sizeof(packet), 0);
+    uint32_t headers = (packet[0] & 0x0f) * 4 + 8;
+    if (len < headers) return ERR_BUF;
+
+    wire_bytes += len;
+    send(tx_fd, packet + headers, len - headers, 0);
+    receive();
+
+    return ERR_OK;
+}
+
+static err_t bench_netif_init(struct netif *netif) {
+    netif->name[0] = 'b';
+    netif->name[1] = 'n';
+    netif->mtu = 1500;
+    netif->output = bench_output;
+    return ERR_OK;
+}
+
+/**
+ * telemetry_send_t for -c: copy the payload into a fresh pbuf
+ *
+ * @return bool
+ */
+static bool copy_send(uint32_t slot, uint8_t *mem, uint32_t len, void *user) {
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+    err_t err = ERR_MEM;
+
+    if (p) {
+        pbuf_take(p, mem + TELEMETRY_HEADROOM, len);
+        err = udp_sendto(copy_pcb, p, &copy_addr, BENCH_PORT);
+        pbuf_free(p);
+    }
+    // the copy went out, the slot is free right away
+    telemetry_release(slot);
+
+    return err == ERR_OK;
+}
+
+/**
+ * Loopback sockets, rx bound to an ephemeral port and tx connected to it
+ *
+ * @return bool
+ */
+static bool open_sockets(void) {
+    struct sockaddr_in addr = {0};
+    socklen_t addr_len = sizeof(addr);
+    int size = 4 << 20;
+
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    rx_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    tx_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (rx_fd < 0 || tx_fd < 0) return false;
+
+    setsockopt(rx_fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    if (bind(rx_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) return false;
+    if (getsockname(rx_fd, (struct sockaddr *) &addr, &addr_len) < 0) return false;
+
+    return connect(tx_fd, (struct sockaddr *) &addr, sizeof(addr)) == 0;
+}
+
+int main(int argc, char **argv) {
+    uint32_t datagrams = 100000;
+    bool copy = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "cn:")) != -1) {
+        switch (opt) {
+            case 'c': copy = true; break;
+            case 'n': datagrams = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-c] [-n datagrams]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (!open_sockets()) {
+        perror("telemetry_bench");
+        return 1;
+    }
+
+    lwip_init();
+
+    ip4_addr_t ip, netmask, gw;
+    IP4_ADDR(&ip, 10, 0, 0, 1);
+    IP4_ADDR(&netmask, 255, 255, 255, 0);
+    IP4_ADDR(&gw, 10, 0, 0, 254);
+    netif_add(&bench_netif, &ip, &netmask, &gw, NULL, bench_netif_init, netif_input);
+    netif_set_default(&bench_netif);
+    netif_set_up(&bench_netif);
+    netif_set_link_up(&bench_netif);
+
+    if (copy) {
+        copy_pcb = udp_new();
+        ipaddr_aton(BENCH_HOST, &copy_addr);
+        telemetry_init(copy_send, NULL, 0);
+    } else if (!telemetry_udp_init(BENCH_HOST, BENCH_PORT, 0)) {
+        printf("telemetry_udp_init failed\n");
+        return 1;
+    }
+
+    // setup is allowed to allocate, the stream isn't
+    allocs = 0;
+    alloc_bytes = 0;
+
+    uint16_t samples[ADC_BLOCK];
+    for (uint32_t i = 0; i < ADC_BLOCK; i++) {
+        samples[i] = i * 40;
+    }
+
+    telemetry_stats_t stats;
+    uint32_t blocks = 0;
+    double start = now_seconds();
+
+    do {
+        telemetry_adc(0, samples, ADC_BLOCK);
+        if (++blocks % COUNT_EVERY == 0) telemetry_count(0, blocks);
+        telemetry_get_stats(&stats);
+    } while (stats.datagrams + stats.send_errors < datagrams);
+    telemetry_flush();
+
+    double elapsed = now_seconds() - start;
+    receive();
+    telemetry_get_stats(&stats);
+
+    printf("%s: %lu datagrams in %.3f s, %.0f datagrams/s, %.1f MB/s payload\n", copy ? "copy" : "zero-copy",
+           (unsigned long) stats.datagrams, elapsed, stats.datagrams / elapsed, stats.bytes / elapsed / 1e6);
+    printf("  allocations: %llu (%.2f per datagram, %llu bytes)\n", (unsigned long long) allocs,
+           (double) allocs / stats.datagrams, (unsigned long long) alloc_bytes);
+    printf("  chained packets: %llu, on the wire %llu bytes\n", (unsigned long long) chained,
+           (unsigned long long) wire_bytes);
+    printf("  dropped %lu, send errors %lu, in flight max %lu\n", (unsigned long) stats.dropped,
+           (unsigned long) stats.send_errors, (unsigned long) stats.busy_max);
+    printf("  received %llu datagrams, %llu of %lu records, %llu lost, %llu bad\n", (unsigned long long) received,
+           (unsigned long long) received_records, (unsigned long) stats.records, (unsigned long long) lost,
+           (unsigned long long) bad);
+
+    bool ok = received == stats.datagrams && received_records == stats.records && !lost && !bad && !stats.send_errors;
+    if (!copy) ok = ok && !allocs && !chained;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,550 @@
+/**
+ * @brief Host check of lib/telemetry, and a receiver for picow_udp
+ *
+ * Runs the batching code against a fake transport that keeps a copy
+ * of every datagram and decodes them all again:
+ *
+ * - every record comes back in order and intact, across datagram
+ *   boundaries, and no datagram is larger than TELEMETRY_PAYLOAD
+ * - datagrams go out once per period, none when there's nothing to
+ *   send, and a stall doesn't turn into a burst
+ * - with every slot held by the transport records are dropped and
+ *   counted, the next header carries the count, releasing recovers
+ * - refused datagrams are counted and their slot reused
+ * - oversized records are refused, trace bytes come back in order,
+ *   malformed datagrams are rejected by telemetry_decode()
+ *
+ * The producer side never allocates, the whole pool is static.
+ *
+ * Usage:
+ *
+ *   telemetry_check              run the checks, exits with 1 on a failure
+ *   telemetry_check -l <port>    print what picow_udp sends, trace records decoded
+ */
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "telemetry.h"
+#include "trace.h"
+
+#define MAX_DATAGRAMS 4096
+#define MAX_RECORDS 65536
+
+typedef struct {
+    uint8_t data[TELEMETRY_PAYLOAD];
+    uint32_t len;
+} datagram_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t len;
+    uint8_t data[TELEMETRY_RECORD_MAX];
+} record_t;
+
+static datagram_t datagrams[MAX_DATAGRAMS];
+static uint32_t datagram_count;
+// hold sent slots instead of releasing them, refuse every datagram
+static bool hold;
+static bool refuse;
+static uint32_t held[TELEMETRY_SLOTS];
+static uint32_t held_count;
+
+static record_t expected[MAX_RECORDS];
+static uint32_t expected_count;
+static uint32_t decoded_count;
+
+static uint32_t failures = 0;
+static uint32_t cases = 0;
+
+static void fail(const char *name, const char *fmt, unsigned long long a, unsigned long long b) {
+    printf("FAIL %s: ", name);
+    printf(fmt, a, b);
+    printf("\n");
+    failures++;
+}
+
+// small LCG, same sequence on every run
+static uint32_t next_random(uint32_t *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+/**
+ * telemetry_send_t: keep a copy, then release, hold or refuse
+ *
+ * @return bool
+ */
+static bool fake_send(uint32_t slot, uint8_t *mem, uint32_t len, void *user) {
+    if (refuse) return false;
+
+    // the transport owns the headroom, scribble over it like lwIP would
+    memset(mem, 0xa5, TELEMETRY_HEADROOM);
+
+    if (datagram_count < MAX_DATAGRAMS && len <= TELEMETRY_PAYLOAD) {
+        memcpy(datagrams[datagram_count].data, mem + TELEMETRY_HEADROOM, len);
+    }
+    datagrams[datagram_count < MAX_DATAGRAMS ? datagram_count : MAX_DATAGRAMS - 1].len = len;
+    datagram_count++;
+
+    if (hold) {
+        held[held_count++] = slot;
+    } else {
+        telemetry_release(slot);
+    }
+    return true;
+}
+
+static void reset(uint32_t period_us) {
+    telemetry_init(fake_send, NULL, period_us);
+    datagram_count = 0;
+    expected_count = 0;
+    decoded_count = 0;
+    hold = false;
+    refuse = false;
+    held_count = 0;
+}
+
+/**
+ * Add a record and remember it, ADC and count records go through
+ * their helpers, the rest through telemetry_put()
+ *
+ * @return bool - false if it was dropped
+ */
+static bool add_record(uint8_t type, const uint8_t *data, uint8_t len) {
+    bool ok;
+
+    if (type == TELEMETRY_TYPE_ADC) {
+        uint16_t samples[TELEMETRY_ADC_MAX];
+        for (uint32_t i = 0; i < (uint32_t) (len - 1) / 2; i++) {
+            samples[i] = data[1 + 2 * i] | (data[2 + 2 * i] << 8);
+        }
+        ok = telemetry_adc(data[0], samples, (len - 1) / 2);
+    } else if (type == TELEMETRY_TYPE_COUNT) {
+        ok = telemetry_count(data[0], data[1] | (data[2] << 8) | (data[3] << 16) | ((uint32_t) data[4] << 24));
+    } else {
+        ok = telemetry_put(type, data, len);
+    }
+
+    if (ok && expected_count < MAX_RECORDS) {
+        expected[expected_count].type = type;
+        expected[expected_count].len = len;
+        memcpy(expected[expected_count].data, data, len);
+        expected_count++;
+    }
+    return ok;
+}
+
+/**
+ * telemetry_record_t: compare with the next expected record
+ *
+ * @return void
+ */
+static void check_record(uint8_t type, const uint8_t *data, uint8_t len, void *user) {
+    const char *name = user;
+
+    if (decoded_count >= expected_count) {
+        if (decoded_count == expected_count) fail(name, "more records than the %llu sent%llu", expected_count, 0);
+        decoded_count++;
+        return;
+    }
+
+    const record_t *r = &expected[decoded_count];
+    if (r->type != type || r->len != len || memcmp(r->data, data, len)) {
+        fail(name, "record %llu differs (type %llu)", decoded_count, type);
+    }
+    decoded_count++;
+}
+
+/**
+ * Decode every captured datagram, check the sequence numbers and the records
+ *
+ * @param name - case name
+ *
+ * @return void
+ */
+static void check_datagrams(const char *name) {
+    telemetry_header_t header;
+
+    for (uint32_t i = 0; i < datagram_count && i < MAX_DATAGRAMS; i++) {
+        if (datagrams[i].len > TELEMETRY_PAYLOAD) {
+            fail(name, "datagram of %llu bytes, payload is %llu", datagrams[i].len, TELEMETRY_PAYLOAD);
+            return;
+        }
+        if (!telemetry_decode(datagrams[i].data, datagrams[i].len, &header, check_record, (void *) name)) {
+            fail(name, "datagram %llu of %llu bytes doesn't decode", i, datagrams[i].len);
+            return;
+        }
+        if (header.seq != i) {
+            fail(name, "sequence number %llu, expected %llu", header.seq, i);
+            return;
+        }
+        if (!header.records) {
+            fail(name, "empty datagram %llu sent%llu", i, 0);
+        }
+    }
+
+    if (decoded_count != expected_count) {
+        fail(name, "%llu records decoded, %llu sent", decoded_count, expected_count);
+    }
+}
+
+/**
+ * Random records of every type and size, polled on a fake clock
+ *
+ * @return void
+ */
+static void check_roundtrip(void) {
+    const char *name = "roundtrip";
+    uint32_t seed = 1;
+    uint8_t data[TELEMETRY_RECORD_MAX];
+    uint32_t now = 0xfff00000u;
+
+    cases++;
+    reset(0);
+
+    for (uint32_t i = 0; i < 20000; i++) {
+        uint32_t kind = next_random(&seed) % 4;
+        uint8_t type;
+        uint32_t len;
+
+        if (kind == 0) {
+            type = TELEMETRY_TYPE_ADC;
+            len = 1 + 2 * (next_random(&seed) % (TELEMETRY_ADC_MAX + 1));
+        } else if (kind == 1) {
+            type = TELEMETRY_TYPE_COUNT;
+            len = 5;
+        } else {
+            type = 0x80 + kind;
+            len = next_random(&seed) % (TELEMETRY_RECORD_MAX + 1);
+        }
+        for (uint32_t j = 0; j < len; j++) {
+            data[j] = next_random(&seed);
+        }
+
+        if (!add_record(type, data, len)) {
+            fail(name, "record %llu of %llu bytes dropped", i, len);
+            return;
+        }
+
+        // the clock wraps around on the way
+        now += next_random(&seed) % 700;
+        telemetry_poll(now);
+    }
+    telemetry_flush();
+
+    check_datagrams(name);
+
+    telemetry_stats_t stats;
+    telemetry_get_stats(&stats);
+    if (stats.records != expected_count || stats.datagrams != datagram_count || stats.dropped) {
+        fail(name, "stats say %llu records, %llu sent", stats.records, expected_count);
+    }
+    printf("roundtrip:    %lu records in %lu datagrams, %.1f bytes per datagram (%.1f%% full)\n",
+           (unsigned long) expected_count, (unsigned long) datagram_count, (double) stats.bytes / stats.datagrams,
+           100.0 * stats.bytes / stats.datagrams / TELEMETRY_PAYLOAD);
+}
+
+/**
+ * A small record every ms, a datagram every period
+ *
+ * @return void
+ */
+static void check_cadence(void) {
+    const char *name = "cadence";
+    const uint32_t period = 20000;
+    telemetry_header_t header;
+    uint32_t now = 1000;
+    uint8_t data[5] = {0};
+
+    cases++;
+    reset(period);
+
+    // the first poll starts the schedule
+    telemetry_poll(now);
+    for (uint32_t ms = 0; ms < 200; ms++) {
+        add_record(TELEMETRY_TYPE_COUNT, data, 5);
+        now += 1000;
+        telemetry_poll(now);
+    }
+    check_datagrams(name);
+
+    if (datagram_count != 10) {
+        fail(name, "%llu datagrams in 200 ms, expected %llu", datagram_count, 10);
+        return;
+    }
+    for (uint32_t i = 0; i < datagram_count; i++) {
+        telemetry_decode(datagrams[i].data, datagrams[i].len, &header, NULL, NULL);
+        if (header.timestamp != 1000 + (i + 1) * period || header.records != 20) {
+            fail(name, "datagram at %llu us with %llu records", header.timestamp, header.records);
+            return;
+        }
+    }
+
+    // nothing to send, nothing sent
+    uint32_t before = datagram_count;
+    for (uint32_t ms = 0; ms < 100; ms++) {
+        now += 1000;
+        telemetry_poll(now);
+    }
+    if (datagram_count != before) {
+        fail(name, "%llu empty datagrams sent%llu", datagram_count - before, 0);
+    }
+
+    // a 100 ms stall sends once, then the schedule starts over from there
+    add_record(TELEMETRY_TYPE_COUNT, data, 5);
+    now += 100000;
+    telemetry_poll(now);
+    uint32_t stalled = now;
+    for (uint32_t ms = 0; ms < 40; ms++) {
+        add_record(TELEMETRY_TYPE_COUNT, data, 5);
+        now += 1000;
+        telemetry_poll(now);
+    }
+    if (datagram_count != before + 3) {
+        fail(name, "%llu datagrams after the stall, expected %llu", datagram_count - before, 3);
+        return;
+    }
+    telemetry_decode(datagrams[before + 1].data, datagrams[before + 1].len, &header, NULL, NULL);
+    if (header.timestamp != stalled + period) {
+        fail(name, "first datagram after the stall at %llu us, expected %llu", header.timestamp, stalled + period);
+    }
+}
+
+/**
+ * The transport keeps every slot, then gives them back
+ *
+ * @return void
+ */
+static void check_in_flight(void) {
+    const char *name = "in flight";
+    uint8_t data[200];
+    telemetry_header_t header;
+
+    cases++;
+    reset(0);
+    hold = true;
+    memset(data, 0x42, sizeof(data));
+
+    // 5 records of 202 bytes fill a datagram, the sixth sends it
+    uint32_t added = 0;
+    uint32_t refused = 0;
+    for (uint32_t i = 0; i < 6 * TELEMETRY_SLOTS; i++) {
+        if (add_record(0x90, data, sizeof(data))) {
+            added++;
+        } else {
+            refused++;
+        }
+    }
+
+    telemetry_stats_t stats;
+    telemetry_get_stats(&stats);
+    if (datagram_count != TELEMETRY_SLOTS || stats.busy_max != TELEMETRY_SLOTS) {
+        fail(name, "%llu datagrams in flight, expected %llu", datagram_count, TELEMETRY_SLOTS);
+        return;
+    }
+    if (!refused || stats.dropped != refused) {
+        fail(name, "%llu dropped, stats say %llu", refused, stats.dropped);
+        return;
+    }
+
+    // slots come back, the next datagram reports the drops
+    hold = false;
+    for (uint32_t i = 0; i < held_count; i++) {
+        telemetry_release(held[i]);
+    }
+    if (!add_record(0x90, data, sizeof(data))) {
+        fail(name, "still dropping after the release%llu%llu", 0, 0);
+        return;
+    }
+    telemetry_flush();
+    check_datagrams(name);
+
+    telemetry_decode(datagrams[datagram_count - 1].data, datagrams[datagram_count - 1].len, &header, NULL, NULL);
+    if (header.dropped != refused) {
+        fail(name, "header says %llu dropped, expected %llu", header.dropped, refused);
+    }
+}
+
+/**
+ * The transport refuses everything, nothing may get stuck
+ *
+ * @return void
+ */
+static void check_refused(void) {
+    const char *name = "refused";
+    uint8_t data[200] = {0};
+
+    cases++;
+    reset(0);
+    refuse = true;
+
+    for (uint32_t i = 0; i < 10 * 6 * TELEMETRY_SLOTS; i++) {
+        if (!telemetry_put(0x90, data, sizeof(data))) {
+            fail(name, "record %llu dropped with free slots%llu", i, 0);
+            return;
+        }
+    }
+
+    telemetry_stats_t stats;
+    telemetry_get_stats(&stats);
+    if (!stats.send_errors || stats.datagrams || stats.dropped) {
+        fail(name, "%llu send errors, %llu datagrams", stats.send_errors, stats.datagrams);
+    }
+}
+
+/**
+ * Limits, trace chunks and malformed datagrams
+ *
+ * @return void
+ */
+static void check_edges(void) {
+    const char *name = "edges";
+    static uint8_t trace_bytes[600];
+    uint16_t samples[TELEMETRY_ADC_MAX + 1] = {0};
+    telemetry_header_t header;
+
+    cases++;
+    reset(0);
+
+    if (telemetry_reserve(0x90, TELEMETRY_RECORD_MAX + 1) || telemetry_adc(0, samples, TELEMETRY_ADC_MAX + 1)) {
+        fail(name, "accepted a record over %llu bytes%llu", TELEMETRY_RECORD_MAX, 0);
+    }
+    // an empty record is fine
+    if (!add_record(0x90, NULL, 0)) {
+        fail(name, "empty record dropped%llu%llu", 0, 0);
+    }
+
+    // trace bytes split into records of at most TELEMETRY_RECORD_MAX, in order
+    for (uint32_t i = 0; i < sizeof(trace_bytes); i++) {
+        trace_bytes[i] = i * 7;
+    }
+    telemetry_trace_write(trace_bytes, sizeof(trace_bytes), NULL);
+    for (uint32_t pos = 0; pos < sizeof(trace_bytes); pos += TELEMETRY_RECORD_MAX) {
+        uint32_t len = sizeof(trace_bytes) - pos;
+        len = len > TELEMETRY_RECORD_MAX ? TELEMETRY_RECORD_MAX : len;
+        memcpy(expected[expected_count].data, trace_bytes + pos, len);
+        expected[expected_count].type = TELEMETRY_TYPE_TRACE;
+        expected[expected_count].len = len;
+        expected_count++;
+    }
+    telemetry_flush();
+    check_datagrams(name);
+
+    // malformed: short, bad magic, a record running past the end, bytes left over
+    datagram_t *d = &datagrams[0];
+    if (telemetry_decode(d->data, TELEMETRY_HEADER_SIZE - 1, &header, NULL, NULL) ||
+        telemetry_decode(d->data, d->len - 1, &header, NULL, NULL) ||
+        telemetry_decode(d->data + 1, d->len - 1, &header, NULL, NULL)) {
+        fail(name, "malformed datagram of %llu bytes accepted%llu", d->len - 1, 0);
+    }
+    d->data[d->len] = 0;
+    if (telemetry_decode(d->data, d->len + 1, &header, NULL, NULL)) {
+        fail(name, "datagram with %llu trailing byte accepted%llu", 1, 0);
+    }
+}
+
+// listen mode, what picow_udp sends
+static trace_decoder_t trace_decoder;
+
+static void print_trace_line(const char *line, void *user) {
+    printf("trace  %s\n", line);
+}
+
+static void print_record(uint8_t type, const uint8_t *data, uint8_t len, void *user) {
+    if (type == TELEMETRY_TYPE_ADC && len >= 1) {
+        uint32_t count = (len - 1) / 2;
+        uint32_t min = 0xffff, max = 0, sum = 0;
+
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t sample = data[1 + 2 * i] | (data[2 + 2 * i] << 8);
+            min = sample < min ? sample : min;
+            max = sample > max ? sample : max;
+            sum += sample;
+        }
+        printf("adc    channel %u, %u samples, min %u, max %u, mean %u\n", data[0], count, count ? min : 0, max,
+               count ? sum / count : 0);
+    } else if (type == TELEMETRY_TYPE_COUNT && len == 5) {
+        printf("count  channel %u, %u\n", data[0], data[1] | (data[2] << 8) | (data[3] << 16) | ((uint32_t) data[4] << 24));
+    } else if (type == TELEMETRY_TYPE_TRACE) {
+        trace_decoder_feed(&trace_decoder, data, len, print_trace_line, NULL);
+    } else {
+        printf("type   0x%02x, %u bytes\n", type, len);
+    }
+}
+
+/**
+ * Receive and print datagrams until killed
+ *
+ * @param port
+ *
+ * @return int
+ */
+static int listen_udp(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    if (fd < 0 || bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        perror("telemetry_check");
+        return 1;
+    }
+
+    trace_decoder_init(&trace_decoder);
+    printf("listening on udp port %u\n", port);
+
+    uint8_t buffer[2048];
+    uint32_t expected_seq = 0;
+    uint32_t lost = 0;
+    bool first = true;
+
+    while (true) {
+        ssize_t len = recv(fd, buffer, sizeof(buffer), 0);
+        if (len < 0) break;
+
+        telemetry_header_t header;
+        if (!telemetry_decode(buffer, len, &header, NULL, NULL)) {
+            printf("bad datagram of %zd bytes\n", len);
+            continue;
+        }
+        if (!first && header.seq != expected_seq) lost += header.seq - expected_seq;
+        first = false;
+        expected_seq = header.seq + 1;
+
+        printf("-- seq %u at %u us, %u records, %zd bytes, %u dropped on the board, %u lost\n", header.seq,
+               header.timestamp, header.records, len, header.dropped, lost);
+        telemetry_decode(buffer, len, &header, print_record, NULL);
+        fflush(stdout);
+    }
+
+    trace_decoder_free(&trace_decoder);
+    close(fd);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "l:")) != -1) {
+        switch (opt) {
+            case 'l': return listen_udp(strtoul(optarg, NULL, 0));
+            default:
+                fprintf(stderr, "usage: %s [-l port]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    check_roundtrip();
+    check_cadence();
+    check_in_flight();
+    check_refused();
+    check_edges();
+
+    printf("telemetry_check: %u cases, %u failures\n", cases, failures);
+    return failures ? 1 : 0;
+}
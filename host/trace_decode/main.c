@@ -0,0 +1,315 @@
+/**
+ * @brief Host decoder for lib/trace
+ *
+ * Turns the binary trace frames from the board back into text,
+ * printf() output in between is passed through.
+ *
+ * Usage:
+ *
+ *   trace_decode [device|file]     decode, stdin if none is given
+ *   trace_decode selftest          check the logger, flusher and decoder
+ *
+ * The selftest logs from two threads standing in for the two cores,
+ * flushes on the main thread straight into the decoder and checks
+ * every record arrives once, in order per core, or is counted as
+ * dropped. It also times the TRACE() call.
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "trace.h"
+
+// records per core in the threaded test
+#define SELFTEST_RECORDS 200000
+
+static int failures = 0;
+
+static void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static void print_line(const char *line, void *user) {
+    puts(line);
+}
+
+static double now_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Decode a device or file until it ends
+ *
+ * @param path - NULL for stdin
+ *
+ * @return int - exit code
+ */
+static int decode(const char *path) {
+    int fd = path ? open(path, O_RDONLY | O_NOCTTY) : STDIN_FILENO;
+    if (fd < 0) {
+        perror(path);
+        return 1;
+    }
+
+    // a serial port has to pass every byte through untouched
+    struct termios tio;
+    if (isatty(fd) && tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    trace_decoder_t *decoder = malloc(sizeof(trace_decoder_t));
+    trace_decoder_init(decoder);
+
+    uint8_t buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        trace_decoder_feed(decoder, buf, n, print_line, NULL);
+        fflush(stdout);
+    }
+    // end whatever text is left like a delimiter would
+    trace_decoder_feed(decoder, (const uint8_t *) "", 1, print_line, NULL);
+
+    fprintf(stderr, "%u records, %u dropped, %u bad frames\n", decoder->records, decoder->dropped, decoder->errors);
+    trace_decoder_free(decoder);
+    free(decoder);
+    return 0;
+}
+
+//
+// selftest
+//
+
+// collected decoder output
+typedef struct {
+    char lines[16][160];
+    int count;
+} lines_t;
+
+static void collect_line(const char *line, void *user) {
+    lines_t *lines = user;
+    if (lines->count < 16) {
+        snprintf(lines->lines[lines->count], sizeof(lines->lines[0]), "%s", line);
+    }
+    lines->count++;
+}
+
+typedef struct {
+    trace_decoder_t decoder;
+    lines_t lines;
+} text_test_t;
+
+static void feed_text_test(const uint8_t *data, size_t len, void *user) {
+    text_test_t *state = user;
+    trace_decoder_feed(&state->decoder, data, len, collect_line, &state->lines);
+}
+
+/**
+ * Compare trace_format() against snprintf() for one format
+ *
+ * @return void
+ */
+static void check_format(const char *format, const char *expected, uint32_t nargs, uint32_t a0, uint32_t a1) {
+    char out[128];
+    uint32_t args[2] = {a0, a1};
+
+    trace_format(out, sizeof(out), format, args, nargs);
+    if (strcmp(out, expected)) {
+        printf("FAIL: format \"%s\" gave \"%s\", expected \"%s\"\n", format, out, expected);
+        failures++;
+    }
+}
+
+static void selftest_format(void) {
+    check_format("plain", "plain", 0, 0, 0);
+    check_format("%d %u", "-5 4294967291", 2, -5, -5);
+    check_format("%lu hz", "1000 hz", 1, 1000, 0);
+    check_format("%08lx|%-4d|", "0000beef|7   |", 2, 0xbeef, 7);
+    check_format("%c%c", "ok", 2, 'o', 'k');
+    check_format("100%% %s", "100% <str>", 0, 0, 0);
+    check_format("%d %d", "1 <?>", 1, 1, 0);
+    check_format("%p", "0x20001000", 1, 0x20001000, 0);
+    check_format("%f", "%f", 1, 0, 0);
+}
+
+static void selftest_text(void) {
+    text_test_t *state = calloc(1, sizeof(text_test_t));
+    const char *text = "hello from printf\r\n";
+
+    trace_decoder_init(&state->decoder);
+    trace_init();
+    trace_host_set_core(1);
+
+    trace_decoder_feed(&state->decoder, (const uint8_t *) text, strlen(text), collect_line, &state->lines);
+    TRACE("level %u of %u", 3, 32);
+    trace_flush(feed_text_test, state);
+    text = "tail\n";
+    trace_decoder_feed(&state->decoder, (const uint8_t *) text, strlen(text), collect_line, &state->lines);
+    // a delimiter ends the text like the next flush would
+    trace_decoder_feed(&state->decoder, (const uint8_t *) "", 1, collect_line, &state->lines);
+
+    check(state->lines.count == 3, "text + record + text gives 3 lines");
+    check(!strcmp(state->lines.lines[0], "hello from printf"), "text before the frames passed through");
+    check(strstr(state->lines.lines[1], "c1 level 3 of 32") != NULL, "record decoded with its core");
+    check(!strcmp(state->lines.lines[2], "tail"), "text after the frames passed through");
+
+    // corrupt frame is counted, not printed as a record
+    uint8_t bad[] = {0, 0x05, 0x01, 0x02, 0x03, 0x04, 0};
+    uint32_t records = state->decoder.records;
+    trace_decoder_feed(&state->decoder, bad, sizeof(bad), collect_line, &state->lines);
+    check(state->decoder.records == records, "corrupt frame rejected");
+
+    trace_decoder_free(&state->decoder);
+    free(state);
+}
+
+// threaded test state
+static atomic_int running;
+
+static void *selftest_core(void *arg) {
+    uint32_t core = (uint32_t) (uintptr_t) arg;
+    trace_host_set_core(core);
+
+    for (uint32_t i = 0; i < SELFTEST_RECORDS; i++) {
+        TRACE("seq %u", i);
+        // let the flusher keep up most of the time
+        if ((i & 63) == 63) sched_yield();
+    }
+
+    atomic_fetch_sub(&running, 1);
+    return NULL;
+}
+
+typedef struct {
+    uint32_t next[TRACE_CORES];
+    uint32_t received[TRACE_CORES];
+    uint32_t dropped[TRACE_CORES];
+    uint32_t out_of_order;
+} sequence_t;
+
+static void check_sequence(const char *line, void *user) {
+    sequence_t *seq = user;
+    unsigned core, value, count;
+
+    if (sscanf(line, "[trace] core %u dropped %u", &core, &count) == 2 && core < TRACE_CORES) {
+        seq->dropped[core] += count;
+        return;
+    }
+
+    const char *body = strchr(line, ']');
+    if (!body || sscanf(body, "] c%u seq %u", &core, &value) != 2 || core >= TRACE_CORES) {
+        seq->out_of_order++;
+        return;
+    }
+
+    // drops leave gaps, but never go backwards
+    if (value < seq->next[core]) seq->out_of_order++;
+    seq->next[core] = value + 1;
+    seq->received[core]++;
+}
+
+static void feed_sequence(const uint8_t *data, size_t len, void *user) {
+    void **state = user;
+    trace_decoder_feed(state[0], data, len, check_sequence, state[1]);
+}
+
+static void selftest_threads(void) {
+    trace_decoder_t *decoder = malloc(sizeof(trace_decoder_t));
+    sequence_t seq = {0};
+    void *state[2] = {decoder, &seq};
+    pthread_t threads[TRACE_CORES];
+
+    trace_decoder_init(decoder);
+    trace_init();
+    atomic_store(&running, TRACE_CORES);
+
+    for (uint32_t core = 0; core < TRACE_CORES; core++) {
+        pthread_create(&threads[core], NULL, selftest_core, (void *) (uintptr_t) core);
+    }
+
+    // flush until both are done and the rings are empty
+    bool busy;
+    size_t flushed;
+    do {
+        busy = atomic_load(&running) > 0;
+        flushed = trace_flush(feed_sequence, state);
+    } while (busy || flushed);
+
+    for (uint32_t core = 0; core < TRACE_CORES; core++) {
+        pthread_join(threads[core], NULL);
+    }
+    trace_flush(feed_sequence, state);
+
+    for (uint32_t core = 0; core < TRACE_CORES; core++) {
+        printf("core %u: %u received, %u dropped\n", core, seq.received[core], seq.dropped[core]);
+        check(seq.received[core] + seq.dropped[core] == SELFTEST_RECORDS, "every record received or counted as dropped");
+        check(seq.dropped[core] == trace_get_dropped(core), "decoder saw every drop");
+    }
+    check(seq.out_of_order == 0, "records in order per core");
+    check(decoder->errors == 0, "no bad frames");
+
+    trace_decoder_free(decoder);
+    free(decoder);
+}
+
+static void discard(const uint8_t *data, size_t len, void *user) {
+}
+
+static void selftest_timing(void) {
+    const uint32_t rounds = 1000000;
+
+    trace_init();
+    trace_host_set_core(0);
+
+    double start = now_seconds();
+    for (uint32_t i = 0; i < rounds; i++) {
+        TRACE("value %u", i);
+        if ((i & 63) == 63) trace_flush(discard, NULL);
+    }
+    double with_flush = now_seconds() - start;
+
+    start = now_seconds();
+    for (uint32_t i = 0; i < rounds; i++) {
+        TRACE("value %u", i);
+        // empty the ring without sending anything
+        if ((i & 63) == 63) trace_init();
+    }
+    double log_only = now_seconds() - start;
+
+    printf("TRACE(): %.1f ns per call, %.1f ns with the flush\n", log_only * 1e9 / rounds, with_flush * 1e9 / rounds);
+}
+
+static int selftest(void) {
+    selftest_format();
+    selftest_text();
+    selftest_threads();
+    selftest_timing();
+
+    printf("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && !strcmp(argv[1], "selftest")) {
+        return selftest();
+    }
+
+    if (argc > 2 || (argc == 2 && argv[1][0] == '-')) {
+        fprintf(stderr, "usage: %s [device|file] | selftest\n", argv[0]);
+        return 1;
+    }
+
+    return decode(argc == 2 ? argv[1] : NULL);
+}
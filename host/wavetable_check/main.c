@@ -0,0 +1,190 @@
+/**
+ * @brief Host check of the compile-time wavetables
+ *
+ * Expands the FADE() and WAVETABLE_LEVEL() macros of picow_dma,
+ * picow_dma_pwm and picow_dma_pio through lib/wavetable, the same way
+ * their main.c do, and compares the tables word for word against the
+ * loops that used to fill them at boot or in dma_handler(). Also
+ * checks that the ring buffers land on their ring size.
+ *
+ * Usage:
+ *
+ *   wavetable_check [-v]
+ *
+ * Exits with 1 if any check fails.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "pico/stdlib.h"
+#include "pwm_solver.h"
+#include "pwm_dma.h"
+#include "wavetable.h"
+#include "fade_curve.h"
+#include "pwm_levels.h"
+
+static bool verbose = false;
+static unsigned int checks = 0;
+static unsigned int failures = 0;
+
+static void check(bool ok, const char *name, long got, long expected) {
+    checks++;
+    if (!ok) {
+        printf("FAIL %s: got %ld, expected %ld\n", name, got, expected);
+        failures++;
+    } else if (verbose) {
+        printf("ok   %s: %ld\n", name, got);
+    }
+}
+
+/**
+ * Compare two tables, report the first differing index
+ *
+ * @param name
+ * @param table - from the macros
+ * @param loop - from the old loop
+ * @param length
+ *
+ * @return void
+ */
+static void check_table(const char *name, const uint32_t *table, const uint32_t *loop, uint length) {
+    uint i = 0;
+
+    while (i < length && table[i] == loop[i]) i++;
+    if (i < length) {
+        printf("FAIL %s: [%u] = %lu, the loop gave %lu\n", name, i, (unsigned long) table[i],
+               (unsigned long) loop[i]);
+        checks++;
+        failures++;
+        return;
+    }
+    check(true, name, length, length);
+}
+
+static void check_aligned(const char *name, const void *table, uint ring_bits) {
+    uintptr_t offset = (uintptr_t) table & ((1u << ring_bits) - 1);
+    check(offset == 0, name, offset, 0);
+}
+
+//
+// picow_dma, the quadratic float fade
+//
+
+// the original loop only ever had the full 16-bit wrap
+#define PWM_WRAP 65535
+
+static uint32_t dma_fade[2][FADE_STEPS] WAVETABLE_RING_ALIGNED(FADE_RING_BITS) = {
+    { WAVETABLE_REPEAT_256(FADE) },
+};
+
+static void check_dma(void) {
+    uint32_t fade[256];
+
+    // the loop main() ran before starting the DMA
+    for(int i = 0; i < 256; i++) {
+        float scale = 65535.0f / (255.0f * 255.0f);
+        fade[i] = (uint32_t)(i * i * scale);
+    }
+    check_table("picow_dma fade", dma_fade[0], fade, 256);
+
+    // the wrap the firmware solves for its carrier, same loop with that scale
+    uint32_t wrap = PWM_SOLVE_WRAP(SYS_CLK_KHZ * 1000, PWM_HZ(240));
+    for(int i = 0; i < 256; i++) {
+        float scale = (float) wrap / (255.0f * 255.0f);
+        fade[i] = (uint32_t)(i * i * scale);
+    }
+#undef PWM_WRAP
+#define PWM_WRAP wrap
+    uint32_t solved[FADE_STEPS];
+    for(int i = 0; i < FADE_STEPS; i++) solved[i] = FADE(i);
+    check_table("picow_dma fade at the solved wrap", solved, fade, 256);
+    // float truncation can land one below the wrap, never above it
+    check(solved[FADE_STEPS - 1] <= wrap && solved[FADE_STEPS - 1] + 1 >= wrap, "picow_dma fade peaks at the wrap",
+          solved[FADE_STEPS - 1], wrap);
+
+    check_aligned("picow_dma fade_buffers[0] ring", dma_fade[0], FADE_RING_BITS);
+    check_aligned("picow_dma fade_buffers[1] ring", dma_fade[1], FADE_RING_BITS);
+}
+
+//
+// picow_dma_pwm, the fade_a/fade_b fill
+//
+
+#undef FADE
+#include "fade_cycle.h"
+
+static const uint16_t pwm_fade[512] = { WAVETABLE_REPEAT_512(FADE) };
+
+PWM_DMA_FRAMES(pwm_frames, 8, 512);
+
+static void check_dma_pwm(void) {
+    // one spare word: the loop wrote fade_a[512 - 0], one past the end
+    uint32_t fade_a[513] __attribute__((aligned(2048)));
+    uint32_t fade_b[513] __attribute__((aligned(2048)));
+    uint32_t table_a[512];
+    uint32_t table_b[512];
+
+    for(int i = 0; i <= 256; i++) {
+        uint32_t fade = i * i;
+
+        fade = fade > 65535 ? 65535 : fade;
+
+        fade_a[i] = fade;
+        fade_a[512 - i] = fade;
+
+        fade_b[i] = fade << 16u;
+        fade_b[512 - i] = fade << 16u;
+    }
+
+    fade_a[511] = 0;
+    fade_b[511] = 0;
+
+    // the engine puts channel a in the low half of the CC word, b in the high half
+    for(int i = 0; i < 512; i++) {
+        table_a[i] = pwm_fade[i];
+        table_b[i] = (uint32_t) pwm_fade[i] << 16u;
+    }
+    check_table("picow_dma_pwm fade_a", table_a, fade_a, 512);
+    check_table("picow_dma_pwm fade_b", table_b, fade_b, 512);
+
+    // 8 slices * 512 steps * 4 bytes, read through a 2^14 byte ring
+    check(sizeof(pwm_frames) == (1u << 14), "picow_dma_pwm frames size", sizeof(pwm_frames), 1u << 14);
+    check_aligned("picow_dma_pwm frames ring", pwm_frames, 14);
+}
+
+//
+// picow_dma_pio, the wavetable dma_handler() built on its first call
+//
+
+static const uint32_t pio_wavetable[32] = { WAVETABLE_REPEAT_32(WAVETABLE_LEVEL) };
+
+static void check_dma_pio(void) {
+    uint32_t wavetable[32];
+
+    for(int i = 0; i < 32; i++) {
+        wavetable[i] = ~(~0u << i);
+    }
+    check_table("picow_dma_pio wavetable", pio_wavetable, wavetable, 32);
+}
+
+int main(int argc, char **argv) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "v")) != -1) {
+        switch (opt) {
+            case 'v': verbose = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    check_dma();
+    check_dma_pwm();
+    check_dma_pio();
+
+    printf("wavetable_check: %u checks, %u failures\n", checks, failures);
+    return failures ? 1 : 0;
+}
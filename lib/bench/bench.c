@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+
+#if !PICO_ON_DEVICE
+#include <time.h>
+#endif
+
+// samples of the case being run
+static uint32_t samples[BENCH_REPS_MAX];
+
+#if !PICO_ON_DEVICE
+/**
+ * Host stand-in for SysTick, counts nanoseconds
+ *
+ * @return uint32_t
+ */
+uint32_t bench_host_cycles(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t) (now.tv_sec * 1000000000ull + now.tv_nsec);
+}
+#endif
+
+static uint32_t empty_run(void) {
+    return 0;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *) a;
+    uint32_t y = *(const uint32_t *) b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Initialize the harness and start the cycle counter
+ *
+ * @param bench
+ * @param warmup - untimed calls before the samples
+ * @param reps - samples per case, at most BENCH_REPS_MAX
+ *
+ * @return void
+ */
+void bench_init(bench_t *bench, uint32_t warmup, uint32_t reps) {
+    bench->warmup = warmup;
+    bench->reps = reps < 1 ? 1 : reps > BENCH_REPS_MAX ? BENCH_REPS_MAX : reps;
+    bench->overhead = 0;
+
+#if PICO_ON_DEVICE
+    // free-running, processor clock, no interrupt
+    systick_hw->rvr = 0xffffff;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5;
+#endif
+}
+
+/**
+ * Measure an empty call, taken off every sample from here on
+ *
+ * @param bench
+ *
+ * @return void
+ */
+void bench_calibrate(bench_t *bench) {
+    const bench_case_t empty = {"empty", NULL, empty_run, NULL, 1, 0};
+    bench_result_t result;
+
+    bench->overhead = 0;
+    bench_run(bench, &empty, &result);
+    bench->overhead = result.min;
+}
+
+/**
+ * Run one case: setup, warm-up, samples, teardown
+ *
+ * @param bench
+ * @param bench_case
+ * @param result - receives the statistics, cycles per call
+ *
+ * @return bool - false if the case has no run function
+ */
+bool bench_run(bench_t *bench, const bench_case_t *bench_case, bench_result_t *result) {
+    if (!bench_case->run) return false;
+
+    if (bench_case->setup) bench_case->setup();
+
+    for (uint32_t i = 0; i < bench->warmup; i++) {
+        bench_case->run();
+    }
+
+#if PICO_ON_DEVICE
+    bool irqs = bench_case->flags & BENCH_IRQS;
+#endif
+    bool self_timed = bench_case->flags & BENCH_SELF_TIMED;
+    uint64_t total = 0;
+
+    for (uint32_t i = 0; i < bench->reps; i++) {
+#if PICO_ON_DEVICE
+        uint32_t save = irqs ? 0 : save_and_disable_interrupts();
+#endif
+        uint32_t start = bench_cycles();
+        uint32_t cycles = bench_case->run();
+        uint32_t end = bench_cycles();
+#if PICO_ON_DEVICE
+        if (!irqs) restore_interrupts(save);
+#endif
+
+        if (!self_timed) {
+            cycles = bench_elapsed(start, end);
+            cycles = cycles > bench->overhead ? cycles - bench->overhead : 0;
+        }
+
+        samples[i] = cycles;
+        total += cycles;
+    }
+
+    if (bench_case->teardown) bench_case->teardown();
+
+    qsort(samples, bench->reps, sizeof(uint32_t), compare_u32);
+
+    snprintf(result->name, sizeof(result->name), "%s", bench_case->name);
+    result->ops = bench_case->ops ? bench_case->ops : 1;
+    result->reps = bench->reps;
+    result->min = samples[0];
+    result->median = samples[bench->reps / 2];
+    result->p99 = samples[(bench->reps * 99) / 100];
+    result->mean = total / bench->reps;
+
+    return true;
+}
+
+/**
+ * Calibrate and run every case, printing a result line each
+ *
+ * @param bench
+ * @param cases
+ * @param count - number of cases
+ * @param clk_hz - CPU clock, printed so results can be turned into time
+ *
+ * @return void
+ */
+void bench_run_all(bench_t *bench, const bench_case_t *cases, size_t count, uint32_t clk_hz) {
+    char line[BENCH_LINE_MAX];
+    bench_result_t result;
+
+    bench_calibrate(bench);
+    printf("bench-begin clk=%lu overhead=%lu\n", (unsigned long) clk_hz, (unsigned long) bench->overhead);
+
+    for (size_t i = 0; i < count; i++) {
+        if (!bench_run(bench, &cases[i], &result)) continue;
+        bench_format(line, sizeof(line), &result);
+        printf("%s\n", line);
+    }
+
+    printf("bench-end\n");
+}
+
+/**
+ * Format a result line, without the newline
+ *
+ * @param out
+ * @param size
+ * @param result
+ *
+ * @return size_t - length of the line
+ */
+size_t bench_format(char *out, size_t size, const bench_result_t *result) {
+    int len = snprintf(out, size, "bench %s ops=%lu reps=%lu min=%lu median=%lu p99=%lu mean=%lu",
+                       result->name, (unsigned long) result->ops, (unsigned long) result->reps,
+                       (unsigned long) result->min, (unsigned long) result->median,
+                       (unsigned long) result->p99, (unsigned long) result->mean);
+    return len < 0 ? 0 : (size_t) len;
+}
+
+/**
+ * Parse a result line, anything else on the port is ignored
+ *
+ * @param line
+ * @param result
+ *
+ * @return bool - false if it isn't a result line
+ */
+bool bench_parse(const char *line, bench_result_t *result) {
+    unsigned long ops, reps, min, median, p99, mean;
+    char name[BENCH_NAME_MAX];
+
+    if (sscanf(line, "bench %31s ops=%lu reps=%lu min=%lu median=%lu p99=%lu mean=%lu",
+               name, &ops, &reps, &min, &median, &p99, &mean) != 7) {
+        return false;
+    }
+
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    result->ops = ops;
+    result->reps = reps;
+    result->min = min;
+    result->median = median;
+    result->p99 = p99;
+    result->mean = mean;
+
+    return true;
+}
@@ -0,0 +1,124 @@
+/**
+ * @brief On-target micro-benchmark harness
+ *
+ * Times registered cases in CPU cycles and prints one result line
+ * per case, host/bench_runner parses them and compares runs.
+ *
+ * How it works:
+ *
+ * - SysTick runs free at the CPU clock, a sample is the difference of
+ *   two reads (24 bits, ~130 ms at 125 MHz is plenty)
+ * - each case does `ops` operations per call, unrolled where it can,
+ *   so the loop and call overhead is spread thin, and the cost of
+ *   an empty call (calibrated first) is taken off every sample
+ * - `warmup` calls fill the XIP cache and settle the branch targets,
+ *   then `reps` samples are sorted for min, median and p99
+ * - interrupts are off while a sample runs unless the case asks for
+ *   them (BENCH_IRQS), USB stdio otherwise lands in the numbers
+ * - BENCH_SELF_TIMED cases return their own cycle count, for things
+ *   like IRQ entry where the end of the sample isn't the return
+ *
+ * Result line, one per case:
+ *
+ *   bench <name> ops=<n> reps=<n> min=<c> median=<c> p99=<c> mean=<c>
+ *
+ * cycles per call after the overhead, divide by ops for one operation.
+ * A run starts with "bench-begin clk=<hz>" and ends with "bench-end".
+ *
+ * Plain C, on the host the clock is clock_gettime() in ns, so the
+ * same code runs the host self-test of bench_runner.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if PICO_ON_DEVICE
+#include "hardware/structs/systick.h"
+#include "hardware/sync.h"
+#endif
+
+#define BENCH_NAME_MAX 32
+// longest result line
+#define BENCH_LINE_MAX 160
+// most samples a case can ask for
+#define BENCH_REPS_MAX 1024
+
+// case flags
+#define BENCH_IRQS (1u << 0)        // leave interrupts on while sampling
+#define BENCH_SELF_TIMED (1u << 1)  // run() returns the cycles itself
+
+typedef struct {
+    const char *name;
+    // once before the warm-up, may be NULL
+    void (*setup)(void);
+    // one sample, ops operations, returns cycles if BENCH_SELF_TIMED
+    uint32_t (*run)(void);
+    // once after the last sample, may be NULL
+    void (*teardown)(void);
+    uint32_t ops;
+    uint32_t flags;
+} bench_case_t;
+
+typedef struct {
+    char name[BENCH_NAME_MAX];
+    uint32_t ops;
+    uint32_t reps;
+    uint32_t min;
+    uint32_t median;
+    uint32_t p99;
+    uint32_t mean;
+} bench_result_t;
+
+typedef struct {
+    uint32_t warmup;
+    uint32_t reps;
+    // cycles of an empty call, set by bench_calibrate()
+    uint32_t overhead;
+} bench_t;
+
+#if !PICO_ON_DEVICE
+uint32_t bench_host_cycles(void);
+#endif
+
+/**
+ * Read the cycle counter, counts up
+ *
+ * SysTick counts down, so it's negated, only the low 24 bits of a
+ * difference are valid, see bench_elapsed().
+ *
+ * @return uint32_t
+ */
+static inline uint32_t bench_cycles(void) {
+#if PICO_ON_DEVICE
+    return -systick_hw->cvr;
+#else
+    return bench_host_cycles();
+#endif
+}
+
+/**
+ * Get the cycles between two bench_cycles() reads
+ *
+ * @param start
+ * @param end
+ *
+ * @return uint32_t
+ */
+static inline uint32_t bench_elapsed(uint32_t start, uint32_t end) {
+#if PICO_ON_DEVICE
+    return (end - start) & 0xffffff;
+#else
+    return end - start;
+#endif
+}
+
+void bench_init(bench_t *bench, uint32_t warmup, uint32_t reps);
+void bench_calibrate(bench_t *bench);
+bool bench_run(bench_t *bench, const bench_case_t *bench_case, bench_result_t *result);
+void bench_run_all(bench_t *bench, const bench_case_t *cases, size_t count, uint32_t clk_hz);
+
+size_t bench_format(char *out, size_t size, const bench_result_t *result);
+bool bench_parse(const char *line, bench_result_t *result);
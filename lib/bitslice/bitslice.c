@@ -0,0 +1,149 @@
+#include "bitslice.h"
+
+#if PICO_ON_DEVICE
+#include "pico.h"
+// runs from RAM, so it doesn't wait on flash behind the other core
+#define BITSLICE_FUNC(name) __not_in_flash_func(name)
+#else
+#define BITSLICE_FUNC(name) name
+#endif
+
+// bits of a word whose column has bit j clear, for j = 1, 2, 4, 8, 16
+static const uint32_t masks[5] = {0x55555555, 0x33333333, 0x0f0f0f0f, 0x00ff00ff, 0x0000ffff};
+
+// swap the bits of a with column bit j set and the bits of b with it clear
+#define SWAP(a, b, j, m)                         \
+    do {                                         \
+        uint32_t t = (((a) >> (j)) ^ (b)) & (m); \
+        (b) ^= t;                                \
+        (a) ^= t << (j);                         \
+    } while (0)
+
+/**
+ * Transpose 8 pins, 4 steps per output word
+ *
+ * @param channels - channel p's word at channels[p * stride]
+ * @param stride - words between two channels
+ * @param out - receives 8 words
+ *
+ * @return void
+ */
+void BITSLICE_FUNC(bitslice_transpose8)(const uint32_t *channels, uint32_t stride, uint32_t *out) {
+    uint32_t a0 = channels[0];
+    uint32_t a1 = channels[stride];
+    uint32_t a2 = channels[2 * stride];
+    uint32_t a3 = channels[3 * stride];
+    uint32_t a4 = channels[4 * stride];
+    uint32_t a5 = channels[5 * stride];
+    uint32_t a6 = channels[6 * stride];
+    uint32_t a7 = channels[7 * stride];
+
+    // transpose the four 8 x 8 blocks, byte l of a_r is then step 8l + r
+    SWAP(a0, a4, 4, 0x0f0f0f0f);
+    SWAP(a1, a5, 4, 0x0f0f0f0f);
+    SWAP(a2, a6, 4, 0x0f0f0f0f);
+    SWAP(a3, a7, 4, 0x0f0f0f0f);
+    SWAP(a0, a2, 2, 0x33333333);
+    SWAP(a1, a3, 2, 0x33333333);
+    SWAP(a4, a6, 2, 0x33333333);
+    SWAP(a5, a7, 2, 0x33333333);
+    SWAP(a0, a1, 1, 0x55555555);
+    SWAP(a2, a3, 1, 0x55555555);
+    SWAP(a4, a5, 1, 0x55555555);
+    SWAP(a6, a7, 1, 0x55555555);
+
+    // a 4 x 4 byte transpose of each half puts steps 8l .. 8l + 3 in a_l
+    SWAP(a0, a2, 16, 0x0000ffff);
+    SWAP(a1, a3, 16, 0x0000ffff);
+    SWAP(a0, a1, 8, 0x00ff00ff);
+    SWAP(a2, a3, 8, 0x00ff00ff);
+    SWAP(a4, a6, 16, 0x0000ffff);
+    SWAP(a5, a7, 16, 0x0000ffff);
+    SWAP(a4, a5, 8, 0x00ff00ff);
+    SWAP(a6, a7, 8, 0x00ff00ff);
+
+    // and 8l + 4 .. 8l + 7 in a_(l + 4)
+    out[0] = a0;
+    out[1] = a4;
+    out[2] = a1;
+    out[3] = a5;
+    out[4] = a2;
+    out[5] = a6;
+    out[6] = a3;
+    out[7] = a7;
+}
+
+/**
+ * Transpose 32 pins, 1 step per output word
+ *
+ * @param channels - channel p's word at channels[p * stride]
+ * @param stride - words between two channels
+ * @param out - receives 32 words
+ *
+ * @return void
+ */
+void BITSLICE_FUNC(bitslice_transpose32)(const uint32_t *channels, uint32_t stride, uint32_t *out) {
+    for (uint32_t p = 0; p < 32; p++) {
+        out[p] = channels[p * stride];
+    }
+
+    // 16 x 16 blocks first, then 8 x 8 within them, down to single bits
+    for (uint32_t j = 16, i = 4; j; j >>= 1, i--) {
+        for (uint32_t k = 0; k < 32; k = (k + j + 1) & ~j) {
+            SWAP(out[k], out[k + j], j, masks[i]);
+        }
+    }
+}
+
+/**
+ * Transpose any power of two pins up to 32
+ *
+ * @param channels - channel p's word at channels[p * stride]
+ * @param stride - words between two channels
+ * @param out - receives pins words
+ * @param pins - 1, 2, 4, 8, 16 or 32
+ *
+ * @return void
+ */
+void bitslice_transpose(const uint32_t *channels, uint32_t stride, uint32_t *out, uint32_t pins) {
+    uint32_t a[32];
+
+    if (pins == 1) {
+        out[0] = channels[0];
+        return;
+    }
+    if (pins == 8) {
+        bitslice_transpose8(channels, stride, out);
+        return;
+    }
+    if (pins == 32) {
+        bitslice_transpose32(channels, stride, out);
+        return;
+    }
+
+    for (uint32_t p = 0; p < pins; p++) {
+        a[p] = channels[p * stride];
+    }
+
+    // transpose every pins x pins block, field l of a[r] is then step l * pins + r
+    for (uint32_t j = pins >> 1; j; j >>= 1) {
+        for (uint32_t k = 0; k < pins; k = (k + j + 1) & ~j) {
+            SWAP(a[k], a[k + j], j, masks[__builtin_ctz(j)]);
+        }
+    }
+
+    // put the fields in step order, 32 / pins of them per word
+    uint32_t shift = __builtin_ctz(pins);
+    uint32_t per_word = 32 >> shift;
+    uint32_t field = (1u << pins) - 1;
+
+    for (uint32_t w = 0; w < pins; w++) {
+        out[w] = 0;
+    }
+    for (uint32_t r = 0; r < pins; r++) {
+        for (uint32_t l = 0; l < per_word; l++) {
+            uint32_t step = (l << shift) + r;
+            out[step / per_word] |= ((a[r] >> (l << shift)) & field) << ((step % per_word) << shift);
+        }
+    }
+}
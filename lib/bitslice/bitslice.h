@@ -0,0 +1,34 @@
+/**
+ * @brief Bit-sliced streams for PIO programs that drive several pins
+ *
+ * A state machine running `out pins, N` with the OSR shifting right
+ * puts the N lowest bits of its word on N consecutive pins every
+ * clock, so one DMA stream drives N outputs in lockstep. The stream
+ * has to be time-major though, each N-bit field is one step for all
+ * pins, while waveforms are generated per pin, each 32-bit word is 32
+ * steps of one pin (like lib/sigma_delta's output).
+ *
+ * Going from one to the other is a transpose of a bit matrix:
+ *
+ *   channels[p]  bit t   = pin p at step t        (N words, 32 steps)
+ *   out[w]       field f = all pins at step w * (32 / N) + f
+ *                bit p of a field = pin p          (N words, 32 steps)
+ *
+ * It's done the recursive way: swap the off-diagonal halves of the
+ * N x N blocks, then of their quarters, and so on, each swap a shift,
+ * two xors and a mask on whole words, so log2(N) passes over N words
+ * instead of 32 * N single bit moves. bitslice_transpose8() and
+ * bitslice_transpose32() are the unrolled versions for 8 and 32 pins.
+ *
+ * Plain C, no SDK, checked against a one bit at a time reference and
+ * benchmarked on the host (host/bitslice_bench), on the board by
+ * picow_test.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+void bitslice_transpose8(const uint32_t *channels, uint32_t stride, uint32_t *out);
+void bitslice_transpose32(const uint32_t *channels, uint32_t stride, uint32_t *out);
+void bitslice_transpose(const uint32_t *channels, uint32_t stride, uint32_t *out, uint32_t pins);
@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "pico/multicore.h"
+#include "board.h"
+
+static board_stage_t stages[BOARD_STAGES_MAX];
+static uint32_t stage_count;
+
+// written by whichever core runs the init, read by both
+static uint32_t radio_state = BOARD_CYW43_OFF;
+static uint32_t radio_start_us;
+static uint32_t radio_ready_us;
+static uint32_t radio_core;
+
+/**
+ * First stage, C constructors run right before main()
+ *
+ * @return void
+ */
+static void __attribute__((constructor)) board_runtime_mark(void) {
+    board_mark("runtime");
+}
+
+/**
+ * Initialize stdio and record it, cyw43 is left off
+ *
+ * @return void
+ */
+void board_init(void) {
+    stdio_init_all();
+    board_mark("stdio");
+}
+
+/**
+ * Record a boot stage, core 0 only
+ *
+ * @param stage - string literal, e.g. "waveform"
+ *
+ * @return void
+ */
+void board_mark(const char *stage) {
+    if (stage_count >= BOARD_STAGES_MAX) return;
+
+    stages[stage_count].name = stage;
+    stages[stage_count].us = time_us_32();
+    stage_count++;
+}
+
+/**
+ * Print every stage since reset and when cyw43 came up
+ *
+ * @return void
+ */
+void board_report(void) {
+    uint32_t last = 0;
+
+    for (uint32_t i = 0; i < stage_count; i++) {
+        printf("boot %-12s %8lu us (+%lu)\n", stages[i].name, (unsigned long) stages[i].us,
+               (unsigned long) (stages[i].us - last));
+        last = stages[i].us;
+    }
+
+    switch (board_cyw43_state()) {
+        case BOARD_CYW43_OFF:
+            printf("boot cyw43        off\n");
+            break;
+        case BOARD_CYW43_STARTING:
+            printf("boot cyw43        starting since %lu us\n", (unsigned long) radio_start_us);
+            break;
+        case BOARD_CYW43_READY:
+            printf("boot cyw43        %8lu us (%lu us on core %lu)\n", (unsigned long) radio_ready_us,
+                   (unsigned long) (radio_ready_us - radio_start_us), (unsigned long) radio_core);
+            break;
+        case BOARD_CYW43_FAILED:
+            printf("boot cyw43        failed\n");
+            break;
+    }
+}
+
+/**
+ * Run cyw43_arch_init() on the calling core and publish the result
+ *
+ * @return bool - true if cyw43 is up
+ */
+static bool radio_bring_up(void) {
+    radio_start_us = time_us_32();
+    radio_core = get_core_num();
+
+    bool ok = cyw43_arch_init() == 0;
+
+    radio_ready_us = time_us_32();
+    // times first, the other core reads them once it sees the state
+    __atomic_store_n(&radio_state, ok ? BOARD_CYW43_READY : BOARD_CYW43_FAILED, __ATOMIC_RELEASE);
+
+    return ok;
+}
+
+/**
+ * Core 1: bring up cyw43, then stay around for its interrupts
+ *
+ * @return void
+ */
+static void radio_core1_entry(void) {
+    radio_bring_up();
+
+    while (true) {
+        __wfi();
+    }
+}
+
+/**
+ * Start cyw43 on core 1 in the background
+ *
+ * Core 1 has to be free and stays busy afterwards.
+ *
+ * @return bool - false if cyw43 was already started
+ */
+bool board_cyw43_start(void) {
+    if (board_cyw43_state() != BOARD_CYW43_OFF) return false;
+
+    __atomic_store_n(&radio_state, BOARD_CYW43_STARTING, __ATOMIC_RELAXED);
+    multicore_launch_core1(radio_core1_entry);
+
+    return true;
+}
+
+/**
+ * Make sure cyw43 is up before using it
+ *
+ * Initializes it right here if nobody started it, or waits for the
+ * background init to finish.
+ *
+ * @return bool - true if cyw43 can be used
+ */
+bool board_cyw43_require(void) {
+    board_cyw43_state_t state = board_cyw43_state();
+
+    if (state == BOARD_CYW43_OFF) {
+        __atomic_store_n(&radio_state, BOARD_CYW43_STARTING, __ATOMIC_RELAXED);
+        return radio_bring_up();
+    }
+
+    while (state == BOARD_CYW43_STARTING) {
+        tight_loop_contents();
+        state = board_cyw43_state();
+    }
+
+    return state == BOARD_CYW43_READY;
+}
+
+/**
+ * Get where the cyw43 init is at
+ *
+ * @return board_cyw43_state_t
+ */
+board_cyw43_state_t board_cyw43_state(void) {
+    return __atomic_load_n(&radio_state, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Set the onboard LED, brings cyw43 up on first use
+ *
+ * @param on
+ *
+ * @return void
+ */
+void board_led_put(bool on) {
+    if (!board_cyw43_require()) return;
+
+    cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, on);
+}
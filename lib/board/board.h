@@ -0,0 +1,56 @@
+/**
+ * @brief Board bring-up without paying for cyw43 up front
+ *
+ * On the Pico W the onboard LED hangs off the wireless chip, so every
+ * example used to start with cyw43_arch_init(), which uploads the chip
+ * firmware over SPI and takes a good part of a second before main()
+ * does anything useful. Most examples never touch the radio.
+ *
+ * - board_init() only starts stdio, cyw43 stays off
+ * - lazy: board_led_put() (or board_cyw43_require()) brings cyw43 up
+ *   the first time it's actually needed
+ * - background: board_cyw43_start() runs the init on core 1 while
+ *   core 0 gets on with the real work, the first LED call waits for
+ *   it if it isn't done yet. Core 1 stays parked afterwards (the cyw43
+ *   interrupts are serviced on the core that initialized it), so this
+ *   is for examples that don't use core 1 themselves
+ * - board_mark("stage") records a boot-stage timestamp, board_report()
+ *   prints them all with the cyw43 start and ready times
+ *
+ * Timestamps are the 1 MHz timer, which the runtime takes out of reset
+ * early on, so 0 is just after the boot ROM and boot2 (~1 ms) and
+ * every stage counts from (close to) reset. board_mark() is for core 0
+ * only, the background init records its own times.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// most stages board_mark() records, later marks are ignored
+#define BOARD_STAGES_MAX 16
+
+typedef enum {
+    BOARD_CYW43_OFF,
+    BOARD_CYW43_STARTING,
+    BOARD_CYW43_READY,
+    BOARD_CYW43_FAILED,
+} board_cyw43_state_t;
+
+typedef struct {
+    // string literal, only the pointer is kept
+    const char *name;
+    // time since the timer started
+    uint32_t us;
+} board_stage_t;
+
+void board_init(void);
+void board_mark(const char *stage);
+void board_report(void);
+
+bool board_cyw43_start(void);
+bool board_cyw43_require(void);
+board_cyw43_state_t board_cyw43_state(void);
+
+void board_led_put(bool on);
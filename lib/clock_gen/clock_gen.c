@@ -0,0 +1,249 @@
+#include "hardware/clocks.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "clock_gen.h"
+#include "clock_gen.pio.h"
+
+static PIO clock_pio;
+static uint clock_sm;
+static uint clock_pin;
+static uint gen_offset;
+static uint pulse_offset;
+static bool clock_monostable = false;
+static clock_timing_t clock_timing;
+// divider the state machine currently runs at
+static uint16_t applied_clkdiv;
+// astable: divider of the setting waiting in the TX FIFO
+static uint16_t pending_clkdiv;
+// monostable: a pulse waits for the running one to end before the divider changes
+static bool pending_pulse = false;
+
+// TX FIFO words per state machine, unjoined
+#define CLOCK_FIFO_DEPTH 4
+
+static enum pio_interrupt_source clock_pulled_source() {
+    return (enum pio_interrupt_source) (pis_sm0_tx_fifo_not_full + clock_sm);
+}
+
+static enum pio_interrupt_source clock_pulse_done_source() {
+    return (enum pio_interrupt_source) (pis_interrupt0 + clock_sm);
+}
+
+/**
+ * Fire the pulse waiting on a new divider once the state machine is idle
+ *
+ * Idle is an empty FIFO with the program on its pull, or on the irq
+ * just before it, the rest of that cycle is clock low anyway.
+ * Interrupts must be off or this is the interrupt.
+ *
+ * @return void
+ */
+static void clock_pulse_apply() {
+    if (!pending_pulse || !pio_sm_is_tx_fifo_empty(clock_pio, clock_sm)) return;
+
+    uint pc = pio_sm_get_pc(clock_pio, clock_sm);
+    if (pc != pulse_offset + clock_pulse_wrap_target && pc != pulse_offset + clock_pulse_wrap) return;
+
+    pio_sm_set_clkdiv_int_frac(clock_pio, clock_sm, clock_timing.clkdiv, 0);
+    applied_clkdiv = clock_timing.clkdiv;
+    pending_pulse = false;
+    pio_set_irq0_source_enabled(clock_pio, clock_pulse_done_source(), false);
+
+    pio_sm_put(clock_pio, clock_sm, clock_pulse_word(&clock_timing));
+}
+
+/**
+ * Switch the divider along with the setting that needs it
+ *
+ * Astable: the TX FIFO was filled with the new setting, it drops
+ * below full when the program pulls the first copy at the period
+ * boundary. Monostable: a pulse ended.
+ *
+ * @return void
+ */
+static void clock_irq_handler() {
+    if (clock_monostable) {
+        pio_interrupt_clear(clock_pio, clock_sm);
+        clock_pulse_apply();
+        return;
+    }
+
+    if (pio_sm_is_tx_fifo_full(clock_pio, clock_sm)) return;
+
+    pio_set_irq0_source_enabled(clock_pio, clock_pulled_source(), false);
+    if (pending_clkdiv != applied_clkdiv) {
+        pio_sm_set_clkdiv_int_frac(clock_pio, clock_sm, pending_clkdiv, 0);
+        applied_clkdiv = pending_clkdiv;
+    }
+}
+
+/**
+ * (Re)start the state machine on one of the two programs
+ *
+ * Leaves the pin low, the programs only drive it high while
+ * running a setting or pulse.
+ *
+ * @param uint offset - gen_offset or pulse_offset
+ * @return void
+ */
+static void clock_sm_start(uint offset) {
+    pio_sm_config config = offset == gen_offset
+        ? clock_gen_program_get_default_config(offset)
+        : clock_pulse_program_get_default_config(offset);
+
+    sm_config_set_sideset_pins(&config, clock_pin);
+    sm_config_set_out_shift(&config, true, false, 32);
+    sm_config_set_clkdiv_int_frac(&config, clock_timing.clkdiv, 0);
+
+    // drop whatever waited for a divider change in the other mode
+    pio_set_irq0_source_enabled(clock_pio, clock_pulled_source(), false);
+    pio_set_irq0_source_enabled(clock_pio, clock_pulse_done_source(), false);
+    pending_pulse = false;
+
+    pio_sm_set_enabled(clock_pio, clock_sm, false);
+    pio_sm_clear_fifos(clock_pio, clock_sm);
+    pio_interrupt_clear(clock_pio, clock_sm);
+    pio_sm_set_pins_with_mask(clock_pio, clock_sm, 0, 1u << clock_pin);
+    pio_sm_init(clock_pio, clock_sm, offset, &config);
+    applied_clkdiv = pending_clkdiv = clock_timing.clkdiv;
+
+    // astable needs its first setting before it runs, X starts at 0
+    if (offset == gen_offset) {
+        pio_sm_put(clock_pio, clock_sm, clock_gen_word(&clock_timing));
+    }
+
+    pio_sm_set_enabled(clock_pio, clock_sm, true);
+}
+
+/**
+ * Initialize the clock generator, astable output from the first cycle
+ *
+ * @param PIO pio - pio0 or pio1
+ * @param uint pin - clock output
+ * @param uint32_t frequency - Hz
+ * @param uint duty_cycle - %
+ * @return bool - false if the frequency is out of range, nothing is claimed then
+ */
+bool clock_gen_init(PIO pio, uint pin, uint32_t frequency, uint duty_cycle) {
+    if (!clock_solve(clock_get_hz(clk_sys), frequency, duty_cycle, &clock_timing)) return false;
+
+    clock_pio = pio;
+    clock_pin = pin;
+    clock_sm = pio_claim_unused_sm(pio, true);
+    gen_offset = pio_add_program(pio, &clock_gen_program);
+    pulse_offset = pio_add_program(pio, &clock_pulse_program);
+
+    pio_gpio_init(pio, pin);
+    pio_sm_set_consecutive_pindirs(pio, clock_sm, pin, 1, true);
+
+    // switches the divider when a setting that needs another one starts
+    uint irq_num = pio == pio0 ? PIO0_IRQ_0 : PIO1_IRQ_0;
+    irq_set_exclusive_handler(irq_num, clock_irq_handler);
+    irq_set_enabled(irq_num, true);
+
+    clock_sm_start(gen_offset);
+
+    return true;
+}
+
+/**
+ * Retune the frequency and duty cycle
+ *
+ * Never waits. In astable mode the new setting replaces one the
+ * program hasn't picked up yet and takes over at the end of the
+ * current period. If it needs a different divider, the FIFO is
+ * filled with it and the interrupt switches the divider as soon as
+ * the program pulls the first copy, i.e. an interrupt latency into
+ * the first period, so no runt pulse.
+ *
+ * @param uint32_t frequency - Hz
+ * @param uint duty_cycle - %
+ * @param clock_timing_t *timing - optional, receives the chosen setting
+ * @return bool - false if the frequency is out of range
+ */
+bool clock_gen_set(uint32_t frequency, uint duty_cycle, clock_timing_t *timing) {
+    clock_timing_t next;
+
+    if (!clock_solve(clock_get_hz(clk_sys), frequency, duty_cycle, &next)) return false;
+
+    uint32_t status = save_and_disable_interrupts();
+
+    if (!clock_monostable) {
+        uint32_t word = clock_gen_word(&next);
+
+        // nothing switches the divider for a setting that is about to go
+        pio_set_irq0_source_enabled(clock_pio, clock_pulled_source(), false);
+        pending_clkdiv = applied_clkdiv;
+
+        // pull noblock only empties the FIFO at a period boundary, so
+        // dropping what is still in there replaces the pending setting
+        pio_sm_clear_fifos(clock_pio, clock_sm);
+
+        if (next.clkdiv == applied_clkdiv) {
+            pio_sm_put(clock_pio, clock_sm, word);
+        } else {
+            // if the program pulls while we fill, the FIFO never gets
+            // full and the interrupt switches the divider right away
+            for (uint i = 0; i < CLOCK_FIFO_DEPTH; i++) {
+                pio_sm_put(clock_pio, clock_sm, word);
+            }
+            pending_clkdiv = next.clkdiv;
+            pio_set_irq0_source_enabled(clock_pio, clock_pulled_source(), true);
+        }
+    }
+
+    // monostable picks up the divider with the next pulse
+    clock_timing = next;
+
+    restore_interrupts(status);
+
+    if (timing) *timing = next;
+
+    return true;
+}
+
+/**
+ * Switch between astable and monostable output
+ *
+ * @param bool monostable
+ * @return void
+ */
+void clock_gen_set_monostable(bool monostable) {
+    if (monostable == clock_monostable) return;
+
+    clock_monostable = monostable;
+    clock_sm_start(monostable ? pulse_offset : gen_offset);
+}
+
+/**
+ * Fire one pulse of the current high time, monostable mode only
+ *
+ * Never waits. Queued if a pulse is still running, dropped if four
+ * are queued. A pulse that needs a new divider is fired by the
+ * interrupt once the running pulses are done, further presses until
+ * then are dropped.
+ *
+ * @return void
+ */
+void clock_gen_pulse() {
+    if (!clock_monostable) return;
+
+    uint32_t status = save_and_disable_interrupts();
+
+    if (pending_pulse) {
+        // one is already waiting for the divider
+    } else if (clock_timing.clkdiv == applied_clkdiv) {
+        if (!pio_sm_is_tx_fifo_full(clock_pio, clock_sm)) {
+            pio_sm_put(clock_pio, clock_sm, clock_pulse_word(&clock_timing));
+        }
+    } else {
+        // a new divider is only applied between pulses, right away
+        // if nothing runs, otherwise when the running pulse ends
+        pending_pulse = true;
+        pio_interrupt_clear(clock_pio, clock_sm);
+        pio_set_irq0_source_enabled(clock_pio, clock_pulse_done_source(), true);
+        clock_pulse_apply();
+    }
+
+    restore_interrupts(status);
+}
@@ -0,0 +1,26 @@
+/**
+ * @brief PIO clock generator, picow_timer's clock output and picow_pio's LED
+ *
+ * One state machine, two programs from clock_gen.pio:
+ *
+ * - clock_gen: astable clock, high/low times from a FIFO word that is
+ *   reused every period, retuned on the next period boundary
+ * - clock_pulse: monostable, one precisely timed pulse per FIFO word
+ *
+ * clock_solver.c picks an integer divider and the loop counts, so the
+ * output is jitter-free from 1 Hz up to sys_clk / 6 (~20.8 MHz).
+ *
+ * Nothing here waits on the state machine. A divider change is
+ * switched from the PIO's IRQ 0 when the setting that needs it starts.
+ */
+
+#pragma once
+
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "clock_solver.h"
+
+bool clock_gen_init(PIO pio, uint pin, uint32_t frequency, uint duty_cycle);
+bool clock_gen_set(uint32_t frequency, uint duty_cycle, clock_timing_t *timing);
+void clock_gen_set_monostable(bool monostable);
+void clock_gen_pulse();
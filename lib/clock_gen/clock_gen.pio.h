@@ -0,0 +1,84 @@
+// -------------------------------------------------- //
+// This file is autogenerated by pioasm; do not edit! //
+// -------------------------------------------------- //
+
+#pragma once
+
+#if !PICO_NO_HARDWARE
+#include "hardware/pio.h"
+#endif
+
+// --------- //
+// clock_gen //
+// --------- //
+
+#define clock_gen_wrap_target 0
+#define clock_gen_wrap 5
+#define clock_gen_pio_version 0
+
+static const uint16_t clock_gen_program_instructions[] = {
+            //     .wrap_target
+    0x9080, //  0: pull   noblock          side 0    
+    0xa027, //  1: mov    x, osr                     
+    0x7850, //  2: out    y, 16            side 1    
+    0x0083, //  3: jmp    y--, 3                     
+    0x7050, //  4: out    y, 16            side 0    
+    0x0085, //  5: jmp    y--, 5                     
+            //     .wrap
+};
+
+#if !PICO_NO_HARDWARE
+static const struct pio_program clock_gen_program = {
+    .instructions = clock_gen_program_instructions,
+    .length = 6,
+    .origin = -1,
+    .pio_version = 0,
+#if PICO_PIO_VERSION > 0
+    .used_gpio_ranges = 0x0
+#endif
+};
+
+static inline pio_sm_config clock_gen_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + clock_gen_wrap_target, offset + clock_gen_wrap);
+    sm_config_set_sideset(&c, 2, true, false);
+    return c;
+}
+#endif
+
+// ----------- //
+// clock_pulse //
+// ----------- //
+
+#define clock_pulse_wrap_target 0
+#define clock_pulse_wrap 3
+#define clock_pulse_pio_version 0
+
+static const uint16_t clock_pulse_program_instructions[] = {
+            //     .wrap_target
+    0x90a0, //  0: pull   block            side 0    
+    0x7840, //  1: out    y, 32            side 1    
+    0x0082, //  2: jmp    y--, 2                     
+    0xd010, //  3: irq    nowait 0 rel     side 0    
+            //     .wrap
+};
+
+#if !PICO_NO_HARDWARE
+static const struct pio_program clock_pulse_program = {
+    .instructions = clock_pulse_program_instructions,
+    .length = 4,
+    .origin = -1,
+    .pio_version = 0,
+#if PICO_PIO_VERSION > 0
+    .used_gpio_ranges = 0x0
+#endif
+};
+
+static inline pio_sm_config clock_pulse_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + clock_pulse_wrap_target, offset + clock_pulse_wrap);
+    sm_config_set_sideset(&c, 2, true, false);
+    return c;
+}
+#endif
+
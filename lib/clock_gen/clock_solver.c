@@ -0,0 +1,82 @@
+#include "clock_solver.h"
+
+/**
+ * Find the clock divider and high/low times for a frequency and duty cycle
+ *
+ * The period is clkdiv * (high + low) system cycles. Starting from
+ * the smallest divider that fits the 16-bit counts (best duty cycle
+ * resolution), tries dividers up to twice that and keeps the one
+ * closest to the requested frequency, stopping early on an exact hit.
+ *
+ * @param uint32_t sys_clk - system clock in Hz
+ * @param uint32_t frequency - requested frequency in Hz
+ * @param unsigned int duty_cycle - requested duty cycle in %
+ * @param clock_timing_t *timing - result
+ * @return bool - false if the frequency is out of range
+ */
+bool clock_solve(uint32_t sys_clk, uint32_t frequency, unsigned int duty_cycle, clock_timing_t *timing) {
+    uint64_t max_period = CLOCK_MAX_HIGH + CLOCK_MAX_LOW;
+    uint64_t min_period = CLOCK_MIN_HIGH + CLOCK_MIN_LOW;
+    uint64_t best_error = UINT64_MAX;
+    uint32_t limit = CLOCK_MAX_DIV;
+    bool found = false;
+
+    if (!frequency || (uint64_t) sys_clk < min_period * frequency) return false;
+    if (duty_cycle > 100) duty_cycle = 100;
+
+    uint64_t start = ((uint64_t) sys_clk + max_period * frequency - 1) / (max_period * frequency);
+    if (start < 1) start = 1;
+
+    for (uint32_t div = start; div <= limit; div++) {
+        uint64_t step = (uint64_t) div * frequency;
+        uint64_t period = ((uint64_t) sys_clk + step / 2) / step;
+        // larger dividers only make the period shorter
+        if (period < min_period) break;
+
+        uint64_t high = (period * duty_cycle + 50) / 100;
+        if (high < CLOCK_MIN_HIGH) high = CLOCK_MIN_HIGH;
+        if (high > period - CLOCK_MIN_LOW) high = period - CLOCK_MIN_LOW;
+        uint64_t low = period - high;
+        if (high > CLOCK_MAX_HIGH || low > CLOCK_MAX_LOW) continue;
+
+        if (!found) {
+            found = true;
+            limit = div * 2 < CLOCK_MAX_DIV ? div * 2 : CLOCK_MAX_DIV;
+        }
+
+        // distance of clkdiv * period * frequency from sys_clk, same scale for every divider
+        uint64_t actual = step * period;
+        uint64_t error = actual > sys_clk ? actual - sys_clk : sys_clk - actual;
+        if (error < best_error) {
+            best_error = error;
+            timing->clkdiv = div;
+            timing->high = high;
+            timing->low = low;
+            timing->frequency_mhz = (uint64_t) sys_clk * 1000 / (div * period);
+            timing->error_ppm = (int32_t) (((int64_t) sys_clk - (int64_t) actual) * 1000000 / (int64_t) actual);
+        }
+        if (!error) break;
+    }
+
+    return found;
+}
+
+/**
+ * Encode a timing for the clock_gen program
+ *
+ * @param const clock_timing_t *timing
+ * @return uint32_t - TX FIFO word
+ */
+uint32_t clock_gen_word(const clock_timing_t *timing) {
+    return (timing->high - CLOCK_MIN_HIGH) | ((timing->low - CLOCK_MIN_LOW) << 16);
+}
+
+/**
+ * Encode the high time of a timing for the clock_pulse program
+ *
+ * @param const clock_timing_t *timing
+ * @return uint32_t - TX FIFO word
+ */
+uint32_t clock_pulse_word(const clock_timing_t *timing) {
+    return timing->high - CLOCK_MIN_HIGH;
+}
@@ -0,0 +1,36 @@
+/**
+ * @brief Clock divider and loop count solver for the clock_gen program
+ *
+ * Pure C, shared with the host tools so the chosen settings can be
+ * checked against the simulated program (host/clock_check).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// shortest high and low times the program can produce, in SM cycles
+#define CLOCK_MIN_HIGH 2
+#define CLOCK_MIN_LOW 4
+// longest, the counts are 16 bits each
+#define CLOCK_MAX_HIGH (0xffffu + CLOCK_MIN_HIGH)
+#define CLOCK_MAX_LOW (0xffffu + CLOCK_MIN_LOW)
+// largest integer clock divider
+#define CLOCK_MAX_DIV 0xffffu
+
+typedef struct {
+    // integer clock divider, fractional dividers would add jitter
+    uint16_t clkdiv;
+    // high and low time in state machine cycles
+    uint32_t high;
+    uint32_t low;
+    // achieved frequency in mHz
+    uint64_t frequency_mhz;
+    // achieved vs requested frequency
+    int32_t error_ppm;
+} clock_timing_t;
+
+bool clock_solve(uint32_t sys_clk, uint32_t frequency, unsigned int duty_cycle, clock_timing_t *timing);
+uint32_t clock_gen_word(const clock_timing_t *timing);
+uint32_t clock_pulse_word(const clock_timing_t *timing);
@@ -0,0 +1,154 @@
+#include <string.h>
+#include "hist.h"
+
+static inline void put32(uint8_t *p, uint32_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+static inline uint32_t get32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+/**
+ * Empty a histogram
+ *
+ * @param hist
+ *
+ * @return void
+ */
+void hist_reset(hist_t *hist) {
+    memset(hist, 0, sizeof(*hist));
+    hist->min = UINT32_MAX;
+}
+
+/**
+ * Get the bucket of a value
+ *
+ * @param value
+ *
+ * @return uint32_t - 0 to HIST_BUCKETS - 1
+ */
+uint32_t hist_bucket(uint32_t value) {
+    if (value < 4) return value;
+
+    // the top bit picks the octave, the two bits below it the quarter
+    uint32_t top = 31 - __builtin_clz(value);
+    return 4 * (top - 1) + ((value >> (top - 2)) & 3);
+}
+
+/**
+ * Get the smallest value of a bucket
+ *
+ * @param bucket
+ *
+ * @return uint32_t
+ */
+uint32_t hist_bucket_low(uint32_t bucket) {
+    if (bucket < 4) return bucket;
+
+    return (4 + (bucket & 3)) << (bucket / 4 - 1);
+}
+
+/**
+ * Get the largest value of a bucket
+ *
+ * @param bucket
+ *
+ * @return uint32_t
+ */
+uint32_t hist_bucket_high(uint32_t bucket) {
+    if (bucket >= HIST_BUCKETS - 1) return UINT32_MAX;
+
+    return hist_bucket_low(bucket + 1) - 1;
+}
+
+/**
+ * Get a percentile, the top of the bucket it falls in but never
+ * more than the largest value seen
+ *
+ * @param hist
+ * @param permille - 500 for the median, 990 for p99
+ *
+ * @return uint32_t - 0 if the histogram is empty
+ */
+uint32_t hist_percentile(const hist_t *hist, uint32_t permille) {
+    if (!hist->count) return 0;
+
+    // rank of the value, 1-based, rounded up
+    uint64_t rank = ((uint64_t) hist->count * permille + 999) / 1000;
+    if (!rank) rank = 1;
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            uint32_t high = hist_bucket_high(i);
+            return high < hist->max ? high : hist->max;
+        }
+    }
+
+    // buckets missing, see hist_decode()
+    return hist->max;
+}
+
+/**
+ * Encode a histogram for the wire
+ *
+ * @param hist
+ * @param out
+ * @param room - bytes available in out
+ *
+ * @return size_t - encoded length, 0 if not even the header fits
+ */
+size_t hist_encode(const hist_t *hist, uint8_t *out, size_t room) {
+    if (room < HIST_HEADER_SIZE) return 0;
+
+    put32(out, hist->count);
+    put32(out + 4, hist->count ? hist->min : 0);
+    put32(out + 8, hist->max);
+    put32(out + 12, hist->sum);
+    put32(out + 16, hist->sum >> 32);
+    size_t len = HIST_HEADER_SIZE;
+
+    for (uint32_t i = 0; i < HIST_BUCKETS && len + HIST_PAIR_SIZE <= room; i++) {
+        if (!hist->buckets[i]) continue;
+
+        out[len] = i;
+        put32(out + len + 1, hist->buckets[i]);
+        len += HIST_PAIR_SIZE;
+    }
+
+    return len;
+}
+
+/**
+ * Decode a histogram from hist_encode()
+ *
+ * If the buckets add up to less than count, the sender ran out of
+ * room and the top of the distribution is missing.
+ *
+ * @param hist - receives the histogram
+ * @param data
+ * @param len
+ *
+ * @return bool - false if malformed
+ */
+bool hist_decode(hist_t *hist, const uint8_t *data, size_t len) {
+    if (len < HIST_HEADER_SIZE || (len - HIST_HEADER_SIZE) % HIST_PAIR_SIZE) return false;
+
+    hist_reset(hist);
+    hist->count = get32(data);
+    hist->min = get32(data + 4);
+    hist->max = get32(data + 8);
+    hist->sum = get32(data + 12) | ((uint64_t) get32(data + 16) << 32);
+
+    for (size_t pos = HIST_HEADER_SIZE; pos < len; pos += HIST_PAIR_SIZE) {
+        if (data[pos] >= HIST_BUCKETS) return false;
+        hist->buckets[data[pos]] = get32(data + pos + 1);
+    }
+
+    return true;
+}
@@ -0,0 +1,64 @@
+/**
+ * @brief Log-linear latency histogram
+ *
+ * Four buckets per power of two, so a bucket is at most a quarter of
+ * its value wide and a percentile read from the buckets is within
+ * 25% (always on the high side). 124 counters cover all of uint32_t,
+ * adding a value is a count leading zeros and an increment, cheap
+ * enough to run around every command on the RP2040.
+ *
+ *   bucket 0-3     values 0-3
+ *   bucket 4-7     4, 5, 6, 7
+ *   bucket 8-11    8-9, 10-11, 12-13, 14-15
+ *   ...
+ *
+ * Plain C, the firmware fills them in and host tools read them back
+ * with hist_encode()/hist_decode(). Encoded, little endian:
+ *
+ *   count u32, min u32, max u32, sum u64, (bucket u8, count u32) * n
+ *
+ * Only the non-empty buckets are sent, lowest first, as many as fit.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define HIST_BUCKETS 124
+#define HIST_HEADER_SIZE 20
+#define HIST_PAIR_SIZE 5
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[HIST_BUCKETS];
+} hist_t;
+
+void hist_reset(hist_t *hist);
+uint32_t hist_bucket(uint32_t value);
+uint32_t hist_bucket_low(uint32_t bucket);
+uint32_t hist_bucket_high(uint32_t bucket);
+uint32_t hist_percentile(const hist_t *hist, uint32_t permille);
+
+size_t hist_encode(const hist_t *hist, uint8_t *out, size_t room);
+bool hist_decode(hist_t *hist, const uint8_t *data, size_t len);
+
+/**
+ * Count a value
+ *
+ * @param hist
+ * @param value
+ *
+ * @return void
+ */
+static inline void hist_add(hist_t *hist, uint32_t value) {
+    if (value < hist->min) hist->min = value;
+    if (value > hist->max) hist->max = value;
+    hist->count++;
+    hist->sum += value;
+    hist->buckets[hist_bucket(value)]++;
+}
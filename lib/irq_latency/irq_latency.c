@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "irq_latency.h"
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *) a;
+    uint32_t y = *(const uint32_t *) b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Drop all samples
+ *
+ * @param latency
+ *
+ * @return void
+ */
+void irq_latency_reset(irq_latency_t *latency) {
+    latency->count = 0;
+    latency->timeouts = 0;
+}
+
+/**
+ * Statistics of one metric, the name and metric are left alone
+ *
+ * @param samples - sorted in place
+ * @param count
+ * @param result - receives count, min, median, p99, max, mean and the histogram
+ *
+ * @return void
+ */
+void irq_latency_stats(uint32_t *samples, uint32_t count, irq_latency_result_t *result) {
+    uint64_t total = 0;
+
+    hist_reset(&result->hist);
+    result->count = count;
+    result->min = result->median = result->p99 = result->max = result->mean = 0;
+    if (!count) return;
+
+    qsort(samples, count, sizeof(uint32_t), compare_u32);
+    for (uint32_t i = 0; i < count; i++) {
+        hist_add(&result->hist, samples[i]);
+        total += samples[i];
+    }
+
+    result->min = samples[0];
+    result->median = samples[count / 2];
+    result->p99 = samples[(count * 99) / 100];
+    result->max = samples[count - 1];
+    result->mean = total / count;
+}
+
+/**
+ * Both results of a case
+ *
+ * @param latency - its samples get sorted
+ * @param name - case name, no spaces
+ * @param entry - receives the entry latency
+ * @param handler - receives the handler time
+ *
+ * @return void
+ */
+void irq_latency_results(irq_latency_t *latency, const char *name, irq_latency_result_t *entry,
+                         irq_latency_result_t *handler) {
+    irq_latency_stats(latency->entry, latency->count, entry);
+    snprintf(entry->name, sizeof(entry->name), "%s", name);
+    snprintf(entry->metric, sizeof(entry->metric), "%s", IRQ_LATENCY_ENTRY);
+    entry->timeouts = latency->timeouts;
+
+    irq_latency_stats(latency->handler, latency->count, handler);
+    snprintf(handler->name, sizeof(handler->name), "%s", name);
+    snprintf(handler->metric, sizeof(handler->metric), "%s", IRQ_LATENCY_HANDLER);
+    handler->timeouts = latency->timeouts;
+}
+
+/**
+ * Format a result line, without the newline
+ *
+ * @param out
+ * @param size - IRQ_LATENCY_LINE_MAX fits the statistics and plenty of buckets
+ * @param result
+ *
+ * @return size_t - length of the line
+ */
+size_t irq_latency_format(char *out, size_t size, const irq_latency_result_t *result) {
+    int len = snprintf(out, size, "irq %s %s count=%lu timeouts=%lu min=%lu median=%lu p99=%lu max=%lu mean=%lu hist=",
+                       result->name, result->metric, (unsigned long) result->count,
+                       (unsigned long) result->timeouts, (unsigned long) result->min,
+                       (unsigned long) result->median, (unsigned long) result->p99,
+                       (unsigned long) result->max, (unsigned long) result->mean);
+    if (len < 0 || (size_t) len >= size) return 0;
+
+    size_t used = len;
+    const char *separator = "";
+
+    for (uint32_t i = 0; i < HIST_BUCKETS; i++) {
+        if (!result->hist.buckets[i]) continue;
+
+        char pair[24];
+        int n = snprintf(pair, sizeof(pair), "%s%lu:%lu", separator, (unsigned long) i,
+                         (unsigned long) result->hist.buckets[i]);
+        // the statistics are what counts, the tail of the histogram can go
+        if (used + n >= size) break;
+
+        memcpy(out + used, pair, n + 1);
+        used += n;
+        separator = ",";
+    }
+
+    return used;
+}
+
+/**
+ * Parse a result line, anything else on the port is ignored
+ *
+ * The histogram's min and max come from the line, its sum from the
+ * mean.
+ *
+ * @param line
+ * @param result
+ *
+ * @return bool - false if it isn't a result line
+ */
+bool irq_latency_parse(const char *line, irq_latency_result_t *result) {
+    unsigned long count, timeouts, min, median, p99, max, mean;
+    char name[IRQ_LATENCY_NAME_MAX];
+    char metric[IRQ_LATENCY_METRIC_MAX];
+    int offset = 0;
+
+    if (sscanf(line, "irq %31s %7s count=%lu timeouts=%lu min=%lu median=%lu p99=%lu max=%lu mean=%lu hist=%n",
+               name, metric, &count, &timeouts, &min, &median, &p99, &max, &mean, &offset) != 9 || !offset) {
+        return false;
+    }
+
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    snprintf(result->metric, sizeof(result->metric), "%s", metric);
+    result->count = count;
+    result->timeouts = timeouts;
+    result->min = min;
+    result->median = median;
+    result->p99 = p99;
+    result->max = max;
+    result->mean = mean;
+
+    hist_reset(&result->hist);
+    const char *p = line + offset;
+    while (*p && *p != '\r' && *p != '\n') {
+        char *end;
+        unsigned long bucket = strtoul(p, &end, 10);
+        if (end == p || *end != ':' || bucket >= HIST_BUCKETS) return false;
+
+        p = end + 1;
+        unsigned long n = strtoul(p, &end, 10);
+        if (end == p) return false;
+
+        result->hist.buckets[bucket] += n;
+        result->hist.count += n;
+        p = *end == ',' ? end + 1 : end;
+    }
+
+    if (result->hist.count) {
+        result->hist.min = min;
+        result->hist.max = max;
+        result->hist.sum = (uint64_t) mean * result->hist.count;
+    }
+
+    return true;
+}
@@ -0,0 +1,89 @@
+/**
+ * @brief Interrupt latency samples and result lines
+ *
+ * Collects two numbers per interrupt, in CPU cycles:
+ *
+ * - entry: from the interrupt being asserted (a loopback GPIO edge,
+ *   a PWM wrap, a DMA completion, a timer alarm) to the first line
+ *   of the handler, the NVIC, the vector fetch and the stacking
+ * - handler: from the first line of the handler to the last, what
+ *   the handler itself costs, a flash handler fetching from XIP
+ *
+ * The samples are sorted for exact min, median, p99 and max like
+ * lib/bench, and counted into a lib/hist histogram for the shape.
+ * picow_test prints one result line per case and metric, framed by
+ * "irq-begin clk=<hz>" and "irq-end", host/irq_report parses them:
+ *
+ *   irq <case> <metric> count=<n> timeouts=<n> min=<c> median=<c> p99=<c> max=<c> mean=<c> hist=<b>:<n>,...
+ *
+ * hist= lists the non-empty lib/hist buckets lowest first, as many
+ * as fit the line.
+ *
+ * Plain C, how the interrupts are raised and stamped is up to the
+ * firmware (picow_test/src/irq_cases.c), host/irq_report checks the
+ * statistics and the line format in its selftest.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hist.h"
+
+// most samples a case can take
+#define IRQ_LATENCY_REPS_MAX 1024
+#define IRQ_LATENCY_NAME_MAX 32
+#define IRQ_LATENCY_METRIC_MAX 8
+// longest result line
+#define IRQ_LATENCY_LINE_MAX 512
+
+// the two metrics of a case
+#define IRQ_LATENCY_ENTRY "entry"
+#define IRQ_LATENCY_HANDLER "handler"
+
+typedef struct {
+    uint32_t entry[IRQ_LATENCY_REPS_MAX];
+    uint32_t handler[IRQ_LATENCY_REPS_MAX];
+    uint32_t count;
+    // interrupts that never came, not in the samples
+    uint32_t timeouts;
+} irq_latency_t;
+
+typedef struct {
+    char name[IRQ_LATENCY_NAME_MAX];
+    char metric[IRQ_LATENCY_METRIC_MAX];
+    uint32_t count;
+    uint32_t timeouts;
+    uint32_t min;
+    uint32_t median;
+    uint32_t p99;
+    uint32_t max;
+    uint32_t mean;
+    hist_t hist;
+} irq_latency_result_t;
+
+void irq_latency_reset(irq_latency_t *latency);
+void irq_latency_stats(uint32_t *samples, uint32_t count, irq_latency_result_t *result);
+void irq_latency_results(irq_latency_t *latency, const char *name, irq_latency_result_t *entry,
+                         irq_latency_result_t *handler);
+
+size_t irq_latency_format(char *out, size_t size, const irq_latency_result_t *result);
+bool irq_latency_parse(const char *line, irq_latency_result_t *result);
+
+/**
+ * Keep one sample, anything past IRQ_LATENCY_REPS_MAX is ignored
+ *
+ * @param latency
+ * @param entry - cycles from assertion to handler entry
+ * @param handler - cycles from handler entry to exit
+ *
+ * @return void
+ */
+static inline void irq_latency_add(irq_latency_t *latency, uint32_t entry, uint32_t handler) {
+    if (latency->count >= IRQ_LATENCY_REPS_MAX) return;
+
+    latency->entry[latency->count] = entry;
+    latency->handler[latency->count] = handler;
+    latency->count++;
+}
@@ -0,0 +1,348 @@
+#include <string.h>
+#include "proto.h"
+
+// CRC-16/CCITT-FALSE, one nibble at a time, 32 bytes of table instead of 512
+static const uint16_t crc16_nibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+};
+
+/**
+ * COBS encode, the output has no 0x00 bytes
+ *
+ * @param in - data
+ * @param len - data length
+ * @param out - at least len + len / 254 + 1 bytes
+ *
+ * @return size_t - encoded length, no delimiter
+ */
+size_t proto_cobs_encode(const uint8_t *in, size_t len, uint8_t *out) {
+    size_t code_pos = 0;
+    size_t out_len = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (in[i]) {
+            out[out_len++] = in[i];
+            code++;
+        }
+        // a zero, or a full block of 254 non-zero bytes, closes the block
+        if (!in[i] || code == 0xff) {
+            out[code_pos] = code;
+            code_pos = out_len++;
+            code = 1;
+        }
+    }
+    out[code_pos] = code;
+
+    return out_len;
+}
+
+/**
+ * COBS decode, in and out may be the same buffer
+ *
+ * @param in - encoded data, no delimiter
+ * @param len - encoded length
+ * @param out - at least len bytes
+ *
+ * @return size_t - decoded length, 0 if the data isn't valid COBS
+ */
+size_t proto_cobs_decode(const uint8_t *in, size_t len, uint8_t *out) {
+    size_t out_len = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        uint8_t code = in[i++];
+        if (!code || i + code - 1 > len) return 0;
+
+        for (uint8_t j = 1; j < code; j++) {
+            out[out_len++] = in[i++];
+        }
+        // a short block stands for a zero, except at the very end
+        if (code != 0xff && i < len) {
+            out[out_len++] = 0;
+        }
+    }
+
+    return out_len;
+}
+
+/**
+ * CRC-16/CCITT-FALSE (poly 0x1021, init 0xffff)
+ *
+ * @param data
+ * @param len
+ *
+ * @return uint16_t
+ */
+uint16_t proto_crc16(const uint8_t *data, size_t len) {
+    uint16_t crc = 0xffff;
+
+    for (size_t i = 0; i < len; i++) {
+        crc = (crc << 4) ^ crc16_nibble[(crc >> 12) ^ (data[i] >> 4)];
+        crc = (crc << 4) ^ crc16_nibble[(crc >> 12) ^ (data[i] & 0x0f)];
+    }
+
+    return crc;
+}
+
+/**
+ * Start a new frame
+ *
+ * @param frame
+ * @param seq - sequence number, echoed in the response
+ *
+ * @return void
+ */
+void proto_frame_begin(proto_frame_t *frame, uint8_t seq) {
+    frame->buf[0] = seq;
+    frame->buf[1] = 0;
+    frame->len = PROTO_HEADER_SIZE;
+}
+
+/**
+ * Add an item and get a pointer to fill in its data
+ *
+ * @param frame
+ * @param op - PROTO_OP_*
+ * @param len - data length
+ *
+ * @return uint8_t * - data of the new item, NULL if it doesn't fit
+ */
+uint8_t *proto_frame_reserve(proto_frame_t *frame, uint8_t op, uint8_t len) {
+    if (frame->buf[1] == 0xff || frame->len + 2 + len + PROTO_CRC_SIZE > PROTO_FRAME_MAX) return NULL;
+
+    frame->buf[frame->len++] = op;
+    frame->buf[frame->len++] = len;
+    frame->buf[1]++;
+
+    uint8_t *data = &frame->buf[frame->len];
+    frame->len += len;
+    return data;
+}
+
+/**
+ * Add an item
+ *
+ * @param frame
+ * @param op - PROTO_OP_*
+ * @param data - item data
+ * @param len - data length
+ *
+ * @return bool - false if the frame is full, send it and start another
+ */
+bool proto_frame_add(proto_frame_t *frame, uint8_t op, const void *data, uint8_t len) {
+    uint8_t *dest = proto_frame_reserve(frame, op, len);
+    if (!dest) return false;
+
+    if (len) memcpy(dest, data, len);
+    return true;
+}
+
+/**
+ * Get the number of items in a frame
+ *
+ * @param frame
+ *
+ * @return uint8_t
+ */
+uint8_t proto_frame_count(const proto_frame_t *frame) {
+    return frame->buf[1];
+}
+
+/**
+ * Append the CRC, the frame in buf is then complete as is, for
+ * transports that delimit frames themselves (UDP)
+ *
+ * @param frame
+ *
+ * @return size_t - frame length, CRC included
+ */
+size_t proto_frame_finish(proto_frame_t *frame) {
+    uint16_t crc = proto_crc16(frame->buf, frame->len);
+    frame->buf[frame->len] = crc & 0xff;
+    frame->buf[frame->len + 1] = crc >> 8;
+
+    return frame->len + PROTO_CRC_SIZE;
+}
+
+/**
+ * Append the CRC and encode the frame for the wire
+ *
+ * @param frame
+ * @param out - PROTO_ENCODED_MAX bytes
+ *
+ * @return size_t - bytes to send, delimiter included
+ */
+size_t proto_frame_encode(proto_frame_t *frame, uint8_t *out) {
+    size_t len = proto_cobs_encode(frame->buf, proto_frame_finish(frame), out);
+    out[len++] = 0;
+    return len;
+}
+
+/**
+ * Check a decoded frame and start reading its items
+ *
+ * @param reader
+ * @param frame - decoded frame, from proto_rx_feed()
+ * @param len - decoded length
+ *
+ * @return bool - false on a bad CRC or truncated frame
+ */
+bool proto_reader_init(proto_reader_t *reader, const uint8_t *frame, size_t len) {
+    if (len < PROTO_HEADER_SIZE + PROTO_CRC_SIZE) return false;
+
+    uint16_t crc = frame[len - 2] | (frame[len - 1] << 8);
+    if (proto_crc16(frame, len - PROTO_CRC_SIZE) != crc) return false;
+
+    reader->seq = frame[0];
+    reader->count = frame[1];
+    reader->index = 0;
+    reader->pos = frame + PROTO_HEADER_SIZE;
+    reader->end = frame + len - PROTO_CRC_SIZE;
+
+    // walk the items once so proto_reader_next() never sees a truncated one
+    const uint8_t *pos = reader->pos;
+    for (uint8_t i = 0; i < reader->count; i++) {
+        if (reader->end - pos < 2 || reader->end - pos - 2 < pos[1]) return false;
+        pos += 2 + pos[1];
+    }
+
+    return pos == reader->end;
+}
+
+/**
+ * Read the next item
+ *
+ * @param reader
+ * @param item - points into the frame
+ *
+ * @return bool - false after the last item
+ */
+bool proto_reader_next(proto_reader_t *reader, proto_item_t *item) {
+    if (reader->index == reader->count) return false;
+
+    item->op = reader->pos[0];
+    item->len = reader->pos[1];
+    item->data = reader->pos + 2;
+    reader->pos += 2 + item->len;
+    reader->index++;
+
+    return true;
+}
+
+/**
+ * Initialize a stream receiver
+ *
+ * @param rx
+ *
+ * @return void
+ */
+void proto_rx_init(proto_rx_t *rx) {
+    memset(rx, 0, sizeof(*rx));
+}
+
+/**
+ * Feed one received byte
+ *
+ * @param rx
+ * @param byte
+ * @param frame - PROTO_ENCODED_MAX bytes, receives the decoded frame
+ *
+ * @return size_t - decoded frame length once a frame is complete, else 0
+ */
+size_t proto_rx_feed(proto_rx_t *rx, uint8_t byte, uint8_t *frame) {
+    if (byte) {
+        if (rx->len < sizeof(rx->buf)) {
+            rx->buf[rx->len++] = byte;
+        } else {
+            rx->overflow = true;
+        }
+        return 0;
+    }
+
+    // delimiter, an empty frame is just resync padding
+    size_t len = rx->overflow ? 0 : proto_cobs_decode(rx->buf, rx->len, frame);
+    if (rx->len && !len) rx->errors++;
+    if (len) rx->frames++;
+
+    rx->len = 0;
+    rx->overflow = false;
+    return len;
+}
+
+/**
+ * Run every command of a request frame and build the response
+ *
+ * Commands run in order. Once the response is full the remaining
+ * commands are not run and the host sees fewer items than it sent,
+ * handlers return PROTO_STATUS_NO_SPACE if their reply doesn't fit.
+ *
+ * @param handlers - indexed by op, NULL for unknown ops
+ * @param count - number of handlers
+ * @param frame - decoded request
+ * @param len - decoded length
+ * @param response - receives the response, not finished yet
+ * @param timing - times each handler call, NULL for none
+ * @param user - passed to the handlers and timing->served
+ *
+ * @return bool - false if the request was corrupt
+ */
+bool proto_dispatch(const proto_handler_t *handlers, uint8_t count, const uint8_t *frame, size_t len,
+                    proto_frame_t *response, const proto_timing_t *timing, void *user) {
+    proto_reader_t reader;
+    proto_item_t item;
+
+    if (!proto_reader_init(&reader, frame, len)) return false;
+
+    proto_frame_begin(response, reader.seq);
+
+    while (proto_reader_next(&reader, &item)) {
+        // status byte first, the frame may be full already
+        if (response->len + 2 + 1 + PROTO_CRC_SIZE > PROTO_FRAME_MAX) break;
+
+        // the reply can take what's left, the length byte counts the status too
+        size_t room = PROTO_FRAME_MAX - response->len - 2 - 1 - PROTO_CRC_SIZE;
+        uint8_t reply_len = room > 0xfe ? 0xfe : room;
+        uint8_t *data = proto_frame_reserve(response, item.op, 1);
+        uint8_t status;
+
+        if (item.op >= count || !handlers[item.op]) {
+            status = PROTO_STATUS_UNKNOWN_OP;
+            reply_len = 0;
+        } else if (timing) {
+            uint32_t start = timing->ticks();
+            status = handlers[item.op](item.data, item.len, data + 1, &reply_len, user);
+            timing->served(item.op, status, timing->ticks() - start, user);
+        } else {
+            status = handlers[item.op](item.data, item.len, data + 1, &reply_len, user);
+        }
+
+        // grow the item by the reply written right behind the status byte
+        data[0] = status;
+        data[-1] = 1 + reply_len;
+        response->len += reply_len;
+    }
+
+    return true;
+}
+
+/**
+ * Run a request from a byte stream, see proto_dispatch()
+ *
+ * @param handlers - indexed by op, NULL for unknown ops
+ * @param count - number of handlers
+ * @param frame - decoded request, from proto_rx_feed()
+ * @param len - decoded length
+ * @param out - PROTO_ENCODED_MAX bytes, receives the encoded response
+ * @param user - passed to the handlers
+ *
+ * @return size_t - bytes to send, 0 if the request was corrupt
+ */
+size_t proto_handle(const proto_handler_t *handlers, uint8_t count, const uint8_t *frame, size_t len, uint8_t *out, void *user) {
+    proto_frame_t response;
+
+    if (!proto_dispatch(handlers, count, frame, len, &response, NULL, user)) return 0;
+
+    return proto_frame_encode(&response, out);
+}
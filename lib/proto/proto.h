@@ -0,0 +1,129 @@
+/**
+ * @brief Binary framed command protocol
+ *
+ * Frames carry a batch of commands, so one USB transfer can do the
+ * work of hundreds of text commands.
+ *
+ * Frame on the wire:
+ *
+ *   COBS(seq, count, item * count, crc16) 0x00
+ *
+ *   item = op, len, data[len]
+ *
+ * - COBS removes every 0x00 from the frame, so 0x00 always marks the
+ *   end of a frame and a receiver resyncs on the next one after noise
+ * - crc16 is CRC-16/CCITT-FALSE over seq .. last item, little endian
+ * - a response has the seq of its request and one item per command,
+ *   same op, data[0] is a PROTO_STATUS_* code followed by the reply
+ *
+ * Over UDP a datagram carries the frame without COBS and delimiter,
+ * see proto_server.h.
+ *
+ * Plain C, no SDK, shared by the firmware (picow_proto, picow_udp)
+ * and the host client (host/proto_cli).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// frame before COBS: seq, count, items and crc
+#define PROTO_FRAME_MAX 256
+#define PROTO_HEADER_SIZE 2
+#define PROTO_CRC_SIZE 2
+// COBS adds one byte per 254, plus one, plus the delimiter
+#define PROTO_ENCODED_MAX (PROTO_FRAME_MAX + PROTO_FRAME_MAX / 254 + 2)
+// largest item data, whole frame to itself
+#define PROTO_DATA_MAX (PROTO_FRAME_MAX - PROTO_HEADER_SIZE - PROTO_CRC_SIZE - 2)
+
+// commands
+#define PROTO_OP_PING 0x01      // data echoed back
+#define PROTO_OP_LED 0x02       // data[0]: 0 off, 1 on
+#define PROTO_OP_GPIO_PUT 0x03  // data[0]: pin, data[1]: level
+#define PROTO_OP_GPIO_GET 0x04  // data[0]: pin, reply: level
+#define PROTO_OP_UPTIME 0x05    // reply: us since boot, 64 bits little endian
+#define PROTO_OP_BOOTSEL 0x06   // reboot to BOOTSEL mode after the reply
+#define PROTO_OP_PWM 0x07       // data[0]: pin, data[1..2]: level 0-65535, little endian
+#define PROTO_OP_TIMER 0x08     // data[0..3]: pin toggle frequency in Hz, 0 stops, little endian
+#define PROTO_OP_HIST 0x09      // data[0]: op, data[1]: 1 resets after reading, see proto_server.h
+#define PROTO_OP_COUNT 0x0a
+
+// first data byte of every response item
+#define PROTO_STATUS_OK 0
+#define PROTO_STATUS_UNKNOWN_OP 1
+#define PROTO_STATUS_BAD_LENGTH 2
+#define PROTO_STATUS_BAD_ARGUMENT 3
+#define PROTO_STATUS_NO_SPACE 4
+
+typedef struct {
+    uint8_t op;
+    uint8_t len;
+    const uint8_t *data;
+} proto_item_t;
+
+// frame under construction
+typedef struct {
+    uint8_t buf[PROTO_FRAME_MAX];
+    size_t len;
+} proto_frame_t;
+
+// frame being read
+typedef struct {
+    const uint8_t *pos;
+    const uint8_t *end;
+    uint8_t seq;
+    uint8_t count;
+    uint8_t index;
+} proto_reader_t;
+
+// stream receiver, collects bytes up to the next delimiter
+typedef struct {
+    uint8_t buf[PROTO_ENCODED_MAX];
+    size_t len;
+    bool overflow;
+    uint32_t frames;
+    uint32_t errors;
+} proto_rx_t;
+
+/**
+ * Command handler
+ *
+ * @param data - command data
+ * @param len - command data length
+ * @param reply - room for the reply data (after the status byte)
+ * @param reply_len - in: room in reply, out: reply length
+ * @param user - user pointer given to proto_handle()
+ * @return uint8_t - PROTO_STATUS_*
+ */
+typedef uint8_t (*proto_handler_t)(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user);
+
+// optional timing of every handler call in proto_dispatch()
+typedef struct {
+    // free-running counter, counting up
+    uint32_t (*ticks)(void);
+    // called after each handler with the difference of two ticks() reads
+    void (*served)(uint8_t op, uint8_t status, uint32_t ticks, void *user);
+} proto_timing_t;
+
+size_t proto_cobs_encode(const uint8_t *in, size_t len, uint8_t *out);
+size_t proto_cobs_decode(const uint8_t *in, size_t len, uint8_t *out);
+uint16_t proto_crc16(const uint8_t *data, size_t len);
+
+void proto_frame_begin(proto_frame_t *frame, uint8_t seq);
+bool proto_frame_add(proto_frame_t *frame, uint8_t op, const void *data, uint8_t len);
+uint8_t *proto_frame_reserve(proto_frame_t *frame, uint8_t op, uint8_t len);
+uint8_t proto_frame_count(const proto_frame_t *frame);
+size_t proto_frame_finish(proto_frame_t *frame);
+size_t proto_frame_encode(proto_frame_t *frame, uint8_t *out);
+
+bool proto_reader_init(proto_reader_t *reader, const uint8_t *frame, size_t len);
+bool proto_reader_next(proto_reader_t *reader, proto_item_t *item);
+
+void proto_rx_init(proto_rx_t *rx);
+size_t proto_rx_feed(proto_rx_t *rx, uint8_t byte, uint8_t *frame);
+
+bool proto_dispatch(const proto_handler_t *handlers, uint8_t count, const uint8_t *frame, size_t len,
+                    proto_frame_t *response, const proto_timing_t *timing, void *user);
+size_t proto_handle(const proto_handler_t *handlers, uint8_t count, const uint8_t *frame, size_t len, uint8_t *out, void *user);
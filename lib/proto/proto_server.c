@@ -0,0 +1,104 @@
+#include <string.h>
+#include "proto_server.h"
+
+static inline void put32(uint8_t *p, uint32_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+/**
+ * proto_timing_t served callback, one histogram entry per command
+ *
+ * @return void
+ */
+static void server_served(uint8_t op, uint8_t status, uint32_t ticks, void *user) {
+    proto_server_t *server = user;
+
+    if (op < PROTO_OP_COUNT) {
+        hist_add(&server->hists[op], ticks & server->clock.tick_mask);
+    }
+}
+
+/**
+ * Set up a server, the histograms start empty
+ *
+ * @param server
+ * @param handlers - indexed by op, NULL for unknown ops
+ * @param count - number of handlers
+ * @param clock - ticks for the histograms, microseconds for the acks
+ *
+ * @return void
+ */
+void proto_server_init(proto_server_t *server, const proto_handler_t *handlers, uint8_t count, const proto_clock_t *clock) {
+    memset(server, 0, sizeof(*server));
+    server->handlers = handlers;
+    server->count = count;
+    server->clock = *clock;
+    server->timing.ticks = clock->ticks;
+    server->timing.served = server_served;
+
+    for (uint32_t i = 0; i < PROTO_OP_COUNT; i++) {
+        hist_reset(&server->hists[i]);
+    }
+}
+
+/**
+ * Run a request datagram and build the response datagram
+ *
+ * @param server
+ * @param request - frame, no COBS
+ * @param len - request length
+ * @param rx_us - when the request arrived
+ * @param out - PROTO_SERVER_DATAGRAM_MAX bytes, receives the response
+ *
+ * @return size_t - bytes to send, 0 if the request was corrupt
+ */
+size_t proto_server_handle(proto_server_t *server, const uint8_t *request, size_t len, uint32_t rx_us, uint8_t *out) {
+    proto_frame_t response;
+
+    if (len > PROTO_FRAME_MAX ||
+        !proto_dispatch(server->handlers, server->count, request, len, &response, &server->timing, server)) {
+        server->bad++;
+        return 0;
+    }
+    server->requests++;
+
+    size_t frame_len = proto_frame_finish(&response);
+    memcpy(out + PROTO_SERVER_ACK_SIZE, response.buf, frame_len);
+
+    put32(out, rx_us);
+    put32(out + 4, server->clock.now_us());
+    return PROTO_SERVER_ACK_SIZE + frame_len;
+}
+
+/**
+ * PROTO_OP_HIST handler, the service times of one op
+ *
+ * @param data - op, optionally 1 to reset it after reading
+ * @param len
+ * @param reply - tick_hz u32, hist_encode()
+ * @param reply_len
+ * @param user - the server
+ *
+ * @return uint8_t - PROTO_STATUS_*
+ */
+uint8_t proto_server_hist_op(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    proto_server_t *server = user;
+    uint8_t room = *reply_len;
+
+    *reply_len = 0;
+    // not behind a server, e.g. proto_handle() over USB
+    if (!server) return PROTO_STATUS_UNKNOWN_OP;
+    if (len != 1 && len != 2) return PROTO_STATUS_BAD_LENGTH;
+    if (data[0] >= PROTO_OP_COUNT) return PROTO_STATUS_BAD_ARGUMENT;
+    if (room < 4 + HIST_HEADER_SIZE) return PROTO_STATUS_NO_SPACE;
+
+    hist_t *hist = &server->hists[data[0]];
+    put32(reply, server->clock.tick_hz);
+    *reply_len = 4 + hist_encode(hist, reply + 4, room - 4);
+
+    if (len == 2 && data[1]) hist_reset(hist);
+    return PROTO_STATUS_OK;
+}
@@ -0,0 +1,69 @@
+/**
+ * @brief lib/proto over datagrams, with per-command service times
+ *
+ * A request datagram is one frame as is (seq, count, items, crc), no
+ * COBS: the datagram delimits it and UDP has its own checksum, the CRC
+ * stays so the frame code is the one used over USB. The response:
+ *
+ *   rx_us u32, tx_us u32, frame
+ *
+ * rx_us is when the request arrived (stamped by the transport as it
+ * comes in), tx_us when the response was done, both from the board's
+ * microsecond timer and little endian. tx_us - rx_us is the time
+ * spent on the board, the rest of a round trip is network and host.
+ *
+ * Every handler call is timed with the server's tick counter (SysTick
+ * cycles on the RP2040) into a hist_t per op. PROTO_OP_HIST reads one:
+ *
+ *   reply: tick_hz u32, hist_encode() of the op's service times
+ *
+ * The handlers get the server as their user pointer, so the table can
+ * use proto_server_hist_op for PROTO_OP_HIST.
+ *
+ * Plain C, proto_udp.c is the lwIP raw API transport, host/proto_cli
+ * runs the same server on a Linux socket for --udp-loopback.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hist.h"
+#include "proto.h"
+
+#define PROTO_UDP_PORT 5006
+// rx_us and tx_us in front of the response frame
+#define PROTO_SERVER_ACK_SIZE 8
+#define PROTO_SERVER_DATAGRAM_MAX (PROTO_SERVER_ACK_SIZE + PROTO_FRAME_MAX)
+
+typedef struct {
+    // free-running counter counting up, wraps at tick_mask + 1
+    uint32_t (*ticks)(void);
+    uint32_t tick_mask;
+    uint32_t tick_hz;
+    // ack timestamps
+    uint32_t (*now_us)(void);
+} proto_clock_t;
+
+typedef struct {
+    const proto_handler_t *handlers;
+    uint8_t count;
+    proto_clock_t clock;
+    proto_timing_t timing;
+    // service times in ticks, by op
+    hist_t hists[PROTO_OP_COUNT];
+
+    uint32_t requests;
+    // corrupt or oversized requests, no response
+    uint32_t bad;
+    // responses the transport couldn't send
+    uint32_t send_errors;
+} proto_server_t;
+
+void proto_server_init(proto_server_t *server, const proto_handler_t *handlers, uint8_t count, const proto_clock_t *clock);
+size_t proto_server_handle(proto_server_t *server, const uint8_t *request, size_t len, uint32_t rx_us, uint8_t *out);
+uint8_t proto_server_hist_op(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user);
+
+// lwIP transport, see proto_udp.c
+bool proto_udp_init(proto_server_t *server, const proto_handler_t *handlers, uint8_t count, uint16_t port);
@@ -0,0 +1,112 @@
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "hardware/clocks.h"
+#include "hardware/structs/systick.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include "proto_server.h"
+
+static struct udp_pcb *proto_pcb;
+
+/**
+ * SysTick counts down at the CPU clock, turned around so it counts up
+ *
+ * @return uint32_t
+ */
+static uint32_t proto_udp_ticks(void) {
+    return 0xffffff - systick_hw->cvr;
+}
+
+static uint32_t proto_udp_now_us(void) {
+    return time_us_32();
+}
+
+/**
+ * lwIP receive callback, runs the request and answers right away
+ *
+ * Called from lwIP's context: cyw43_arch_poll() with
+ * pico_cyw43_arch_lwip_poll, the low priority background interrupt
+ * with pico_cyw43_arch_lwip_threadsafe_background. The handlers run
+ * there too.
+ *
+ * @param arg - the server
+ * @param pcb
+ * @param p - request datagram, ours to free
+ * @param addr - sender, the response goes back there
+ * @param port
+ *
+ * @return void
+ */
+static void proto_udp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port) {
+    // first thing, the rest of the callback is time on the board
+    uint32_t rx_us = time_us_32();
+    proto_server_t *server = arg;
+    static uint8_t request[PROTO_FRAME_MAX];
+
+    // the cyw43 driver hands over one pbuf per packet, copy in case it's a chain
+    bool whole = p->tot_len <= sizeof(request);
+    uint16_t len = pbuf_copy_partial(p, request, sizeof(request), 0);
+    pbuf_free(p);
+
+    if (!whole) {
+        server->bad++;
+        return;
+    }
+
+    // one PBUF_RAM pbuf, contiguous, the response is built straight into it
+    struct pbuf *out = pbuf_alloc(PBUF_TRANSPORT, PROTO_SERVER_DATAGRAM_MAX, PBUF_RAM);
+    if (!out) {
+        server->send_errors++;
+        return;
+    }
+
+    size_t out_len = proto_server_handle(server, request, len, rx_us, out->payload);
+    if (out_len) {
+        pbuf_realloc(out, out_len);
+        if (udp_sendto(pcb, out, addr, port) != ERR_OK) server->send_errors++;
+    }
+    pbuf_free(out);
+}
+
+/**
+ * Serve lib/proto commands on a UDP port, lwIP has to be up already
+ *
+ * Service times are SysTick cycles, SysTick is started here if it
+ * isn't running (lib/bench sets it up the same way).
+ *
+ * @param server
+ * @param handlers - indexed by op, NULL for unknown ops
+ * @param count - number of handlers
+ * @param port - e.g. PROTO_UDP_PORT
+ *
+ * @return bool - false if there's no pcb left or the port is taken
+ */
+bool proto_udp_init(proto_server_t *server, const proto_handler_t *handlers, uint8_t count, uint16_t port) {
+    if (!(systick_hw->csr & 0x1)) {
+        // free running at the CPU clock, no interrupt
+        systick_hw->rvr = 0xffffff;
+        systick_hw->cvr = 0;
+        systick_hw->csr = 0x5;
+    }
+
+    proto_clock_t clock = {
+        .ticks = proto_udp_ticks,
+        .tick_mask = 0xffffff,
+        .tick_hz = clock_get_hz(clk_sys),
+        .now_us = proto_udp_now_us,
+    };
+    proto_server_init(server, handlers, count, &clock);
+
+    cyw43_arch_lwip_begin();
+
+    bool ok = false;
+    proto_pcb = udp_new();
+    if (proto_pcb && udp_bind(proto_pcb, IP_ANY_TYPE, port) == ERR_OK) {
+        udp_recv(proto_pcb, proto_udp_recv, server);
+        ok = true;
+    }
+
+    cyw43_arch_lwip_end();
+
+    return ok;
+}
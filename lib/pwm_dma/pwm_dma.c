@@ -0,0 +1,154 @@
+#include "hardware/dma.h"
+#include "hardware/pwm.h"
+#include "pwm_dma.h"
+
+/**
+ * Get log2 of a power of two, used for the ring sizes
+ *
+ * @param value - power of two
+ *
+ * @return uint
+ */
+static uint log2_pow2(uint value) {
+    uint bits = 0;
+    while ((1u << bits) < value) bits++;
+    return bits;
+}
+
+static bool is_pow2(uint value) {
+    return value && !(value & (value - 1));
+}
+
+/**
+ * Initialize the engine and claim its 2 DMA channels
+ *
+ * The engine drives slices 0 .. num_slices - 1. All outputs start at
+ * level 0, use pwm_dma_set_wave() to give them a waveform.
+ *
+ * @param engine - engine state, must stay valid while running
+ * @param num_slices - number of slices to drive (1, 2, 4 or 8)
+ * @param num_steps - number of steps in the frame table (power of two)
+ * @param frames - frame buffer from PWM_DMA_FRAMES(name, num_slices, num_steps)
+ *
+ * @return bool - false if the sizes can't be driven through a DMA ring
+ */
+bool pwm_dma_init(pwm_dma_t *engine, uint num_slices, uint num_steps, uint32_t *frames) {
+    uint frame_bytes = num_slices * num_steps * sizeof(uint32_t);
+
+    if (!is_pow2(num_slices) || num_slices > PWM_DMA_MAX_SLICES || !is_pow2(num_steps)) {
+        return false;
+    }
+    // the ring needs a naturally aligned buffer no bigger than 2^15 bytes
+    if (frame_bytes > PWM_DMA_MAX_FRAME_BYTES || ((uintptr_t) frames & (frame_bytes - 1))) {
+        return false;
+    }
+
+    engine->frames = frames;
+    engine->num_slices = num_slices;
+    engine->num_steps = num_steps;
+
+    for (uint slice = 0; slice < num_slices; slice++) {
+        // derive the address from the register map instead of hard-coding it
+        engine->cc_addrs[slice] = (uint32_t) (uintptr_t) &pwm_hw->slice[slice].cc;
+    }
+    for (uint i = 0; i < num_slices * num_steps; i++) {
+        frames[i] = 0;
+    }
+
+    engine->data_channel = dma_claim_unused_channel(true);
+    engine->control_channel = dma_claim_unused_channel(true);
+
+    return true;
+}
+
+/**
+ * Load a wavetable into one PWM channel of the frame table
+ *
+ * The same wavetable can be shared by any number of channels, the
+ * phase shifts where each of them starts in it.
+ *
+ * @param engine - engine state
+ * @param slice - PWM slice
+ * @param chan - PWM_CHAN_A or PWM_CHAN_B
+ * @param wavetable - PWM levels, NULL holds the channel at 0
+ * @param length - number of levels in the wavetable
+ * @param phase - index of the level used on step 0
+ *
+ * @return void
+ */
+void pwm_dma_set_wave(pwm_dma_t *engine, uint slice, uint chan, const uint16_t *wavetable, uint length, uint phase) {
+    // channel b lives in the upper 16 bits of the CC register
+    uint shift = chan == PWM_CHAN_B ? 16 : 0;
+
+    for (uint step = 0; step < engine->num_steps; step++) {
+        uint32_t *frame = &engine->frames[step * engine->num_slices + slice];
+        uint32_t level = wavetable ? wavetable[(step + phase) % length] : 0;
+        *frame = (*frame & ~(0xffffu << shift)) | (level << shift);
+    }
+}
+
+/**
+ * Start streaming the frame table to the PWM slices
+ *
+ * @param engine - engine state
+ * @param dreq_slice - slice whose wrap paces the updates, usually one of
+ *                     the driven slices running with the same config
+ *
+ * @return void
+ */
+void pwm_dma_start(pwm_dma_t *engine, uint dreq_slice) {
+    uint frame_bits = log2_pow2(engine->num_slices * engine->num_steps * sizeof(uint32_t));
+    uint control_bits = log2_pow2(engine->num_slices * sizeof(uint32_t));
+
+    // data channel: one CC word per PWM wrap, then hand over to the control channel
+    dma_channel_config data_config = dma_channel_get_default_config(engine->data_channel);
+    channel_config_set_transfer_data_size(&data_config, DMA_SIZE_32);
+    channel_config_set_read_increment(&data_config, true);
+    channel_config_set_write_increment(&data_config, false);
+    channel_config_set_ring(&data_config, false, frame_bits);
+    channel_config_set_dreq(&data_config, pwm_get_dreq(dreq_slice));
+    channel_config_set_chain_to(&data_config, engine->control_channel);
+
+    dma_channel_configure(
+        engine->data_channel, // channel
+        &data_config, // config
+        &pwm_hw->slice[0].cc, // set by the control channel
+        engine->frames, // walks the frame table
+        1, // one CC word per trigger
+        false // started by the control channel
+    );
+
+    // control channel: next CC register address into the data channel's
+    // alias 2 write address, which also triggers it
+    dma_channel_config control_config = dma_channel_get_default_config(engine->control_channel);
+    channel_config_set_transfer_data_size(&control_config, DMA_SIZE_32);
+    channel_config_set_read_increment(&control_config, true);
+    channel_config_set_write_increment(&control_config, false);
+    channel_config_set_ring(&control_config, false, control_bits);
+
+    dma_channel_configure(
+        engine->control_channel, // channel
+        &control_config, // config
+        &dma_hw->ch[engine->data_channel].al2_write_addr_trig, // write address
+        engine->cc_addrs, // walks the CC register addresses
+        1, // one address per trigger
+        true // start now, everything is automatic from here...
+    );
+}
+
+/**
+ * Stop the engine, the PWM slices keep their last levels
+ *
+ * @param engine - engine state
+ *
+ * @return void
+ */
+void pwm_dma_stop(pwm_dma_t *engine) {
+    // break the chain first so the data channel can't restart the control channel
+    dma_channel_config data_config = dma_get_channel_config(engine->data_channel);
+    channel_config_set_chain_to(&data_config, engine->data_channel);
+    dma_channel_set_config(engine->data_channel, &data_config, false);
+
+    dma_channel_abort(engine->control_channel);
+    dma_channel_abort(engine->data_channel);
+}
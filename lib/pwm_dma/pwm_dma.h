@@ -0,0 +1,58 @@
+/**
+ * @brief N-slice DMA PWM waveform engine
+ *
+ * Drives up to all 8 PWM slices (16 channels) from wavetables with
+ * a fixed budget of 2 DMA channels, no matter how many outputs fade.
+ *
+ * How it works:
+ *
+ * Each PWM slice has one CC register holding both channel levels
+ * (b in the upper 16 bits, a in the lower 16 bits). The engine
+ * builds a frame table with one CC word per slice per step:
+ *
+ *   frames = [step 0: slice 0, slice 1, ... slice N-1][step 1: ...]...
+ *
+ * - data channel: copies the next frame word to a slice CC register,
+ *   paced by the PWM wrap DREQ, then chains to the control channel
+ * - control channel: walks the list of CC register addresses (derived
+ *   from pwm_hw->slice[n].cc) and writes the next one to the data
+ *   channel's al2_write_addr_trig, which triggers it again
+ *
+ * Both channels read through a DMA ring, so once started the engine
+ * runs forever without interrupts or CPU involvement. Every PWM wrap
+ * updates one slice, so each slice advances one step every N wraps.
+ */
+
+#pragma once
+
+#include "pico/stdlib.h"
+
+#define PWM_DMA_MAX_SLICES 8
+// the DMA ring can wrap at most 2^15 bytes
+#define PWM_DMA_MAX_FRAME_BYTES (1u << 15)
+
+/**
+ * Declare a frame buffer for the engine, aligned for the DMA ring
+ *
+ * @param name - variable name
+ * @param slices - number of slices (1, 2, 4 or 8)
+ * @param steps - number of steps (power of two)
+ */
+#define PWM_DMA_FRAMES(name, slices, steps) \
+    static uint32_t name[(slices) * (steps)] __attribute__((aligned((slices) * (steps) * sizeof(uint32_t))))
+
+typedef struct {
+    // CC register address of each slice, read by the control channel through a ring
+    uint32_t cc_addrs[PWM_DMA_MAX_SLICES] __attribute__((aligned(PWM_DMA_MAX_SLICES * sizeof(uint32_t))));
+    // CC words, num_steps * num_slices, read by the data channel through a ring
+    uint32_t *frames;
+    uint num_slices;
+    uint num_steps;
+    int data_channel;
+    int control_channel;
+} pwm_dma_t;
+
+bool pwm_dma_init(pwm_dma_t *engine, uint num_slices, uint num_steps, uint32_t *frames);
+void pwm_dma_set_wave(pwm_dma_t *engine, uint slice, uint chan, const uint16_t *wavetable, uint length, uint phase);
+void pwm_dma_start(pwm_dma_t *engine, uint dreq_slice);
+void pwm_dma_stop(pwm_dma_t *engine);
@@ -0,0 +1,119 @@
+#include "pwm_solver.h"
+
+/**
+ * Compare a * b with c * d without overflowing 64 bits
+ *
+ * a and c are the error numerators (< 2^48), b and d the periods
+ * (< 2^28), so each product is split on the 32-bit halves of a/c.
+ *
+ * @return int - <0, 0 or >0 like a * b - c * d
+ */
+static int compare_products(uint64_t a, uint32_t b, uint64_t c, uint32_t d) {
+    uint64_t ab_hi = (a >> 32) * b;
+    uint64_t ab_lo = (a & 0xffffffffu) * b;
+    uint64_t cd_hi = (c >> 32) * d;
+    uint64_t cd_lo = (c & 0xffffffffu) * d;
+
+    // carry the upper half of the low products into the high ones
+    ab_hi += ab_lo >> 32;
+    cd_hi += cd_lo >> 32;
+    ab_lo &= 0xffffffffu;
+    cd_lo &= 0xffffffffu;
+
+    if (ab_hi != cd_hi) return ab_hi < cd_hi ? -1 : 1;
+    if (ab_lo != cd_lo) return ab_lo < cd_lo ? -1 : 1;
+    return 0;
+}
+
+/**
+ * Fill in the achieved frequency and error of a setting
+ *
+ * @param sys_clk - system clock in Hz
+ * @param freq_mhz - requested frequency in mHz
+ * @param div16 - divider * 16
+ * @param wrap
+ * @param timing - result
+ *
+ * @return void
+ */
+void pwm_timing_from(uint32_t sys_clk, uint64_t freq_mhz, uint16_t div16, uint16_t wrap, pwm_timing_t *timing) {
+    uint64_t scale = PWM_SOLVE_SCALE(sys_clk);
+    uint64_t period = (uint64_t) div16 * (wrap + 1u);
+
+    timing->div16 = div16;
+    timing->wrap = wrap;
+    timing->frequency_mhz = (scale + period / 2) / period;
+    // (scale / period - freq) / freq, scaled before dividing
+    int64_t diff = (int64_t) scale - (int64_t) (freq_mhz * period);
+    timing->error_ppm = (int32_t) (diff * 1000000 / (int64_t) (freq_mhz * period));
+}
+
+/**
+ * Find the divider and wrap closest to a frequency
+ *
+ * For each of the 4080 dividers the best wrap is one of the two
+ * around scale / (freq * div16), clamped to the allowed range, so the
+ * search is exhaustive in 8160 candidates. Candidates are compared on
+ * their exact relative error |scale - freq * period| / period, no
+ * rounding involved.
+ *
+ * @param sys_clk - system clock in Hz
+ * @param freq_mhz - requested frequency in mHz
+ * @param min_levels - fewest duty cycle steps (wrap + 1) acceptable
+ * @param timing - result
+ *
+ * @return bool - false if the frequency is more than half a count
+ *                outside what the dividers and min_levels..65536
+ *                steps can produce
+ */
+bool pwm_solve(uint32_t sys_clk, uint64_t freq_mhz, uint32_t min_levels, pwm_timing_t *timing) {
+    uint64_t scale = PWM_SOLVE_SCALE(sys_clk);
+    uint64_t best_error = 0;
+    uint32_t best_period = 0;
+    uint32_t best_div16 = 0;
+    uint32_t best_wrap = 0;
+
+    if (!freq_mhz || !sys_clk) return false;
+    if (min_levels < 1) min_levels = 1;
+    if (min_levels > PWM_WRAP_MAX + 1) return false;
+
+    // more than half a count slower than the longest period or faster than the shortest one
+    uint64_t slowest = (uint64_t) PWM_DIV16_MAX * (2u * (PWM_WRAP_MAX + 1) + 1);
+    if (freq_mhz < (2 * scale + slowest - 1) / slowest) return false;
+    if (freq_mhz * PWM_DIV16_MIN * (2u * min_levels - 1) > 2 * scale) return false;
+
+    for (uint32_t div16 = PWM_DIV16_MIN; div16 <= PWM_DIV16_MAX; div16++) {
+        uint64_t top = scale / (freq_mhz * div16);
+
+        // the period (wrap + 1) just below and just above the ideal one
+        for (uint64_t ideal = top; ideal <= top + 1; ideal++) {
+            uint64_t counts = ideal;
+            if (counts < min_levels) counts = min_levels;
+            if (counts > PWM_WRAP_MAX + 1u) counts = PWM_WRAP_MAX + 1u;
+
+            uint32_t period = div16 * (uint32_t) counts;
+            uint64_t actual = freq_mhz * period;
+            uint64_t error = actual > scale ? actual - scale : scale - actual;
+
+            int better = best_period ? compare_products(error, best_period, best_error, period) : -1;
+            if (!better) {
+                // same error: finer duty steps, then integer dividers, then smaller dividers
+                if (counts - 1 != best_wrap) {
+                    better = counts - 1 > best_wrap ? -1 : 1;
+                } else if (!(div16 & 15) != !(best_div16 & 15)) {
+                    better = !(div16 & 15) ? -1 : 1;
+                }
+            }
+
+            if (better < 0) {
+                best_error = error;
+                best_period = period;
+                best_div16 = div16;
+                best_wrap = counts - 1;
+            }
+        }
+    }
+
+    pwm_timing_from(sys_clk, freq_mhz, best_div16, best_wrap, timing);
+    return true;
+}
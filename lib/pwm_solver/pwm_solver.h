@@ -0,0 +1,80 @@
+/**
+ * @brief PWM clock divider and wrap solver
+ *
+ * A PWM slice runs at
+ *
+ *   f = sys_clk / (div * (wrap + 1)),  div = int + frac / 16
+ *
+ * with an 8.4 fixed point divider (1.0 .. 255.9375) and a 16-bit wrap.
+ * pwm_solve() searches every divider, integer and fractional, for the
+ * wrap that gets closest to the target while giving at least
+ * min_levels duty cycle steps, and reports what it actually achieved.
+ *
+ * Ties go to the larger wrap (finer duty steps), then to an integer
+ * divider (no fractional jitter), then to the smaller divider.
+ *
+ * For constants, PWM_SOLVE_DIV16() and PWM_SOLVE_WRAP() give the
+ * maximum resolution setting as integer constant expressions, usable
+ * in initializers and _Static_assert().
+ *
+ * Plain C, no SDK, checked exhaustively on the host (host/pwm_solver_check).
+ * Frequencies are in mHz so slow blinks like 7.5 Hz are exact.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// divider * 16, 8.4 fixed point
+#define PWM_DIV16_MIN 16u
+#define PWM_DIV16_MAX 4095u
+#define PWM_WRAP_MAX 0xffffu
+
+// Hz to the mHz the solver takes
+#define PWM_HZ(hz) ((uint64_t) (hz) * 1000u)
+
+typedef struct {
+    // clock divider * 16, int = div16 >> 4, frac = div16 & 15
+    uint16_t div16;
+    // counter top, the period is wrap + 1 counts
+    uint16_t wrap;
+    // achieved frequency in mHz, rounded
+    uint64_t frequency_mhz;
+    // achieved vs requested frequency
+    int32_t error_ppm;
+} pwm_timing_t;
+
+//
+// Compile-time version: the smallest divider that fits the period in
+// 16 bits (so the largest wrap), then the nearest wrap for it
+//
+
+// sys_clk * 16 * 1000, one count of an 8.4 divider in mHz
+#define PWM_SOLVE_SCALE(sys_clk) ((uint64_t) (sys_clk) * 16000u)
+#define PWM_SOLVE_DIV16_RAW(sys_clk, freq_mhz) \
+    ((PWM_SOLVE_SCALE(sys_clk) + (uint64_t) (freq_mhz) * 65536u - 1) / ((uint64_t) (freq_mhz) * 65536u))
+
+/**
+ * Divider * 16 for a constant frequency, 0 if it's too low to reach
+ *
+ * @param sys_clk - system clock in Hz
+ * @param freq_mhz - requested frequency in mHz
+ */
+#define PWM_SOLVE_DIV16(sys_clk, freq_mhz) \
+    (PWM_SOLVE_DIV16_RAW(sys_clk, freq_mhz) > PWM_DIV16_MAX ? 0u : \
+     PWM_SOLVE_DIV16_RAW(sys_clk, freq_mhz) < PWM_DIV16_MIN ? PWM_DIV16_MIN : \
+     (uint32_t) PWM_SOLVE_DIV16_RAW(sys_clk, freq_mhz))
+
+/**
+ * Wrap for a constant frequency, rounded to the nearest count
+ *
+ * @param sys_clk - system clock in Hz
+ * @param freq_mhz - requested frequency in mHz
+ */
+#define PWM_SOLVE_WRAP(sys_clk, freq_mhz) \
+    ((uint32_t) ((PWM_SOLVE_SCALE(sys_clk) + (uint64_t) (freq_mhz) * PWM_SOLVE_DIV16(sys_clk, freq_mhz) / 2) / \
+                 ((uint64_t) (freq_mhz) * PWM_SOLVE_DIV16(sys_clk, freq_mhz))) - 1)
+
+bool pwm_solve(uint32_t sys_clk, uint64_t freq_mhz, uint32_t min_levels, pwm_timing_t *timing);
+void pwm_timing_from(uint32_t sys_clk, uint64_t freq_mhz, uint16_t div16, uint16_t wrap, pwm_timing_t *timing);
@@ -0,0 +1,308 @@
+#include <stdio.h>
+#include <string.h>
+#include "shell.h"
+
+#if PICO_ON_DEVICE
+#include "pico/stdlib.h"
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// FNV-1a, 32 bits
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+_Static_assert((SHELL_RING_SIZE & (SHELL_RING_SIZE - 1)) == 0, "SHELL_RING_SIZE must be a power of two");
+_Static_assert((SHELL_TABLE_SIZE & (SHELL_TABLE_SIZE - 1)) == 0, "SHELL_TABLE_SIZE must be a power of two");
+
+/**
+ * Hash a command name
+ *
+ * @param const char *str
+ * @return uint32_t
+ */
+uint32_t shell_hash(const char *str) {
+    uint32_t hash = FNV_OFFSET;
+
+    while (*str) {
+        hash = (hash ^ (uint8_t) *str++) * FNV_PRIME;
+    }
+
+    return hash;
+}
+
+/**
+ * Find the slot of a name in the hash table
+ *
+ * Linear probing, the table is at most half full so a probe
+ * ends after a slot or two.
+ *
+ * @param const shell_t *shell
+ * @param const char *name
+ * @param uint32_t hash - shell_hash(name)
+ * @return const shell_command_t * - NULL if not found
+ */
+static const shell_command_t *lookup(const shell_t *shell, const char *name, uint32_t hash) {
+    for (uint32_t i = 0; i < SHELL_TABLE_SIZE; i++) {
+        const shell_slot_t *slot = &shell->table[(hash + i) & (SHELL_TABLE_SIZE - 1)];
+
+        if (!slot->command) return NULL;
+        if (slot->hash == hash) {
+            const shell_command_t *command = &shell->commands[slot->command - 1];
+            if (strcmp(command->name, name) == 0) return command;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Initialize the shell and build the dispatch table
+ *
+ * @param shell_t *shell
+ * @param const shell_command_t *commands - static table, must outlive the shell
+ * @param uint8_t count - number of commands, at most SHELL_COMMANDS_MAX
+ * @param shell_getc_t getc - non-blocking input, e.g. shell_stdio_getc
+ * @return bool - false on too many or duplicate commands
+ */
+bool shell_init(shell_t *shell, const shell_command_t *commands, uint8_t count, shell_getc_t getc) {
+    memset(shell, 0, sizeof(*shell));
+    shell->commands = commands;
+    shell->count = count;
+    shell->getc = getc;
+
+    if (count > SHELL_COMMANDS_MAX) return false;
+
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t hash = shell_hash(commands[i].name);
+        if (lookup(shell, commands[i].name, hash)) return false;
+
+        uint32_t index = hash & (SHELL_TABLE_SIZE - 1);
+        while (shell->table[index].command) {
+            index = (index + 1) & (SHELL_TABLE_SIZE - 1);
+        }
+        shell->table[index].hash = hash;
+        shell->table[index].command = i + 1;
+    }
+
+    return true;
+}
+
+/**
+ * Find a command by name
+ *
+ * @param const shell_t *shell
+ * @param const char *name
+ * @return const shell_command_t * - NULL if not found
+ */
+const shell_command_t *shell_find(const shell_t *shell, const char *name) {
+    return lookup(shell, name, shell_hash(name));
+}
+
+/**
+ * Queue one input character, e.g. from an interrupt
+ *
+ * Only with getc NULL, shell_poll() pushes the getc input itself and
+ * the ring takes a single producer.
+ *
+ * @param shell_t *shell
+ * @param char c
+ * @return bool - false if the ring is full and the character was dropped
+ */
+bool shell_push(shell_t *shell, char c) {
+    uint32_t head = shell->ring_head;
+
+    if (head - __atomic_load_n(&shell->ring_tail, __ATOMIC_ACQUIRE) >= SHELL_RING_SIZE) return false;
+
+    shell->ring[head & (SHELL_RING_SIZE - 1)] = c;
+    // publishes the character, shell_poll() loads the head with acquire
+    __atomic_store_n(&shell->ring_head, head + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/**
+ * Split a line into arguments and run the command
+ *
+ * Arguments are separated by spaces or tabs, double quotes group
+ * an argument with spaces in it. The line is modified in place.
+ *
+ * @param shell_t *shell
+ * @param char *line
+ * @return bool - false for an empty line, an unknown command or too many arguments
+ */
+bool shell_execute(shell_t *shell, char *line) {
+    char *argv[SHELL_ARGS_MAX + 1];
+    int argc = 0;
+    uint32_t hash = FNV_OFFSET;
+    char *p = line;
+
+    while (*p) {
+        while (*p == ' ' || *p == '\t') p++;
+        if (!*p) break;
+
+        if (argc == SHELL_ARGS_MAX) {
+            printf("too many arguments (max %d)\n", SHELL_ARGS_MAX - 1);
+            return false;
+        }
+
+        bool quoted = *p == '"';
+        if (quoted) p++;
+        argv[argc++] = p;
+
+        while (*p && (quoted ? *p != '"' : (*p != ' ' && *p != '\t'))) {
+            // hash the command name on the way, no second pass
+            if (argc == 1) hash = (hash ^ (uint8_t) *p) * FNV_PRIME;
+            p++;
+        }
+        if (*p) *p++ = '\0';
+    }
+    argv[argc] = NULL;
+
+    if (!argc) return false;
+
+    const shell_command_t *command = lookup(shell, argv[0], hash);
+    if (!command) {
+        if (shell->unknown) {
+            shell->unknown(argc, argv);
+        } else {
+            printf("unknown command: %s\n", argv[0]);
+        }
+        return false;
+    }
+
+    command->handler(argc, argv);
+    return true;
+}
+
+/**
+ * Take one character from the ring into the line
+ *
+ * @param shell_t *shell
+ * @param char c
+ * @return bool - true if a line was completed and dispatched
+ */
+static bool shell_input(shell_t *shell, char c) {
+    bool cr = c == '\r';
+
+    // CRLF counts as one line end
+    if (c == '\n' && shell->last_cr) {
+        shell->last_cr = false;
+        return false;
+    }
+    shell->last_cr = cr;
+
+    if (cr || c == '\n') {
+        if (shell->echo) printf("\n");
+
+        bool overflow = shell->overflow;
+        shell->line[shell->length] = '\0';
+        shell->length = 0;
+        shell->overflow = false;
+        shell->prompted = false;
+
+        if (overflow) {
+            printf("line too long (max %d)\n", SHELL_LINE_MAX);
+            return false;
+        }
+        shell_execute(shell, shell->line);
+        return true;
+    }
+
+    // backspace and delete
+    if (c == '\b' || c == 0x7f) {
+        if (shell->length) {
+            shell->length--;
+            if (shell->echo) printf("\b \b");
+        }
+        return false;
+    }
+
+    if (shell->length < SHELL_LINE_MAX) {
+        shell->line[shell->length++] = c;
+        if (shell->echo) putchar(c);
+    } else {
+        shell->overflow = true;
+    }
+
+    return false;
+}
+
+/**
+ * Read the available input and run any complete lines, never waits
+ *
+ * @param shell_t *shell
+ * @return int - number of lines dispatched
+ */
+int shell_poll(shell_t *shell) {
+    int lines = 0;
+
+    if (shell->prompt && !shell->prompted) {
+        printf("%s", shell->prompt);
+        fflush(stdout);
+        shell->prompted = true;
+    }
+
+    // take what's there, up to what the ring can hold
+    if (shell->getc) {
+        while (shell->ring_head - shell->ring_tail < SHELL_RING_SIZE) {
+            int c = shell->getc();
+            if (c < 0) break;
+            shell_push(shell, (char) c);
+        }
+    }
+
+    // what was pushed up to now, a push from an interrupt meanwhile waits for the next poll
+    uint32_t head = __atomic_load_n(&shell->ring_head, __ATOMIC_ACQUIRE);
+    uint32_t tail = shell->ring_tail;
+
+    while (tail != head) {
+        char c = shell->ring[tail & (SHELL_RING_SIZE - 1)];
+        // the slot is free again before a slow handler runs
+        __atomic_store_n(&shell->ring_tail, ++tail, __ATOMIC_RELEASE);
+        lines += shell_input(shell, c);
+    }
+
+    if (shell->echo) fflush(stdout);
+
+    return lines;
+}
+
+/**
+ * Print the command table
+ *
+ * @param const shell_t *shell
+ * @return void
+ */
+void shell_print_help(const shell_t *shell) {
+    printf("Commands:\n");
+    for (uint8_t i = 0; i < shell->count; i++) {
+        printf("  %s: %s\n", shell->commands[i].name, shell->commands[i].help);
+    }
+}
+
+/**
+ * Non-blocking getc on stdio
+ *
+ * On the board this is getchar_timeout_us(0), on the host stdin
+ * is switched to non-blocking on first use.
+ *
+ * @return int - the character, or -1 if none is available
+ */
+int shell_stdio_getc(void) {
+#if PICO_ON_DEVICE
+    int c = getchar_timeout_us(0);
+    return c == PICO_ERROR_TIMEOUT ? -1 : c;
+#else
+    static bool nonblocking = false;
+    unsigned char c;
+
+    if (!nonblocking) {
+        fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+        nonblocking = true;
+    }
+
+    return read(STDIN_FILENO, &c, 1) == 1 ? c : -1;
+#endif
+}
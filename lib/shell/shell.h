@@ -0,0 +1,109 @@
+/**
+ * @brief Non-blocking line-oriented command shell
+ *
+ * shell_poll() takes whatever input is available right now (never
+ * waits), so it can sit in an application loop next to everything
+ * else. Characters go through a ring buffer into the line buffer,
+ * complete lines are split into argc/argv and dispatched through a
+ * hash table built once from a static command table:
+ *
+ *   static const shell_command_t commands[] = {
+ *       {"on", "Turn on the LED", cmd_on},
+ *       {"off", "Turn off the LED", cmd_off},
+ *   };
+ *
+ *   shell_init(&shell, commands, 2, shell_stdio_getc);
+ *   while (true) {
+ *       shell_poll(&shell);
+ *       // ... everything else
+ *   }
+ *
+ * Lookup hashes the command name while the line is split and probes
+ * the table once, so dispatch doesn't slow down with more commands.
+ *
+ * The ring has one producer and one consumer (shell_poll()). The
+ * producer is shell_poll() itself when a getc is given, or whoever
+ * calls shell_push(), e.g. a UART interrupt, when getc is NULL. Never
+ * both: an interrupt pushing while shell_poll() reads getc would be a
+ * second producer.
+ *
+ * Plain C and stdio, builds on the host against stdin/stdout.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// longest line, longer lines are dropped with an error
+#define SHELL_LINE_MAX 64
+// most arguments per line, command name included
+#define SHELL_ARGS_MAX 8
+// input ring, power of two
+#define SHELL_RING_SIZE 128
+// hash table slots, power of two, at least twice the number of commands
+#define SHELL_TABLE_SIZE 32
+#define SHELL_COMMANDS_MAX (SHELL_TABLE_SIZE / 2)
+
+/**
+ * Read one character without waiting
+ *
+ * @return int - the character, or -1 if none is available
+ */
+typedef int (*shell_getc_t)(void);
+
+/**
+ * Command handler
+ *
+ * @param argc - number of arguments, argv[0] is the command name
+ * @param argv - arguments, valid until the handler returns
+ */
+typedef void (*shell_handler_t)(int argc, char **argv);
+
+typedef struct {
+    const char *name;
+    const char *help;
+    shell_handler_t handler;
+} shell_command_t;
+
+typedef struct {
+    uint32_t hash;
+    // index into the command table + 1, 0 for an empty slot
+    uint8_t command;
+} shell_slot_t;
+
+typedef struct {
+    const shell_command_t *commands;
+    uint8_t count;
+    shell_slot_t table[SHELL_TABLE_SIZE];
+
+    shell_getc_t getc;
+    // printed before each line, NULL for none
+    const char *prompt;
+    // echo typed characters back, USB serial terminals don't echo locally
+    bool echo;
+    // called for unknown commands, NULL prints a message
+    shell_handler_t unknown;
+
+    char ring[SHELL_RING_SIZE];
+    // free-running, written by the producer / shell_poll() only,
+    // release/acquire ordered so the characters are there before the index
+    volatile uint32_t ring_head;
+    volatile uint32_t ring_tail;
+
+    char line[SHELL_LINE_MAX + 1];
+    uint32_t length;
+    bool overflow;
+    bool prompted;
+    // the previous line ended on CR, swallow the LF of a CRLF
+    bool last_cr;
+} shell_t;
+
+bool shell_init(shell_t *shell, const shell_command_t *commands, uint8_t count, shell_getc_t getc);
+bool shell_push(shell_t *shell, char c);
+int shell_poll(shell_t *shell);
+bool shell_execute(shell_t *shell, char *line);
+const shell_command_t *shell_find(const shell_t *shell, const char *name);
+void shell_print_help(const shell_t *shell);
+uint32_t shell_hash(const char *str);
+int shell_stdio_getc(void);
@@ -0,0 +1,103 @@
+#include "sigma_delta.h"
+
+#if PICO_ON_DEVICE
+#include "pico.h"
+// the encoder runs from RAM, so it doesn't wait on flash behind the other core
+#define SIGMA_DELTA_FUNC(name) __not_in_flash_func(name)
+#else
+#define SIGMA_DELTA_FUNC(name) name
+#endif
+
+// repeat a step for bits 0 .. 31
+#define STEP4(S, k) S(k) S((k) + 1) S((k) + 2) S((k) + 3)
+#define STEP32(S) STEP4(S, 0) STEP4(S, 4) STEP4(S, 8) STEP4(S, 12) STEP4(S, 16) STEP4(S, 20) STEP4(S, 24) STEP4(S, 28)
+
+// first order: add the sample, the carry out of 16 bits is the bit
+#define FIRST_ORDER_STEP(k)      \
+    acc += x;                    \
+    word |= (acc >> 16) << (k);  \
+    acc &= 0xffff;
+
+// second order: a one if the second integrator is above 0,
+// (uint32_t) -i2 >> 31 is that without a branch, then both
+// integrators take the sample minus what was sent
+#define SECOND_ORDER_STEP(k)                 \
+    bit = (uint32_t) -i2 >> 31;              \
+    word |= bit << (k);                      \
+    i1 += x - (int32_t) (bit << 16);         \
+    i2 += i1 - (int32_t) (bit << 16);
+
+/**
+ * Clamp an integrator
+ *
+ * @param value
+ * @param limit
+ *
+ * @return int32_t
+ */
+static inline int32_t clamp(int32_t value, int32_t limit) {
+    return value > limit ? limit : value < -limit ? -limit : value;
+}
+
+/**
+ * Reset an encoder
+ *
+ * @param sd
+ * @param order - 1 or 2, anything else is taken as 2
+ *
+ * @return void
+ */
+void sigma_delta_init(sigma_delta_t *sd, uint32_t order) {
+    sd->order = order == 1 ? 1 : 2;
+    sd->i1 = 0;
+    sd->i2 = 0;
+}
+
+/**
+ * Encode samples into words, one word per sample
+ *
+ * The state carries over between calls, so a stream can be encoded
+ * in blocks of any size with the same result as all at once.
+ *
+ * @param sd
+ * @param samples - 16-bit levels, 65535 is a one almost every bit
+ * @param words - receives count words, LSB first
+ * @param count
+ *
+ * @return void
+ */
+void SIGMA_DELTA_FUNC(sigma_delta_encode)(sigma_delta_t *sd, const uint16_t *samples, uint32_t *words, uint32_t count) {
+    if (sd->order == 1) {
+        uint32_t acc = sd->i1;
+
+        for (uint32_t n = 0; n < count; n++) {
+            uint32_t x = samples[n];
+            uint32_t word = 0;
+
+            STEP32(FIRST_ORDER_STEP)
+            words[n] = word;
+        }
+
+        sd->i1 = acc;
+        return;
+    }
+
+    int32_t i1 = sd->i1;
+    int32_t i2 = sd->i2;
+
+    for (uint32_t n = 0; n < count; n++) {
+        int32_t x = samples[n];
+        uint32_t word = 0;
+        uint32_t bit;
+
+        STEP32(SECOND_ORDER_STEP)
+        words[n] = word;
+
+        // from the limits a word takes i1 below 2^22 and i2 below 2^28, far from overflowing
+        i1 = clamp(i1, SIGMA_DELTA_I1_LIMIT);
+        i2 = clamp(i2, SIGMA_DELTA_I2_LIMIT);
+    }
+
+    sd->i1 = i1;
+    sd->i2 = i2;
+}
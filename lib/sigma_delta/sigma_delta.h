@@ -0,0 +1,52 @@
+/**
+ * @brief Sigma-delta (PDM) encoder for a 1-bit output
+ *
+ * Turns 16-bit samples into a bitstream whose density of ones is
+ * sample / 65536, packed 32 bits per word LSB first, the format
+ * picow_dma_pio's `out pins, 1` program shifts out. Each sample is
+ * held for one word, so a word is 32 PIO clocks.
+ *
+ * A thermometer code (`~(~0u << level)`) only has 33 densities per
+ * word. A sigma-delta modulator carries its quantization error over
+ * to the next bits instead of dropping it, so the average over a few
+ * words settles on the exact 16-bit level, the error is pushed up to
+ * frequencies an LED (or an RC filter) averages out:
+ *
+ * - first order: acc += x, every carry out of 16 bits is a one.
+ *   Always stable, the error is shaped by (1 - z^-1)
+ * - second order: two integrators in a loop (Candy's modulator), the
+ *   error is shaped by (1 - z^-1)^2, less of it at low frequencies
+ *   but more at high ones, it pays off behind a proper low pass, not
+ *   so much behind an LED. ~3x slower. The integrators are clamped
+ *   once per word so it recovers from the overload at 0 and full scale
+ *
+ * sigma_delta_encode() keeps the loop state in registers and builds
+ * whole words with no branches, one unrolled step per bit.
+ *
+ * Plain C, no SDK, checked bit for bit against a one bit at a time
+ * reference and benchmarked on the host (host/sigma_delta_bench).
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// a sample is held for one 32-bit word
+#define SIGMA_DELTA_BITS_PER_WORD 32
+
+// integrator limits of the second order loop, it swings up to ~32x full
+// scale by itself close to 0, so they only catch a real overload
+#define SIGMA_DELTA_I1_LIMIT (1 << 20)
+#define SIGMA_DELTA_I2_LIMIT (1 << 23)
+
+typedef struct {
+    // 1 or 2
+    uint32_t order;
+    // first order: 0 .. 65535 accumulator, second order: first integrator
+    int32_t i1;
+    // second order: second integrator
+    int32_t i2;
+} sigma_delta_t;
+
+void sigma_delta_init(sigma_delta_t *sd, uint32_t order);
+void sigma_delta_encode(sigma_delta_t *sd, const uint16_t *samples, uint32_t *words, uint32_t count);
@@ -0,0 +1,307 @@
+/**
+ * @brief Lock-free single-producer/single-consumer ring
+ *
+ * For passing messages between the two cores (or an interrupt and
+ * the main loop) without locks, spin locks or the 8 word SIO FIFO.
+ * Exactly one context may push and exactly one may pop.
+ *
+ * How it works:
+ *
+ * - head and tail count pushes and pops forever (free-running 32-bit),
+ *   head - tail is the fill level, the capacity is a power of two so
+ *   the slot is just index & mask and wrap-around is free
+ * - the producer only writes head, the consumer only writes tail, each
+ *   on its own SPSC_CACHE_LINE so the two sides never share a line
+ * - each side keeps a cached copy of the other side's index and only
+ *   reloads it when that copy doesn't cover the request, so most
+ *   operations touch no shared state at all
+ * - release on the index store publishes the slot contents, acquire on
+ *   the load makes them visible, on the RP2040 that's a plain load or
+ *   store plus a DMB
+ * - batch push/pop copy up to n elements with at most two memcpy()s
+ *   and one index update
+ * - spsc_reserve()/spsc_commit() and spsc_peek()/spsc_release() fill
+ *   and read a slot in place when copying the element would cost more
+ *
+ * Header only, GCC __atomic builtins so the same code builds as C on
+ * the board and C or C++ on the host.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// the RP2040 has no data cache, padding just keeps the indices in separate words
+#ifndef SPSC_CACHE_LINE
+#if defined(PICO_ON_DEVICE) && PICO_ON_DEVICE
+#define SPSC_CACHE_LINE 4
+#else
+#define SPSC_CACHE_LINE 64
+#endif
+#endif
+
+/**
+ * Declare the storage for a ring
+ *
+ * @param name - variable name
+ * @param type - element type
+ * @param capacity - number of elements, power of two
+ */
+#define SPSC_BUFFER(name, type, capacity) \
+    static type name[(capacity)]; \
+    SPSC_STATIC_ASSERT(((capacity) & ((capacity) - 1)) == 0, "spsc capacity must be a power of two")
+
+#ifdef __cplusplus
+#define SPSC_STATIC_ASSERT static_assert
+#else
+#define SPSC_STATIC_ASSERT _Static_assert
+#endif
+
+typedef struct {
+    // producer side
+    uint32_t head __attribute__((aligned(SPSC_CACHE_LINE)));
+    uint32_t cached_tail;
+
+    // consumer side
+    uint32_t tail __attribute__((aligned(SPSC_CACHE_LINE)));
+    uint32_t cached_head;
+
+    // read-only after spsc_init()
+    uint8_t *buffer __attribute__((aligned(SPSC_CACHE_LINE)));
+    uint32_t mask;
+    uint32_t elem_size;
+} spsc_t;
+
+/**
+ * Initialize a ring
+ *
+ * @param ring
+ * @param buffer - capacity * elem_size bytes, e.g. from SPSC_BUFFER()
+ * @param capacity - number of elements, power of two
+ * @param elem_size - size of one element in bytes
+ *
+ * @return bool - false if capacity isn't a power of two
+ */
+static inline bool spsc_init(spsc_t *ring, void *buffer, uint32_t capacity, uint32_t elem_size) {
+    if (!capacity || (capacity & (capacity - 1))) return false;
+
+    ring->head = 0;
+    ring->cached_tail = 0;
+    ring->tail = 0;
+    ring->cached_head = 0;
+    ring->buffer = (uint8_t *) buffer;
+    ring->mask = capacity - 1;
+    ring->elem_size = elem_size;
+
+    return true;
+}
+
+/**
+ * Get the free space, reloading the consumer's index only if the
+ * cached one says there's less than wanted, producer only
+ *
+ * @param ring
+ * @param want - number of elements the caller wants to push
+ *
+ * @return uint32_t
+ */
+static inline uint32_t spsc_room(spsc_t *ring, uint32_t want) {
+    uint32_t room = ring->mask + 1 - (ring->head - ring->cached_tail);
+
+    if (room < want) {
+        // looks full, see how far the consumer got
+        ring->cached_tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        room = ring->mask + 1 - (ring->head - ring->cached_tail);
+    }
+
+    return room;
+}
+
+/**
+ * Get the fill level, reloading the producer's index only if the
+ * cached one says there's less than wanted, consumer only
+ *
+ * @param ring
+ * @param want - number of elements the caller wants to pop
+ *
+ * @return uint32_t
+ */
+static inline uint32_t spsc_level(spsc_t *ring, uint32_t want) {
+    uint32_t level = ring->cached_head - ring->tail;
+
+    if (level < want) {
+        // looks empty, see if the producer added some
+        ring->cached_head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        level = ring->cached_head - ring->tail;
+    }
+
+    return level;
+}
+
+/**
+ * Get the number of elements that can be pushed, producer only
+ *
+ * @param ring
+ *
+ * @return uint32_t
+ */
+static inline uint32_t spsc_free(spsc_t *ring) {
+    return spsc_room(ring, ring->mask + 1);
+}
+
+/**
+ * Get the number of elements that can be popped, consumer only
+ *
+ * @param ring
+ *
+ * @return uint32_t
+ */
+static inline uint32_t spsc_available(spsc_t *ring) {
+    return spsc_level(ring, ring->mask + 1);
+}
+
+/**
+ * Copy n elements in or out of the ring starting at index, in up to two parts
+ *
+ * @param ring
+ * @param index - free-running head or tail
+ * @param elems - n elements
+ * @param n
+ * @param in - true to copy into the ring, false to copy out
+ *
+ * @return void
+ */
+static inline void spsc_copy(spsc_t *ring, uint32_t index, void *elems, uint32_t n, bool in) {
+    uint32_t slot = index & ring->mask;
+    uint32_t first = ring->mask + 1 - slot;
+    if (first > n) first = n;
+
+    uint8_t *ring_ptr = ring->buffer + slot * ring->elem_size;
+    uint8_t *elems_ptr = (uint8_t *) elems;
+    uint32_t first_bytes = first * ring->elem_size;
+    uint32_t rest_bytes = (n - first) * ring->elem_size;
+
+    if (in) {
+        memcpy(ring_ptr, elems_ptr, first_bytes);
+        if (rest_bytes) memcpy(ring->buffer, elems_ptr + first_bytes, rest_bytes);
+    } else {
+        memcpy(elems_ptr, ring_ptr, first_bytes);
+        if (rest_bytes) memcpy(elems_ptr + first_bytes, ring->buffer, rest_bytes);
+    }
+}
+
+/**
+ * Push up to n elements, producer only
+ *
+ * @param ring
+ * @param elems - n elements
+ * @param n
+ *
+ * @return uint32_t - number of elements pushed, less than n if the ring filled up
+ */
+static inline uint32_t spsc_push_batch(spsc_t *ring, const void *elems, uint32_t n) {
+    uint32_t room = spsc_room(ring, n);
+    if (n > room) n = room;
+    if (!n) return 0;
+
+    spsc_copy(ring, ring->head, (void *) elems, n, true);
+    // publish the slots together with the new head
+    __atomic_store_n(&ring->head, ring->head + n, __ATOMIC_RELEASE);
+
+    return n;
+}
+
+/**
+ * Pop up to n elements, consumer only
+ *
+ * @param ring
+ * @param elems - room for n elements
+ * @param n
+ *
+ * @return uint32_t - number of elements popped, less than n if the ring ran empty
+ */
+static inline uint32_t spsc_pop_batch(spsc_t *ring, void *elems, uint32_t n) {
+    uint32_t available = spsc_level(ring, n);
+    if (n > available) n = available;
+    if (!n) return 0;
+
+    spsc_copy(ring, ring->tail, elems, n, false);
+    // hand the slots back once they're copied out
+    __atomic_store_n(&ring->tail, ring->tail + n, __ATOMIC_RELEASE);
+
+    return n;
+}
+
+/**
+ * Push one element, producer only
+ *
+ * @param ring
+ * @param elem
+ *
+ * @return bool - false if the ring is full
+ */
+static inline bool spsc_push(spsc_t *ring, const void *elem) {
+    return spsc_push_batch(ring, elem, 1) == 1;
+}
+
+/**
+ * Pop one element, consumer only
+ *
+ * @param ring
+ * @param elem - receives the element
+ *
+ * @return bool - false if the ring is empty
+ */
+static inline bool spsc_pop(spsc_t *ring, void *elem) {
+    return spsc_pop_batch(ring, elem, 1) == 1;
+}
+
+/**
+ * Get the next free slot to fill in place, producer only
+ *
+ * Nothing is visible to the consumer until spsc_commit().
+ *
+ * @param ring
+ *
+ * @return void * - the slot, NULL if the ring is full
+ */
+static inline void *spsc_reserve(spsc_t *ring) {
+    if (!spsc_room(ring, 1)) return NULL;
+    return ring->buffer + (ring->head & ring->mask) * ring->elem_size;
+}
+
+/**
+ * Publish the slot filled after spsc_reserve(), producer only
+ *
+ * @param ring
+ *
+ * @return void
+ */
+static inline void spsc_commit(spsc_t *ring) {
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Get the oldest element without popping it, consumer only
+ *
+ * @param ring
+ *
+ * @return void * - the element, NULL if the ring is empty
+ */
+static inline void *spsc_peek(spsc_t *ring) {
+    if (!spsc_level(ring, 1)) return NULL;
+    return ring->buffer + (ring->tail & ring->mask) * ring->elem_size;
+}
+
+/**
+ * Hand the element from spsc_peek() back to the producer, consumer only
+ *
+ * @param ring
+ *
+ * @return void
+ */
+static inline void spsc_release(spsc_t *ring) {
+    __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,314 @@
+#include <string.h>
+#include "telemetry.h"
+
+typedef struct {
+    // headroom for the transport, then the payload
+    uint8_t mem[TELEMETRY_HEADROOM + TELEMETRY_PAYLOAD] __attribute__((aligned(8)));
+    // set by the producer when sent, cleared by telemetry_release()
+    bool busy;
+} telemetry_slot_t;
+
+static telemetry_slot_t slots[TELEMETRY_SLOTS];
+
+static telemetry_send_t send_datagram;
+static void *send_user;
+static uint32_t period;
+
+// slot being filled, -1 if none is open
+static int32_t open_slot = -1;
+// bytes of its payload used so far, header included
+static uint32_t open_len;
+static uint16_t open_records;
+
+static uint32_t seq;
+// now_us from the last telemetry_poll(), the header timestamp
+static uint32_t last_now;
+static uint32_t next_send;
+static bool scheduled;
+
+static telemetry_stats_t stats;
+
+static inline void put16(uint8_t *p, uint16_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+}
+
+static inline void put32(uint8_t *p, uint32_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+/**
+ * Check if a slot is still with the transport
+ *
+ * @param slot
+ *
+ * @return bool
+ */
+static inline bool slot_busy(uint32_t slot) {
+    // acquire, the transport is done with the memory before we write it
+    return __atomic_load_n(&slots[slot].busy, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Start filling the first free slot
+ *
+ * @return bool - false if every slot is in flight
+ */
+static bool open_datagram(void) {
+    for (uint32_t i = 0; i < TELEMETRY_SLOTS; i++) {
+        if (slot_busy(i)) continue;
+
+        open_slot = i;
+        open_len = TELEMETRY_HEADER_SIZE;
+        open_records = 0;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Write the header of the open slot and hand it to the transport,
+ * an empty slot stays open
+ *
+ * @return void
+ */
+static void send_open(void) {
+    if (open_slot < 0 || !open_records) return;
+
+    uint32_t slot = open_slot;
+    uint8_t *payload = slots[slot].mem + TELEMETRY_HEADROOM;
+
+    put16(payload, TELEMETRY_MAGIC);
+    put16(payload + 2, open_records);
+    put32(payload + 4, seq++);
+    put32(payload + 8, last_now);
+    put32(payload + 12, stats.dropped);
+    open_slot = -1;
+
+    // busy before the call, the transport may release it before returning
+    __atomic_store_n(&slots[slot].busy, true, __ATOMIC_RELAXED);
+
+    uint32_t busy = 0;
+    for (uint32_t i = 0; i < TELEMETRY_SLOTS; i++) {
+        busy += slot_busy(i);
+    }
+    if (busy > stats.busy_max) stats.busy_max = busy;
+
+    if (send_datagram(slot, slots[slot].mem, open_len, send_user)) {
+        stats.datagrams++;
+        stats.bytes += open_len;
+    } else {
+        stats.send_errors++;
+        __atomic_store_n(&slots[slot].busy, false, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * Reset the pool and the counters, every slot has to be free
+ *
+ * @param send - transport
+ * @param user - passed to send
+ * @param period_us - longest a record waits in an open datagram, 0 for TELEMETRY_PERIOD_US
+ *
+ * @return void
+ */
+void telemetry_init(telemetry_send_t send, void *user, uint32_t period_us) {
+    for (uint32_t i = 0; i < TELEMETRY_SLOTS; i++) {
+        slots[i].busy = false;
+    }
+
+    send_datagram = send;
+    send_user = user;
+    period = period_us ? period_us : TELEMETRY_PERIOD_US;
+    open_slot = -1;
+    seq = 0;
+    last_now = 0;
+    scheduled = false;
+    memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ * Reserve a record in the open datagram, to be filled in place
+ *
+ * Sends the open datagram first if the record doesn't fit anymore.
+ *
+ * @param type - TELEMETRY_TYPE_* or an application type
+ * @param len - payload bytes, up to TELEMETRY_RECORD_MAX
+ *
+ * @return uint8_t* - len bytes to fill, NULL if the record was dropped
+ */
+uint8_t *telemetry_reserve(uint8_t type, uint32_t len) {
+    if (len > TELEMETRY_RECORD_MAX) {
+        stats.dropped++;
+        return NULL;
+    }
+
+    if (open_slot >= 0 && open_len + TELEMETRY_RECORD_HEADER + len > TELEMETRY_PAYLOAD) {
+        send_open();
+    }
+    if (open_slot < 0 && !open_datagram()) {
+        stats.dropped++;
+        return NULL;
+    }
+
+    uint8_t *record = slots[open_slot].mem + TELEMETRY_HEADROOM + open_len;
+    record[0] = type;
+    record[1] = len;
+    open_len += TELEMETRY_RECORD_HEADER + len;
+    open_records++;
+    stats.records++;
+
+    return record + TELEMETRY_RECORD_HEADER;
+}
+
+/**
+ * Copy a record into the open datagram
+ *
+ * @param type
+ * @param data
+ * @param len - up to TELEMETRY_RECORD_MAX
+ *
+ * @return bool - false if the record was dropped
+ */
+bool telemetry_put(uint8_t type, const void *data, uint32_t len) {
+    uint8_t *record = telemetry_reserve(type, len);
+    if (!record) return false;
+
+    memcpy(record, data, len);
+    return true;
+}
+
+/**
+ * Send the open datagram when it's due, call from the main loop
+ *
+ * Datagrams go out every period_us (from the first call), empty ones
+ * are skipped. After a stall longer than a period the schedule starts
+ * over from now instead of sending a burst.
+ *
+ * @param now_us - free-running microseconds, stamped into the header
+ *
+ * @return void
+ */
+void telemetry_poll(uint32_t now_us) {
+    last_now = now_us;
+
+    if (!scheduled) {
+        next_send = now_us + period;
+        scheduled = true;
+        return;
+    }
+    if ((int32_t) (now_us - next_send) < 0) return;
+
+    send_open();
+
+    next_send += period;
+    if ((int32_t) (now_us - next_send) >= 0) {
+        next_send = now_us + period;
+    }
+}
+
+/**
+ * Send the open datagram now, if it has records
+ *
+ * @return void
+ */
+void telemetry_flush(void) {
+    send_open();
+}
+
+/**
+ * Give a slot back, from the transport once it's done with the memory
+ *
+ * Safe from another context than the producer (an interrupt, the
+ * network stack), only the transport clears a busy slot.
+ *
+ * @param slot - index the send callback got
+ *
+ * @return void
+ */
+void telemetry_release(uint32_t slot) {
+    if (slot >= TELEMETRY_SLOTS) return;
+
+    // release, the transport's last reads of the memory come first
+    __atomic_store_n(&slots[slot].busy, false, __ATOMIC_RELEASE);
+}
+
+/**
+ * Get the counters since telemetry_init()
+ *
+ * @param stats - receives a copy
+ *
+ * @return void
+ */
+void telemetry_get_stats(telemetry_stats_t *out) {
+    *out = stats;
+}
+
+/**
+ * Add a block of ADC samples
+ *
+ * @param channel
+ * @param samples
+ * @param count - up to TELEMETRY_ADC_MAX
+ *
+ * @return bool - false if the record was dropped
+ */
+bool telemetry_adc(uint8_t channel, const uint16_t *samples, uint32_t count) {
+    if (count > TELEMETRY_ADC_MAX) {
+        stats.dropped++;
+        return false;
+    }
+
+    uint8_t *record = telemetry_reserve(TELEMETRY_TYPE_ADC, 1 + 2 * count);
+    if (!record) return false;
+
+    record[0] = channel;
+    for (uint32_t i = 0; i < count; i++) {
+        put16(record + 1 + 2 * i, samples[i]);
+    }
+    return true;
+}
+
+/**
+ * Add a counter reading, e.g. pulses since boot
+ *
+ * @param channel
+ * @param count
+ *
+ * @return bool - false if the record was dropped
+ */
+bool telemetry_count(uint8_t channel, uint32_t count) {
+    uint8_t *record = telemetry_reserve(TELEMETRY_TYPE_COUNT, 5);
+    if (!record) return false;
+
+    record[0] = channel;
+    put32(record + 1, count);
+    return true;
+}
+
+/**
+ * trace_write_t for trace_flush(), the trace byte stream goes out in
+ * TELEMETRY_TYPE_TRACE records
+ *
+ * A lost chunk costs the frames in it, the decoder picks up again at
+ * the next frame delimiter.
+ *
+ * @param data
+ * @param len
+ * @param user - unused
+ *
+ * @return void
+ */
+void telemetry_trace_write(const uint8_t *data, size_t len, void *user) {
+    while (len) {
+        uint32_t chunk = len > TELEMETRY_RECORD_MAX ? TELEMETRY_RECORD_MAX : len;
+
+        telemetry_put(TELEMETRY_TYPE_TRACE, data, chunk);
+        data += chunk;
+        len -= chunk;
+    }
+}
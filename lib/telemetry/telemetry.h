@@ -0,0 +1,131 @@
+/**
+ * @brief Batched telemetry datagrams without per-sample allocation
+ *
+ * Samples (ADC readings, pulse counts, lib/trace frames) are written
+ * straight into the payload of the datagram being built, and the
+ * datagram goes out every TELEMETRY_PERIOD_US or as soon as the next
+ * record doesn't fit, whichever comes first.
+ *
+ * How it works:
+ *
+ * - a fixed pool of TELEMETRY_SLOTS payload buffers, each with
+ *   TELEMETRY_HEADROOM bytes in front that belong to the transport, so
+ *   a network stack can keep its buffer descriptor there and prepend
+ *   its UDP/IP/link headers in place instead of copying the payload
+ * - telemetry_reserve() hands out the next len bytes of the open slot,
+ *   the caller fills them in place, telemetry_put() is the copying
+ *   version
+ * - a full or due slot is given to the send callback and stays busy
+ *   until the transport calls telemetry_release(), which may happen
+ *   later from another context (lwIP freeing the pbuf), so each slot
+ *   has its own busy flag with one writer per transition
+ * - with every slot in flight, records are counted as dropped instead
+ *   of blocking, the next header carries the total
+ *
+ * telemetry_udp.c is the lwIP transport: a slot becomes a custom pbuf
+ * (pbuf_alloced_custom(), PBUF_RAM type over the slot's memory, the
+ * struct itself in the headroom) that udp_sendto() sends as is, and
+ * the pbuf's free callback releases the slot. The batching here is
+ * plain C, it also runs under lwIP's unix port (host/telemetry_bench)
+ * and against a fake transport (host/telemetry_check).
+ *
+ * Records are produced from one context only (the main loop), an
+ * interrupt handler should go through lib/spsc or lib/trace first.
+ *
+ * Datagram payload, little endian:
+ *
+ *   header   magic u16, records u16, seq u32, timestamp u32 (us), dropped u32
+ *   records  type u8, len u8, payload u8 * len
+ *
+ *   TELEMETRY_TYPE_ADC    channel u8, samples u16 * n
+ *   TELEMETRY_TYPE_COUNT  channel u8, count u32
+ *   TELEMETRY_TYPE_TRACE  lib/trace frames, a chunk of the byte stream
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// payload buffers, one is filled while the others are in flight
+#define TELEMETRY_SLOTS 4
+// datagram payload, below the 1472 bytes of a 1500 byte MTU
+#define TELEMETRY_PAYLOAD 1024
+// room in front of the payload for the transport's pbuf and headers
+#define TELEMETRY_HEADROOM 96
+// send the open datagram at least this often
+#define TELEMETRY_PERIOD_US 20000
+
+#define TELEMETRY_MAGIC 0x4d54
+#define TELEMETRY_HEADER_SIZE 16
+#define TELEMETRY_RECORD_HEADER 2
+#define TELEMETRY_RECORD_MAX 255
+// ADC samples that fit one record
+#define TELEMETRY_ADC_MAX ((TELEMETRY_RECORD_MAX - 1) / 2)
+
+#define TELEMETRY_TYPE_ADC 0x01
+#define TELEMETRY_TYPE_COUNT 0x02
+#define TELEMETRY_TYPE_TRACE 0x03
+
+typedef struct {
+    uint32_t datagrams;
+    uint32_t records;
+    uint32_t bytes;
+    // records that found no free slot
+    uint32_t dropped;
+    // datagrams the transport refused
+    uint32_t send_errors;
+    // most slots in flight at once
+    uint32_t busy_max;
+} telemetry_stats_t;
+
+/**
+ * Transport for a finished datagram
+ *
+ * The payload is mem + TELEMETRY_HEADROOM, len bytes. Returning
+ * true hands the slot over, the transport calls telemetry_release()
+ * once it's done with the memory (possibly before returning). false
+ * drops the datagram and the slot is reused right away.
+ *
+ * @param slot - index for telemetry_release()
+ * @param mem - the slot's memory, 8-byte aligned, headroom first
+ * @param len - payload length
+ * @param user - user pointer given to telemetry_init()
+ */
+typedef bool (*telemetry_send_t)(uint32_t slot, uint8_t *mem, uint32_t len, void *user);
+
+void telemetry_init(telemetry_send_t send, void *user, uint32_t period_us);
+uint8_t *telemetry_reserve(uint8_t type, uint32_t len);
+bool telemetry_put(uint8_t type, const void *data, uint32_t len);
+void telemetry_poll(uint32_t now_us);
+void telemetry_flush(void);
+void telemetry_release(uint32_t slot);
+void telemetry_get_stats(telemetry_stats_t *stats);
+
+bool telemetry_adc(uint8_t channel, const uint16_t *samples, uint32_t count);
+bool telemetry_count(uint8_t channel, uint32_t count);
+void telemetry_trace_write(const uint8_t *data, size_t len, void *user);
+
+// lwIP transport, see telemetry_udp.c
+bool telemetry_udp_init(const char *host, uint16_t port, uint32_t period_us);
+
+// host side, see telemetry_decode.c
+typedef struct {
+    uint16_t records;
+    uint32_t seq;
+    uint32_t timestamp;
+    uint32_t dropped;
+} telemetry_header_t;
+
+/**
+ * Decoder output, one call per record
+ *
+ * @param type - TELEMETRY_TYPE_*
+ * @param data - record payload
+ * @param len
+ * @param user - user pointer given to telemetry_decode()
+ */
+typedef void (*telemetry_record_t)(uint8_t type, const uint8_t *data, uint8_t len, void *user);
+
+bool telemetry_decode(const uint8_t *data, size_t len, telemetry_header_t *header, telemetry_record_t record, void *user);
@@ -0,0 +1,50 @@
+#include "telemetry.h"
+
+static inline uint16_t get16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t get32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+/**
+ * Check a datagram and walk its records
+ *
+ * Nothing is reported unless the whole datagram is well formed: the
+ * magic, the record count and every record length adding up to
+ * exactly len bytes.
+ *
+ * @param data - UDP payload
+ * @param len
+ * @param header - receives the header
+ * @param record - called for every record, may be NULL
+ * @param user - passed to record
+ *
+ * @return bool - false if the datagram is malformed
+ */
+bool telemetry_decode(const uint8_t *data, size_t len, telemetry_header_t *header, telemetry_record_t record, void *user) {
+    if (len < TELEMETRY_HEADER_SIZE || get16(data) != TELEMETRY_MAGIC) return false;
+
+    header->records = get16(data + 2);
+    header->seq = get32(data + 4);
+    header->timestamp = get32(data + 8);
+    header->dropped = get32(data + 12);
+
+    // lengths first, so a bad datagram reports no records at all
+    size_t pos = TELEMETRY_HEADER_SIZE;
+    for (uint32_t i = 0; i < header->records; i++) {
+        if (pos + TELEMETRY_RECORD_HEADER > len) return false;
+        pos += TELEMETRY_RECORD_HEADER + data[pos + 1];
+        if (pos > len) return false;
+    }
+    if (pos != len) return false;
+
+    pos = TELEMETRY_HEADER_SIZE;
+    for (uint32_t i = 0; i < header->records && record; i++) {
+        record(data[pos], data + pos + TELEMETRY_RECORD_HEADER, data[pos + 1], user);
+        pos += TELEMETRY_RECORD_HEADER + data[pos + 1];
+    }
+
+    return true;
+}
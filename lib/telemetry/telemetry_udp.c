@@ -0,0 +1,111 @@
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include "telemetry.h"
+
+#if PICO_ON_DEVICE
+#include "pico/cyw43_arch.h"
+// lwIP calls from outside its context, a no-op with pico_cyw43_arch_lwip_poll
+#define TELEMETRY_LWIP_BEGIN() cyw43_arch_lwip_begin()
+#define TELEMETRY_LWIP_END() cyw43_arch_lwip_end()
+#else
+// lwIP's unix port with NO_SYS, everything runs in one thread
+#define TELEMETRY_LWIP_BEGIN()
+#define TELEMETRY_LWIP_END()
+#endif
+
+#if !LWIP_SUPPORT_CUSTOM_PBUF
+#error "telemetry_udp.c needs LWIP_SUPPORT_CUSTOM_PBUF 1 in lwipopts.h"
+#endif
+
+// the pbuf of a slot, kept at the start of the slot's headroom
+typedef struct {
+    struct pbuf_custom custom;
+    uint32_t slot;
+} telemetry_pbuf_t;
+
+// lwIP puts the payload LWIP_MEM_ALIGN_SIZE(PBUF_TRANSPORT) bytes into the memory it's given,
+// that has to land on the slot's payload with the pbuf itself still in front of it
+#define TELEMETRY_UDP_HEADERS LWIP_MEM_ALIGN_SIZE(PBUF_TRANSPORT)
+_Static_assert(sizeof(telemetry_pbuf_t) + TELEMETRY_UDP_HEADERS <= TELEMETRY_HEADROOM,
+               "TELEMETRY_HEADROOM too small for the pbuf and the link/IP/UDP headers");
+
+static struct udp_pcb *telemetry_pcb;
+static ip_addr_t telemetry_addr;
+static uint16_t telemetry_port;
+
+/**
+ * Called by lwIP when the last reference to a slot's pbuf goes away
+ *
+ * @param p
+ *
+ * @return void
+ */
+static void telemetry_pbuf_free(struct pbuf *p) {
+    telemetry_pbuf_t *pbuf = (telemetry_pbuf_t *) p;
+
+    telemetry_release(pbuf->slot);
+}
+
+/**
+ * telemetry_send_t: wrap the slot in a custom pbuf and send it as is
+ *
+ * The pbuf struct sits at the start of the slot and the payload at
+ * TELEMETRY_HEADROOM, so udp_sendto() and ip4_output() prepend their
+ * headers in the gap between the two, no pbuf_alloc() and no copy.
+ * pbuf_add_header() only grows a PBUF_RAM payload down towards its
+ * own struct, which is why the struct lives in the slot too.
+ *
+ * @param slot
+ * @param mem
+ * @param len
+ * @param user - unused
+ *
+ * @return bool - false if lwIP didn't take the datagram
+ */
+static bool telemetry_udp_send(uint32_t slot, uint8_t *mem, uint32_t len, void *user) {
+    telemetry_pbuf_t *pbuf = (telemetry_pbuf_t *) mem;
+    uint8_t *payload_mem = mem + TELEMETRY_HEADROOM - TELEMETRY_UDP_HEADERS;
+
+    pbuf->slot = slot;
+    pbuf->custom.custom_free_function = telemetry_pbuf_free;
+
+    TELEMETRY_LWIP_BEGIN();
+
+    struct pbuf *p = pbuf_alloced_custom(PBUF_TRANSPORT, len, PBUF_RAM, &pbuf->custom, payload_mem,
+                                         TELEMETRY_UDP_HEADERS + len);
+    err_t err = ERR_MEM;
+    if (p) {
+        err = udp_sendto(telemetry_pcb, p, &telemetry_addr, telemetry_port);
+        // our reference, the slot comes back in telemetry_pbuf_free() once the driver lets go too
+        pbuf_free(p);
+    }
+
+    TELEMETRY_LWIP_END();
+
+    return err == ERR_OK;
+}
+
+/**
+ * Start streaming to a UDP receiver, lwIP has to be up already
+ *
+ * @param host - receiver IPv4 address, e.g. "192.168.1.10"
+ * @param port - receiver port
+ * @param period_us - see telemetry_init()
+ *
+ * @return bool - false if the address is bad or there's no pcb left
+ */
+bool telemetry_udp_init(const char *host, uint16_t port, uint32_t period_us) {
+    if (!ipaddr_aton(host, &telemetry_addr)) return false;
+
+    TELEMETRY_LWIP_BEGIN();
+    telemetry_pcb = udp_new();
+    TELEMETRY_LWIP_END();
+
+    if (!telemetry_pcb) return false;
+
+    telemetry_port = port;
+    telemetry_init(telemetry_udp_send, NULL, period_us);
+
+    return true;
+}
@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <string.h>
+#include "proto.h"
+#include "trace.h"
+
+#if PICO_ON_DEVICE
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#else
+#include <time.h>
+#endif
+
+_Static_assert((TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) == 0, "TRACE_RING_SIZE must be a power of two");
+_Static_assert((TRACE_FORMAT_TABLE_SIZE & (TRACE_FORMAT_TABLE_SIZE - 1)) == 0, "TRACE_FORMAT_TABLE_SIZE must be a power of two");
+
+// largest frame before COBS: type, format id and string, crc
+#define TRACE_FRAME_MAX (1 + 4 + TRACE_FORMAT_MAX + PROTO_CRC_SIZE)
+// flusher output buffer, written out whenever the next frame might not fit
+#define TRACE_OUT_SIZE 512
+
+SPSC_BUFFER(records, trace_record_t, TRACE_CORES * TRACE_RING_SIZE);
+static spsc_t rings[TRACE_CORES];
+// written by the logging core, read by the flusher
+static volatile uint32_t dropped[TRACE_CORES];
+
+// flusher state
+static const char *sent_formats[TRACE_FORMAT_TABLE_SIZE];
+static uint32_t sent_dropped[TRACE_CORES];
+static uint32_t flushes;
+
+#if !PICO_ON_DEVICE
+static _Thread_local uint32_t host_core;
+
+/**
+ * Set the core the calling thread logs as, host only
+ *
+ * @param core - 0 .. TRACE_CORES - 1
+ *
+ * @return void
+ */
+void trace_host_set_core(uint32_t core) {
+    host_core = core;
+}
+#endif
+
+static inline uint32_t trace_core(void) {
+#if PICO_ON_DEVICE
+    return get_core_num();
+#else
+    return host_core;
+#endif
+}
+
+static inline uint32_t trace_timestamp(void) {
+#if PICO_ON_DEVICE
+    // low word of the 1 MHz timer, no latching needed
+    return timer_hw->timerawl;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t) (now.tv_sec * 1000000ull + now.tv_nsec / 1000);
+#endif
+}
+
+/**
+ * Initialize the per-core rings, call before the first TRACE()
+ *
+ * @return void
+ */
+void trace_init(void) {
+    for (uint32_t core = 0; core < TRACE_CORES; core++) {
+        spsc_init(&rings[core], &records[core * TRACE_RING_SIZE], TRACE_RING_SIZE, sizeof(trace_record_t));
+        dropped[core] = 0;
+        sent_dropped[core] = 0;
+    }
+
+    memset(sent_formats, 0, sizeof(sent_formats));
+    flushes = 0;
+}
+
+/**
+ * Store one record in the calling core's ring, use TRACE()
+ *
+ * Interrupts are off while the slot is filled, so an ISR on the same
+ * core can't become a second producer halfway through.
+ *
+ * @param format - string literal, only its address is stored
+ * @param nargs - number of arguments used
+ * @param a0 .. a3 - arguments
+ *
+ * @return void
+ */
+void trace_record(const char *format, uint32_t nargs, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3) {
+    uint32_t core = trace_core();
+    spsc_t *ring = &rings[core];
+
+#if PICO_ON_DEVICE
+    uint32_t save = save_and_disable_interrupts();
+#endif
+
+    trace_record_t *record = spsc_reserve(ring);
+
+    if (record) {
+        record->timestamp = trace_timestamp();
+        record->format = format;
+        record->core = core;
+        record->nargs = nargs;
+        record->args[0] = a0;
+        record->args[1] = a1;
+        record->args[2] = a2;
+        record->args[3] = a3;
+        spsc_commit(ring);
+    } else {
+        dropped[core]++;
+    }
+
+#if PICO_ON_DEVICE
+    restore_interrupts(save);
+#endif
+}
+
+/**
+ * Get the number of records a core dropped because its ring was full
+ *
+ * @param core
+ *
+ * @return uint32_t
+ */
+uint32_t trace_get_dropped(uint32_t core) {
+    return dropped[core];
+}
+
+static uint8_t *put_u32(uint8_t *pos, uint32_t value) {
+    pos[0] = value;
+    pos[1] = value >> 8;
+    pos[2] = value >> 16;
+    pos[3] = value >> 24;
+    return pos + 4;
+}
+
+/**
+ * Append one frame to the output buffer, writing it out first if full
+ *
+ * @param out - output buffer, TRACE_OUT_SIZE bytes
+ * @param out_len - bytes already in it
+ * @param frame - frame with room for the crc
+ * @param len - frame length without the crc
+ * @param write - output
+ * @param user - passed on to write
+ *
+ * @return size_t - new output length
+ */
+static size_t put_frame(uint8_t *out, size_t out_len, uint8_t *frame, size_t len, trace_write_t write, void *user) {
+    if (out_len + PROTO_ENCODED_MAX > TRACE_OUT_SIZE) {
+        write(out, out_len, user);
+        out_len = 0;
+    }
+
+    uint16_t crc = proto_crc16(frame, len);
+    frame[len++] = crc & 0xff;
+    frame[len++] = crc >> 8;
+
+    out_len += proto_cobs_encode(frame, len, out + out_len);
+    out[out_len++] = 0;
+    return out_len;
+}
+
+/**
+ * Check if the decoder has been sent a format, and remember it
+ *
+ * @param format
+ *
+ * @return bool - true if it still has to be sent
+ */
+static bool format_is_new(const char *format) {
+    uint32_t slot = ((uint32_t) (uintptr_t) format >> 2) & (TRACE_FORMAT_TABLE_SIZE - 1);
+
+    for (uint32_t i = 0; i < TRACE_FORMAT_TABLE_SIZE; i++) {
+        const char **entry = &sent_formats[(slot + i) & (TRACE_FORMAT_TABLE_SIZE - 1)];
+        if (*entry == format) return false;
+        if (!*entry) {
+            *entry = format;
+            return true;
+        }
+    }
+
+    // table full, start over, the decoder doesn't mind repeats
+    memset(sent_formats, 0, sizeof(sent_formats));
+    sent_formats[slot] = format;
+    return true;
+}
+
+/**
+ * Send everything logged so far, oldest first across the cores
+ *
+ * Call from one place only (it's the consumer of every ring), in
+ * the main loop or wherever a few hundred microseconds don't hurt.
+ *
+ * @param write - output, e.g. trace_stdio_write
+ * @param user - passed on to write
+ *
+ * @return size_t - number of records sent
+ */
+size_t trace_flush(trace_write_t write, void *user) {
+    uint8_t out[TRACE_OUT_SIZE];
+    uint8_t frame[TRACE_FRAME_MAX];
+    // a delimiter first, separates any printf() text before us
+    size_t out_len = 1;
+    size_t count = 0;
+
+    out[0] = 0;
+
+    if (++flushes % TRACE_FORMAT_REFRESH == 0) {
+        memset(sent_formats, 0, sizeof(sent_formats));
+    }
+
+    for (uint32_t core = 0; core < TRACE_CORES; core++) {
+        uint32_t lost = dropped[core];
+        if (lost == sent_dropped[core]) continue;
+
+        frame[0] = TRACE_FRAME_DROPPED;
+        frame[1] = core;
+        put_u32(&frame[2], lost - sent_dropped[core]);
+        out_len = put_frame(out, out_len, frame, 6, write, user);
+        sent_dropped[core] = lost;
+    }
+
+    // bounded, so a core that logs nonstop can't keep us here
+    while (count < TRACE_CORES * TRACE_RING_SIZE) {
+        // pick the older head record, timestamps are wrap-safe as differences
+        trace_record_t *record = NULL;
+        spsc_t *ring = NULL;
+
+        for (uint32_t core = 0; core < TRACE_CORES; core++) {
+            trace_record_t *head = spsc_peek(&rings[core]);
+            if (head && (!record || (int32_t) (head->timestamp - record->timestamp) < 0)) {
+                record = head;
+                ring = &rings[core];
+            }
+        }
+
+        if (!record) break;
+
+        uint32_t id = (uint32_t) (uintptr_t) record->format;
+
+        if (format_is_new(record->format)) {
+            size_t length = strlen(record->format);
+            if (length > TRACE_FORMAT_MAX) length = TRACE_FORMAT_MAX;
+
+            frame[0] = TRACE_FRAME_FORMAT;
+            put_u32(&frame[1], id);
+            memcpy(&frame[5], record->format, length);
+            out_len = put_frame(out, out_len, frame, 5 + length, write, user);
+        }
+
+        uint8_t *pos = frame;
+        *pos++ = TRACE_FRAME_RECORD;
+        pos = put_u32(pos, record->timestamp);
+        pos = put_u32(pos, id);
+        *pos++ = record->core;
+        *pos++ = record->nargs;
+        for (uint32_t i = 0; i < record->nargs; i++) {
+            pos = put_u32(pos, record->args[i]);
+        }
+
+        spsc_release(ring);
+        out_len = put_frame(out, out_len, frame, pos - frame, write, user);
+        count++;
+    }
+
+    if (out_len > 1) {
+        write(out, out_len, user);
+    }
+
+    return count;
+}
+
+/**
+ * trace_flush() output to stdio, without the CRLF translation
+ *
+ * @param data
+ * @param len
+ * @param user - unused
+ *
+ * @return void
+ */
+void trace_stdio_write(const uint8_t *data, size_t len, void *user) {
+#if PICO_ON_DEVICE
+    for (size_t i = 0; i < len; i++) {
+        putchar_raw(data[i]);
+    }
+#else
+    fwrite(data, 1, len, stdout);
+#endif
+}
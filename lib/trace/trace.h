@@ -0,0 +1,132 @@
+/**
+ * @brief Deferred binary trace log
+ *
+ * TRACE("freq %lu div %u", freq, div) instead of printf() on hot
+ * paths. The call only stores the format string's address, a
+ * timestamp and the raw arguments, formatting happens on the host.
+ *
+ * How it works:
+ *
+ * - one lib/spsc ring of trace_record_t per core, the call fills the
+ *   next slot in place with interrupts off, so it's safe from ISRs
+ *   and costs a few dozen cycles, a full ring counts a drop instead
+ *   of blocking
+ * - trace_flush() (from the main loop, one place only) drains both
+ *   rings oldest first and writes COBS/CRC16 frames like lib/proto
+ * - the first time the flusher sees a format it sends the string
+ *   itself, after that only its 32-bit id (the address)
+ * - host/trace_decode rebuilds the text, plain text in between the
+ *   frames (regular printf output) is passed through
+ *
+ * Arguments are 32 bits each, so %d %i %u %x %X %o %c and %p work,
+ * %s can't (the pointer means nothing on the host) and floats need
+ * to be scaled to integers first.
+ *
+ * Frame payloads, little endian:
+ *
+ *   TRACE_FRAME_RECORD  timestamp u32, id u32, core u8, nargs u8, args u32 * nargs
+ *   TRACE_FRAME_FORMAT  id u32, format string without the terminator
+ *   TRACE_FRAME_DROPPED core u8, count u32
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "spsc.h"
+
+#define TRACE_CORES 2
+#define TRACE_MAX_ARGS 4
+// records per core, power of two
+#define TRACE_RING_SIZE 128
+// formats the flusher remembers having sent, power of two
+#define TRACE_FORMAT_TABLE_SIZE 64
+// flushes between re-sending every format, so a late decoder catches up
+#define TRACE_FORMAT_REFRESH 256
+// longest format string sent
+#define TRACE_FORMAT_MAX 200
+
+#define TRACE_FRAME_RECORD 0x01
+#define TRACE_FRAME_FORMAT 0x02
+#define TRACE_FRAME_DROPPED 0x03
+
+typedef struct {
+    uint32_t timestamp;
+    const char *format;
+    uint8_t core;
+    uint8_t nargs;
+    uint32_t args[TRACE_MAX_ARGS];
+} trace_record_t;
+
+/**
+ * Output for trace_flush()
+ *
+ * @param data
+ * @param len
+ * @param user - user pointer given to trace_flush()
+ */
+typedef void (*trace_write_t)(const uint8_t *data, size_t len, void *user);
+
+// pick trace_log0 .. trace_log4 by the number of arguments
+#define TRACE_SELECT(_0, _1, _2, _3, _4, name, ...) name
+#define TRACE(...) TRACE_SELECT(__VA_ARGS__, trace_log4, trace_log3, trace_log2, trace_log1, trace_log0, _)(__VA_ARGS__)
+
+void trace_init(void);
+void trace_record(const char *format, uint32_t nargs, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+size_t trace_flush(trace_write_t write, void *user);
+uint32_t trace_get_dropped(uint32_t core);
+void trace_stdio_write(const uint8_t *data, size_t len, void *user);
+
+#if !PICO_ON_DEVICE
+void trace_host_set_core(uint32_t core);
+#endif
+
+static inline void trace_log0(const char *format) {
+    trace_record(format, 0, 0, 0, 0, 0);
+}
+
+static inline void trace_log1(const char *format, uint32_t a0) {
+    trace_record(format, 1, a0, 0, 0, 0);
+}
+
+static inline void trace_log2(const char *format, uint32_t a0, uint32_t a1) {
+    trace_record(format, 2, a0, a1, 0, 0);
+}
+
+static inline void trace_log3(const char *format, uint32_t a0, uint32_t a1, uint32_t a2) {
+    trace_record(format, 3, a0, a1, a2, 0);
+}
+
+static inline void trace_log4(const char *format, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3) {
+    trace_record(format, 4, a0, a1, a2, a3);
+}
+
+// host side, see trace_decode.c
+#define TRACE_DECODER_FORMATS 1024
+#define TRACE_DECODER_BUFFER 512
+
+typedef struct {
+    // format strings by id, open addressing
+    uint32_t ids[TRACE_DECODER_FORMATS];
+    char *formats[TRACE_DECODER_FORMATS];
+    // bytes since the last delimiter, a frame or plain text
+    uint8_t raw[TRACE_DECODER_BUFFER];
+    size_t len;
+    uint32_t records;
+    uint32_t errors;
+    uint32_t dropped;
+} trace_decoder_t;
+
+/**
+ * Decoder output, one call per line of text
+ *
+ * @param line - without the newline
+ * @param user - user pointer given to trace_decoder_feed()
+ */
+typedef void (*trace_line_t)(const char *line, void *user);
+
+size_t trace_format(char *out, size_t size, const char *format, const uint32_t *args, uint32_t nargs);
+void trace_decoder_init(trace_decoder_t *decoder);
+void trace_decoder_free(trace_decoder_t *decoder);
+void trace_decoder_feed(trace_decoder_t *decoder, const uint8_t *data, size_t len, trace_line_t line, void *user);
@@ -0,0 +1,280 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "proto.h"
+#include "trace.h"
+
+/**
+ * Format a trace record like printf() would have
+ *
+ * Every conversion takes one 32-bit argument, length modifiers are
+ * ignored, %s prints a placeholder and a missing argument prints
+ * as <?>.
+ *
+ * @param out - receives the text, always terminated
+ * @param size - size of out
+ * @param format - the TRACE() format string
+ * @param args - raw arguments
+ * @param nargs - number of raw arguments
+ *
+ * @return size_t - length of the text
+ */
+size_t trace_format(char *out, size_t size, const char *format, const uint32_t *args, uint32_t nargs) {
+    size_t len = 0;
+    uint32_t arg = 0;
+
+    if (!size) return 0;
+
+    while (*format && len + 1 < size) {
+        if (*format != '%') {
+            out[len++] = *format++;
+            continue;
+        }
+
+        if (format[1] == '%') {
+            out[len++] = '%';
+            format += 2;
+            continue;
+        }
+
+        // rebuild the spec without length modifiers: flags, width, precision, conversion
+        char spec[16];
+        size_t spec_len = 0;
+        const char *start = format++;
+
+        spec[spec_len++] = '%';
+        while (*format && strchr("-+ #0123456789.", *format) && spec_len < sizeof(spec) - 3) {
+            spec[spec_len++] = *format++;
+        }
+        while (*format && strchr("hlzjt", *format)) format++;
+
+        char conversion = *format;
+        if (!conversion || !strchr("diuxXocps", conversion)) {
+            // not something we know, print it as is
+            size_t n = format - start;
+            if (n > size - 1 - len) n = size - 1 - len;
+            memcpy(out + len, start, n);
+            len += n;
+            continue;
+        }
+        format++;
+
+        int written;
+        if (conversion == 's') {
+            written = snprintf(out + len, size - len, "<str>");
+        } else if (arg >= nargs) {
+            written = snprintf(out + len, size - len, "<?>");
+        } else if (conversion == 'p') {
+            written = snprintf(out + len, size - len, "0x%08x", (unsigned) args[arg]);
+        } else {
+            spec[spec_len++] = conversion;
+            spec[spec_len] = 0;
+
+            if (conversion == 'd' || conversion == 'i') {
+                written = snprintf(out + len, size - len, spec, (int) (int32_t) args[arg]);
+            } else {
+                written = snprintf(out + len, size - len, spec, (unsigned) args[arg]);
+            }
+        }
+
+        if (conversion != 's' && arg < nargs) arg++;
+        if (written < 0) break;
+        len += (size_t) written < size - len ? (size_t) written : size - 1 - len;
+    }
+
+    out[len] = 0;
+    return len;
+}
+
+/**
+ * Initialize a decoder
+ *
+ * @param decoder
+ *
+ * @return void
+ */
+void trace_decoder_init(trace_decoder_t *decoder) {
+    memset(decoder, 0, sizeof(*decoder));
+}
+
+/**
+ * Free the format strings a decoder collected
+ *
+ * @param decoder
+ *
+ * @return void
+ */
+void trace_decoder_free(trace_decoder_t *decoder) {
+    for (uint32_t i = 0; i < TRACE_DECODER_FORMATS; i++) {
+        free(decoder->formats[i]);
+    }
+    trace_decoder_init(decoder);
+}
+
+/**
+ * Find the table slot of a format id
+ *
+ * @param decoder
+ * @param id
+ *
+ * @return uint32_t - the slot holding id, or the empty slot it goes into
+ */
+static uint32_t format_slot(trace_decoder_t *decoder, uint32_t id) {
+    uint32_t slot = (id >> 2) & (TRACE_DECODER_FORMATS - 1);
+
+    for (uint32_t i = 0; i < TRACE_DECODER_FORMATS; i++) {
+        uint32_t index = (slot + i) & (TRACE_DECODER_FORMATS - 1);
+        if (decoder->ids[index] == id || !decoder->formats[index]) return index;
+    }
+
+    // full, reuse the home slot
+    return slot;
+}
+
+static uint32_t get_u32(const uint8_t *pos) {
+    return pos[0] | (pos[1] << 8) | (pos[2] << 16) | ((uint32_t) pos[3] << 24);
+}
+
+/**
+ * Pass plain text through line by line
+ *
+ * @param text
+ * @param len
+ * @param all - also pass a trailing partial line
+ * @param line - output
+ * @param user - passed on to line
+ *
+ * @return size_t - bytes used, a trailing partial line is left over
+ */
+static size_t emit_text(const uint8_t *text, size_t len, bool all, trace_line_t line, void *user) {
+    char buf[TRACE_DECODER_BUFFER + 1];
+    size_t used = 0;
+    size_t start = 0;
+
+    for (size_t i = 0; i <= len; i++) {
+        bool end = i == len;
+        if (!end && text[i] != '\n') continue;
+        if (end && !all) break;
+
+        size_t n = i - start;
+        // CRLF from stdio
+        while (n && (text[start + n - 1] == '\r')) n--;
+        if (n || !end) {
+            memcpy(buf, text + start, n);
+            buf[n] = 0;
+            line(buf, user);
+        }
+
+        start = i + 1;
+        used = end ? len : start;
+    }
+
+    return used;
+}
+
+/**
+ * Handle the frame (or text) collected up to a delimiter
+ *
+ * @param decoder
+ * @param line - output
+ * @param user - passed on to line
+ *
+ * @return void
+ */
+static void decode_chunk(trace_decoder_t *decoder, trace_line_t line, void *user) {
+    uint8_t frame[TRACE_DECODER_BUFFER];
+    char text[TRACE_DECODER_BUFFER + 64];
+    size_t len = proto_cobs_decode(decoder->raw, decoder->len, frame);
+
+    if (len < 1 + PROTO_CRC_SIZE || proto_crc16(frame, len - PROTO_CRC_SIZE) != (frame[len - 2] | (frame[len - 1] << 8))) {
+        // not a frame, printf() output in between
+        emit_text(decoder->raw, decoder->len, true, line, user);
+        return;
+    }
+    len -= PROTO_CRC_SIZE;
+
+    switch (frame[0]) {
+        case TRACE_FRAME_FORMAT: {
+            if (len < 5) break;
+            uint32_t id = get_u32(&frame[1]);
+            uint32_t slot = format_slot(decoder, id);
+
+            free(decoder->formats[slot]);
+            decoder->formats[slot] = malloc(len - 5 + 1);
+            memcpy(decoder->formats[slot], &frame[5], len - 5);
+            decoder->formats[slot][len - 5] = 0;
+            decoder->ids[slot] = id;
+            return;
+        }
+        case TRACE_FRAME_DROPPED: {
+            if (len < 6) break;
+            uint32_t count = get_u32(&frame[2]);
+            decoder->dropped += count;
+            snprintf(text, sizeof(text), "[trace] core %u dropped %u records", frame[1], (unsigned) count);
+            line(text, user);
+            return;
+        }
+        case TRACE_FRAME_RECORD: {
+            if (len < 11 || frame[10] > TRACE_MAX_ARGS || len != 11 + frame[10] * 4u) break;
+            uint32_t timestamp = get_u32(&frame[1]);
+            uint32_t id = get_u32(&frame[5]);
+            uint32_t args[TRACE_MAX_ARGS];
+            uint32_t nargs = frame[10];
+
+            for (uint32_t i = 0; i < nargs; i++) {
+                args[i] = get_u32(&frame[11 + i * 4]);
+            }
+
+            int prefix = snprintf(text, sizeof(text), "[%5u.%06u] c%u ", (unsigned) (timestamp / 1000000), (unsigned) (timestamp % 1000000), frame[9]);
+            uint32_t slot = format_slot(decoder, id);
+
+            if (decoder->formats[slot] && decoder->ids[slot] == id) {
+                trace_format(text + prefix, sizeof(text) - prefix, decoder->formats[slot], args, nargs);
+            } else {
+                // joined after the format was sent, it comes again every TRACE_FORMAT_REFRESH flushes
+                int n = snprintf(text + prefix, sizeof(text) - prefix, "<format 0x%08x>", (unsigned) id);
+                for (uint32_t i = 0; i < nargs && prefix + n < (int) sizeof(text); i++) {
+                    n += snprintf(text + prefix + n, sizeof(text) - prefix - n, " 0x%x", (unsigned) args[i]);
+                }
+            }
+
+            decoder->records++;
+            line(text, user);
+            return;
+        }
+    }
+
+    decoder->errors++;
+}
+
+/**
+ * Feed bytes received from the board
+ *
+ * @param decoder
+ * @param data
+ * @param len
+ * @param line - called with every decoded record and every line of plain text
+ * @param user - passed on to line
+ *
+ * @return void
+ */
+void trace_decoder_feed(trace_decoder_t *decoder, const uint8_t *data, size_t len, trace_line_t line, void *user) {
+    for (size_t i = 0; i < len; i++) {
+        if (data[i]) {
+            if (decoder->len == sizeof(decoder->raw)) {
+                // longer than any frame, must be text, keep the partial line
+                size_t used = emit_text(decoder->raw, decoder->len, false, line, user);
+                if (!used) used = emit_text(decoder->raw, decoder->len, true, line, user);
+                memmove(decoder->raw, decoder->raw + used, decoder->len - used);
+                decoder->len -= used;
+            }
+            decoder->raw[decoder->len++] = data[i];
+            continue;
+        }
+
+        if (decoder->len) {
+            decode_chunk(decoder, line, user);
+        }
+        decoder->len = 0;
+    }
+}
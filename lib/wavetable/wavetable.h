@@ -0,0 +1,42 @@
+/**
+ * @brief Compile-time wavetable generation
+ *
+ * The C preprocessor can't loop, but it can expand a macro a fixed
+ * number of times. WAVETABLE_REPEAT_<n>(F) expands to
+ *
+ *   F(0), F(1), F(2), ..., F(n - 1)
+ *
+ * so any table whose entries are a constant expression of the index
+ * can be written as a const initializer:
+ *
+ *   #define SQUARE(i) ((i) * (i))
+ *   static const uint32_t squares[256] = { WAVETABLE_REPEAT_256(SQUARE) };
+ *
+ * The compiler folds every entry, so the table ends up as plain const
+ * data (flash) with no code running at boot or inside an ISR.
+ */
+
+#pragma once
+
+#define WAVETABLE_R1(F, i) F(i)
+#define WAVETABLE_R2(F, i) WAVETABLE_R1(F, i), WAVETABLE_R1(F, (i) + 1)
+#define WAVETABLE_R4(F, i) WAVETABLE_R2(F, i), WAVETABLE_R2(F, (i) + 2)
+#define WAVETABLE_R8(F, i) WAVETABLE_R4(F, i), WAVETABLE_R4(F, (i) + 4)
+#define WAVETABLE_R16(F, i) WAVETABLE_R8(F, i), WAVETABLE_R8(F, (i) + 8)
+#define WAVETABLE_R32(F, i) WAVETABLE_R16(F, i), WAVETABLE_R16(F, (i) + 16)
+#define WAVETABLE_R64(F, i) WAVETABLE_R32(F, i), WAVETABLE_R32(F, (i) + 32)
+#define WAVETABLE_R128(F, i) WAVETABLE_R64(F, i), WAVETABLE_R64(F, (i) + 64)
+#define WAVETABLE_R256(F, i) WAVETABLE_R128(F, i), WAVETABLE_R128(F, (i) + 128)
+#define WAVETABLE_R512(F, i) WAVETABLE_R256(F, i), WAVETABLE_R256(F, (i) + 256)
+#define WAVETABLE_R1024(F, i) WAVETABLE_R512(F, i), WAVETABLE_R512(F, (i) + 512)
+
+// expand F(0) .. F(n - 1), n must be a power of two up to 1024
+#define WAVETABLE_REPEAT_32(F) WAVETABLE_R32(F, 0)
+#define WAVETABLE_REPEAT_64(F) WAVETABLE_R64(F, 0)
+#define WAVETABLE_REPEAT_128(F) WAVETABLE_R128(F, 0)
+#define WAVETABLE_REPEAT_256(F) WAVETABLE_R256(F, 0)
+#define WAVETABLE_REPEAT_512(F) WAVETABLE_R512(F, 0)
+#define WAVETABLE_REPEAT_1024(F) WAVETABLE_R1024(F, 0)
+
+// DMA ring alignment: a ring of 2^bits bytes must start on a 2^bits boundary
+#define WAVETABLE_RING_ALIGNED(bits) __attribute__((aligned(1u << (bits))))
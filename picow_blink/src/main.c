@@ -1,25 +1,19 @@
 #include "pico/stdlib.h"
-#include "pico/cyw43_arch.h"
+#include "board.h"
 
 int main() {
     // initialize stdio
-    stdio_init_all();
-
-    // initialize Wi-Fi
-    if (cyw43_arch_init()) {
-        printf("Wi-Fi init failed");
-        return -1;
-    }
+    board_init();
 
     while (true) {
         // turn on the LED
         printf("LED ON\n");
-        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
+        board_led_put(1);
         sleep_ms(1000);
 
         // turn off the LED
         printf("LED OFF\n");
-        cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
+        board_led_put(0);
         sleep_ms(1000);
     }
 
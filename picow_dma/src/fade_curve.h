@@ -0,0 +1,26 @@
+/**
+ * @brief Fade curve of the picow_dma example
+ *
+ * Kept apart from main.c so host/wavetable_check can expand the same
+ * FADE() into a table and compare it against the loop it replaced.
+ * The includer defines PWM_WRAP before using FADE().
+ */
+
+#pragma once
+
+// use quadratic function to get non-linear fade effect
+// which results in a more gradual and smooth fade effect
+//
+// calculate our scaling factor using quadratic function
+// this allows us to generate values that are non-linear
+// but will still fit into the PWM counter resolution (the
+// wrap) and our buffer size of 256
+#define FADE_SCALE ((float) PWM_WRAP / (255.0f * 255.0f))
+// calculate the fade value, same float math the loop used to do at boot
+#define FADE(i) ((uint32_t) ((i) * (i) * FADE_SCALE))
+
+// fade steps per pass, one per PWM period, so a pass takes ~1.07 s
+#define FADE_STEPS 256
+// the data channel reads a table through a ring of
+// FADE_STEPS * 4 = 1024 bytes (2^10), so tables must be 1024-byte aligned
+#define FADE_RING_BITS 10
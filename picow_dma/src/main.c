@@ -1,19 +1,136 @@
 #include "pico/stdlib.h"
-#include "pico/cyw43_arch.h"
+#include "hardware/clocks.h"
 #include "hardware/dma.h"
 #include "hardware/pwm.h"
+#include "board.h"
+#include "pwm_solver.h"
+#include "wavetable.h"
+#include "fade_curve.h"
 
 #define LED_PIN 16
 
+// PWM carrier, fast enough not to flicker, solved at compile time
+// for the default system clock (SYS_CLK_KHZ) with the finest steps
+#define PWM_FREQUENCY PWM_HZ(240)
+#define PWM_DIV16 PWM_SOLVE_DIV16(SYS_CLK_KHZ * 1000, PWM_FREQUENCY)
+#define PWM_WRAP PWM_SOLVE_WRAP(SYS_CLK_KHZ * 1000, PWM_FREQUENCY)
+
+_Static_assert(PWM_DIV16 != 0, "PWM_FREQUENCY is too low for the system clock");
+_Static_assert(PWM_WRAP <= PWM_WRAP_MAX, "PWM_FREQUENCY doesn't fit a 16-bit wrap");
+
+// peak brightness of each curve the main loop cycles through, in percent
+static const uint8_t fade_peaks[] = {100, 50, 25};
+
+// two fade tables, the DMA plays one while the CPU writes the other.
+// the first one is generated by the compiler, so nothing has to be
+// computed at boot, it is copied to RAM with the rest of .data
+static uint32_t fade_buffers[2][FADE_STEPS] WAVETABLE_RING_ALIGNED(FADE_RING_BITS) = {
+    { WAVETABLE_REPEAT_256(FADE) },
+};
+
+_Static_assert(sizeof(fade_buffers[0]) == (1u << FADE_RING_BITS), "fade table ring size");
+
+// table the next pass plays, read by the control channel at every
+// buffer boundary. a single aligned 32-bit store, so a swap is atomic
+static volatile uint32_t fade_next_table;
+// feeds the PWM CC register, its read address tells us which table plays
+static int fade_data_channel;
+
+/**
+ * Start the fade, it runs on its own from here
+ *
+ * The data channel writes one table entry into the slice's CC register
+ * per PWM wrap and wraps its read address around the table through a
+ * ring. When a pass is done it chains to the control channel, which
+ * copies fade_next_table into the data channel's al3_read_addr_trig,
+ * restarting it on whatever table is queued:
+ *
+ *   data ---chain---> control ---al3_read_addr_trig---> data
+ *
+ * Because of the ring the data channel's read address never leaves
+ * the table it plays, see fade_swap_pending().
+ *
+ * @param slice_num - PWM slice, its wrap paces the fade
+ * @param table - first table, FADE_STEPS words, 1024-byte aligned
+ *
+ * @return void
+ */
+void fade_start(uint slice_num, const uint32_t *table) {
+    // claim the data and control channels
+    fade_data_channel = dma_claim_unused_channel(true);
+    int control_channel = dma_claim_unused_channel(true);
+
+    // replay the first table until another one is queued
+    fade_next_table = (uint32_t) (uintptr_t) table;
+
+    // data channel: one table entry per PWM wrap, then hand over to the control channel
+    dma_channel_config data_config = dma_channel_get_default_config(fade_data_channel);
+    // set transfer data size to 32 bits
+    channel_config_set_transfer_data_size(&data_config, DMA_SIZE_32);
+    // walk the table, the ring brings the read address back to its start
+    channel_config_set_read_increment(&data_config, true);
+    channel_config_set_ring(&data_config, false, FADE_RING_BITS);
+    // always the same PWM cc register (cc = counter compare)
+    channel_config_set_write_increment(&data_config, false);
+    // transfer when the PWM slice asks for a new value
+    channel_config_set_dreq(&data_config, pwm_get_dreq(slice_num));
+    channel_config_set_chain_to(&data_config, control_channel);
+
+    dma_channel_configure(
+        fade_data_channel, // channel
+        &data_config, // config
+        &pwm_hw->slice[slice_num].cc, // write directly to the PWM cc register
+        table, // set by the control channel
+        FADE_STEPS, // one pass, reloaded at every trigger
+        false // started by the control channel
+    );
+
+    // control channel: copies the queued table address into the
+    // data channel's al3_read_addr_trig, which also triggers it
+    dma_channel_config control_config = dma_channel_get_default_config(control_channel);
+    channel_config_set_transfer_data_size(&control_config, DMA_SIZE_32);
+    channel_config_set_read_increment(&control_config, false);
+    channel_config_set_write_increment(&control_config, false);
+
+    dma_channel_configure(
+        control_channel, // channel
+        &control_config, // config
+        &dma_hw->ch[fade_data_channel].al3_read_addr_trig, // write address
+        &fade_next_table, // read address
+        1, // one word
+        true // load the first pass, everything is automatic from here...
+    );
+}
+
+/**
+ * Queue a table, it starts playing at the next buffer boundary
+ *
+ * The pass that is playing always finishes on its own table, so a
+ * fade never jumps halfway through.
+ *
+ * @param table - FADE_STEPS words, 1024-byte aligned
+ *
+ * @return void
+ */
+void fade_queue(const uint32_t *table) {
+    fade_next_table = (uint32_t) (uintptr_t) table;
+}
+
+/**
+ * Check if the queued table hasn't started playing yet
+ *
+ * Until it has, the table that is playing must not be touched.
+ *
+ * @return bool
+ */
+bool fade_swap_pending(void) {
+    uint32_t playing = dma_hw->ch[fade_data_channel].read_addr & ~((1u << FADE_RING_BITS) - 1);
+    return playing != fade_next_table;
+}
+
 int main() {
     // initialize stdio
-    stdio_init_all();
-
-    // initialize Wi-Fi
-    if (cyw43_arch_init()) {
-        printf("Wi-Fi init failed");
-        return -1;
-    }
+    board_init();
 
     // initialize led pin to use PWM
     gpio_set_function(LED_PIN, GPIO_FUNC_PWM);
@@ -22,63 +139,47 @@ int main() {
     uint slice_num = pwm_gpio_to_slice_num(LED_PIN);
     // get default config
     pwm_config config = pwm_get_default_config();
-    // set clock divider to 8 (125 Mhz / 8 = 15.625 Mhz)
-    pwm_config_set_clkdiv(&config, 8.f);
+    // set the solved 8.4 clock divider and wrap
+    pwm_config_set_clkdiv_int_frac(&config, PWM_DIV16 >> 4, PWM_DIV16 & 15);
+    pwm_config_set_wrap(&config, PWM_WRAP);
     // initialize PWM
     pwm_init(slice_num, &config, true);
 
-    // holds the fade buffer, should be 32-bit aligned 
-    // since we are using 32-bit transfer size
-    uint32_t fade[256];
-    // fill the fade buffer
-    for(int i = 0; i < 256; i++) {
-        // use quadratic function to get non-linear fade effect
-        // which results in a more gradual and smooth fade effect
-
-        // calculate our scaling factor using quadratic function
-        // this allows us to generate values that are non-linear
-        // but will still fit into the 16-bit PWM counter resolution
-        // and our buffer size of 256
-        float scale = 65535.0f / (255.0f * 255.0f);
-        // calculate the fade value
-        fade[i] = (uint32_t)(i * i * scale);
-    }
+    // what the constants give at the clock we actually run at
+    pwm_timing_t timing;
+    pwm_timing_from(clock_get_hz(clk_sys), PWM_FREQUENCY, PWM_DIV16, PWM_WRAP, &timing);
+    printf("PWM %llu mHz (%ld ppm), div %u + %u/16, wrap %u\n", (unsigned long long) timing.frequency_mhz,
+           (long) timing.error_ppm,
+           timing.div16 >> 4, timing.div16 & 15, timing.wrap);
 
-    // initialize DMA channel
-    int dma_channel = dma_claim_unused_channel(true);
-    // get default dma config
-    dma_channel_config dma_config = dma_channel_get_default_config(dma_channel);
-    // set transfer data size to 32 bits
-    channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_32);
-    // set read increment to true, this will increment the read address after each transfer
-    // our read address will start from the fade buffer address and will increment by 4 bytes
-    // (32-bit) after each transfer. We need to enable this since we are reading from the fade buffer
-    channel_config_set_read_increment(&dma_config, true);
-    // set write increment to false, this will keep the write address constant
-    // since we are writing to the PWM slice cc register, we don't need to increment the write address
-    channel_config_set_write_increment(&dma_config, false);
-    // transfer when PWM slice that is connected to LED_PIN ask for a new value
-    channel_config_set_dreq(&dma_config, DREQ_PWM_WRAP0 + slice_num);
+    // the fade repeats without the CPU
+    uint front = 0;
+    fade_start(slice_num, fade_buffers[front]);
+
+    uint peak = 0;
 
     while (true) {
-        // reset dma channel every 256 transfers
-        if (dma_channel_is_busy(dma_channel)) {
-            dma_channel_wait_for_finish_blocking(dma_channel);
+        sleep_ms(3000);
+
+        // next curve
+        peak = (peak + 1) % (sizeof(fade_peaks) / sizeof(fade_peaks[0]));
+
+        // the buffer we are about to write has to be done playing
+        while (fade_swap_pending()) {
+            sleep_ms(10);
         }
 
-        // reset the dma channel
-        dma_channel_configure(
-            dma_channel, // channel
-            &dma_config, // config
-            &pwm_hw->slice[slice_num].cc, // Write directly to PWM cc register (cc = counter compare)
-            fade, // src
-            256, // transfer count
-            true // start immediately
-        );
+        // scale the quadratic curve into the buffer that isn't playing
+        uint32_t *back = fade_buffers[front ^ 1];
+        for (uint i = 0; i < FADE_STEPS; i++) {
+            back[i] = FADE(i) * fade_peaks[peak] / 100;
+        }
 
-        sleep_ms(3000);
-        tight_loop_contents();
+        // picked up at the end of the current pass
+        fade_queue(back);
+        front ^= 1;
+        printf("fade peak %u%%\n", fade_peaks[peak]);
     }
 
     return 0;
-}
\ No newline at end of file
+}
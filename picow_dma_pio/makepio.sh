@@ -0,0 +1 @@
+$PICO_SDK_PATH/tools/pioasm/build/pioasm -o c-sdk src/dma_pio.pio src/dma_pio.pio.h
\ No newline at end of file
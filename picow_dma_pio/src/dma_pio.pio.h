@@ -0,0 +1,74 @@
+// -------------------------------------------------- //
+// This file is autogenerated by pioasm; do not edit! //
+// -------------------------------------------------- //
+
+#pragma once
+
+#if !PICO_NO_HARDWARE
+#include "hardware/pio.h"
+#endif
+
+// ------- //
+// dma_pio //
+// ------- //
+
+#define dma_pio_wrap_target 0
+#define dma_pio_wrap 0
+#define dma_pio_pio_version 0
+
+static const uint16_t dma_pio_program_instructions[] = {
+            //     .wrap_target
+    0x6001, //  0: out    pins, 1                    
+            //     .wrap
+};
+
+#if !PICO_NO_HARDWARE
+static const struct pio_program dma_pio_program = {
+    .instructions = dma_pio_program_instructions,
+    .length = 1,
+    .origin = -1,
+    .pio_version = 0,
+#if PICO_PIO_VERSION > 0
+    .used_gpio_ranges = 0x0
+#endif
+};
+
+static inline pio_sm_config dma_pio_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + dma_pio_wrap_target, offset + dma_pio_wrap);
+    return c;
+}
+#endif
+
+// ---------- //
+// dma_pio_x8 //
+// ---------- //
+
+#define dma_pio_x8_wrap_target 0
+#define dma_pio_x8_wrap 0
+#define dma_pio_x8_pio_version 0
+
+static const uint16_t dma_pio_x8_program_instructions[] = {
+            //     .wrap_target
+    0x6008, //  0: out    pins, 8                    
+            //     .wrap
+};
+
+#if !PICO_NO_HARDWARE
+static const struct pio_program dma_pio_x8_program = {
+    .instructions = dma_pio_x8_program_instructions,
+    .length = 1,
+    .origin = -1,
+    .pio_version = 0,
+#if PICO_PIO_VERSION > 0
+    .used_gpio_ranges = 0x0
+#endif
+};
+
+static inline pio_sm_config dma_pio_x8_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + dma_pio_x8_wrap_target, offset + dma_pio_x8_wrap);
+    return c;
+}
+#endif
+
@@ -17,25 +17,137 @@
  * 2. PIO State Machine
  *    - PIO state machine reads data from the TX FIFO into the OSR
  *      and then shifts it out to the GPIO pin
+ *
+ * Sequencer mode (DMA_SEQUENCER 1, default):
+ *
+ * Instead of taking an interrupt after every block to point the
+ * DMA at the next pwm level, a control channel walks a table of
+ * {transfer_count, read_addr} control blocks and re-triggers the
+ * data channel by itself, like the al2_write_addr_trig chain in
+ * picow_dma_pwm. The whole fade runs with zero interrupts, the
+ * report once a second shows the DMA IRQ lines (enabled, with a
+ * counting handler) staying quiet while the data blocks advance:
+ *
+ *   data ---chain---> reload ---al2_write_addr_trig---> control
+ *    ^                                                     |
+ *    +----------------al3_read_addr_trig-------------------+
+ *
+ * - data: streams one wavetable word DMA_TRANSFER_SIZE times into the PIO TX FIFO
+ * - control: copies the next control block into the data channel's alias 3
+ *   registers, the read_addr write triggers the data channel
+ * - reload: rewinds the control channel's write address back to the data
+ *   channel's registers, which also triggers the control channel
+ *
+ * The control channel reads the table through a ring, so after the
+ * last pwm level it wraps back to the first one without CPU help.
+ *
+ * Sigma-delta mode (PDM_ORDER 1 or 2, default 1, -DPDM_ORDER=0 for the
+ * wavetable sequencer above):
+ *
+ * The thermometer code above has 33 duty steps per word. Instead,
+ * core 1 encodes a 16-bit fade into sigma-delta words (lib/sigma_delta),
+ * whose density of ones averages out to the exact level. Same PIO
+ * program, same bit rate. Two buffers are played in turn:
+ *
+ *   data ---chain---> control ---al3_read_addr_trig---> data
+ *
+ * - data: streams one buffer into the PIO TX FIFO
+ * - control: copies the next buffer address from a 2-entry ring
+ *   into the data channel, which also triggers it
+ *
+ * Core 1 refills whichever buffer the data channel just left, it has
+ * PDM_BLOCK words of time (2.6 ms) to do it.
+ *
+ * Multi-pin (PIO_PINS 8, sigma-delta mode only):
+ *
+ * The state machine runs `out pins, 8` (dma_pio_x8) and drives 8 pins
+ * from the same DMA stream. Core 1 encodes a phase-shifted fade per
+ * pin, then bitslice_transpose() turns 8 per-pin words (32 steps each)
+ * into 8 stream words (4 steps of all 8 pins each). The clock divider
+ * goes up 8 times, so the DMA and core 1 move the same 12.5 Mbit/s.
  */
 
 #include "pico/stdlib.h"
-#include "pico/cyw43_arch.h"
+#include "pico/multicore.h"
 #include "hardware/dma.h"
 #include "hardware/irq.h"
 #include "hardware/pio.h"
+#include "board.h"
 #include "dma_pio.pio.h"
+#include "bitslice.h"
+#include "sigma_delta.h"
+#include "trace.h"
+#include "wavetable.h"
+#include "pwm_levels.h"
 
 // define the LED pin
 #define LED_PIN 16
-// state machine will run at 125 Mhz / 10 = 12.5 Mhz
-#define PIO_CLK_DIV 10.f
+// state machine will run at 125 Mhz / 10 = 12.5 Mhz, with PIO_PINS 8
+// at 1/8 of that, so the DMA and core 1 still move 12.5 Mbit/s
+#define PIO_CLK_DIV (10.f * PIO_PINS)
 // number of samples to transfer
 #define DMA_TRANSFER_SIZE 10000
 // number of PWM levels
 #define PWM_LEVELS 32
+// 1 = chained control block sequencer (no interrupts), 0 = reload from dma_handler()
+#define DMA_SEQUENCER 1
+// 1 or 2 = sigma-delta fade encoded by core 1 (order 2 takes about twice
+// the CPU time, close to the 2.56 us per word at PIO_CLK_DIV 10), 0 = the
+// 32-level wavetable with DMA_SEQUENCER, set with cmake -DPDM_ORDER=0
+#ifndef PDM_ORDER
+#define PDM_ORDER 1
+#endif
+// words per sigma-delta buffer, 1024 * 32 bits at 12.5 Mbit/s = 2.6 ms
+#define PDM_BLOCK 1024
+// pins driven from the one DMA stream: 1 = LED_PIN (`out pins, 1`),
+// 8 = PIO_PIN_BASE .. PIO_PIN_BASE + 7 (`out pins, 8`), each with its
+// own sigma-delta fade, bit-sliced into the stream by lib/bitslice
+#define PIO_PINS 1
+#if PIO_PINS == 1
+#define PIO_PIN_BASE LED_PIN
+#else
+// GPIO 8 .. 15, GPIO 23 and up belong to the wireless chip on the Pico W
+#define PIO_PIN_BASE 8
+#endif
+// fade up and back down, in words of one pin's stream (~2 s)
+#define PDM_FADE_WORDS (781250 / PIO_PINS)
+// words of one pin's stream per buffer
+#define PDM_PIN_WORDS (PDM_BLOCK / PIO_PINS)
+
+_Static_assert(PIO_PINS == 1 || (PIO_PINS == 8 && PDM_ORDER), "PIO_PINS is 1, or 8 in sigma-delta mode");
 
 int dma_channel;
+// DMA interrupts that reached the CPU: dma_handler() in reload mode,
+// dma_idle_handler() in sequencer and sigma-delta mode, where it stays 0
+volatile uint32_t dma_irq_count = 0;
+// main loop samples per report, 10 a second so the sequencer's ring of
+// PWM_LEVELS blocks (0.8 s at DMA_TRANSFER_SIZE words) can't lap between two
+#define REPORT_SAMPLES 10
+
+// wavetable (emulates PWM levels), WAVETABLE_LEVEL() is in pwm_levels.h
+
+// wavetable data from lowest to highest, lives in flash
+// so the DMA handler no longer has to build it on first run
+static const uint32_t wavetable[PWM_LEVELS] = { WAVETABLE_REPEAT_32(WAVETABLE_LEVEL) };
+
+// one control block per pwm level, laid out like the
+// data channel's alias 3 trans_count/read_addr_trig pair
+typedef struct {
+    uint32_t transfer_count;
+    uint32_t read_addr;
+} dma_control_block_t;
+
+// the control channel reads this through a ring of
+// PWM_LEVELS * 8 = 256 bytes (2^8), so it must be 256-byte aligned
+#define CONTROL_RING_BITS 8
+static dma_control_block_t control_blocks[PWM_LEVELS] __attribute__((aligned(1u << CONTROL_RING_BITS)));
+
+_Static_assert(sizeof(control_blocks) == (1u << CONTROL_RING_BITS), "control block ring size");
+
+// control channel write address, copied back by the reload channel
+static uint32_t control_write_addr;
+// control channel, its read address tells us the current pwm level
+int control_channel;
 
 /**
  * Initialize the DMA PIO program, this can be placed in dma_pio.pio.h
@@ -43,22 +155,26 @@ int dma_channel;
  * @param pio - pointer to the PIO instance
  * @param sm - state machine number
  * @param offset - offset of the PIO program
- * @param pin - pin number
+ * @param pin - first pin number
+ * @param pin_count - 1 for dma_pio, 8 for dma_pio_x8
  * @param clk_div - clock divider
  * 
  * @return void
  */
-void dma_pio_program_init(PIO pio, uint sm, uint offset, uint pin, float clk_div) {
-    // initialize led pin to use PIO
-    pio_gpio_init(pio, pin);
-    // set the direction of the pin to output
-    pio_sm_set_consecutive_pindirs(pio, sm, pin, 1, true);
-    // get the dma pio program default config (see: dma_pio.pio.h)
-    pio_sm_config c = dma_pio_program_get_default_config(offset);
+void dma_pio_program_init(PIO pio, uint sm, uint offset, uint pin, uint pin_count, float clk_div) {
+    // initialize the pins to use PIO
+    for (uint i = 0; i < pin_count; i++) {
+        pio_gpio_init(pio, pin + i);
+    }
+    // set the direction of the pins to output
+    pio_sm_set_consecutive_pindirs(pio, sm, pin, pin_count, true);
+    // get the program's default config (see: dma_pio.pio.h), both only set the wrap
+    pio_sm_config c = pin_count == 1 ? dma_pio_program_get_default_config(offset)
+                                     : dma_pio_x8_program_get_default_config(offset);
 
     // configure state machine
     // set out pins
-    sm_config_set_out_pins(&c, pin, 1);
+    sm_config_set_out_pins(&c, pin, pin_count);
     // join FIFO as TX fifo (we have 2 FIFOs, TX and RX)
     // each has 4 slots, 32-bits each, so we now have 8 slots
     sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
@@ -94,38 +210,8 @@ void dma_pio_program_init(PIO pio, uint sm, uint offset, uint pin, float clk_div
 void dma_handler() {
     // pwm level index
     static int pwm_level = 0;
-    // wavetable data from lowest to highest
-    static uint32_t wavetable[PWM_LEVELS];
-    // first run flag
-    static bool first_run = true;
-
-    // if first run, generate the wavetable
-    if (first_run) {
-        first_run = false;
-
-        //
-        // Generate the wavetable (emulates PWM levels)
-        //
-        // this part is really clever, for us to be able to
-        // generate a gradual fade effect with PIO and DMA we
-        // need to generate a bit pattern that graudually increases
-        // the number of bits set to 1 starting from the lowest bit
-        // 
-        // ex: (note that DMA transfers 32-bits at a time)
-        // 
-        // 00000000000000000000000000000000 = 0 (off for 31 cycles)
-        // 00000000000000000000000000000001 = 1 (on for 1 cycle)
-        // 00000000000000000000000000000011 = 3 (on for 2 cycles)
-        // 00000000000000000000000000000111 = 7
-        // ....
-        // 00000000000000011111111111111111 = 65535 (50% duty cycle, on for half of the cycles)
-        // ....
-        // 01111111111111111111111111111111 = 2147483647 (100% duty cycle, on for all cycles)
-        for(int i = 0; i < PWM_LEVELS; i++) {
-            wavetable[i] = ~(~0u << i);
-            printf("wavetable[%d] = %lu\n", i, wavetable[i]);
-        } 
-    }
+
+    dma_irq_count++;
 
     // by default ints0 = 0, meaning no interrupts are pending
     // when the DMA transfer completes, the DMA channel will
@@ -152,28 +238,343 @@ void dma_handler() {
 
     // increment the pwm level making sure it wraps around
     pwm_level = (pwm_level + 1) % PWM_LEVELS;
+
+    // safe in here, the formatting happens on the host
+    if (pwm_level == 0) {
+        TRACE("fade cycle done, irq %lu", dma_irq_count);
+    }
 }
 
-int main() {
-    // initialize stdio
-    stdio_init_all();
+/**
+ * Handler of both DMA IRQs when no channel is supposed to raise one
+ *
+ * Installed and enabled in the NVIC in sequencer and sigma-delta mode,
+ * so an interrupt the design didn't mean to raise lands here and
+ * shows up in dma_irq_count instead of going unnoticed.
+ *
+ * @return void
+ */
+void dma_idle_handler() {
+    dma_irq_count++;
+
+    // acknowledge whatever it was, the lines are levels
+    uint32_t channels = (1u << NUM_DMA_CHANNELS) - 1;
+    dma_hw->ints0 = dma_hw->ints0 & channels;
+    dma_hw->ints1 = dma_hw->ints1 & channels;
+}
 
-    // initialize Wi-Fi
-    if (cyw43_arch_init()) {
-        printf("Wi-Fi init failed");
-        return -1;
+/**
+ * Count the blocks the sequencer's data channel finished, call at
+ * least once per PWM_LEVELS blocks
+ *
+ * The control channel already points at the block after the one
+ * playing, the distance it moved since the last call is the number
+ * of blocks done.
+ *
+ * @param uint *level - receives the pwm level playing
+ * @return uint32_t - blocks since boot
+ */
+uint32_t sequencer_blocks(uint *level) {
+    static uint last_next = 1;
+    static uint32_t blocks = 0;
+
+    uint32_t offset = dma_hw->ch[control_channel].read_addr - (uint32_t) (uintptr_t) control_blocks;
+    uint next = (offset / sizeof(dma_control_block_t)) % PWM_LEVELS;
+
+    blocks += (next + PWM_LEVELS - last_next) % PWM_LEVELS;
+    last_next = next;
+    *level = (next + PWM_LEVELS - 1) % PWM_LEVELS;
+
+    return blocks;
+}
+
+/**
+ * Set up the data, control and reload channels of the sequencer
+ * 
+ * @param data_channel - channel feeding the PIO TX FIFO
+ * 
+ * @return void
+ */
+void dma_sequencer_init(int data_channel) {
+    // claim the control and reload channels
+    control_channel = dma_claim_unused_channel(true);
+    int reload_channel = dma_claim_unused_channel(true);
+
+    // fill the control blocks, one block of DMA_TRANSFER_SIZE words per pwm level
+    for (int i = 0; i < PWM_LEVELS; i++) {
+        control_blocks[i].transfer_count = DMA_TRANSFER_SIZE;
+        control_blocks[i].read_addr = (uint32_t) (uintptr_t) &wavetable[i];
     }
 
-    // slight delay...
-    sleep_ms(2000);
+    // the control channel always starts writing at the data channel's alias 3 trans_count
+    control_write_addr = (uint32_t) (uintptr_t) &dma_hw->ch[data_channel].al3_transfer_count;
+
+    // data channel: same as before, but chains to the reload channel when done
+    dma_channel_config data_config = dma_channel_get_default_config(data_channel);
+    channel_config_set_transfer_data_size(&data_config, DMA_SIZE_32);
+    channel_config_set_read_increment(&data_config, false);
+    channel_config_set_dreq(&data_config, DREQ_PIO0_TX0);
+    channel_config_set_chain_to(&data_config, reload_channel);
+
+    dma_channel_configure(
+        data_channel, // channel
+        &data_config, // config
+        &pio0_hw->txf[0], // write address, PIO0 TX FIFO state machine 0
+        NULL, // set by the control channel
+        DMA_TRANSFER_SIZE, // set by the control channel
+        false // started by the control channel
+    );
+
+    // control channel: copies one control block (2 words) into
+    // al3_transfer_count and al3_read_addr_trig, the second write
+    // triggers the data channel. the read address wraps around the table
+    dma_channel_config control_config = dma_channel_get_default_config(control_channel);
+    channel_config_set_transfer_data_size(&control_config, DMA_SIZE_32);
+    channel_config_set_read_increment(&control_config, true);
+    channel_config_set_write_increment(&control_config, true);
+    channel_config_set_ring(&control_config, false, CONTROL_RING_BITS);
+
+    dma_channel_configure(
+        control_channel, // channel
+        &control_config, // config
+        &dma_hw->ch[data_channel].al3_transfer_count, // write address, rewound by the reload channel
+        control_blocks, // read address, walks the table
+        2, // one control block
+        false // started by the reload channel
+    );
+
+    // reload channel: writes the control channel's write address
+    // through al2_write_addr_trig, which also triggers it
+    dma_channel_config reload_config = dma_channel_get_default_config(reload_channel);
+    channel_config_set_transfer_data_size(&reload_config, DMA_SIZE_32);
+    channel_config_set_read_increment(&reload_config, false);
+    channel_config_set_write_increment(&reload_config, false);
+
+    dma_channel_configure(
+        reload_channel, // channel
+        &reload_config, // config
+        &dma_hw->ch[control_channel].al2_write_addr_trig, // write address
+        &control_write_addr, // read address
+        1, // one word
+        false // don't start yet
+    );
+
+    // load the first control block, everything is automatic from here...
+    dma_channel_start(control_channel);
+}
+
+// two sigma-delta buffers, the DMA plays one while core 1 fills the other
+static uint32_t pdm_buffers[2][PDM_BLOCK];
+// their addresses, read by the pdm control channel through a ring of 8 bytes (2^3)
+#define PDM_RING_BITS 3
+static uint32_t pdm_buffer_addrs[2] __attribute__((aligned(1u << PDM_RING_BITS)));
+// streams the buffers, its read address tells core 1 which one plays
+static int pdm_data_channel;
+// encoder state of each pin, carried over from buffer to buffer
+static sigma_delta_t pdm_encoders[PIO_PINS];
+// buffers core 1 filled, and the ones it finished after the DMA had started on them
+volatile uint32_t pdm_blocks = 0;
+volatile uint32_t pdm_late = 0;
+// last fade level encoded, of the last pin
+volatile uint16_t pdm_level = 0;
+
+/**
+ * Get the buffer the data channel is playing
+ *
+ * Right after a buffer ends the read address points just past it,
+ * that's already the next buffer's turn.
+ *
+ * @return uint - 0 or 1
+ */
+static uint pdm_playing(void) {
+    uint32_t offset = dma_hw->ch[pdm_data_channel].read_addr - (uint32_t) (uintptr_t) pdm_buffers[0];
+    return (offset / sizeof(pdm_buffers[0])) & 1;
+}
+
+/**
+ * Encode the next PDM_BLOCK words of the fade into a buffer
+ *
+ * @param buffer - 0 or 1
+ *
+ * @return void
+ */
+static void pdm_fill(uint buffer) {
+    // position in the fade, in words of one pin's stream
+    static uint32_t position = 0;
+    static uint16_t samples[PDM_PIN_WORDS];
+#if PIO_PINS > 1
+    // each pin's words, bit-sliced into the buffer below
+    static uint32_t pin_words[PIO_PINS][PDM_PIN_WORDS];
+#endif
+
+    for (uint pin = 0; pin < PIO_PINS; pin++) {
+        // the same fade on every pin, spread out over its length
+        uint32_t pin_position = position + pin * (PDM_FADE_WORDS / PIO_PINS);
+
+        for (uint i = 0; i < PDM_PIN_WORDS; i++) {
+            // triangle 0 .. 65535 .. 0, squared for a gradual looking fade
+            uint32_t t = (uint64_t) ((pin_position + i) % PDM_FADE_WORDS) * 131070 / PDM_FADE_WORDS;
+            if (t > 65535) t = 131070 - t;
+            samples[i] = (t * t) >> 16;
+        }
+
+#if PIO_PINS > 1
+        sigma_delta_encode(&pdm_encoders[pin], samples, pin_words[pin], PDM_PIN_WORDS);
+#else
+        sigma_delta_encode(&pdm_encoders[pin], samples, pdm_buffers[buffer], PDM_BLOCK);
+#endif
+    }
+
+#if PIO_PINS > 1
+    // word i of every pin is 32 steps, PIO_PINS words of the stream
+    for (uint i = 0; i < PDM_PIN_WORDS; i++) {
+        bitslice_transpose(&pin_words[0][i], PDM_PIN_WORDS, &pdm_buffers[buffer][i * PIO_PINS], PIO_PINS);
+    }
+#endif
+
+    position = (position + PDM_PIN_WORDS) % PDM_FADE_WORDS;
+    pdm_level = samples[PDM_PIN_WORDS - 1];
+}
+
+/**
+ * Core 1: keep the buffer the DMA isn't playing filled
+ *
+ * @return void
+ */
+void pdm_core1_entry(void) {
+    // buffer 0 plays first
+    uint buffer = 0;
+    while (true) {
+        // wait for the DMA to leave this buffer
+        while (pdm_playing() == buffer) {
+            tight_loop_contents();
+        }
+
+        pdm_fill(buffer);
+        pdm_blocks++;
+
+        // the DMA came back to it while we were writing, that block glitched
+        if (pdm_playing() == buffer) {
+            pdm_late++;
+        }
+
+        buffer ^= 1;
+    }
+}
+
+/**
+ * Set up the data and control channels of the sigma-delta player and start core 1
+ *
+ * @param data_channel - channel feeding the PIO TX FIFO
+ *
+ * @return void
+ */
+void pdm_init(int data_channel) {
+    pdm_data_channel = data_channel;
+    int pdm_control_channel = dma_claim_unused_channel(true);
+
+    pdm_buffer_addrs[0] = (uint32_t) (uintptr_t) pdm_buffers[0];
+    pdm_buffer_addrs[1] = (uint32_t) (uintptr_t) pdm_buffers[1];
+
+    // data channel: one buffer into the PIO TX FIFO, then chain to the control channel
+    dma_channel_config data_config = dma_channel_get_default_config(data_channel);
+    channel_config_set_transfer_data_size(&data_config, DMA_SIZE_32);
+    channel_config_set_read_increment(&data_config, true);
+    channel_config_set_dreq(&data_config, DREQ_PIO0_TX0);
+    channel_config_set_chain_to(&data_config, pdm_control_channel);
+
+    dma_channel_configure(
+        data_channel, // channel
+        &data_config, // config
+        &pio0_hw->txf[0], // write address, PIO0 TX FIFO state machine 0
+        pdm_buffers[0], // set by the control channel
+        PDM_BLOCK, // reloaded at every trigger
+        false // started by the control channel
+    );
+
+    // control channel: the next buffer address into al3_read_addr_trig,
+    // the read address wraps around the 2 addresses
+    dma_channel_config control_config = dma_channel_get_default_config(pdm_control_channel);
+    channel_config_set_transfer_data_size(&control_config, DMA_SIZE_32);
+    channel_config_set_read_increment(&control_config, true);
+    channel_config_set_write_increment(&control_config, false);
+    channel_config_set_ring(&control_config, false, PDM_RING_BITS);
+
+    dma_channel_configure(
+        pdm_control_channel, // channel
+        &control_config, // config
+        &dma_hw->ch[data_channel].al3_read_addr_trig, // write address
+        pdm_buffer_addrs, // read address
+        1, // one address
+        false // started below
+    );
+
+    // both buffers before the DMA starts, core 1 takes over from there
+    for (uint pin = 0; pin < PIO_PINS; pin++) {
+        sigma_delta_init(&pdm_encoders[pin], PDM_ORDER);
+    }
+    pdm_fill(0);
+    pdm_fill(1);
+    multicore_launch_core1(pdm_core1_entry);
+
+    // play buffer 0, everything is automatic from here...
+    dma_channel_start(pdm_control_channel);
+}
+
+/**
+ * Get the blocks the data channel finished since boot
+ *
+ * From what the DMA did rather than from interrupts: core 1's refills
+ * (one per buffer the data channel left) in sigma-delta mode, the
+ * control channel's read address in sequencer mode. Reload mode has
+ * one interrupt per block. Call at least REPORT_SAMPLES times a second.
+ *
+ * @param uint *level - receives the fade or pwm level playing
+ * @return uint32_t
+ */
+static uint32_t dma_blocks(uint *level) {
+#if PDM_ORDER
+    *level = pdm_level;
+    return pdm_blocks;
+#elif DMA_SEQUENCER
+    return sequencer_blocks(level);
+#else
+    *level = 0;
+    return dma_irq_count;
+#endif
+}
+
+int main() {
+    // initialize stdio
+    board_init();
+
+    // before dma_handler() can log
+    trace_init();
 
     // add the pio program to the PIO instance and get the offset
-    uint offset = pio_add_program(pio0, &dma_pio_program);
+    uint offset = pio_add_program(pio0, PIO_PINS == 1 ? &dma_pio_program : &dma_pio_x8_program);
     // call the dma_pio_program_init function to initialize the PIO program
-    dma_pio_program_init(pio0, 0, offset, LED_PIN, PIO_CLK_DIV);
+    dma_pio_program_init(pio0, 0, offset, PIO_PIN_BASE, PIO_PINS, PIO_CLK_DIV);
 
     // claim an unused DMA channel
     dma_channel = dma_claim_unused_channel(true);
+
+#if PDM_ORDER || DMA_SEQUENCER
+    // no channel enables its interrupt, but the lines are live so
+    // anything raised by mistake would be counted
+    irq_set_exclusive_handler(DMA_IRQ_0, dma_idle_handler);
+    irq_set_exclusive_handler(DMA_IRQ_1, dma_idle_handler);
+    irq_set_enabled(DMA_IRQ_0, true);
+    irq_set_enabled(DMA_IRQ_1, true);
+#endif
+
+#if PDM_ORDER
+    // sigma-delta fade from core 1, no interrupts
+    pdm_init(dma_channel);
+#elif DMA_SEQUENCER
+    // chained control blocks, no interrupts
+    dma_sequencer_init(dma_channel);
+#else
     // get the default dma channel config
     dma_channel_config dma_config = dma_channel_get_default_config(dma_channel);
     // set the transfer data size to 32 bits
@@ -201,12 +602,42 @@ int main() {
     // enable the DMA channel interrupt
     irq_set_enabled(DMA_IRQ_0, true);
 
-    // call the handler manually to setup the
-    // wavetable and the initial dma read address
+    // call the handler manually to setup
+    // the initial dma read address
     dma_handler();
+#endif
+    board_mark("waveform");
 
+    // give the USB host time to open the port, then show the boot timeline
+    sleep_ms(2000);
+    board_report();
+
+    uint level = 0;
+    uint32_t last_irq_count = dma_irq_count;
+    uint32_t last_blocks = dma_blocks(&level);
     while (true) {
-        tight_loop_contents();
+        for (int i = 0; i < REPORT_SAMPLES; i++) {
+            sleep_ms(1000 / REPORT_SAMPLES);
+            dma_blocks(&level);
+        }
+
+        // the blocks move while the irq count stays 0, except in reload mode
+        uint32_t irq_count = dma_irq_count;
+        uint32_t blocks = dma_blocks(&level);
+#if PDM_ORDER
+        TRACE("dma irqs/s: %lu, blocks/s: %lu, late: %lu, level: %u", irq_count - last_irq_count,
+              blocks - last_blocks, pdm_late, level);
+#elif DMA_SEQUENCER
+        TRACE("dma irqs/s: %lu, blocks/s: %lu, pwm level: %u", irq_count - last_irq_count, blocks - last_blocks,
+              level);
+#else
+        TRACE("dma irqs/s: %lu, blocks/s: %lu", irq_count - last_irq_count, blocks - last_blocks);
+#endif
+        last_irq_count = irq_count;
+        last_blocks = blocks;
+
+        // send what the handler and this loop logged, see host/trace_decode
+        trace_flush(trace_stdio_write, NULL);
     }
 
     return 0;
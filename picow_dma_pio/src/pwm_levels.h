@@ -0,0 +1,30 @@
+/**
+ * @brief PWM level bit patterns of the picow_dma_pio example
+ *
+ * Kept apart from main.c so host/wavetable_check can expand the same
+ * WAVETABLE_LEVEL() into a table and compare it against the loop
+ * dma_handler() used to run on its first call.
+ */
+
+#pragma once
+
+// generated at compile time
+//
+// this part is really clever, for us to be able to
+// generate a gradual fade effect with PIO and DMA we
+// need to generate a bit pattern that graudually increases
+// the number of bits set to 1 starting from the lowest bit
+// 
+// ex: (note that DMA transfers 32-bits at a time)
+// 
+// 00000000000000000000000000000000 = 0 (off for 31 cycles)
+// 00000000000000000000000000000001 = 1 (on for 1 cycle)
+// 00000000000000000000000000000011 = 3 (on for 2 cycles)
+// 00000000000000000000000000000111 = 7
+// ....
+// 00000000000000011111111111111111 = 65535 (50% duty cycle, on for half of the cycles)
+// ....
+// 01111111111111111111111111111111 = 2147483647 (100% duty cycle, on for all cycles)
+#define WAVETABLE_LEVEL(i) (~(~0u << (i)))
+
+_Static_assert(WAVETABLE_LEVEL(0) == 0 && WAVETABLE_LEVEL(16) == 65535 && WAVETABLE_LEVEL(31) == 0x7fffffffu, "wavetable shape");
@@ -0,0 +1,16 @@
+/**
+ * @brief Fade cycle of the picow_dma_pwm example
+ *
+ * Kept apart from main.c so host/wavetable_check can expand the same
+ * FADE() into a table and compare it against the loop it replaced.
+ */
+
+#pragma once
+
+// quadratic fade level, making sure it does not exceed 65535
+#define FADE_LEVEL(i) ((i) * (i) > 65535 ? 65535 : (i) * (i))
+// first half (0..256) increases, second half decreases back
+// down and the last element is 0 so the fade loops cleanly
+#define FADE(i) ((i) == 511 ? 0 : (i) <= 256 ? FADE_LEVEL(i) : FADE_LEVEL(512 - (i)))
+
+_Static_assert(FADE(256) == 65535 && FADE(257) == 65025 && FADE(510) == 4, "fade shape");
@@ -0,0 +1,73 @@
+/**
+ * @brief HD44780 bus timing and command execution times
+ *
+ * Pure C so the host tools can check the PIO transport against
+ * the same numbers the firmware uses.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// write cycle timing in ns, HD44780U datasheet, VCC = 2.7 to 4.5 V
+#define HD44780_T_CYCE_NS 1000  // enable cycle time (E rise to E rise)
+#define HD44780_PW_EH_NS 450    // enable pulse width, high level
+#define HD44780_T_AS_NS 60      // address (RS) set-up time before E rises
+#define HD44780_T_AH_NS 20      // address (RS) hold time after E falls
+#define HD44780_T_DSW_NS 195    // data set-up time before E falls
+#define HD44780_T_H_NS 10       // data hold time after E falls
+
+// command execution times in us at the typical fosc of 270 kHz
+#define HD44780_EXEC_TYP_US 37
+// clear display (0x01) and return home (0x02, 0x03)
+#define HD44780_EXEC_LONG_TYP_US 1520
+
+// the execution times scale with 1 / fosc, and the internal oscillator
+// of the 3 V parts runs as slow as 190 kHz, so budget for that one
+#define HD44780_FOSC_TYP_KHZ 270
+#define HD44780_FOSC_MIN_KHZ 190
+#define HD44780_AT_FOSC_MIN(us) (((us) * HD44780_FOSC_TYP_KHZ + HD44780_FOSC_MIN_KHZ - 1) / HD44780_FOSC_MIN_KHZ)
+// 53 us
+#define HD44780_EXEC_US HD44780_AT_FOSC_MIN(HD44780_EXEC_TYP_US)
+// 2160 us
+#define HD44780_EXEC_LONG_US HD44780_AT_FOSC_MIN(HD44780_EXEC_LONG_TYP_US)
+
+/**
+ * Get the execution time of a command or data write
+ *
+ * @param bool rs - true for data, false for a command
+ * @param uint8_t byte
+ * @return uint32_t - time in us before the display accepts the next byte
+ */
+static inline uint32_t hd44780_exec_us(bool rs, uint8_t byte) {
+    return (!rs && byte >= 0x01 && byte <= 0x03) ? HD44780_EXEC_LONG_US : HD44780_EXEC_US;
+}
+
+/**
+ * Get the execution time of a command or data write at the typical fosc
+ *
+ * @param bool rs - true for data, false for a command
+ * @param uint8_t byte
+ * @return uint32_t - time in us a display with a 270 kHz oscillator needs
+ */
+static inline uint32_t hd44780_exec_typ_us(bool rs, uint8_t byte) {
+    return (!rs && byte >= 0x01 && byte <= 0x03) ? HD44780_EXEC_LONG_TYP_US : HD44780_EXEC_TYP_US;
+}
+
+/**
+ * Encode one byte for the lcd_pio program (see lcd_pio.pio)
+ *
+ * Out pins are RS, E, D4, D5, D6, D7, E is kept low here and
+ * pulsed with side-set by the program.
+ *
+ * @param bool rs - true for data, false for a command
+ * @param uint8_t byte
+ * @param uint32_t delay - extra state machine cycles after the byte, 20 bits
+ * @return uint32_t - TX FIFO word
+ */
+static inline uint32_t hd44780_pio_word(bool rs, uint8_t byte, uint32_t delay) {
+    uint32_t high = (rs ? 1u : 0u) | ((uint32_t) (byte >> 4) << 2);
+    uint32_t low = (rs ? 1u : 0u) | ((uint32_t) (byte & 0x0f) << 2);
+    return high | (low << 6) | ((delay & 0xfffffu) << 12);
+}
@@ -0,0 +1,168 @@
+#include "lcd.h"
+#include "lcd_pio.h"
+#include "hd44780.h"
+
+// number of bytes (commands and data) sent to the display
+static uint32_t bus_writes = 0;
+
+/**
+ * Initialize the LCD display
+ * 
+ * @return void
+ */
+void lcd_init() {
+    // Initialize GPIO pins
+    gpio_init(RS);
+    gpio_init(E);
+    gpio_init(D4);
+    gpio_init(D5);
+    gpio_init(D6);
+    gpio_init(D7);
+
+    // Set GPIO pins as output
+    gpio_set_dir(RS, GPIO_OUT);
+    gpio_set_dir(E, GPIO_OUT);
+    gpio_set_dir(D4, GPIO_OUT);
+    gpio_set_dir(D5, GPIO_OUT);
+    gpio_set_dir(D6, GPIO_OUT);
+    gpio_set_dir(D7, GPIO_OUT);
+
+    // Initialization sequence
+    sleep_ms(15); // Wait for power on
+    lcd_send_command(0x03);  // Set to 8-bit mode
+    sleep_ms(5);
+    lcd_send_command(0x03);
+    sleep_ms(1);
+    lcd_send_command(0x03);
+
+    lcd_send_command(0x02);  // Switch to 4-bit mode
+
+    // Configure LCD function
+    lcd_send_command(0x28);  // 4-bit mode, 2 lines, 5x8 font
+    lcd_send_command(0x0C);  // Display on, cursor off, blink off
+    lcd_send_command(0x06);  // Increment cursor
+    lcd_clear();  // Clear display
+}
+
+/**
+ * Send a command to the LCD display
+ * 
+ * Queued without blocking once lcd_pio_init() took over the bus.
+ * 
+ * @param uint8_t command
+ * @return void
+ */
+void lcd_send_command(uint8_t command) {
+    if (lcd_pio_enabled()) {
+        bus_writes++;
+        lcd_pio_write(false, command);
+        return;
+    }
+
+    gpio_put(RS, 0);  // Command mode
+    lcd_send_data(command);
+}
+
+/**
+ * Write one character at the cursor
+ * 
+ * @param char c
+ * @return void
+ */
+void lcd_write_char(char c) {
+    if (lcd_pio_enabled()) {
+        bus_writes++;
+        lcd_pio_write(true, c);
+        return;
+    }
+
+    gpio_put(RS, 1);  // Data mode
+    lcd_send_data(c);
+}
+
+/**
+ * Send data to the LCD display over GPIO, RS must already be set
+ * 
+ * @param uint8_t data
+ * @return void
+ */
+void lcd_send_data(uint8_t data) {
+    bus_writes++;
+
+    gpio_put(D4, (data >> 4) & 0x01);
+    gpio_put(D5, (data >> 4) & 0x02);
+    gpio_put(D6, (data >> 4) & 0x04);
+    gpio_put(D7, (data >> 4) & 0x08);
+    pulse_enable();
+
+    gpio_put(D4, data & 0x01);
+    gpio_put(D5, data & 0x02);
+    gpio_put(D6, data & 0x04);
+    gpio_put(D7, data & 0x08);
+    pulse_enable();
+}
+
+/**
+ * Clear the LCD display
+ * 
+ * @return void
+ */
+void lcd_clear() {
+    lcd_send_command(0x01);
+
+    // the PIO transport holds the bus for the execution time itself
+    if (!lcd_pio_enabled()) {
+        sleep_us(HD44780_EXEC_LONG_US);
+    }
+}
+
+/**
+ * Set the cursor position
+ * 
+ * Rows 2 and 3 are only there on 20x4 displays, they
+ * continue rows 0 and 1 in the display memory.
+ * 
+ * @param uint8_t row
+ * @param uint8_t col
+ * @return void
+ */
+void lcd_set_cursor(uint8_t row, uint8_t col) {
+    static const uint8_t row_address[] = {0x00, 0x40, 0x14, 0x54};
+    uint8_t address = row_address[row & 0x03] + col;
+    lcd_send_command(0x80 | address);
+}
+
+/**
+ * Print a string to the LCD display
+ * 
+ * @param const char *str
+ * @return void
+ */
+void lcd_print(const char *str) {
+    while (*str) {
+        lcd_write_char(*str++);
+    }
+}
+
+/**
+ * Pulse the enable pin
+ * 
+ * @return void
+ */
+void pulse_enable() {
+    gpio_put(E, 1);
+    sleep_us(1);
+    gpio_put(E, 0);
+    sleep_us(100);
+}
+
+/**
+ * Get the number of bytes sent over the bus since boot
+ * 
+ * Each byte is two nibbles, i.e. two pulse_enable() calls.
+ * 
+ * @return uint32_t
+ */
+uint32_t lcd_get_bus_writes() {
+    return bus_writes;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "pico/stdlib.h"
+
+#define RS 10
+#define E 11
+#define D4 12
+#define D5 13
+#define D6 14
+#define D7 15
+
+void lcd_init();
+void lcd_send_command(uint8_t command);
+void lcd_send_data(uint8_t data);
+void lcd_write_char(char c);
+void lcd_clear();
+void lcd_set_cursor(uint8_t row, uint8_t col);
+void lcd_print(const char *str);
+void pulse_enable();
+uint32_t lcd_get_bus_writes();
@@ -0,0 +1,106 @@
+#include <string.h>
+#include "lcd.h"
+#include "lcd_fb.h"
+
+// display memory address of the first column of each row
+static const uint8_t row_address[LCD_FB_MAX_ROWS] = {0x00, 0x40, 0x14, 0x54};
+
+/**
+ * Get the address the display moves to after a data write
+ *
+ * In 2-line mode the display memory is 0x00-0x27 and 0x40-0x67,
+ * the address counter jumps from the end of one to the start of
+ * the other. On 20x4 displays this is why writing past the end of
+ * row 0 continues on row 2.
+ *
+ * @param int16_t address
+ * @return int16_t
+ */
+static int16_t next_address(int16_t address) {
+    if (address == 0x27) return 0x40;
+    if (address == 0x67) return 0x00;
+    return address + 1;
+}
+
+/**
+ * Initialize the framebuffer
+ *
+ * Call right after lcd_init(), which leaves the display cleared,
+ * so the shadow starts out as all spaces.
+ *
+ * @param lcd_fb_t *fb
+ * @param uint8_t rows - 2 or 4
+ * @param uint8_t cols - 16 or 20
+ * @return void
+ */
+void lcd_fb_init(lcd_fb_t *fb, uint8_t rows, uint8_t cols) {
+    fb->rows = rows > LCD_FB_MAX_ROWS ? LCD_FB_MAX_ROWS : rows;
+    fb->cols = cols > LCD_FB_MAX_COLS ? LCD_FB_MAX_COLS : cols;
+    memset(fb->frame, ' ', sizeof(fb->frame));
+    memset(fb->shadow, ' ', sizeof(fb->shadow));
+    // clear also homes the cursor
+    fb->address = 0;
+}
+
+/**
+ * Fill the frame with spaces, nothing is sent until lcd_fb_flush()
+ *
+ * @param lcd_fb_t *fb
+ * @return void
+ */
+void lcd_fb_clear(lcd_fb_t *fb) {
+    memset(fb->frame, ' ', sizeof(fb->frame));
+}
+
+/**
+ * Write a string into the frame, clipped at the end of the row
+ *
+ * @param lcd_fb_t *fb
+ * @param uint8_t row
+ * @param uint8_t col
+ * @param const char *str
+ * @return void
+ */
+void lcd_fb_print(lcd_fb_t *fb, uint8_t row, uint8_t col, const char *str) {
+    if (row >= fb->rows) return;
+
+    while (*str && col < fb->cols) {
+        fb->frame[row][col++] = *str++;
+    }
+}
+
+/**
+ * Send the cells that changed since the last flush
+ *
+ * Rewrites nothing that is already on the display and never
+ * clears it, so a single changed digit costs one data byte
+ * plus at most one cursor move.
+ *
+ * @param lcd_fb_t *fb
+ * @return uint - number of bytes sent over the bus
+ */
+uint lcd_fb_flush(lcd_fb_t *fb) {
+    uint writes = 0;
+
+    for (uint8_t row = 0; row < fb->rows; row++) {
+        for (uint8_t col = 0; col < fb->cols; col++) {
+            char c = fb->frame[row][col];
+            if (c == fb->shadow[row][col]) continue;
+
+            // only move the cursor if auto-increment didn't take us here
+            int16_t address = row_address[row] + col;
+            if (fb->address != address) {
+                lcd_set_cursor(row, col);
+                writes++;
+            }
+
+            lcd_write_char(c);
+            writes++;
+
+            fb->shadow[row][col] = c;
+            fb->address = next_address(address);
+        }
+    }
+
+    return writes;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "pico/stdlib.h"
+
+// largest supported layout, 20x4
+#define LCD_FB_MAX_ROWS 4
+#define LCD_FB_MAX_COLS 20
+
+/**
+ * Shadow framebuffer for the HD44780
+ *
+ * `frame` is what we want on the display, `shadow` is what the
+ * display currently shows. lcd_fb_flush() only sends the cells
+ * that differ, and only moves the cursor when the display's own
+ * auto-increment doesn't already put it in the right place.
+ */
+typedef struct {
+    uint8_t rows;
+    uint8_t cols;
+    char frame[LCD_FB_MAX_ROWS][LCD_FB_MAX_COLS];
+    char shadow[LCD_FB_MAX_ROWS][LCD_FB_MAX_COLS];
+    // display memory address the next data byte goes to, -1 if unknown
+    int16_t address;
+} lcd_fb_t;
+
+void lcd_fb_init(lcd_fb_t *fb, uint8_t rows, uint8_t cols);
+void lcd_fb_clear(lcd_fb_t *fb);
+void lcd_fb_print(lcd_fb_t *fb, uint8_t row, uint8_t col, const char *str);
+uint lcd_fb_flush(lcd_fb_t *fb);
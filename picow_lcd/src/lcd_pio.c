@@ -0,0 +1,179 @@
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hd44780.h"
+#include "lcd.h"
+#include "lcd_pio.h"
+#include "lcd_pio.pio.h"
+
+// the DMA ring needs a buffer aligned to its size
+static uint32_t queue[LCD_PIO_QUEUE_SIZE] __attribute__((aligned(1u << LCD_PIO_QUEUE_BITS)));
+
+// words written by the CPU, and words handed to the DMA so far
+static volatile uint32_t queue_head = 0;
+static volatile uint32_t queue_committed = 0;
+
+static PIO lcd_pio;
+static uint lcd_sm;
+static uint lcd_offset;
+static int dma_chan = -1;
+
+/**
+ * Hand everything queued since the last kick to the DMA
+ *
+ * Only starts a new transfer when the channel is idle, the
+ * completion interrupt calls this again for whatever was
+ * queued in the meantime.
+ *
+ * @return void
+ */
+static void queue_kick() {
+    uint32_t status = save_and_disable_interrupts();
+
+    if (!dma_channel_is_busy(dma_chan) && queue_head != queue_committed) {
+        uint32_t count = queue_head - queue_committed;
+        queue_committed = queue_head;
+        // the read address carries on from where the ring left it
+        dma_channel_set_trans_count(dma_chan, count, true);
+    }
+
+    restore_interrupts(status);
+}
+
+/**
+ * DMA completion interrupt, re-arms the channel if more bytes are queued
+ *
+ * @return void
+ */
+static void dma_handler() {
+    if (!dma_channel_get_irq1_status(dma_chan)) return;
+
+    dma_channel_acknowledge_irq1(dma_chan);
+    queue_kick();
+}
+
+/**
+ * Get the number of queued words the DMA hasn't read yet
+ *
+ * @return uint32_t
+ */
+static uint32_t queue_pending() {
+    uint32_t remaining = dma_channel_hw_addr(dma_chan)->transfer_count;
+    return queue_head - (queue_committed - remaining);
+}
+
+/**
+ * Hand the display pins over to the PIO transport
+ *
+ * Call after lcd_init(), the power-on sequence has long
+ * waits and single nibble writes so it stays on GPIO.
+ *
+ * @param PIO pio - pio0 or pio1
+ * @return bool - false if there's no free state machine or program space
+ */
+bool lcd_pio_init(PIO pio) {
+    if (!pio_can_add_program(pio, &lcd_pio_program)) return false;
+
+    int sm = pio_claim_unused_sm(pio, false);
+    if (sm < 0) return false;
+
+    uint offset = pio_add_program(pio, &lcd_pio_program);
+    pio_sm_config config = lcd_pio_program_get_default_config(offset);
+
+    lcd_pio = pio;
+    lcd_sm = sm;
+    lcd_offset = offset;
+
+    // RS, E, D4-D7 are consecutive pins starting at RS
+    sm_config_set_out_pins(&config, RS, 6);
+    sm_config_set_sideset_pins(&config, E);
+    // nibbles go out lsb first, no autopull, the program pulls one word per byte
+    sm_config_set_out_shift(&config, true, false, 32);
+    sm_config_set_fifo_join(&config, PIO_FIFO_JOIN_TX);
+    sm_config_set_clkdiv(&config, (float) clock_get_hz(clk_sys) / LCD_PIO_FREQ);
+
+    // take over the pins, E starts low
+    pio_sm_set_pins_with_mask(pio, sm, 0, 0x3fu << RS);
+    pio_sm_set_consecutive_pindirs(pio, sm, RS, 6, true);
+    for (uint pin = RS; pin <= D7; pin++) {
+        pio_gpio_init(pio, pin);
+    }
+
+    pio_sm_init(pio, sm, offset, &config);
+    pio_sm_set_enabled(pio, sm, true);
+
+    // queue -> TX FIFO, paced by the FIFO, started by queue_kick()
+    dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config dma_config = dma_channel_get_default_config(dma_chan);
+    channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_32);
+    channel_config_set_read_increment(&dma_config, true);
+    channel_config_set_write_increment(&dma_config, false);
+    channel_config_set_ring(&dma_config, false, LCD_PIO_QUEUE_BITS);
+    channel_config_set_dreq(&dma_config, pio_get_dreq(pio, sm, true));
+
+    dma_channel_configure(
+        dma_chan, // channel
+        &dma_config, // config
+        &pio->txf[sm], // write address
+        queue, // read address
+        0, // set by queue_kick()
+        false // don't start yet
+    );
+
+    // DMA_IRQ_0 is the usual choice in the other examples, stay out of its way
+    dma_channel_set_irq1_enabled(dma_chan, true);
+    irq_add_shared_handler(DMA_IRQ_1, dma_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_1, true);
+
+    return true;
+}
+
+/**
+ * Check if the PIO transport is in use
+ *
+ * @return bool
+ */
+bool lcd_pio_enabled() {
+    return dma_chan >= 0;
+}
+
+/**
+ * Queue one byte, returns as soon as it's in the queue
+ *
+ * The execution time of the byte is encoded in the FIFO word, so
+ * clear and home need no sleep_ms() on the caller's side. Only
+ * blocks if the queue is full.
+ *
+ * @param bool rs - true for data, false for a command
+ * @param uint8_t byte
+ * @return void
+ */
+void lcd_pio_write(bool rs, uint8_t byte) {
+    uint32_t cycles = hd44780_exec_us(rs, byte) * (LCD_PIO_FREQ / 1000000);
+    uint32_t delay = cycles > lcd_pio_delay_overhead ? cycles - lcd_pio_delay_overhead : 0;
+
+    // wait for room, the DMA keeps draining in the background
+    while (queue_pending() >= LCD_PIO_QUEUE_SIZE) {
+        tight_loop_contents();
+    }
+
+    queue[queue_head % LCD_PIO_QUEUE_SIZE] = hd44780_pio_word(rs, byte, delay);
+    queue_head++;
+
+    queue_kick();
+}
+
+/**
+ * Check if there are bytes still going out on the bus
+ *
+ * @return bool
+ */
+bool lcd_pio_busy() {
+    if (queue_pending()) return true;
+
+    // the last word may still be in the FIFO or being clocked out,
+    // the state machine is done once it waits on the pull again
+    return !pio_sm_is_tx_fifo_empty(lcd_pio, lcd_sm)
+        || pio_sm_get_pc(lcd_pio, lcd_sm) != lcd_offset + lcd_pio_wrap_target;
+}
@@ -0,0 +1,26 @@
+/**
+ * @brief Non-blocking HD44780 transport, PIO + DMA
+ *
+ * The PIO program (lcd_pio.pio) clocks each byte out as two nibbles
+ * and holds the bus for the command execution time, so the CPU never
+ * sleeps on the display. Bytes are queued as FIFO words into a DMA
+ * ring, the DMA channel feeds them to the state machine and re-arms
+ * itself from its completion interrupt while there's more to send.
+ */
+
+#pragma once
+
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+
+// queue of FIFO words, one per byte, read by the DMA through a ring
+#define LCD_PIO_QUEUE_BITS 10
+#define LCD_PIO_QUEUE_SIZE ((1u << LCD_PIO_QUEUE_BITS) / sizeof(uint32_t))
+
+// state machine clock, 1 instruction per us
+#define LCD_PIO_FREQ 1000000
+
+bool lcd_pio_init(PIO pio);
+bool lcd_pio_enabled();
+void lcd_pio_write(bool rs, uint8_t byte);
+bool lcd_pio_busy();
@@ -0,0 +1,53 @@
+// -------------------------------------------------- //
+// This file is autogenerated by pioasm; do not edit! //
+// -------------------------------------------------- //
+
+#pragma once
+
+#if !PICO_NO_HARDWARE
+#include "hardware/pio.h"
+#endif
+
+// ------- //
+// lcd_pio //
+// ------- //
+
+#define lcd_pio_wrap_target 0
+#define lcd_pio_wrap 8
+#define lcd_pio_pio_version 0
+
+#define lcd_pio_delay_overhead 5
+
+static const uint16_t lcd_pio_program_instructions[] = {
+            //     .wrap_target
+    0x90a0, //  0: pull   block            side 0    
+    0x6006, //  1: out    pins, 6                    
+    0xb842, //  2: nop                     side 1    
+    0xb042, //  3: nop                     side 0    
+    0x6006, //  4: out    pins, 6                    
+    0xb842, //  5: nop                     side 1    
+    0xb042, //  6: nop                     side 0    
+    0x6034, //  7: out    x, 20                      
+    0x0048, //  8: jmp    x--, 8                     
+            //     .wrap
+};
+
+#if !PICO_NO_HARDWARE
+static const struct pio_program lcd_pio_program = {
+    .instructions = lcd_pio_program_instructions,
+    .length = 9,
+    .origin = -1,
+    .pio_version = 0,
+#if PICO_PIO_VERSION > 0
+    .used_gpio_ranges = 0x0
+#endif
+};
+
+static inline pio_sm_config lcd_pio_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + lcd_pio_wrap_target, offset + lcd_pio_wrap);
+    sm_config_set_sideset(&c, 2, true, false);
+    return c;
+}
+#endif
+
@@ -1,31 +1,242 @@
 #include "pico/stdlib.h"
-#include "pico/cyw43_arch.h"
 #include "pico/multicore.h"
+#include "hardware/structs/systick.h"
+#include "board.h"
+#include "spsc.h"
+#include "trace.h"
 
+// messages per throughput run
+#define BENCH_MESSAGES 100000
+// elements per push/pop in the batched run
+#define BENCH_BATCH 16
+// round trips per latency run
+#define BENCH_ROUNDS 10000
+// ring capacity in words
+#define RING_CAPACITY 256
+
+// core 0 -> core 1 and core 1 -> core 0
+SPSC_BUFFER(ping_buffer, uint32_t, RING_CAPACITY);
+SPSC_BUFFER(pong_buffer, uint32_t, RING_CAPACITY);
+spsc_t ping_ring;
+spsc_t pong_ring;
+
+/**
+ * Core 1: push 0 .. BENCH_MESSAGES - 1 through the SIO FIFO
+ *
+ * @return void
+ */
+void fifo_producer() {
+    for (uint32_t i = 0; i < BENCH_MESSAGES; i++) {
+        multicore_fifo_push_blocking(i);
+    }
+}
+
+/**
+ * Core 1: push 0 .. BENCH_MESSAGES - 1 through the ring, one at a time
+ *
+ * @return void
+ */
+void spsc_producer() {
+    for (uint32_t i = 0; i < BENCH_MESSAGES; i++) {
+        while (!spsc_push(&pong_ring, &i)) {
+        }
+    }
+}
+
+/**
+ * Core 1: push 0 .. BENCH_MESSAGES - 1 through the ring, BENCH_BATCH at a time
+ *
+ * @return void
+ */
+void spsc_batch_producer() {
+    uint32_t batch[BENCH_BATCH];
+
+    for (uint32_t i = 0; i < BENCH_MESSAGES; i += BENCH_BATCH) {
+        for (uint32_t j = 0; j < BENCH_BATCH; j++) {
+            batch[j] = i + j;
+        }
+
+        uint32_t done = 0;
+        while (done < BENCH_BATCH) {
+            done += spsc_push_batch(&pong_ring, batch + done, BENCH_BATCH - done);
+        }
+    }
+}
+
+/**
+ * Core 1: send every word from the SIO FIFO straight back
+ *
+ * @return void
+ */
+void fifo_echo() {
+    for (uint32_t i = 0; i < BENCH_ROUNDS; i++) {
+        multicore_fifo_push_blocking(multicore_fifo_pop_blocking());
+    }
+}
+
+/**
+ * Core 1: send every word from the ping ring back on the pong ring
+ *
+ * @return void
+ */
+void spsc_echo() {
+    uint32_t value;
+
+    for (uint32_t i = 0; i < BENCH_ROUNDS; i++) {
+        while (!spsc_pop(&ping_ring, &value)) {
+        }
+        while (!spsc_push(&pong_ring, &value)) {
+        }
+    }
+}
+
+/**
+ * Start a fresh core 1 on entry with empty rings
+ *
+ * @param entry - core 1 function
+ *
+ * @return void
+ */
+void relaunch_core1(void (*entry)(void)) {
+    multicore_reset_core1();
+    spsc_init(&ping_ring, ping_buffer, RING_CAPACITY, sizeof(uint32_t));
+    spsc_init(&pong_ring, pong_buffer, RING_CAPACITY, sizeof(uint32_t));
+    // the launch handshake leaves the FIFO empty, draining after it
+    // would throw away what the new core 1 already pushed
+    multicore_launch_core1(entry);
+}
+
+/**
+ * Receive BENCH_MESSAGES from core 1 and print the rate
+ *
+ * @param name - printed with the result
+ * @param entry - core 1 producer
+ * @param use_fifo - receive from the SIO FIFO instead of the ring
+ * @param batch - elements per pop from the ring
+ *
+ * @return void
+ */
+void bench_throughput(const char *name, void (*entry)(void), bool use_fifo, uint32_t batch) {
+    uint32_t values[BENCH_BATCH];
+    uint32_t expected = 0;
+    uint32_t errors = 0;
+
+    relaunch_core1(entry);
+    uint64_t start = time_us_64();
+
+    while (expected < BENCH_MESSAGES) {
+        uint32_t count;
+
+        if (use_fifo) {
+            values[0] = multicore_fifo_pop_blocking();
+            count = 1;
+        } else {
+            count = spsc_pop_batch(&pong_ring, values, batch);
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            if (values[i] != expected++) errors++;
+        }
+    }
+
+    uint64_t elapsed = time_us_64() - start;
+    printf("%-12s %7llu messages/s (%u messages in %llu us, %lu errors)\n",
+           name, (uint64_t) BENCH_MESSAGES * 1000000 / elapsed, BENCH_MESSAGES, elapsed, errors);
+}
+
+/**
+ * Bounce one word off core 1 BENCH_ROUNDS times and print the round trip
+ *
+ * SysTick counts down at the CPU clock, 24 bits is plenty for one round.
+ *
+ * @param name - printed with the result
+ * @param entry - core 1 echo
+ * @param use_fifo - bounce through the SIO FIFO instead of the rings
+ *
+ * @return void
+ */
+void bench_latency(const char *name, void (*entry)(void), bool use_fifo) {
+    uint32_t min = UINT32_MAX;
+    uint64_t total = 0;
+
+    relaunch_core1(entry);
+
+    for (uint32_t i = 0; i < BENCH_ROUNDS; i++) {
+        uint32_t value = i;
+        uint32_t start = systick_hw->cvr;
+
+        if (use_fifo) {
+            multicore_fifo_push_blocking(value);
+            value = multicore_fifo_pop_blocking();
+        } else {
+            while (!spsc_push(&ping_ring, &value)) {
+            }
+            while (!spsc_pop(&pong_ring, &value)) {
+            }
+        }
+
+        uint32_t cycles = (start - systick_hw->cvr) & 0xffffff;
+        if (cycles < min) min = cycles;
+        total += cycles;
+    }
+
+    printf("%-12s round trip min %lu cycles, avg %llu cycles\n", name, min, total / BENCH_ROUNDS);
+}
+
+/**
+ * Core 1: say hello through the trace log, core 0 sends it out
+ *
+ * @return void
+ */
 void core1_main() {
+    uint32_t count = 0;
+
     while(true) {
-        printf("Hello from Core 1\n");
+        TRACE("Hello from Core 1 (%lu)", count++);
         sleep_ms(1000);
     }
 }
 
 int main() {
     // initialize the standard io
-    stdio_init_all();
+    board_init();
 
-    // initialize Wi-Fi
-    if (cyw43_arch_init()) {
-        printf("Wi-Fi init failed");
-        return -1;
+    // give the USB host time to open the port
+    sleep_ms(2000);
+
+    // free-running SysTick at the CPU clock for the latency runs
+    systick_hw->rvr = 0xffffff;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5;
+
+    printf("SIO FIFO vs spsc ring, %u messages, %u round trips\n", BENCH_MESSAGES, BENCH_ROUNDS);
+    bench_throughput("fifo", fifo_producer, true, 1);
+    bench_throughput("spsc", spsc_producer, false, 1);
+    bench_throughput("spsc x16", spsc_batch_producer, false, BENCH_BATCH);
+    bench_latency("fifo", fifo_echo, true);
+    bench_latency("spsc", spsc_echo, false);
+
+    // cost of one TRACE() call, the ring holds more than we log here
+    trace_init();
+    uint32_t start = systick_hw->cvr;
+    for (uint32_t i = 0; i < 100; i++) {
+        TRACE("cost %lu", i);
     }
+    printf("TRACE() %lu cycles per call\n", ((start - systick_hw->cvr) & 0xffffff) / 100);
+
+    // both cores log from here on, decode with host/trace_decode
+    trace_init();
 
     // launch core 1
-    multicore_launch_core1(core1_main);
+    relaunch_core1(core1_main);
 
+    uint32_t count = 0;
     while(true) {
-        printf("Hello from Core 0\n");
+        TRACE("Hello from Core 0 (%lu)", count++);
+        // neither core formats or waits on USB stdio
+        trace_flush(trace_stdio_write, NULL);
         sleep_ms(1000);
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1 +1 @@
-$PICO_SDK_PATH/tools/pioasm/build/pioasm -o c-sdk src/program.pio src/program.pio.h
\ No newline at end of file
+$PICO_SDK_PATH/tools/pioasm/build/pioasm -o c-sdk ../lib/clock_gen/clock_gen.pio ../lib/clock_gen/clock_gen.pio.h
\ No newline at end of file
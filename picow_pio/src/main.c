@@ -1,57 +1,63 @@
+#include <stdio.h>
 #include "pico/stdlib.h"
-#include "pico/cyw43_arch.h"
+#include "hardware/clocks.h"
 #include "hardware/pio.h"
-#include "program.pio.h"
+#include "board.h"
+#include "clock_gen.h"
 
 #define LED_PIN 16
 #define LED2_PIN 17
 
+// fast enough that the LED looks dimmed instead of blinking. a period of
+// 62500 cycles fits the 16-bit counts at every duty cycle, so clock_solve()
+// keeps the divider at 1 and every count is 8 ns at 125 MHz
+#define SQUARE_FREQUENCY 2000
+// duty cycle step of the breathing fade
+#define SQUARE_STEP_MS 20
+
 int main() {
     // initialize stdio
-    stdio_init_all();
-
-    // initialize Wi-Fi
-    if (cyw43_arch_init()) {
-        printf("Wi-Fi init failed");
-        return -1;
-    }
-
-    sleep_ms(2000);
-    // light up onboard LED
-    cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
+    board_init();
+    // load the cyw43 firmware on core 1, the PIO doesn't need it
+    board_cyw43_start();
 
     gpio_init(LED2_PIN);
     gpio_set_dir(LED2_PIN, GPIO_IN);
 
-    // use pio 0 (there are two pio blocks on the RP2040)
-    PIO pio = pio0;
-    // claim unused state machine
-    uint sm = pio_claim_unused_sm(pio, true);
-
-    // add program and get the program offset
-    uint offset = pio_add_program(pio, &program_program);
-    // get default config (side set pins, clock divider, etc.)
-    pio_sm_config config = program_program_get_default_config(offset);
+    // claim a state machine on pio 0, load the program and start at 50%
+    clock_gen_init(pio0, LED_PIN, SQUARE_FREQUENCY, 50);
+    board_mark("waveform");
 
-    // initialize pio to the gpio
-    pio_gpio_init(pio, LED_PIN);
+    // light up onboard LED, waits for core 1 if it isn't done yet
+    board_led_put(1);
+    board_mark("led");
 
-    // map the state machines `SET pin` group to one pin
-    sm_config_set_set_pins(&config, LED_PIN, 1);
-    // set the pin direction to output from LED_PIN to pin_count
-    pio_sm_set_consecutive_pindirs(pio, sm, LED_PIN, 1, true);
-
-    // set the state machine clock rate
-    sm_config_set_clkdiv(&config, 62500);
+    // give the USB host time to open the port, then show the boot timeline
+    sleep_ms(2000);
+    board_report();
 
-    // load the program and jump to the start of the program
-    pio_sm_init(pio, sm, offset, &config);
-    // set the state machine to enabled
-    pio_sm_set_enabled(pio, sm, true);
+    // 1, 2 and 4 times the base frequency, one breath each
+    uint multiplier = 1;
+    uint duty_cycle = 50;
+    int step = 1;
 
     while (true) {
-        tight_loop_contents();
+        // the state machine keeps running, the new setting starts on the next rising edge
+        clock_gen_set(SQUARE_FREQUENCY * multiplier, duty_cycle, NULL);
+        sleep_ms(SQUARE_STEP_MS);
+
+        if (duty_cycle == 99) step = -1;
+        if (duty_cycle == 1) {
+            step = 1;
+            multiplier = multiplier == 4 ? 1 : multiplier * 2;
+
+            clock_timing_t timing;
+            clock_solve(clock_get_hz(clk_sys), SQUARE_FREQUENCY * multiplier, 50, &timing);
+            printf("square: %u Hz, period %lu SM cycles at clkdiv %u\n", SQUARE_FREQUENCY * multiplier,
+                   (unsigned long) (timing.high + timing.low), timing.clkdiv);
+        }
+        duty_cycle += step;
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,136 @@
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/bootrom.h"
+#include "pico/stdio_usb.h"
+#include "board.h"
+#include "proto.h"
+
+// pins the host may drive, the rest belong to the board
+#define GPIO_MAX 22
+
+// reboot once the response to PROTO_OP_BOOTSEL is out
+static bool bootsel_pending = false;
+// pins already set up by PROTO_OP_GPIO_PUT/GET
+static uint32_t gpio_ready = 0;
+
+// echo the data back
+static uint8_t op_ping(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    if (len > *reply_len) return PROTO_STATUS_NO_SPACE;
+
+    memcpy(reply, data, len);
+    *reply_len = len;
+    return PROTO_STATUS_OK;
+}
+
+// turn the LED on or off
+static uint8_t op_led(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    *reply_len = 0;
+    if (len != 1) return PROTO_STATUS_BAD_LENGTH;
+
+    board_led_put(data[0] ? 1 : 0);
+    return PROTO_STATUS_OK;
+}
+
+// set up a pin the first time it's used
+static void gpio_prepare(uint pin, bool out) {
+    if (!(gpio_ready & (1u << pin))) {
+        gpio_init(pin);
+        gpio_ready |= 1u << pin;
+    }
+    gpio_set_dir(pin, out);
+}
+
+// drive a pin
+static uint8_t op_gpio_put(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    *reply_len = 0;
+    if (len != 2) return PROTO_STATUS_BAD_LENGTH;
+    if (data[0] > GPIO_MAX) return PROTO_STATUS_BAD_ARGUMENT;
+
+    gpio_prepare(data[0], GPIO_OUT);
+    gpio_put(data[0], data[1] ? 1 : 0);
+    return PROTO_STATUS_OK;
+}
+
+// read a pin, pins the host didn't drive are read as inputs
+static uint8_t op_gpio_get(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    if (len != 1) return PROTO_STATUS_BAD_LENGTH;
+    if (data[0] > GPIO_MAX) return PROTO_STATUS_BAD_ARGUMENT;
+    if (*reply_len < 1) return PROTO_STATUS_NO_SPACE;
+
+    if (!(gpio_ready & (1u << data[0]))) {
+        gpio_prepare(data[0], GPIO_IN);
+    }
+    reply[0] = gpio_get(data[0]);
+    *reply_len = 1;
+    return PROTO_STATUS_OK;
+}
+
+// us since boot
+static uint8_t op_uptime(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    if (*reply_len < 8) return PROTO_STATUS_NO_SPACE;
+
+    uint64_t now = time_us_64();
+    for (uint i = 0; i < 8; i++) {
+        reply[i] = now >> (8 * i);
+    }
+    *reply_len = 8;
+    return PROTO_STATUS_OK;
+}
+
+// reboot to BOOTSEL mode
+static uint8_t op_bootsel(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    *reply_len = 0;
+    bootsel_pending = true;
+    return PROTO_STATUS_OK;
+}
+
+static const proto_handler_t handlers[PROTO_OP_COUNT] = {
+    [PROTO_OP_PING] = op_ping,
+    [PROTO_OP_LED] = op_led,
+    [PROTO_OP_GPIO_PUT] = op_gpio_put,
+    [PROTO_OP_GPIO_GET] = op_gpio_get,
+    [PROTO_OP_UPTIME] = op_uptime,
+    [PROTO_OP_BOOTSEL] = op_bootsel,
+};
+
+int main() {
+    // initialize stdio
+    board_init();
+
+    // frames are binary, a 0x0a must not turn into 0x0d 0x0a
+    stdio_set_translate_crlf(&stdio_usb, false);
+
+    static proto_rx_t rx;
+    static uint8_t frame[PROTO_ENCODED_MAX];
+    static uint8_t response[PROTO_ENCODED_MAX];
+
+    proto_rx_init(&rx);
+
+    while (true) {
+        int c;
+
+        // take everything that's there, never wait for more
+        while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT) {
+            size_t len = proto_rx_feed(&rx, c, frame);
+            if (!len) continue;
+
+            // corrupt frames get no response, the host times out and retries
+            size_t out = proto_handle(handlers, PROTO_OP_COUNT, frame, len, response, NULL);
+            if (out) {
+                fwrite(response, 1, out, stdout);
+                fflush(stdout);
+            }
+
+            if (bootsel_pending) {
+                // let the response reach the host first
+                sleep_ms(100);
+                reset_usb_boot(0, 0);
+            }
+        }
+
+        // the rest of the application runs here
+        tight_loop_contents();
+    }
+
+    return 0;
+}
@@ -10,20 +10,20 @@
  */
 
 #include "pico/stdlib.h"
-#include "pico/cyw43_arch.h"
+#include "hardware/clocks.h"
 #include "hardware/pwm.h"
+#include "board.h"
+#include "pwm_solver.h"
 
 #define LED_PIN 16
+// blink rate in mHz, the slowest a full 16-bit wrap reaches at 125 MHz is ~7.5 Hz
+#define BLINK_MHZ PWM_HZ(8)
+// ask for the full 16-bit counter so the duty cycle stays fine grained
+#define BLINK_LEVELS 65536
 
 int main() {
     // initialize stdio
-    stdio_init_all();
-
-    // initialize Wi-Fi
-    if (cyw43_arch_init()) {
-        printf("Wi-Fi init failed");
-        return -1;
-    }
+    board_init();
 
     // initialize led pin to use PWM
     gpio_set_function(LED_PIN, GPIO_FUNC_PWM);
@@ -33,14 +33,26 @@ int main() {
     // get channel number
     uint channel_num = pwm_gpio_to_channel(LED_PIN);
 
-    // set clock div to 256 this will give us 125 Mhz / 256 = 488.28 kHz
-    pwm_set_clkdiv(slice_num, 256);
-    // set wrap to 65535 this will give us 125 Mhz / 65535 / 256 = 7.63 Hz
-    pwm_set_wrap(slice_num, 65535);
+    // find the divider and wrap for the actual system clock
+    // instead of hand-picking them for 125 MHz
+    pwm_timing_t timing;
+    if (!pwm_solve(clock_get_hz(clk_sys), BLINK_MHZ, BLINK_LEVELS, &timing)) {
+        printf("can't reach %llu mHz\n", (unsigned long long) BLINK_MHZ);
+        return -1;
+    }
+
+    // set the 8.4 clock divider, e.g. 238 + 7/16 at 125 MHz
+    pwm_set_clkdiv_int_frac(slice_num, timing.div16 >> 4, timing.div16 & 15);
+    // set wrap, the counter period is wrap + 1
+    pwm_set_wrap(slice_num, timing.wrap);
     // set the duty cycle to 50%
-    pwm_set_chan_level(slice_num, channel_num, 32768);
+    pwm_set_chan_level(slice_num, channel_num, (timing.wrap + 1) / 2);
     // enable PWM
     pwm_set_enabled(slice_num, true);
+
+    printf("PWM %llu mHz (%ld ppm), div %u + %u/16, wrap %u\n", (unsigned long long) timing.frequency_mhz,
+           (long) timing.error_ppm,
+           timing.div16 >> 4, timing.div16 & 15, timing.wrap);
     
     while (true) {
         tight_loop_contents();
@@ -1,36 +1,64 @@
 #include <stdbool.h>
 #include "pico/stdlib.h"
-#include "pico/cyw43_arch.h"
 #include "pico/bootrom.h"
+#include "board.h"
+#include "shell.h"
+
+static shell_t shell;
 
 void print_welcome() {
     printf("\033[2J\033[H");
     printf("Welcome to Basic RPI Pico Serial Monitor!\n\n");
-    printf("Commands:\n");
-    printf("  on: Turn on the LED\n");
-    printf("  off: Turn off the LED\n");
-    printf("  clr: Clear the screen\n");
-    printf("  bsel: Reboot to BOOTSEL mode\n");
+    shell_print_help(&shell);
     printf("\n");
 }
 
+// turn on the LED
+static void cmd_on(int argc, char **argv) {
+    printf("LED ON\n");
+    board_led_put(1);
+}
+
+// turn off the LED
+static void cmd_off(int argc, char **argv) {
+    printf("LED OFF\n");
+    board_led_put(0);
+}
+
+// clear the screen
+static void cmd_clr(int argc, char **argv) {
+    print_welcome();
+}
+
+// reboot to BOOTSEL mode
+static void cmd_bsel(int argc, char **argv) {
+    printf("BOOTSEL\n");
+    reset_usb_boot(0, 0);
+}
+
+// invalid command
+static void cmd_invalid(int argc, char **argv) {
+    printf("INVALID\n");
+}
+
+static const shell_command_t commands[] = {
+    {"on", "Turn on the LED", cmd_on},
+    {"off", "Turn off the LED", cmd_off},
+    {"clr", "Clear the screen", cmd_clr},
+    {"bsel", "Reboot to BOOTSEL mode", cmd_bsel},
+};
+
 int main() {
     // initialize stdio
-    stdio_init_all();
+    board_init();
 
-    // initialize Wi-Fi
-    if (cyw43_arch_init()) {
-        printf("Wi-Fi init failed");
-        return -1;
-    }
+    // non-blocking shell on stdio, echoes what's typed
+    shell_init(&shell, commands, sizeof(commands) / sizeof(commands[0]), shell_stdio_getc);
+    shell.prompt = "> ";
+    shell.echo = true;
+    shell.unknown = cmd_invalid;
 
-    // FIX: clear buffer before reading input, 
-    // otherwise it will read EOF 
-    while(getchar() == EOF);
-    
     bool welcome = false;
-    // input buffer
-    char buff[20];
     while (true) {
         if (stdio_usb_connected()) {
             if (!welcome) {
@@ -38,37 +66,15 @@ int main() {
                 print_welcome();
             }
 
-            scanf("%s", buff);
-            printf("> %s\n", buff);
-
-            // if turn on the LED
-            if (strcmp(buff, "on") == 0) {
-                printf("LED ON\n");
-                cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
-
-            // if turn off the LED
-            } else if (strcmp(buff, "off") == 0) {
-                printf("LED OFF\n");
-                cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
-
-            // if clear the screen
-            } else if (strcmp(buff, "clr") == 0) {
-                print_welcome();
-
-            // if reboot to BOOTSEL mode
-            } else if (strcmp(buff, "bsel") == 0) {
-                printf("BOOTSEL\n");
-                reset_usb_boot(0, 0);
-
-            // if invalid command
-            } else {
-                printf("INVALID\n");
-            }
+            // returns right away when nothing was typed,
+            // the rest of the loop keeps running
+            shell_poll(&shell);
         } else {
+            welcome = false;
             printf("CONNECTING...\n");
             sleep_ms(1000);
         }
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,41 +1,44 @@
 #include "pico/stdlib.h"
-#include "pico/cyw43_arch.h"
+#include "board.h"
+#include "shell.h"
+
+// turn on the LED
+static void cmd_on(int argc, char **argv) {
+    printf("LED ON\n");
+    board_led_put(1);
+}
+
+// turn off the LED
+static void cmd_off(int argc, char **argv) {
+    printf("LED OFF\n");
+    board_led_put(0);
+}
+
+// invalid command
+static void cmd_invalid(int argc, char **argv) {
+    printf("Invalid command\n");
+}
+
+static const shell_command_t commands[] = {
+    {"on", "Turn on the LED", cmd_on},
+    {"off", "Turn off the LED", cmd_off},
+};
 
 int main() {
     // initialize stdio
-    stdio_init_all();
+    board_init();
 
-    // initialize Wi-Fi
-    if (cyw43_arch_init()) {
-        printf("Wi-Fi init failed");
-        return -1;
-    }
-
-    // FIX: clear buffer before reading input, 
-    // otherwise it will read EOF 
-    while(getchar() == EOF);
+    // non-blocking shell on stdio, lines can't overflow the buffer
+    shell_t shell;
+    shell_init(&shell, commands, sizeof(commands) / sizeof(commands[0]), shell_stdio_getc);
+    shell.prompt = "Turn led [on/off]: ";
+    shell.echo = true;
+    shell.unknown = cmd_invalid;
 
-    // input buffer
-    char buff[5];
     while (true) {
         if (stdio_usb_connected()) {
-            printf("Turn led [on/off]: ");
-            scanf("%s", buff);
-
-            // if turn on the LED
-            if (strcmp(buff, "on") == 0) {
-                printf("\nLED ON\n");
-                cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
-
-            // if turn off the LED
-            } else if (strcmp(buff, "off") == 0) {
-                printf("\nLED OFF\n");
-                cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
-
-            // if invalid command
-            } else {
-                printf("\nInvalid command\n");
-            }
+            // returns right away when nothing was typed
+            shell_poll(&shell);
         } else {
             printf("Waiting for USB connection...\n");
             sleep_ms(1000);
@@ -43,4 +46,4 @@ int main() {
     }
 
     return 0;
-}
\ No newline at end of file
+}
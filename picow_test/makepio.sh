@@ -0,0 +1 @@
+$PICO_SDK_PATH/tools/pioasm/build/pioasm -o c-sdk src/fifo_drain.pio src/fifo_drain.pio.h
\ No newline at end of file
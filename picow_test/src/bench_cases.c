@@ -0,0 +1,208 @@
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "board.h"
+#include "bench_cases.h"
+#include "bitslice.h"
+#include "fifo_drain.pio.h"
+#include "spsc.h"
+
+// 32 copies of a statement, spreads the loop and call overhead
+#define REPEAT_8(x) x x x x x x x x
+#define REPEAT_32(x) REPEAT_8(x) REPEAT_8(x) REPEAT_8(x) REPEAT_8(x)
+
+//
+// GPIO
+//
+
+static void gpio_setup(void) {
+    gpio_init(BENCH_GPIO_PIN);
+    gpio_set_dir(BENCH_GPIO_PIN, GPIO_OUT);
+}
+
+static uint32_t gpio_put_run(void) {
+    REPEAT_32(gpio_put(BENCH_GPIO_PIN, 1); gpio_put(BENCH_GPIO_PIN, 0);)
+    return 0;
+}
+
+static uint32_t gpio_put_masked_run(void) {
+    REPEAT_32(gpio_put_masked(1u << BENCH_GPIO_PIN, 1u << BENCH_GPIO_PIN); gpio_put_masked(1u << BENCH_GPIO_PIN, 0);)
+    return 0;
+}
+
+static uint32_t gpio_xor_mask_run(void) {
+    REPEAT_32(gpio_xor_mask(1u << BENCH_GPIO_PIN); gpio_xor_mask(1u << BENCH_GPIO_PIN);)
+    return 0;
+}
+
+// cyw43 is only brought up on first use, make sure that's not in a sample
+static void cyw43_gpio_put_setup(void) {
+    board_cyw43_require();
+}
+
+// the LED sits on the wireless chip, every write is an SPI transaction
+static uint32_t cyw43_gpio_put_run(void) {
+    cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
+    cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
+    return 0;
+}
+
+//
+// DMA
+//
+
+static int dma_channel = -1;
+static uint32_t dma_source;
+static uint32_t dma_dest;
+
+static void dma_setup(void) {
+    dma_channel = dma_claim_unused_channel(true);
+}
+
+static uint32_t dma_configure_run(void) {
+    dma_channel_config config = dma_channel_get_default_config(dma_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, false);
+
+    dma_channel_configure(
+        dma_channel, // channel
+        &config, // config
+        &dma_dest, // write address
+        &dma_source, // read address
+        1, // one word
+        false // don't start
+    );
+    return 0;
+}
+
+static void dma_teardown(void) {
+    dma_channel_unclaim(dma_channel);
+}
+
+//
+// PIO
+//
+
+static uint pio_offset;
+static int pio_sm = -1;
+
+static void pio_setup(void) {
+    pio_offset = pio_add_program(pio1, &fifo_drain_program);
+    pio_sm = pio_claim_unused_sm(pio1, true);
+
+    pio_sm_config config = fifo_drain_program_get_default_config(pio_offset);
+    // refill the OSR from the FIFO every 32 bits
+    sm_config_set_out_shift(&config, true, true, 32);
+    sm_config_set_fifo_join(&config, PIO_FIFO_JOIN_TX);
+    pio_sm_init(pio1, pio_sm, pio_offset, &config);
+    pio_sm_set_enabled(pio1, pio_sm, true);
+}
+
+// the drain takes a word per cycle, so the FIFO never fills
+static uint32_t pio_put_run(void) {
+    REPEAT_32(pio_sm_put(pio1, pio_sm, 0);)
+    return 0;
+}
+
+static void pio_teardown(void) {
+    pio_sm_set_enabled(pio1, pio_sm, false);
+    pio_sm_unclaim(pio1, pio_sm);
+    pio_remove_program(pio1, &fifo_drain_program, pio_offset);
+}
+
+//
+// IRQ entry
+//
+
+static uint irq_num;
+static volatile uint32_t irq_entry;
+static volatile bool irq_fired;
+
+static void irq_handler(void) {
+    irq_entry = bench_cycles();
+    irq_fired = true;
+}
+
+static void irq_setup(void) {
+    irq_num = user_irq_claim_unused(true);
+    irq_set_exclusive_handler(irq_num, irq_handler);
+    irq_set_enabled(irq_num, true);
+}
+
+// cycles from setting the interrupt pending to the first line of the handler
+static uint32_t irq_entry_run(void) {
+    irq_fired = false;
+    uint32_t start = bench_cycles();
+    irq_set_pending(irq_num);
+
+    while (!irq_fired) {
+    }
+
+    return bench_elapsed(start, irq_entry);
+}
+
+static void irq_teardown(void) {
+    irq_set_enabled(irq_num, false);
+    irq_remove_handler(irq_num, irq_handler);
+    user_irq_unclaim(irq_num);
+}
+
+//
+// lib/spsc
+//
+
+SPSC_BUFFER(ring_buffer, uint32_t, 64);
+static spsc_t ring;
+
+static void spsc_setup(void) {
+    spsc_init(&ring, ring_buffer, 64, sizeof(uint32_t));
+}
+
+static uint32_t spsc_run(void) {
+    uint32_t value = 0;
+    REPEAT_32(spsc_push(&ring, &value); spsc_pop(&ring, &value);)
+    return 0;
+}
+
+//
+// lib/bitslice
+//
+
+static uint32_t bitslice_in[32];
+static uint32_t bitslice_out[32];
+
+static void bitslice_setup(void) {
+    for (uint32_t i = 0; i < 32; i++) {
+        bitslice_in[i] = i * 0x9e3779b9u;
+    }
+}
+
+// 8 pins x 32 steps
+static uint32_t bitslice_transpose8_run(void) {
+    REPEAT_8(bitslice_transpose8(bitslice_in, 1, bitslice_out);)
+    return 0;
+}
+
+// 32 pins x 32 steps
+static uint32_t bitslice_transpose32_run(void) {
+    bitslice_transpose32(bitslice_in, 1, bitslice_out);
+    return 0;
+}
+
+const bench_case_t bench_cases[] = {
+    {"gpio_put", gpio_setup, gpio_put_run, NULL, 64, 0},
+    {"gpio_put_masked", gpio_setup, gpio_put_masked_run, NULL, 64, 0},
+    {"gpio_xor_mask", gpio_setup, gpio_xor_mask_run, NULL, 64, 0},
+    {"cyw43_arch_gpio_put", cyw43_gpio_put_setup, cyw43_gpio_put_run, NULL, 2, BENCH_IRQS},
+    {"dma_channel_configure", dma_setup, dma_configure_run, dma_teardown, 1, 0},
+    {"pio_sm_put", pio_setup, pio_put_run, pio_teardown, 32, 0},
+    {"irq_entry", irq_setup, irq_entry_run, irq_teardown, 1, BENCH_IRQS | BENCH_SELF_TIMED},
+    {"spsc_push_pop", spsc_setup, spsc_run, NULL, 32, 0},
+    {"bitslice_transpose8", bitslice_setup, bitslice_transpose8_run, NULL, 8, 0},
+    {"bitslice_transpose32", bitslice_setup, bitslice_transpose32_run, NULL, 1, 0},
+};
+
+const size_t bench_case_count = sizeof(bench_cases) / sizeof(bench_cases[0]);
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "bench.h"
+
+// GPIO the gpio_* cases toggle
+#define BENCH_GPIO_PIN 16
+
+extern const bench_case_t bench_cases[];
+extern const size_t bench_case_count;
@@ -0,0 +1,42 @@
+// -------------------------------------------------- //
+// This file is autogenerated by pioasm; do not edit! //
+// -------------------------------------------------- //
+
+#pragma once
+
+#if !PICO_NO_HARDWARE
+#include "hardware/pio.h"
+#endif
+
+// ---------- //
+// fifo_drain //
+// ---------- //
+
+#define fifo_drain_wrap_target 0
+#define fifo_drain_wrap 0
+#define fifo_drain_pio_version 0
+
+static const uint16_t fifo_drain_program_instructions[] = {
+            //     .wrap_target
+    0x6060, //  0: out    null, 32                   
+            //     .wrap
+};
+
+#if !PICO_NO_HARDWARE
+static const struct pio_program fifo_drain_program = {
+    .instructions = fifo_drain_program_instructions,
+    .length = 1,
+    .origin = -1,
+    .pio_version = 0,
+#if PICO_PIO_VERSION > 0
+    .used_gpio_ranges = 0x0
+#endif
+};
+
+static inline pio_sm_config fifo_drain_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + fifo_drain_wrap_target, offset + fifo_drain_wrap);
+    return c;
+}
+#endif
+
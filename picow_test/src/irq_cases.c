@@ -0,0 +1,405 @@
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#include "hardware/structs/iobank0.h"
+#include "hardware/structs/systick.h"
+#include "hardware/structs/xip_ctrl.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "bench.h"
+#include "irq_cases.h"
+
+// untimed interrupts before the samples, settle caches and branch targets
+#define IRQ_WARMUP 16
+// an interrupt that doesn't come by then counts as a timeout
+#define IRQ_TIMEOUT_US 1000
+// how long the other handler of IRQ_LOADED keeps the CPU
+#define IRQ_BUSY_CYCLES 2000
+// PWM period in CPU cycles, 16 us at 125 MHz
+#define IRQ_PWM_WRAP 1999
+// cycles before the wrap a PWM trigger waits out
+#define IRQ_PWM_MARGIN 64
+// alarm this far past the tick the trigger lines up with
+#define IRQ_ALARM_US 2
+
+// bench_cycles() without counting on the inliner, a RAM handler mustn't call into flash
+#define IRQ_CYCLES() ((uint32_t) -systick_hw->cvr)
+
+struct irq_source {
+    // the same handler from flash and from RAM
+    irq_handler_t flash;
+    irq_handler_t ram;
+    // claims what it needs, installs the handler, returns the IRQ number
+    uint (*setup)(irq_handler_t handler);
+    // raises the interrupt once, returns the cycle it's asserted at
+    uint32_t (*trigger)(void);
+    void (*teardown)(uint irq, irq_handler_t handler);
+};
+
+// stamps of the last interrupt, written by the handler
+static volatile uint32_t irq_entry;
+static volatile uint32_t irq_exit;
+static volatile bool irq_done;
+// assertion stamp of the last interrupt, from the trigger
+static volatile uint32_t irq_assert;
+
+// first and last thing a measured handler does, ack clears the interrupt
+#define IRQ_BODY(ack)                  \
+    uint32_t entry = IRQ_CYCLES();     \
+    ack;                               \
+    irq_entry = entry;                 \
+    irq_exit = IRQ_CYCLES();           \
+    irq_done = true;
+
+#define IRQ_HANDLERS(name, ack)                         \
+    static void name##_flash(void) {                    \
+        IRQ_BODY(ack)                                   \
+    }                                                   \
+    static void __not_in_flash_func(name##_ram)(void) { \
+        IRQ_BODY(ack)                                   \
+    }
+
+//
+// GPIO, an edge on an output pin, read back through its own pad
+//
+
+#define IRQ_GPIO_EDGE (GPIO_IRQ_EDGE_RISE << 4 * (IRQ_GPIO_PIN % 8))
+
+IRQ_HANDLERS(irq_gpio_handler, iobank0_hw->intr[IRQ_GPIO_PIN / 8] = IRQ_GPIO_EDGE)
+
+// what picow_timer's buttons went through, the SDK's dispatcher in front
+static void irq_gpio_callback(uint gpio, uint32_t events) {
+    IRQ_BODY((void) 0)
+}
+
+static void irq_gpio_init(void) {
+    gpio_init(IRQ_GPIO_PIN);
+    gpio_set_dir(IRQ_GPIO_PIN, GPIO_OUT);
+    gpio_put(IRQ_GPIO_PIN, 0);
+}
+
+static uint irq_gpio_setup(irq_handler_t handler) {
+    irq_gpio_init();
+    irq_set_exclusive_handler(IO_IRQ_BANK0, handler);
+    gpio_set_irq_enabled(IRQ_GPIO_PIN, GPIO_IRQ_EDGE_RISE, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+    return IO_IRQ_BANK0;
+}
+
+static uint irq_gpio_callback_setup(irq_handler_t handler) {
+    irq_gpio_init();
+    gpio_set_irq_enabled_with_callback(IRQ_GPIO_PIN, GPIO_IRQ_EDGE_RISE, true, irq_gpio_callback);
+    return IO_IRQ_BANK0;
+}
+
+static uint32_t __not_in_flash_func(irq_gpio_trigger)(void) {
+    gpio_put(IRQ_GPIO_PIN, 0);
+    // the input synchronizer has to see the low first
+    busy_wait_us_32(1);
+
+    uint32_t now = IRQ_CYCLES();
+    gpio_put(IRQ_GPIO_PIN, 1);
+    return now;
+}
+
+static void irq_gpio_teardown(uint irq, irq_handler_t handler) {
+    gpio_set_irq_enabled(IRQ_GPIO_PIN, GPIO_IRQ_EDGE_RISE, false);
+    irq_set_enabled(irq, false);
+    irq_remove_handler(irq, handler);
+}
+
+static void irq_gpio_callback_teardown(uint irq, irq_handler_t handler) {
+    gpio_set_irq_enabled(IRQ_GPIO_PIN, GPIO_IRQ_EDGE_RISE, false);
+    irq_set_enabled(irq, false);
+    // takes the SDK's dispatcher off the vector, so the raw cases can go back on
+    gpio_set_irq_callback(NULL);
+}
+
+static const irq_source_t irq_gpio = {
+    irq_gpio_handler_flash, irq_gpio_handler_ram, irq_gpio_setup, irq_gpio_trigger, irq_gpio_teardown,
+};
+
+static const irq_source_t irq_gpio_sdk = {
+    NULL, NULL, irq_gpio_callback_setup, irq_gpio_trigger, irq_gpio_callback_teardown,
+};
+
+//
+// PWM wrap, the counter runs at the CPU clock so the wrap is known to the cycle
+//
+
+static uint irq_pwm_slice;
+
+IRQ_HANDLERS(irq_pwm_handler, pwm_hw->intr = 1u << irq_pwm_slice; hw_clear_bits(&pwm_hw->inte, 1u << irq_pwm_slice))
+
+static uint irq_pwm_setup(irq_handler_t handler) {
+    irq_pwm_slice = pwm_gpio_to_slice_num(IRQ_PWM_PIN);
+
+    pwm_config config = pwm_get_default_config();
+    pwm_config_set_clkdiv_int(&config, 1);
+    pwm_config_set_wrap(&config, IRQ_PWM_WRAP);
+    pwm_init(irq_pwm_slice, &config, true);
+
+    irq_set_exclusive_handler(PWM_IRQ_WRAP, handler);
+    irq_set_enabled(PWM_IRQ_WRAP, true);
+    return PWM_IRQ_WRAP;
+}
+
+// arms the next wrap, one shot, the handler masks it again
+static uint32_t __not_in_flash_func(irq_pwm_trigger)(void) {
+    // stay clear of the wrap, the one after the counter read is the one measured
+    while (pwm_hw->slice[irq_pwm_slice].ctr > IRQ_PWM_WRAP - IRQ_PWM_MARGIN) {
+    }
+
+    uint32_t save = save_and_disable_interrupts();
+    pwm_hw->intr = 1u << irq_pwm_slice;
+    hw_set_bits(&pwm_hw->inte, 1u << irq_pwm_slice);
+    uint32_t now = IRQ_CYCLES();
+    uint32_t counter = pwm_hw->slice[irq_pwm_slice].ctr;
+    restore_interrupts(save);
+
+    return now + IRQ_PWM_WRAP - counter + 1;
+}
+
+static void irq_pwm_teardown(uint irq, irq_handler_t handler) {
+    hw_clear_bits(&pwm_hw->inte, 1u << irq_pwm_slice);
+    pwm_set_enabled(irq_pwm_slice, false);
+    irq_set_enabled(irq, false);
+    irq_remove_handler(irq, handler);
+}
+
+static const irq_source_t irq_pwm = {
+    irq_pwm_handler_flash, irq_pwm_handler_ram, irq_pwm_setup, irq_pwm_trigger, irq_pwm_teardown,
+};
+
+//
+// DMA completion, one word, so the stamp includes a few cycles of transfer
+//
+
+static int irq_dma_channel = -1;
+static uint32_t irq_dma_word;
+
+IRQ_HANDLERS(irq_dma_handler, dma_hw->ints0 = 1u << irq_dma_channel)
+
+static uint irq_dma_setup(irq_handler_t handler) {
+    irq_dma_channel = dma_claim_unused_channel(true);
+
+    dma_channel_config config = dma_channel_get_default_config(irq_dma_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, false);
+
+    dma_channel_configure(
+        irq_dma_channel, // channel
+        &config, // config
+        &irq_dma_word, // write address
+        &irq_dma_word, // read address
+        1, // one word
+        false // triggered by the case
+    );
+
+    dma_channel_set_irq0_enabled(irq_dma_channel, true);
+    irq_set_exclusive_handler(DMA_IRQ_0, handler);
+    irq_set_enabled(DMA_IRQ_0, true);
+    return DMA_IRQ_0;
+}
+
+static uint32_t __not_in_flash_func(irq_dma_trigger)(void) {
+    uint32_t now = IRQ_CYCLES();
+    // same count and addresses again
+    dma_hw->multi_channel_trigger = 1u << irq_dma_channel;
+    return now;
+}
+
+static void irq_dma_teardown(uint irq, irq_handler_t handler) {
+    dma_channel_set_irq0_enabled(irq_dma_channel, false);
+    irq_set_enabled(irq, false);
+    irq_remove_handler(irq, handler);
+    dma_channel_unclaim(irq_dma_channel);
+}
+
+static const irq_source_t irq_dma = {
+    irq_dma_handler_flash, irq_dma_handler_ram, irq_dma_setup, irq_dma_trigger, irq_dma_teardown,
+};
+
+//
+// timer alarm, what picow_timer samples its buttons from
+//
+
+static uint irq_alarm;
+static uint32_t irq_cycles_per_us;
+
+IRQ_HANDLERS(irq_alarm_handler, timer_hw->intr = 1u << irq_alarm)
+
+static uint irq_alarm_setup(irq_handler_t handler) {
+    irq_alarm = hardware_alarm_claim_unused(true);
+    // the timer ticks from the same crystal, 125 cycles a tick at 125 MHz
+    irq_cycles_per_us = clock_get_hz(clk_sys) / 1000000;
+
+    irq_set_exclusive_handler(TIMER_IRQ_0 + irq_alarm, handler);
+    hw_set_bits(&timer_hw->inte, 1u << irq_alarm);
+    irq_set_enabled(TIMER_IRQ_0 + irq_alarm, true);
+    return TIMER_IRQ_0 + irq_alarm;
+}
+
+static uint32_t __not_in_flash_func(irq_alarm_trigger)(void) {
+    uint32_t save = save_and_disable_interrupts();
+    uint32_t start = timer_hw->timerawl;
+    uint32_t tick;
+
+    // line up with a tick, the alarm fires on one, a few cycles late at most
+    while ((tick = timer_hw->timerawl) == start) {
+    }
+    uint32_t now = IRQ_CYCLES();
+    timer_hw->alarm[irq_alarm] = tick + IRQ_ALARM_US;
+    restore_interrupts(save);
+
+    return now + IRQ_ALARM_US * irq_cycles_per_us;
+}
+
+static void irq_alarm_teardown(uint irq, irq_handler_t handler) {
+    hw_clear_bits(&timer_hw->inte, 1u << irq_alarm);
+    irq_set_enabled(irq, false);
+    irq_remove_handler(irq, handler);
+    hardware_alarm_unclaim(irq_alarm);
+}
+
+static const irq_source_t irq_timer = {
+    irq_alarm_handler_flash, irq_alarm_handler_ram, irq_alarm_setup, irq_alarm_trigger, irq_alarm_teardown,
+};
+
+//
+// runner
+//
+
+static uint irq_busy;
+static const irq_source_t *irq_source;
+static irq_latency_t latency;
+
+// another handler at work: raises the measured interrupt, then keeps the CPU
+static void irq_busy_handler(void) {
+    irq_assert = irq_source->trigger();
+
+    uint32_t start = IRQ_CYCLES();
+    while (bench_elapsed(start, IRQ_CYCLES()) < IRQ_BUSY_CYCLES) {
+    }
+}
+
+// the next flash fetch goes out to the chip, so this one runs from RAM
+static void __not_in_flash_func(irq_xip_flush)(void) {
+    xip_ctrl_hw->flush = 1;
+    // reads stall until the flush is done
+    (void) xip_ctrl_hw->flush;
+}
+
+/**
+ * Raise one case's interrupt over and over, collecting the samples
+ *
+ * @param irq_case
+ * @param reps - samples, at most IRQ_LATENCY_REPS_MAX
+ *
+ * @return void
+ */
+static void irq_case_run(const irq_case_t *irq_case, uint32_t reps) {
+    const irq_source_t *source = irq_case->source;
+    uint32_t flags = irq_case->flags;
+    irq_handler_t handler = flags & IRQ_RAM ? source->ram : source->flash;
+    uint irq = source->setup(handler);
+
+    irq_set_priority(irq, flags & IRQ_HIGH ? PICO_HIGHEST_IRQ_PRIORITY : PICO_DEFAULT_IRQ_PRIORITY);
+    irq_source = source;
+    irq_latency_reset(&latency);
+
+    for (uint32_t i = 0; i < IRQ_WARMUP + reps; i++) {
+        irq_done = false;
+        if (flags & IRQ_COLD) irq_xip_flush();
+
+        if (flags & IRQ_LOADED) {
+            irq_set_pending(irq_busy);
+        } else {
+            irq_assert = source->trigger();
+        }
+
+        uint32_t start = time_us_32();
+        while (!irq_done && time_us_32() - start < IRQ_TIMEOUT_US) {
+        }
+
+        if (i < IRQ_WARMUP) continue;
+        if (!irq_done) {
+            latency.timeouts++;
+            continue;
+        }
+        irq_latency_add(&latency, bench_elapsed(irq_assert, irq_entry), bench_elapsed(irq_entry, irq_exit));
+    }
+
+    irq_set_priority(irq, PICO_DEFAULT_IRQ_PRIORITY);
+    source->teardown(irq, handler);
+}
+
+/**
+ * Run every case, printing the entry and handler result lines of each
+ *
+ * Cycles come from SysTick, bench_init() has to have started it.
+ *
+ * @param reps - samples per case
+ * @param clk_hz - CPU clock, printed so results can be turned into time
+ *
+ * @return void
+ */
+void irq_cases_run_all(uint32_t reps, uint32_t clk_hz) {
+    static irq_latency_result_t entry, handler;
+    char line[IRQ_LATENCY_LINE_MAX];
+
+    irq_busy = user_irq_claim_unused(true);
+    irq_set_exclusive_handler(irq_busy, irq_busy_handler);
+    irq_set_enabled(irq_busy, true);
+
+    printf("irq-begin clk=%lu\n", (unsigned long) clk_hz);
+
+    for (size_t i = 0; i < irq_case_count; i++) {
+        irq_case_run(&irq_cases[i], reps);
+        irq_latency_results(&latency, irq_cases[i].name, &entry, &handler);
+
+        irq_latency_format(line, sizeof(line), &entry);
+        printf("%s\n", line);
+        irq_latency_format(line, sizeof(line), &handler);
+        printf("%s\n", line);
+    }
+
+    printf("irq-end\n");
+
+    irq_set_enabled(irq_busy, false);
+    irq_remove_handler(irq_busy, irq_busy_handler);
+    user_irq_unclaim(irq_busy);
+}
+
+const irq_case_t irq_cases[] = {
+    {"gpio/flash", &irq_gpio, 0},
+    {"gpio/ram", &irq_gpio, IRQ_RAM},
+    {"gpio/flash-cold", &irq_gpio, IRQ_COLD},
+    {"gpio/ram-cold", &irq_gpio, IRQ_RAM | IRQ_COLD},
+    {"gpio/callback", &irq_gpio_sdk, 0},
+    {"gpio/callback-cold", &irq_gpio_sdk, IRQ_COLD},
+    {"gpio/loaded", &irq_gpio, IRQ_RAM | IRQ_LOADED},
+    {"gpio/loaded-high", &irq_gpio, IRQ_RAM | IRQ_LOADED | IRQ_HIGH},
+    {"pwm/flash", &irq_pwm, 0},
+    {"pwm/ram", &irq_pwm, IRQ_RAM},
+    {"pwm/flash-cold", &irq_pwm, IRQ_COLD},
+    {"pwm/ram-cold", &irq_pwm, IRQ_RAM | IRQ_COLD},
+    {"dma/flash", &irq_dma, 0},
+    {"dma/ram", &irq_dma, IRQ_RAM},
+    {"dma/flash-cold", &irq_dma, IRQ_COLD},
+    {"dma/ram-cold", &irq_dma, IRQ_RAM | IRQ_COLD},
+    {"dma/loaded", &irq_dma, IRQ_RAM | IRQ_LOADED},
+    {"dma/loaded-high", &irq_dma, IRQ_RAM | IRQ_LOADED | IRQ_HIGH},
+    {"alarm/flash", &irq_timer, 0},
+    {"alarm/ram", &irq_timer, IRQ_RAM},
+    {"alarm/flash-cold", &irq_timer, IRQ_COLD},
+    {"alarm/ram-cold", &irq_timer, IRQ_RAM | IRQ_COLD},
+    {"alarm/loaded", &irq_timer, IRQ_RAM | IRQ_LOADED},
+    {"alarm/loaded-high", &irq_timer, IRQ_RAM | IRQ_LOADED | IRQ_HIGH},
+};
+
+const size_t irq_case_count = sizeof(irq_cases) / sizeof(irq_cases[0]);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "irq_latency.h"
+
+// output with an edge interrupt on itself, the pad loops the level back
+#define IRQ_GPIO_PIN 17
+// its PWM slice counts and wraps, the pin stays a plain GPIO
+#define IRQ_PWM_PIN 18
+
+// case flags
+#define IRQ_RAM (1u << 0)     // handler in RAM (__not_in_flash_func), flash otherwise
+#define IRQ_COLD (1u << 1)    // flush the XIP cache before every interrupt
+#define IRQ_LOADED (1u << 2)  // raised from inside another handler that keeps running
+#define IRQ_HIGH (1u << 3)    // at PICO_HIGHEST_IRQ_PRIORITY, above that handler
+
+typedef struct irq_source irq_source_t;
+
+typedef struct {
+    const char *name;
+    const irq_source_t *source;
+    uint32_t flags;
+} irq_case_t;
+
+extern const irq_case_t irq_cases[];
+extern const size_t irq_case_count;
+
+void irq_cases_run_all(uint32_t reps, uint32_t clk_hz);
@@ -1,25 +1,44 @@
 #include <math.h>
 #include <stdlib.h>
 #include "pico/stdlib.h"
-#include "pico/cyw43_arch.h"
 #include "hardware/clocks.h"
+#include "board.h"
+#include "bench.h"
+#include "bench_cases.h"
+#include "irq_cases.h"
+#include "pwm_solver.h"
 
 #define LED_PIN 16
+// fewest duty cycle steps run_pwm() accepts
+#define PWM_MIN_LEVELS 4096
+
+// what main() runs
+#define RUN_BENCH 0
+#define RUN_PWM 1
+#define RUN_PIO 2
+#define RUN RUN_BENCH
+
+// untimed calls and samples per benchmark case
+#define BENCH_WARMUP 16
+#define BENCH_REPS 1000
+// rerun the benchmarks every 10 s, or right away on 'r' (see host/bench_runner, host/irq_report)
+#define BENCH_INTERVAL_US 10000000
 
 /**
  * Convert frequency to string
  * 
  * @param freq frequency in Hz
- * @return frequency in kHz, MHz or Hz
+ * @param str receives the text
+ * @param size size of str
+ * @return str, frequency in kHz, MHz or Hz
  */
-char* to_freq(u_int32_t freq) {
-    static char str[10];
-    if (freq >= 1000 && freq <= 1000000) {
-        snprintf(str, sizeof(str), "%ld kHz", freq / 1000);
+char* to_freq(u_int32_t freq, char *str, size_t size) {
+    if (freq >= 1000 && freq < 1000000) {
+        snprintf(str, size, "%ld kHz", freq / 1000);
     } else if (freq >= 1000000) {
-        snprintf(str, sizeof(str), "%ld MHz", freq / 1000000);
+        snprintf(str, size, "%ld MHz", freq / 1000000);
     } else {
-        snprintf(str, sizeof(str), "%ld Hz", freq);
+        snprintf(str, size, "%ld Hz", freq);
     }
 
     return str;
@@ -38,14 +57,18 @@ void run_pwm() {
     // set duty cycle
     u_int32_t duty = 50;
 
-    // calculate divider
-    u_int32_t div = ceil((float) sys_clk / (4096 * freq) / 16);
-    // calculate wrap
-    u_int32_t wrap = sys_clk / div / freq;
+    // find the divider and wrap closest to the target
+    pwm_timing_t timing;
+    if (!pwm_solve(sys_clk, PWM_HZ(freq), PWM_MIN_LEVELS, &timing)) {
+        printf("%ld Hz can't be reached with %d levels\n", freq, PWM_MIN_LEVELS);
+        return;
+    }
+
+    u_int32_t wrap = timing.wrap;
     // calculate period for high/low based on duty cycle
     u_int32_t period = wrap * duty / 100;
-    // calculate output frequency
-    u_int32_t out = sys_clk / div / wrap;
+    // achieved output frequency
+    u_int32_t out = (timing.frequency_mhz + 500) / 1000;
 
     // calculate ms per whole cycle
     u_int32_t ms = 1000 / freq;
@@ -54,7 +77,10 @@ void run_pwm() {
     // calculate ms for low period
     u_int32_t low = ms - hi;
 
-    printf("out: %s, div %ld, wrap: %ld\n", to_freq(out), div, wrap);
+    char str[16];
+    printf("out: %s (%llu mHz, %ld ppm), div %u + %u/16, wrap: %ld\n", to_freq(out, str, sizeof(str)),
+           (unsigned long long) timing.frequency_mhz, (long) timing.error_ppm, timing.div16 >> 4, timing.div16 & 15,
+           (long) wrap);
 
     while(1) {
         // pwm counter counts from 0 to wrap on every
@@ -88,8 +114,8 @@ void run_pio() {
     // target divider
     u_int32_t div = 62500;
 
-    // let's say our pio instructions has 1928 cycles
-    int cycles = 1928;
+    // 2052 cycles per period, picow_pio's fixed program before lib/clock_gen
+    int cycles = 2052;
     // calculate output frequency
     u_int32_t out = sys_clk / div;
     // calculate us per cycle
@@ -108,7 +134,8 @@ void run_pio() {
         
         // clear
         printf("\033[2J\033[1;1H");
-        printf("out: %s, div %ld, us: %ld\n", to_freq(out), div, us);
+        char str[16];
+        printf("out: %s, div %ld, us: %ld\n", to_freq(out, str, sizeof(str)), div, us);
         // total seconds
         float total = (end - start) / 1000000.0f;
         printf("Time taken: %0.3f seconds\n", total);
@@ -117,25 +144,50 @@ void run_pio() {
     }
 }
 
-int main() {
-    // initialize stdio
-    stdio_init_all();
+/**
+ * Run the benchmark cases and the interrupt latency cases over and over
+ *
+ * Results are machine-readable lines, see lib/bench and
+ * lib/irq_latency, compare runs with host/bench_runner and
+ * host/irq_report.
+ *
+ * @return void
+ */
+void run_bench() {
+    bench_t bench;
+    bench_init(&bench, BENCH_WARMUP, BENCH_REPS);
 
-    // initialize Wi-Fi
-    if (cyw43_arch_init()) {
-        printf("Wi-Fi init failed");
-        return -1;
+    while(1) {
+        bench_run_all(&bench, bench_cases, bench_case_count, clock_get_hz(clk_sys));
+        // SysTick is running from bench_init()
+        irq_cases_run_all(BENCH_REPS, clock_get_hz(clk_sys));
+
+        // wait for the runner to ask, or the next interval
+        absolute_time_t next = make_timeout_time_us(BENCH_INTERVAL_US);
+        while (!time_reached(next)) {
+            if (getchar_timeout_us(100000) == 'r') break;
+        }
     }
+}
+
+int main() {
+    // initialize stdio
+    board_init();
 
     sleep_ms(2000);
     // light up onboard LED
-    cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
+    board_led_put(1);
 
     gpio_init(LED_PIN);
     gpio_set_dir(LED_PIN, GPIO_OUT);
 
-    // run_pwm();
+#if RUN == RUN_PWM
+    run_pwm();
+#elif RUN == RUN_PIO
     run_pio();
+#else
+    run_bench();
+#endif
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "adc_dma.h"
+
+#define BLOCK_BYTES (ADC_FILTER_OVERSAMPLE * sizeof(uint16_t))
+#define BLOCK_RING_BITS 7
+
+_Static_assert(BLOCK_BYTES == 1u << BLOCK_RING_BITS, "the write ring must cover exactly one block");
+
+// aligned for the write ring, each channel owns one buffer
+static uint16_t blocks[2][ADC_FILTER_OVERSAMPLE] __attribute__((aligned(BLOCK_BYTES)));
+
+static int dma_chan[2];
+// completed blocks, and the buffer that completed last
+static volatile uint32_t blocks_done = 0;
+static volatile uint block_ready = 0;
+static uint32_t blocks_seen = 0;
+static uint32_t overruns = 0;
+
+/**
+ * DMA completion interrupt, runs on the core that called adc_dma_init()
+ *
+ * @return void
+ */
+static void dma_handler() {
+    for (uint i = 0; i < 2; i++) {
+        if (dma_channel_get_irq0_status(dma_chan[i])) {
+            dma_channel_acknowledge_irq0(dma_chan[i]);
+            block_ready = i;
+            blocks_done++;
+        }
+    }
+}
+
+/**
+ * Start the ADC and the DMA ping-pong
+ *
+ * @param uint gpio - ADC pin, 26-29
+ * @return void
+ */
+void adc_dma_init(uint gpio) {
+    adc_init();
+    adc_gpio_init(gpio);
+    adc_select_input(gpio - 26);
+
+    // FIFO on, DREQ on each sample, no error bit, keep 12 bits
+    adc_fifo_setup(true, true, 1, false, false);
+    // 48 MHz ADC clock, one conversion every (1 + div) cycles
+    adc_set_clkdiv(48000000.f / ADC_DMA_SAMPLE_RATE - 1);
+
+    dma_chan[0] = dma_claim_unused_channel(true);
+    dma_chan[1] = dma_claim_unused_channel(true);
+
+    for (uint i = 0; i < 2; i++) {
+        dma_channel_config config = dma_channel_get_default_config(dma_chan[i]);
+        channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+        channel_config_set_read_increment(&config, false);
+        channel_config_set_write_increment(&config, true);
+        // back to the start of its own buffer after every block
+        channel_config_set_ring(&config, true, BLOCK_RING_BITS);
+        channel_config_set_dreq(&config, DREQ_ADC);
+        // hand over to the other buffer
+        channel_config_set_chain_to(&config, dma_chan[i ^ 1]);
+
+        dma_channel_configure(
+            dma_chan[i], // channel
+            &config, // config
+            blocks[i], // write address
+            &adc_hw->fifo, // read address
+            ADC_FILTER_OVERSAMPLE, // one block
+            false // started below
+        );
+        dma_channel_set_irq0_enabled(dma_chan[i], true);
+    }
+
+    irq_set_exclusive_handler(DMA_IRQ_0, dma_handler);
+    irq_set_enabled(DMA_IRQ_0, true);
+
+    dma_channel_start(dma_chan[0]);
+    adc_run(true);
+}
+
+/**
+ * Sleep until the next block is complete
+ *
+ * Returns the newest block, blocks that completed while the caller
+ * was busy are counted as overruns. The caller has about a block
+ * time (1 ms) before the DMA comes back around to this buffer.
+ *
+ * @return const uint16_t * - ADC_FILTER_OVERSAMPLE samples
+ */
+const uint16_t *adc_dma_wait() {
+    while (blocks_done == blocks_seen) {
+        __wfe();
+    }
+
+    // read both together, the interrupt updates them as a pair
+    uint32_t status = save_and_disable_interrupts();
+    uint32_t done = blocks_done;
+    uint ready = block_ready;
+    restore_interrupts(status);
+
+    overruns += done - blocks_seen - 1;
+    blocks_seen = done;
+
+    return blocks[ready];
+}
+
+/**
+ * Get the number of blocks skipped because the caller was too slow
+ *
+ * @return uint32_t
+ */
+uint32_t adc_dma_get_overruns() {
+    return overruns;
+}
@@ -0,0 +1,21 @@
+/**
+ * @brief Free-running ADC acquisition into DMA ping-pong buffers
+ *
+ * The ADC converts continuously into its FIFO, two chained DMA
+ * channels copy blocks of ADC_FILTER_OVERSAMPLE samples into two
+ * buffers, each channel wrapping on its own buffer through a write
+ * ring, so the DMA never needs to be re-armed. The completion
+ * interrupt only marks which buffer is ready.
+ */
+
+#pragma once
+
+#include "pico/stdlib.h"
+#include "adc_filter.h"
+
+// ADC sample rate, one block of ADC_FILTER_OVERSAMPLE samples per ms
+#define ADC_DMA_SAMPLE_RATE 64000
+
+void adc_dma_init(uint gpio);
+const uint16_t *adc_dma_wait();
+uint32_t adc_dma_get_overruns();
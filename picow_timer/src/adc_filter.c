@@ -0,0 +1,93 @@
+#include "adc_filter.h"
+
+// 64 12-bit samples sum to 18 bits, shift back down to 16
+#define DECIMATE_SHIFT 2
+
+_Static_assert(ADC_FILTER_OVERSAMPLE == 64, "DECIMATE_SHIFT assumes 64x oversampling");
+_Static_assert(ADC_FILTER_MEDIAN & 1, "the median window must be odd");
+
+/**
+ * Initialize the filter, nothing is published until the window is full
+ *
+ * @param adc_filter_t *filter
+ * @param uint16_t threshold - smallest change that gets published, 16-bit scale
+ * @return void
+ */
+void adc_filter_init(adc_filter_t *filter, uint16_t threshold) {
+    filter->count = 0;
+    filter->pos = 0;
+    filter->threshold = threshold;
+    filter->published = 0;
+    filter->valid = false;
+}
+
+/**
+ * Sum a block of 12-bit samples into one 16-bit value
+ *
+ * @param const uint16_t *samples - ADC_FILTER_OVERSAMPLE samples
+ * @return uint16_t - 0 .. 65520
+ */
+uint16_t adc_filter_decimate(const uint16_t *samples) {
+    uint32_t sum = 0;
+
+    for (unsigned int i = 0; i < ADC_FILTER_OVERSAMPLE; i++) {
+        // bit 15 is the conversion error flag when enabled in the FIFO
+        sum += samples[i] & 0x0fff;
+    }
+
+    return sum >> DECIMATE_SHIFT;
+}
+
+/**
+ * Get the median of ADC_FILTER_MEDIAN values
+ *
+ * Insertion sort on a copy, 5 values is a handful of compares.
+ *
+ * @param const uint16_t *values
+ * @return uint16_t
+ */
+uint16_t adc_filter_median(const uint16_t *values) {
+    uint16_t sorted[ADC_FILTER_MEDIAN];
+
+    for (unsigned int i = 0; i < ADC_FILTER_MEDIAN; i++) {
+        uint16_t v = values[i];
+        unsigned int j = i;
+        while (j > 0 && sorted[j - 1] > v) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = v;
+    }
+
+    return sorted[ADC_FILTER_MEDIAN / 2];
+}
+
+/**
+ * Feed one block of samples
+ *
+ * @param adc_filter_t *filter
+ * @param const uint16_t *samples - ADC_FILTER_OVERSAMPLE samples
+ * @param uint16_t *value - receives the new value when published
+ * @return bool - true if a new value was published
+ */
+bool adc_filter_update(adc_filter_t *filter, const uint16_t *samples, uint16_t *value) {
+    filter->window[filter->pos] = adc_filter_decimate(samples);
+    filter->pos = (filter->pos + 1) % ADC_FILTER_MEDIAN;
+
+    if (filter->count < ADC_FILTER_MEDIAN) {
+        filter->count++;
+        if (filter->count < ADC_FILTER_MEDIAN) return false;
+    }
+
+    uint16_t median = adc_filter_median(filter->window);
+    uint16_t delta = median > filter->published ? median - filter->published : filter->published - median;
+
+    // hysteresis, noise around a resting knob never gets through
+    if (filter->valid && delta <= filter->threshold) return false;
+
+    filter->published = median;
+    filter->valid = true;
+    *value = median;
+
+    return true;
+}
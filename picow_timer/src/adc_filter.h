@@ -0,0 +1,35 @@
+/**
+ * @brief Fixed-point filter for the oversampled potentiometer
+ *
+ * Each block of ADC_FILTER_OVERSAMPLE 12-bit samples is summed and
+ * scaled to one 16-bit value (oversampling adds resolution and
+ * averages out the noise), the last ADC_FILTER_MEDIAN values go
+ * through a median to drop spikes, and a new value is only
+ * published once it moved more than the hysteresis threshold.
+ *
+ * Pure C, no SDK, so it builds on the host (host/adc_filter_check).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// samples per block, power of two
+#define ADC_FILTER_OVERSAMPLE 64
+// decimated values in the median window, odd
+#define ADC_FILTER_MEDIAN 5
+
+typedef struct {
+    uint16_t window[ADC_FILTER_MEDIAN];
+    unsigned int count;
+    unsigned int pos;
+    uint16_t threshold;
+    uint16_t published;
+    bool valid;
+} adc_filter_t;
+
+void adc_filter_init(adc_filter_t *filter, uint16_t threshold);
+uint16_t adc_filter_decimate(const uint16_t *samples);
+uint16_t adc_filter_median(const uint16_t *values);
+bool adc_filter_update(adc_filter_t *filter, const uint16_t *samples, uint16_t *value);
@@ -0,0 +1,79 @@
+#include <string.h>
+#include "debounce.h"
+
+/**
+ * Initialize the debouncer, pins start in the state they're in
+ *
+ * A button held at boot is pressed from the start, its release is the
+ * first event.
+ *
+ * @param debounce
+ * @param pins - mask of pins to debounce
+ * @param active_low - mask of pins that read 0 when pressed
+ * @param samples - samples a level has to hold, 1 to 255
+ * @param events - ring of debounce_event_t
+ * @param levels - current GPIO levels
+ *
+ * @return void
+ */
+void debounce_init(debounce_t *debounce, uint32_t pins, uint32_t active_low, uint8_t samples, spsc_t *events,
+                   uint32_t levels) {
+    memset(debounce, 0, sizeof(*debounce));
+    debounce->pins = pins;
+    debounce->active_low = active_low;
+    debounce->samples = samples ? samples : 1;
+    debounce->events = events;
+    debounce->state = (levels ^ active_low) & pins;
+}
+
+/**
+ * Integrate the pins that differ or are still moving, the slow path
+ * of debounce_sample()
+ *
+ * @param debounce
+ * @param now_us - time of the sample
+ * @param pressed - sampled state of the pins, 1 pressed
+ *
+ * @return uint32_t - number of events pushed
+ */
+uint32_t debounce_sample_moving(debounce_t *debounce, uint32_t now_us, uint32_t pressed) {
+    uint32_t differ = pressed ^ debounce->state;
+    uint32_t pins = differ | debounce->moving;
+    uint32_t pushed = 0;
+
+    while (pins) {
+        uint32_t pin = __builtin_ctz(pins);
+        uint32_t bit = 1u << pin;
+        pins &= pins - 1;
+
+        if (!(differ & bit)) {
+            // back at the debounced level, a glitch dies out at zero
+            if (!--debounce->count[pin]) debounce->moving &= ~bit;
+            continue;
+        }
+
+        if (!debounce->count[pin]++) {
+            debounce->start_us[pin] = now_us;
+            debounce->moving |= bit;
+        }
+        if (debounce->count[pin] < debounce->samples) continue;
+
+        // held long enough, the new level is real
+        debounce->state ^= bit;
+        debounce->count[pin] = 0;
+        debounce->moving &= ~bit;
+
+        debounce_event_t event = {
+            .time_us = debounce->start_us[pin],
+            .pin = pin,
+            .pressed = (debounce->state & bit) != 0,
+        };
+        if (spsc_push(debounce->events, &event)) {
+            pushed++;
+        } else {
+            debounce->dropped++;
+        }
+    }
+
+    return pushed;
+}
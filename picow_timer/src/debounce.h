@@ -0,0 +1,83 @@
+/**
+ * @brief Per-pin button debouncer with timestamped events
+ *
+ * Sampled at a fixed rate (a hardware alarm every DEBOUNCE_PERIOD_US)
+ * with all pin levels at once. Each pin has its own integrator:
+ *
+ * - a sample that differs from the debounced state counts up, one
+ *   that matches counts down, the state flips when the count reaches
+ *   `samples`, a glitch that dies out first is forgotten
+ * - every pin runs on its own, a press on one never masks another
+ * - the event is stamped with the sample the integrator last started
+ *   from zero at, inside the bounce, not when it got there
+ * - press and release events go into an spsc ring for the main loop,
+ *   a full ring counts drops instead of blocking the interrupt
+ *
+ * A level has to hold for `samples` periods net to count, so presses
+ * and releases shorter than that are filtered as bounce, anything
+ * longer always makes it through, in order.
+ *
+ * When no pin is moving a sample is an XOR, an AND and a compare.
+ *
+ * Pure C, no SDK, so it builds on the host (host/debounce_check).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "spsc.h"
+
+// picow_timer samples every ms, a level has to hold DEBOUNCE_SAMPLES of them
+#define DEBOUNCE_PERIOD_US 1000
+#define DEBOUNCE_SAMPLES 5
+#define DEBOUNCE_PINS 32
+
+typedef struct {
+    // sample the integrator started from, within the bounce
+    uint32_t time_us;
+    uint8_t pin;
+    // 1 pressed, 0 released
+    uint8_t pressed;
+} debounce_event_t;
+
+typedef struct {
+    // pins debounced
+    uint32_t pins;
+    // pins that read 0 when pressed (pull-up, button to ground)
+    uint32_t active_low;
+    // debounced state, 1 pressed
+    uint32_t state;
+    // pins whose integrator is off zero
+    uint32_t moving;
+    uint8_t samples;
+    // integrator, towards flipping the state
+    uint8_t count[DEBOUNCE_PINS];
+    // sample the current move started at
+    uint32_t start_us[DEBOUNCE_PINS];
+    // debounce_event_t ring, the sampling context pushes
+    spsc_t *events;
+    uint32_t dropped;
+} debounce_t;
+
+void debounce_init(debounce_t *debounce, uint32_t pins, uint32_t active_low, uint8_t samples, spsc_t *events,
+                   uint32_t levels);
+uint32_t debounce_sample_moving(debounce_t *debounce, uint32_t now_us, uint32_t pressed);
+
+/**
+ * Take one sample of every pin, call every period
+ *
+ * @param debounce
+ * @param now_us - time of the sample
+ * @param levels - GPIO levels, bit n is pin n (gpio_get_all())
+ *
+ * @return uint32_t - number of events pushed
+ */
+static inline uint32_t debounce_sample(debounce_t *debounce, uint32_t now_us, uint32_t levels) {
+    uint32_t pressed = (levels ^ debounce->active_low) & debounce->pins;
+
+    // settled and nothing new, the common case
+    if (pressed == debounce->state && !debounce->moving) return 0;
+
+    return debounce_sample_moving(debounce, now_us, pressed);
+}
@@ -1,13 +1,25 @@
 #include "pico/stdlib.h"
-#include "pico/cyw43_arch.h"
-#include "hardware/adc.h"
 #include "pico/multicore.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "board.h"
+#include <math.h>
+#include "adc_dma.h"
+#include "adc_filter.h"
+#include "clock_gen.h"
+#include "debounce.h"
+#include "spsc.h"
+#include "trace.h"
 
 // define modes
 #define ASTABLE   0
 #define MONOSTABLE 1
-// debounce delay in ms for button press
-#define DEBOUNCE_DELAY 200
+// the potentiometer sweeps 10^0 .. 10^FREQ_DECADES Hz, 1 Hz to 10 MHz
+#define FREQ_DECADES 7
+// smallest knob change that retunes, 16-bit scale (~0.2%)
+#define ADC_THRESHOLD 128
 
 // ADC0 pin for potentiometer
 const uint POTENTIOMETER_PIN = 26;
@@ -19,127 +31,190 @@ const uint STEP_PIN = 15;
 // GPIO pin for CLOCK output
 const uint CLOCK_PIN = 16;
 
-// define frequency in Hz
-volatile int frequency = 1;
 // define duty cycle in %
-volatile int duty_cycle = 50;
+int duty_cycle = 50;
 
-// volatile variables for interrupt handling
-volatile int mode = ASTABLE;
-volatile int pulse = true;
-volatile uint32_t last_interrupt_ms = 0;
+// frequencies in Hz from core 1 to core 0
+SPSC_BUFFER(knob_buffer, uint32_t, 8);
+spsc_t knob_ring;
+// press and release events from the sampling alarm to the main loop
+SPSC_BUFFER(button_buffer, debounce_event_t, 16);
+spsc_t button_ring;
+// each button debounced on its own, only touched by the alarm interrupt
+debounce_t buttons;
+
+// hardware alarm sampling the buttons, and the time of its next sample
+uint button_alarm;
+uint32_t button_next_us;
 
 /**
- * Interrupt handler for button press
- * 
- * @param gpio GPIO pin number
- * @param events GPIO event
+ * Alarm interrupt, samples the buttons every DEBOUNCE_PERIOD_US
+ *
+ * A raw hardware alarm instead of a repeating_timer, no alarm pool
+ * in between: acknowledge, re-arm, read all pins in one go. With no
+ * button moving debounce_sample() is done after a compare.
  *
  * @return void
  */
-void handle_button_interrupt(uint gpio, uint32_t events) {
-    // get current time in ms
-    uint32_t now = to_ms_since_boot(get_absolute_time());
-
-    // debounce button press
-    if ((now - last_interrupt_ms) < DEBOUNCE_DELAY) {
-        return;
+void handle_button_alarm() {
+    uint32_t now = button_next_us;
+
+    timer_hw->intr = 1u << button_alarm;
+    button_next_us += DEBOUNCE_PERIOD_US;
+    // a deadline already gone would only fire after the 32-bit wrap (~72 min)
+    if ((int32_t) (timer_hw->timerawl - button_next_us) >= 0) {
+        button_next_us = timer_hw->timerawl + DEBOUNCE_PERIOD_US;
     }
+    timer_hw->alarm[button_alarm] = button_next_us;
 
-    // MODE button pressed
-    if (gpio == MODE_PIN) {
-        // toggle mode
-        mode = mode == ASTABLE ? MONOSTABLE : ASTABLE;
-        // determine pulse
-        pulse = mode == MONOSTABLE ? false : true;
-    } else if (gpio == STEP_PIN && mode == MONOSTABLE) {
-        // STEP button pressed
-        pulse = true;
+    if (debounce_sample(&buttons, now, gpio_get_all())) {
+        // wake up core 0
+        __sev();
     }
+}
+
+/**
+ * Start sampling MODE_PIN and STEP_PIN
+ *
+ * @return void
+ */
+void buttons_init() {
+    uint32_t pins = (1u << MODE_PIN) | (1u << STEP_PIN);
+
+    // pulled up, pressed is low, whatever is held right now stays pressed
+    debounce_init(&buttons, pins, pins, DEBOUNCE_SAMPLES, &button_ring, gpio_get_all());
+
+    button_alarm = hardware_alarm_claim_unused(true);
+    irq_set_exclusive_handler(TIMER_IRQ_0 + button_alarm, handle_button_alarm);
+    hw_set_bits(&timer_hw->inte, 1u << button_alarm);
+    irq_set_enabled(TIMER_IRQ_0 + button_alarm, true);
 
-    // update last interrupt time
-    last_interrupt_ms = now;
+    button_next_us = timer_hw->timerawl + DEBOUNCE_PERIOD_US;
+    timer_hw->alarm[button_alarm] = button_next_us;
 }
 
 /**
  * Core 1 process for analog pin reading
  * 
+ * Sleeps until the DMA completed a block of samples (every ms),
+ * filters it and only wakes core 0 when the knob really moved.
+ * 
  * @return void
  */
 void start_adc() {
-    // initialize adc
-    adc_init();
-    // init adc GPIO
-    adc_gpio_init(POTENTIOMETER_PIN);
-    // set adc channel
-    adc_select_input(0);
+    adc_filter_t filter;
+    adc_filter_init(&filter, ADC_THRESHOLD);
+    uint32_t frequency = 0;
+
+    // the DMA interrupt is enabled on this core
+    adc_dma_init(POTENTIOMETER_PIN);
 
     while(true) {
-        // read adc value
-        uint16_t raw = adc_read();
-        // map the raw value to the range 1-1000
-        int converted = (raw * 999 / 4095) + 1;
-
-        if (converted <= 5) {
-            frequency = 1;
-        } else {
-            frequency = converted;
+        const uint16_t *samples = adc_dma_wait();
+        uint16_t value;
+
+        if (!adc_filter_update(&filter, samples, &value)) {
+            continue;
+        }
+
+        // map the filtered value to 1 Hz - 10 MHz on a log scale,
+        // the low end of the pot snaps to 1 Hz
+        uint32_t converted = (uint32_t) (powf(10.f, value * (float) FREQ_DECADES / 65535.f) + 0.5f);
+
+        if (value < 256) {
+            converted = 1;
         }
 
-        sleep_ms(1000);
+        // if core 0 is behind the ring is full, the knob
+        // will move again and push the newer value
+        if (converted != frequency && spsc_push(&knob_ring, &converted)) {
+            frequency = converted;
+            // wake up core 0 to retune
+            __sev();
+        }
     }
 }
 
 int main() {
     // initialize stdio
-    stdio_init_all();
+    board_init();
 
-    // initialize Wi-Fi
-    if (cyw43_arch_init()) {
-        printf("Wi-Fi init failed");
-        return -1;
-    }
+    // rings must be ready before the interrupt and core 1 start
+    trace_init();
+    spsc_init(&knob_ring, knob_buffer, 8, sizeof(uint32_t));
+    spsc_init(&button_ring, button_buffer, 16, sizeof(debounce_event_t));
 
     // init GPIOs
     gpio_init(MODE_PIN);
     gpio_init(STEP_PIN);
-    gpio_init(CLOCK_PIN);
 
     // set GPIO mode
     gpio_set_dir(MODE_PIN, GPIO_IN);
     gpio_set_dir(STEP_PIN, GPIO_IN);
-    gpio_set_dir(CLOCK_PIN, GPIO_OUT);
 
     // set GPIO pull-up
     gpio_pull_up(MODE_PIN);
     gpio_pull_up(STEP_PIN);
 
-    // set GPIO IRQ
-    gpio_set_irq_enabled_with_callback(MODE_PIN, GPIO_IRQ_EDGE_FALL, true, &handle_button_interrupt);
-    gpio_set_irq_enabled_with_callback(STEP_PIN, GPIO_IRQ_EDGE_FALL, true, &handle_button_interrupt);
+    // let the pull-ups settle, then sample the buttons from a hardware alarm
+    sleep_ms(1);
+    buttons_init();
+
+    // clock output from PIO (lib/clock_gen), exact timing without the CPU, 1 Hz 50% to start
+    clock_gen_init(pio0, CLOCK_PIN, 1, 50);
 
     // put analog pin reading on core 1
     multicore_launch_core1(start_adc);
 
+    uint32_t current_frequency = 0;
+    int current_mode = ASTABLE;
+    uint32_t buttons_dropped = 0;
+
     while(true) {
-        // calculate high/low time in ms
-        int sleep_in_ms = 1000 / frequency;
-        int high_time = sleep_in_ms * duty_cycle / 100;
-        int low_time = sleep_in_ms - high_time;
-
-       if (pulse) {
-            printf("Mode: %d, Freq: %dhz, Duty: %d, High: %d, Low: %d\n", mode, frequency, duty_cycle, high_time, low_time); 
-
-            gpio_put(CLOCK_PIN, 1);
-            sleep_ms(high_time);
-            gpio_put(CLOCK_PIN, 0);
-
-            // low time for astable mode only
-            if (mode == ASTABLE) {
-                sleep_ms(low_time);
-            } else {
-                pulse = false;
+        debounce_event_t event;
+        uint32_t frequency = current_frequency;
+
+        while (spsc_pop(&button_ring, &event)) {
+            // presses do something, releases are only logged
+            if (!event.pressed) {
+                TRACE("Release: %u at %lu us", event.pin, event.time_us);
+            } else if (event.pin == MODE_PIN) {
+                // switch the output program, pulses are only fired by STEP
+                current_mode = current_mode == ASTABLE ? MONOSTABLE : ASTABLE;
+                clock_gen_set_monostable(current_mode == MONOSTABLE);
+                TRACE("Mode: %d", current_mode);
+            } else if (current_mode == MONOSTABLE) {
+                clock_gen_pulse();
+                TRACE("Pulse, %lu us after the press", time_us_32() - event.time_us);
+            }
+        }
+
+        // only the alarm writes the counter, report what's new
+        if (buttons.dropped != buttons_dropped) {
+            buttons_dropped = buttons.dropped;
+            TRACE("Button events dropped: %lu", buttons_dropped);
+        }
+
+        // only the latest knob position matters
+        while (spsc_pop(&knob_ring, &frequency)) {
+        }
+
+        // retune, the generator switches on a period boundary
+        if (frequency != current_frequency) {
+            clock_timing_t timing;
+            current_frequency = frequency;
+
+            if (clock_gen_set(current_frequency, duty_cycle, &timing)) {
+                TRACE("Mode: %d, Freq: %luhz, Duty: %d, Error: %ld ppm",
+                      current_mode, current_frequency, duty_cycle, timing.error_ppm);
+                TRACE("Div: %u, High: %lu, Low: %lu", timing.clkdiv, timing.high, timing.low);
             }
-       }
+        }
+
+        // formatting happens on the host, see host/trace_decode
+        trace_flush(trace_stdio_write, NULL);
+
+        // sleep until a button or core 1 has something for us
+        __wfe();
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,60 @@
+/**
+ * @brief lwIP options for picow_udp
+ *
+ * NO_SYS, lwIP runs from cyw43_arch_poll() (or the background
+ * interrupt with pico_cyw43_arch_lwip_threadsafe_background).
+ * LWIP_SUPPORT_CUSTOM_PBUF is what lib/telemetry's zero-copy
+ * datagrams need, lwIP turns it off by default together with
+ * LWIP_NETIF_TX_SINGLE_PBUF.
+ */
+
+#pragma once
+
+#define NO_SYS 1
+#define LWIP_SOCKET 0
+#define LWIP_NETCONN 0
+
+#if PICO_CYW43_ARCH_POLL
+#define MEM_LIBC_MALLOC 1
+#else
+// malloc isn't safe from the background interrupt
+#define MEM_LIBC_MALLOC 0
+#endif
+#define MEM_ALIGNMENT 4
+#define MEM_SIZE 4000
+#define MEMP_NUM_ARP_QUEUE 10
+#define PBUF_POOL_SIZE 24
+
+#define LWIP_ARP 1
+#define LWIP_ETHERNET 1
+#define LWIP_ICMP 1
+#define LWIP_RAW 1
+#define LWIP_IPV4 1
+#define LWIP_UDP 1
+#define LWIP_TCP 1
+#define LWIP_DHCP 1
+#define LWIP_DNS 1
+#define DHCP_DOES_ARP_CHECK 0
+#define LWIP_DHCP_DOES_ACD_CHECK 0
+
+#define TCP_MSS 1460
+#define TCP_WND (8 * TCP_MSS)
+#define TCP_SND_BUF (8 * TCP_MSS)
+#define TCP_SND_QUEUELEN ((4 * (TCP_SND_BUF) + (TCP_MSS - 1)) / (TCP_MSS))
+#define MEMP_NUM_TCP_SEG 32
+
+#define LWIP_NETIF_STATUS_CALLBACK 1
+#define LWIP_NETIF_LINK_CALLBACK 1
+#define LWIP_NETIF_HOSTNAME 1
+#define LWIP_NETIF_TX_SINGLE_PBUF 1
+#define LWIP_CHKSUM_ALGORITHM 3
+
+// lib/telemetry sends its slots as custom pbufs
+#define LWIP_SUPPORT_CUSTOM_PBUF 1
+// DHCP, DNS, telemetry and the command port, plus room
+#define MEMP_NUM_UDP_PCB 6
+
+#define MEM_STATS 0
+#define SYS_STATS 0
+#define MEMP_STATS 0
+#define LINK_STATS 0
@@ -0,0 +1,269 @@
+/**
+ * @brief Stream telemetry over Wi-Fi instead of USB printf
+ *
+ * Every other example links pico_cyw43_arch_none, the radio is
+ * powered but unused. Here lwIP runs from the main loop and
+ * lib/telemetry batches three kinds of samples into UDP datagrams:
+ *
+ * - ADC 0 (GPIO 26) every ms, a record per ADC_BLOCK samples
+ * - the rising edges counted on PULSE_PIN, every COUNT_PERIOD_US
+ * - lib/trace records, the trace byte stream goes out as records too
+ *
+ * The datagrams are built in place in preallocated slots and handed to
+ * lwIP as custom pbufs, nothing is allocated per sample or datagram.
+ * One goes out every TELEMETRY_PERIOD_US (~50 per second) or when full.
+ *
+ * The board also takes lib/proto command frames on UDP port
+ * PROTO_UDP_PORT, the picow_proto commands without a USB cable:
+ *
+ * - LED, PWM level on a pin, toggle frequency of TIMER_PIN, BOOTSEL
+ * - ping and uptime, for round-trip measurements
+ * - the service time histogram of any command (PROTO_OP_HIST)
+ *
+ * Receive with host/telemetry_check -l 5005 on TELEMETRY_HOST, send
+ * commands with host/proto_cli -u <board address>.
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include <string.h>
+#include "pico/bootrom.h"
+#include "pico/cyw43_arch.h"
+#include "hardware/adc.h"
+#include "hardware/gpio.h"
+#include "hardware/pwm.h"
+#include "lwip/netif.h"
+#include "board.h"
+#include "proto_server.h"
+#include "telemetry.h"
+#include "trace.h"
+
+#define TELEMETRY_PORT 5005
+// GPIO 26 is ADC 0
+#define ADC_PIN 26
+#define ADC_CHANNEL 0
+// one sample per ms, one record per 100 samples
+#define ADC_PERIOD_US 1000
+#define ADC_BLOCK 100
+// rising edges are counted on this pin
+#define PULSE_PIN 15
+#define COUNT_PERIOD_US 100000
+#define WIFI_TIMEOUT_MS 30000
+// PROTO_OP_TIMER toggles this pin
+#define TIMER_PIN 14
+#define TIMER_MAX_HZ 10000
+// pins the host may drive, the rest belong to the board
+#define GPIO_MAX 22
+// PROTO_OP_PWM levels are 16 bits, ~1.9 kHz at 125 MHz
+#define PWM_WRAP 0xffff
+
+static volatile uint32_t pulses = 0;
+
+static proto_server_t server;
+// reboot once the response to PROTO_OP_BOOTSEL is out
+static bool bootsel_pending = false;
+// pins already switched to PWM
+static uint32_t pwm_ready = 0;
+static repeating_timer_t toggle_timer;
+static bool toggle_running = false;
+
+/**
+ * GPIO interrupt, counts rising edges on PULSE_PIN
+ *
+ * @param gpio
+ * @param events
+ *
+ * @return void
+ */
+static void pulse_callback(uint gpio, uint32_t events) {
+    pulses++;
+}
+
+// echo the data back
+static uint8_t op_ping(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    if (len > *reply_len) return PROTO_STATUS_NO_SPACE;
+
+    memcpy(reply, data, len);
+    *reply_len = len;
+    return PROTO_STATUS_OK;
+}
+
+// turn the LED on or off, a cyw43 GPIO, so it goes over the radio's bus
+static uint8_t op_led(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    *reply_len = 0;
+    if (len != 1) return PROTO_STATUS_BAD_LENGTH;
+
+    board_led_put(data[0] ? 1 : 0);
+    return PROTO_STATUS_OK;
+}
+
+// us since boot
+static uint8_t op_uptime(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    if (*reply_len < 8) return PROTO_STATUS_NO_SPACE;
+
+    uint64_t now = time_us_64();
+    for (uint i = 0; i < 8; i++) {
+        reply[i] = now >> (8 * i);
+    }
+    *reply_len = 8;
+    return PROTO_STATUS_OK;
+}
+
+// reboot to BOOTSEL mode, from the main loop
+static uint8_t op_bootsel(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    *reply_len = 0;
+    bootsel_pending = true;
+    return PROTO_STATUS_OK;
+}
+
+// PWM level on a pin, the slice is set up the first time
+static uint8_t op_pwm(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    *reply_len = 0;
+    if (len != 3) return PROTO_STATUS_BAD_LENGTH;
+
+    uint pin = data[0];
+    if (pin > GPIO_MAX || pin == PULSE_PIN || pin == TIMER_PIN) return PROTO_STATUS_BAD_ARGUMENT;
+
+    if (!(pwm_ready & (1u << pin))) {
+        uint slice = pwm_gpio_to_slice_num(pin);
+        pwm_set_wrap(slice, PWM_WRAP);
+        pwm_set_enabled(slice, true);
+        gpio_set_function(pin, GPIO_FUNC_PWM);
+        pwm_ready |= 1u << pin;
+    }
+
+    pwm_set_gpio_level(pin, data[1] | (data[2] << 8));
+    return PROTO_STATUS_OK;
+}
+
+// repeating timer callback, one edge per call
+static bool toggle_callback(repeating_timer_t *rt) {
+    gpio_xor_mask(1u << TIMER_PIN);
+    return true;
+}
+
+// toggle TIMER_PIN at a frequency, 0 stops it
+static uint8_t op_timer(const uint8_t *data, uint8_t len, uint8_t *reply, uint8_t *reply_len, void *user) {
+    *reply_len = 0;
+    if (len != 4) return PROTO_STATUS_BAD_LENGTH;
+
+    uint32_t hz = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t) data[3] << 24);
+    if (hz > TIMER_MAX_HZ) return PROTO_STATUS_BAD_ARGUMENT;
+
+    if (toggle_running) {
+        cancel_repeating_timer(&toggle_timer);
+        toggle_running = false;
+    }
+    if (!hz) return PROTO_STATUS_OK;
+
+    // negative, the period is from start to start, two edges per cycle
+    if (!add_repeating_timer_us(-(int64_t) (500000 / hz), toggle_callback, NULL, &toggle_timer)) {
+        return PROTO_STATUS_NO_SPACE;
+    }
+    toggle_running = true;
+    return PROTO_STATUS_OK;
+}
+
+static const proto_handler_t handlers[PROTO_OP_COUNT] = {
+    [PROTO_OP_PING] = op_ping,
+    [PROTO_OP_LED] = op_led,
+    [PROTO_OP_UPTIME] = op_uptime,
+    [PROTO_OP_BOOTSEL] = op_bootsel,
+    [PROTO_OP_PWM] = op_pwm,
+    [PROTO_OP_TIMER] = op_timer,
+    [PROTO_OP_HIST] = proto_server_hist_op,
+};
+
+int main() {
+    // initialize stdio
+    board_init();
+    trace_init();
+
+    // cyw43 and lwIP come up together with pico_cyw43_arch_lwip_poll
+    if (!board_cyw43_require()) {
+        printf("cyw43 init failed\n");
+        return 1;
+    }
+    board_mark("cyw43");
+
+    cyw43_arch_enable_sta_mode();
+    printf("connecting to %s\n", WIFI_SSID);
+    if (cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK, WIFI_TIMEOUT_MS)) {
+        printf("wifi connect failed\n");
+        return 1;
+    }
+    board_mark("wifi");
+
+    if (!telemetry_udp_init(TELEMETRY_HOST, TELEMETRY_PORT, TELEMETRY_PERIOD_US)) {
+        printf("bad telemetry host %s\n", TELEMETRY_HOST);
+        return 1;
+    }
+    printf("streaming to %s:%u\n", TELEMETRY_HOST, TELEMETRY_PORT);
+
+    if (!proto_udp_init(&server, handlers, PROTO_OP_COUNT, PROTO_UDP_PORT)) {
+        printf("command port %u unavailable\n", PROTO_UDP_PORT);
+        return 1;
+    }
+    printf("commands on %s:%u\n", ip4addr_ntoa(netif_ip4_addr(netif_list)), PROTO_UDP_PORT);
+
+    adc_init();
+    adc_gpio_init(ADC_PIN);
+    adc_select_input(ADC_CHANNEL);
+
+    gpio_init(PULSE_PIN);
+    gpio_pull_down(PULSE_PIN);
+    gpio_set_irq_enabled_with_callback(PULSE_PIN, GPIO_IRQ_EDGE_RISE, true, &pulse_callback);
+
+    gpio_init(TIMER_PIN);
+    gpio_set_dir(TIMER_PIN, GPIO_OUT);
+
+    board_led_put(1);
+    board_report();
+
+    uint16_t samples[ADC_BLOCK];
+    uint32_t sample_count = 0;
+    uint32_t next_sample = time_us_32();
+    uint32_t next_count = next_sample;
+
+    while (true) {
+        // lwIP and the cyw43 driver run here, a no-op in threadsafe_background mode,
+        // command datagrams are answered from in here too
+        cyw43_arch_poll();
+
+        if (bootsel_pending) {
+            // keep polling a bit, the response has to leave first
+            uint32_t until = time_us_32() + 100000;
+            while ((int32_t) (time_us_32() - until) < 0) {
+                cyw43_arch_poll();
+            }
+            reset_usb_boot(0, 0);
+        }
+
+        uint32_t now = time_us_32();
+
+        if ((int32_t) (now - next_sample) >= 0) {
+            next_sample += ADC_PERIOD_US;
+            samples[sample_count++] = adc_read();
+
+            if (sample_count == ADC_BLOCK) {
+                telemetry_adc(ADC_CHANNEL, samples, sample_count);
+                sample_count = 0;
+            }
+        }
+
+        if ((int32_t) (now - next_count) >= 0) {
+            next_count += COUNT_PERIOD_US;
+            telemetry_count(0, pulses);
+
+            telemetry_stats_t stats;
+            telemetry_get_stats(&stats);
+            TRACE("datagrams %lu, dropped %lu, in flight max %lu", stats.datagrams, stats.dropped, stats.busy_max);
+        }
+
+        // trace records become telemetry records, then the datagram goes out when due
+        trace_flush(telemetry_trace_write, NULL);
+        telemetry_poll(now);
+    }
+
+    return 0;
+}